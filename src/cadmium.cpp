@@ -42,8 +42,11 @@ extern "C" {
 #include <chiplet/chip8decompiler.hpp>
 #include <emulation/chip8cores.hpp>
 #include <emulation/chip8dream.hpp>
+#include <emulation/framemetrics.hpp>
+#include <emulation/lockstep.hpp>
 #include <emulation/time.hpp>
 #include <emulation/timecontrol.hpp>
+#include <emulation/tracefile.hpp>
 #include <chiplet/utility.hpp>
 #include <ghc/cli.hpp>
 #include <chip8emuhostex.hpp>
@@ -63,6 +66,7 @@ extern "C" {
 #include <iomanip>
 #include <memory>
 #include <regex>
+#include <sstream>
 #include <thread>
 #include <mutex>
 #include <new>
@@ -587,6 +591,13 @@ public:
         updateEmulatorOptions(_options);
         whenEmuChanged(*_chipEmu);
         _debugger.updateCore(_chipEmu.get());
+        _debugger.setReverseHandler([this](Debugger::ReverseTarget target, uint32_t value, bool backend) {
+            _debugger.captureStates();
+            if(target == Debugger::eMEMORY_WRITE)
+                reverseToMemoryWrite(value, backend);
+            else
+                reverseToRegisterWrite(value, backend);
+        });
         _screen = GenImageColor(emu::Chip8EmulatorBase::MAX_SCREEN_WIDTH, emu::Chip8EmulatorBase::MAX_SCREEN_HEIGHT, BLACK);
         _screenTexture = LoadTextureFromImage(_screen);
         _crt = GenImageColor(256,512,BLACK);
@@ -743,6 +754,8 @@ public:
         if(_chipEmu) {
             if(_chipEmu->getExecMode() == emu::GenericCpu::eRUNNING) {
                 auto len = _audioBuffer.read(samples, frames);
+                if(len < frames)
+                    ++_audioUnderruns;
                 if(!len) {
                     while(frames--) {
                         *samples++ = 0;
@@ -767,7 +780,10 @@ public:
         static int16_t sampleBuffer[44100];
         if(_chipEmu->getExecMode() == emu::IChip8Emulator::eRUNNING) {
             //if(_audioBuffer.dataAvailable() < _audioCallbackAvgFrames) ++frames;
-            if(frames > _audioBuffer.spaceAvailable()) frames = _audioBuffer.spaceAvailable();
+            if(frames > _audioBuffer.spaceAvailable()) {
+                ++_audioOverruns;
+                frames = _audioBuffer.spaceAvailable();
+            }
             _chipEmu->renderAudio(sampleBuffer, frames, 44100);
             _audioBuffer.write(sampleBuffer, frames);
         }
@@ -775,12 +791,15 @@ public:
 
     void vblank() override
     {
-        if(_chipEmu)
+        // reverse searches replay silently, recorded input keeps its sound
+        if(_chipEmu && (!isReplayingInput() || _inputMode != eINPUT_LIVE))
             pushAudio(44100 / _options.frameRate);
     }
 
     int getKeyPressed() override
     {
+        if(isReplayingInput())
+            return replayKeyPressed();
         static uint32_t instruction = 0;
         static int waitKeyUp = 0;
         static int keyId = 0;
@@ -812,15 +831,31 @@ public:
 
     bool isKeyDown(uint8_t key) override
     {
+        if(isReplayingInput())
+            return replayKeyDown(key);
         _keyScanTime[key & 0xF] = GetTime();
         return !gui::IsSysKeyDown() && IsKeyDown(_keyMapping[key & 0xF]);
     }
 
     const std::array<bool, 16>& getKeyStates() const override
     {
+        if(isReplayingInput())
+            return replayKeyStates();
         return _keyMatrix;
     }
 
+    uint16_t currentKeyMask() const override
+    {
+        uint16_t mask = 0;
+        if(!gui::IsSysKeyDown()) {
+            for(int i = 0; i < 16; ++i) {
+                if(_keyMatrix[i])
+                    mask |= 1 << i;
+            }
+        }
+        return mask;
+    }
+
     void updateKeyboardOverlay()
     {
         static const char* keys = "1\0" "2\0" "3\0" "C\0" "4\0" "5\0" "6\0" "D\0" "7\0" "8\0" "9\0" "E\0" "A\0" "0\0" "B\0" "F\0";
@@ -974,6 +1009,7 @@ public:
 
     void updateScreen() override
     {
+        auto convertStart = std::chrono::steady_clock::now();
         auto* pixel = (uint32_t*)_screen.data;
         if(pixel) {
             const auto* screen = _chipEmu->getScreen();
@@ -992,6 +1028,7 @@ public:
                 UpdateTexture(_screenTexture, _screen.data);
             }
         }
+        _convertTime_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - convertStart).count();
     }
 
     static void updateAndDrawFrame(void* self)
@@ -1052,6 +1089,10 @@ public:
             if (files.count > 0) {
                 //TraceLog(LOG_INFO, "About to load one of %d dropped files.", (int)files.count);
                 loadRom(files.paths[0], LoadOptions::None);
+                if(isPlayingInput()) {
+                    _chipEmu->setExecMode(ExecMode::eRUNNING);
+                    _mainView = eVIDEO;
+                }
             }
             UnloadDroppedFiles(files);
         }
@@ -1062,6 +1103,7 @@ public:
                 _romImage.assign(_editor.compiler().code(), _editor.compiler().code() + _editor.compiler().codeSize());
                 _romSha1Hex = _editor.compiler().sha1().to_hex();
                 _debugger.updateOctoBreakpoints(_editor.compiler());
+                cancelInputMode();
                 reloadRom();
             }
         }
@@ -1070,6 +1112,11 @@ public:
             _keyMatrix[key] = IsKeyDown(_keyMapping[key & 0xF]);
         }
 
+        auto emulationStart = std::chrono::steady_clock::now();
+        auto cyclesBefore = _chipEmu->getCycles();
+        _convertTime_us = 0;
+        // Backspace rewinds, held while running it steps back one frame per frame, while paused once per key press
+        bool rewinding = (_mainView == eVIDEO || _mainView == eDEBUGGER) && IsKeyDown(KEY_BACKSPACE);
         if(_chipEmu->getExecMode() != ExecMode::ePAUSED) {
             _partialFrameTime += GetFrameTime()*1000 * _chipEmu->frameRate();
             if(_partialFrameTime > 10000) {
@@ -1079,8 +1126,18 @@ public:
             if(_partialFrameTime >= 1000) {
                 while (_partialFrameTime >= 1000) {
                     _partialFrameTime -= 1000;
+                    if(rewinding) {
+                        rewindFrame();
+                        continue;
+                    }
                     for(int i = 0; i < getFrameBoost(); ++i) {
+                        if(!nextFrameInput()) {
+                            TraceLog(LOG_INFO, "Input playback finished, end state %s the recording", _inputRecording.matchesEnd(*_chipEmu) ? "matches" : "differs from");
+                            _chipEmu->setExecMode(ExecMode::ePAUSED);
+                            break;
+                        }
                         _chipEmu->tick(getInstrPerFrame());
+                        captureRewindFrame();
                         if(_chipEmu->isBreakpointTriggered())
                             _mainView = eDEBUGGER;
                     }
@@ -1092,7 +1149,11 @@ public:
             if(_showKeyMap)
                 updateKeyboardOverlay();
         }
+        else if(rewinding && IsKeyPressed(KEY_BACKSPACE) && rewindFrame()) {
+            _debugger.captureStates();
+        }
 
+        auto drawStart = std::chrono::steady_clock::now();
         BeginTextureMode(_renderTexture);
         drawGui();
         EndTextureMode();
@@ -1131,9 +1192,62 @@ public:
             // DrawText(TextFormat("Res: %dx%d", GetMonitorWidth(GetCurrentMonitor()), GetMonitorHeight(GetCurrentMonitor())), 10, 30, 10, GREEN);
             // DrawFPS(10,45);
         }
+        if(_chipEmu->getExecMode() == ExecMode::eRUNNING) {
+            // draw time ends before EndDrawing(), that one mostly waits for the buffer swap
+            auto drawEnd = std::chrono::steady_clock::now();
+            emu::FrameMetrics::Sample sample;
+            sample.frame = _chipEmu->frames();
+            sample.frameTime = uint32_t(deltaTC * 1000000);
+            sample.convertTime = _convertTime_us;
+            auto emulationTime = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(drawStart - emulationStart).count());
+            sample.emulationTime = emulationTime > _convertTime_us ? emulationTime - _convertTime_us : 0;
+            sample.drawTime = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(drawEnd - drawStart).count());
+            sample.instructions = _chipEmu->getCycles() - cyclesBefore;
+            sample.audioFill = uint32_t(_audioBuffer.dataAvailable());
+            sample.audioUnderruns = _audioUnderruns.exchange(0);
+            sample.audioOverruns = _audioOverruns.exchange(0);
+            _frameMetrics.add(sample);
+        }
         EndDrawing();
     }
 
+    void drawFrameMetrics()
+    {
+        if(!_frameMetrics.size())
+            return;
+        const auto& last = _frameMetrics.last();
+        uint64_t frameTime = 0, emulationTime = 0, convertTime = 0, drawTime = 0, instructions = 0;
+        uint32_t underruns = 0, overruns = 0;
+        auto count = std::min(_frameMetrics.size(), size_t(60));
+        for(size_t i = _frameMetrics.size() - count; i < _frameMetrics.size(); ++i) {
+            const auto& sample = _frameMetrics[i];
+            frameTime += sample.frameTime;
+            emulationTime += sample.emulationTime;
+            convertTime += sample.convertTime;
+            drawTime += sample.drawTime;
+            instructions += sample.instructions;
+            underruns += sample.audioUnderruns;
+            overruns += sample.audioOverruns;
+        }
+        Rectangle bounds{_screenWidth - 196.0f, 22.0f, 192.0f, 76.0f};
+        DrawRectangleRec(bounds, {0, 0, 0, 160});
+        auto col = StyleManager::getStyleColor(Style::TEXT_COLOR_FOCUSED);
+        DrawTextEx(_font, TextFormat("frame %5.2fms  emu %5.2fms", frameTime / 1000.0 / count, emulationTime / 1000.0 / count), {bounds.x + 4, bounds.y + 3}, 8, 0, col);
+        DrawTextEx(_font, TextFormat("conv  %5.2fms  gui %5.2fms", convertTime / 1000.0 / count, drawTime / 1000.0 / count), {bounds.x + 4, bounds.y + 13}, 8, 0, col);
+        DrawTextEx(_font, TextFormat("%s  %d ipf", formatUnit(emulationTime ? double(instructions) * 1000000 / emulationTime : 0.0, "IPS").c_str(), int(instructions / count)), {bounds.x + 4, bounds.y + 23}, 8, 0, col);
+        DrawTextEx(_font, TextFormat("audio %4u  under %u  over %u", last.audioFill, underruns, overruns), {bounds.x + 4, bounds.y + 33}, 8, 0, underruns || overruns ? RED : col);
+        // frame time histogram in 1ms buckets, the last one collects everything slower
+        const auto& histogram = _frameMetrics.histogram();
+        auto maxBucket = *std::max_element(histogram.begin(), histogram.end());
+        auto barWidth = (bounds.width - 8) / emu::FrameMetrics::HISTOGRAM_BUCKETS;
+        for(int i = 0; i < emu::FrameMetrics::HISTOGRAM_BUCKETS; ++i) {
+            if(!histogram[i])
+                continue;
+            auto height = std::max(1.0f, 28.0f * histogram[i] / maxBucket);
+            DrawRectangleRec({bounds.x + 4 + i * barWidth, bounds.y + bounds.height - 4 - height, barWidth - 1, height}, i < 17 ? col : RED);
+        }
+    }
+
 
     void drawScreen(Rectangle dest, int gridScale)
     {
@@ -1302,9 +1416,9 @@ public:
                     menuOpen = true;
                 if(menuOpen || (IsSysKeyDown() && (IsKeyDown(KEY_N) || IsKeyDown(KEY_O) ||IsKeyDown(KEY_S) || IsKeyDown(KEY_K) || IsKeyDown(KEY_Q)))) {
 #ifndef PLATFORM_WEB
-                    Rectangle menuRect = {1, GetCurrentPos().y + 20, 110, 84};
+                    Rectangle menuRect = {1, GetCurrentPos().y + 20, 110, 120};
 #else
-                    Rectangle menuRect = {1, GetCurrentPos().y + 20, 110, 69};
+                    Rectangle menuRect = {1, GetCurrentPos().y + 20, 110, 81};
 #endif
                     BeginPopup(menuRect, &menuOpen);
                     SetRowHeight(12);
@@ -1340,7 +1454,31 @@ public:
                         _showKeyMap = !_showKeyMap;
                         menuOpen = false;
                     }
+                    if(LabelButton(_showFrameMetrics ? " Hide Metrics" : " Frame Metrics")) {
+                        _showFrameMetrics = !_showFrameMetrics;
+                        menuOpen = false;
+                    }
 #ifndef PLATFORM_WEB
+                    if(LabelButton(isRecordingInput() ? " Stop Recording" : " Record Input")) {
+                        if(isRecordingInput()) {
+                            stopInputRecording();
+                            auto file = (fs::path(_currentDirectory) / fs::path(_romName).filename()).replace_extension(".c8rec").string();
+                            if(!_inputRecording.save(file))
+                                TraceLog(LOG_ERROR, "Could not write input recording '%s'", file.c_str());
+                        }
+                        else if(startInputRecording()) {
+                            _chipEmu->setExecMode(ExecMode::eRUNNING);
+                            _mainView = eVIDEO;
+                        }
+                        menuOpen = false;
+                    }
+                    if(LabelButton(" Save Metrics CSV")) {
+                        auto file = (fs::path(_currentDirectory) / fs::path(_romName).filename()).replace_extension(".metrics.csv").string();
+                        std::ofstream out(file);
+                        if(!_frameMetrics.writeCSV(out))
+                            TraceLog(LOG_ERROR, "Could not write frame metrics '%s'", file.c_str());
+                        menuOpen = false;
+                    }
                     Space(3);
                     if(LabelButton(" Quit    [^Q]") || (IsSysKeyDown() && IsKeyPressed(KEY_Q)))
                         menuOpen = false, _shouldClose = true;
@@ -1403,6 +1541,7 @@ public:
                 TextBox(_romName, 4095);
 
                 bool chip8Control = _debugger.isControllingChip8();
+                bool reverseKey = IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
                 Color controlBack = {3, 127, 161};
                 Color controlColor = Color{0x51, 0xbf, 0xd3, 0xff}; //chip8Control ? Color{0x51, 0xbf, 0xd3, 0xff} : Color{0x51, 0xff, 0xbf, 0xff};
                 if (iconButton(ICON_PLAYER_PAUSE, _chipEmu->getExecMode() == ExecMode::ePAUSED/*, controlBack, controlColor*/) || ((IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) && IsKeyPressed(KEY_F5))) {
@@ -1412,7 +1551,7 @@ public:
                     }
                 }
                 SetTooltip("PAUSE [Shift+F5]");
-                if (iconButton(ICON_PLAYER_PLAY, _chipEmu->getExecMode() == ExecMode::eRUNNING/*, controlBack, controlColor*/) || (!IsKeyDown(KEY_LEFT_SHIFT) && !IsKeyDown(KEY_RIGHT_SHIFT) && IsKeyPressed(KEY_F5))) {
+                if (iconButton(ICON_PLAYER_PLAY, _chipEmu->getExecMode() == ExecMode::eRUNNING/*, controlBack, controlColor*/) || (!reverseKey && !IsKeyDown(KEY_LEFT_SHIFT) && !IsKeyDown(KEY_RIGHT_SHIFT) && IsKeyPressed(KEY_F5))) {
                     _debugger.setExecMode(ExecMode::eRUNNING);
                     if(_mainView == eEDITOR || _mainView == eSETTINGS) {
                         _mainView = _lastRunView;
@@ -1429,7 +1568,7 @@ public:
                 }
                 GuiEnable();
                 SetTooltip("STEP OVER [F8]");
-                if (iconButton(ICON_STEP_INTO, _chipEmu->getExecMode() == ExecMode::eSTEP/*, controlBack, controlColor*/) || (!IsKeyDown(KEY_LEFT_SHIFT) && !IsKeyDown(KEY_RIGHT_SHIFT) && IsKeyPressed(KEY_F7))) {
+                if (iconButton(ICON_STEP_INTO, _chipEmu->getExecMode() == ExecMode::eSTEP/*, controlBack, controlColor*/) || (!reverseKey && !IsKeyDown(KEY_LEFT_SHIFT) && !IsKeyDown(KEY_RIGHT_SHIFT) && IsKeyPressed(KEY_F7))) {
                     _debugger.setExecMode(ExecMode::eSTEP);
                     if(_mainView == eEDITOR || _mainView == eSETTINGS) {
                         _mainView = eDEBUGGER;
@@ -1446,6 +1585,14 @@ public:
                 }
                 GuiEnable();
                 SetTooltip("STEP OUT [Shift+F7]");
+                if(reverseKey && (IsKeyPressed(KEY_F5) || IsKeyPressed(KEY_F7))) {
+                    _debugger.captureStates();
+                    if(IsKeyPressed(KEY_F5) ? reverseContinue(!chip8Control) : reverseStep(!chip8Control)) {
+                        if(_mainView == eEDITOR || _mainView == eSETTINGS) {
+                            _mainView = eDEBUGGER;
+                        }
+                    }
+                }
                 if (iconButton(ICON_RESTART)) {
                     reloadRom();
                     resetStats();
@@ -1671,6 +1818,8 @@ public:
                     }
                 }
             }
+            if(_showFrameMetrics && (_mainView == eVIDEO || _mainView == eDEBUGGER))
+                drawFrameMetrics();
             EndGui();
         }
         static auto lastExecMode = _chipEmu->getExecMode();
@@ -2349,6 +2498,7 @@ public:
     void whenEmuChanged(emu::IChip8Emulator& emu) override
     {
         _debugger.updateCore(&emu);
+        _logView.setDisassembler(&emu);
         _editor.updateCompilerOptions(_options.startAddress);
         reloadRom();
         updateBehaviorSelects();
@@ -2381,18 +2531,13 @@ public:
             _mainView = eEDITOR;
     }
 
-    void reloadRom()
+    void reloadRom() override
     {
         if(!_romImage.empty()) {
-            unsigned int size = 0;
-            _chipEmu->reset();
+            Chip8EmuHostEx::reloadRom();
             _audioBuffer.reset();
             updateScreen();
             _instructionOffset = -1;
-            if(Librarian::isPrefixedTPDRom(_romImage.data(), _romImage.size()))
-                std::memcpy(_chipEmu->memory() + 512, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - 512)));
-            else
-                std::memcpy(_chipEmu->memory() + _options.startAddress, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - _options.startAddress)));
         }
         _debugger.captureStates();
     }
@@ -2435,6 +2580,11 @@ private:
     SMA<120,uint32_t> _frameTimeAverage_us;
     SMA<120,int> _frameDelta;
     emu::FpsMeasure _fps;
+    emu::FrameMetrics _frameMetrics;
+    bool _showFrameMetrics{false};
+    uint32_t _convertTime_us{0};
+    std::atomic_uint32_t _audioUnderruns{0};
+    std::atomic_uint32_t _audioOverruns{0};
     int _partialFrameTime{0};
 #ifndef RESIZABLE_GUI
     bool _scaleBy2{false};
@@ -2484,6 +2634,105 @@ std::string dumOctoStateLine(octo_emulator* octo)
     octo->v[8], octo->v[9], octo->v[10], octo->v[11], octo->v[12], octo->v[13], octo->v[14], octo->v[15],
     octo->i, octo->rp, octo->pc, (octo->ram[octo->pc]<<8)|octo->ram[octo->pc+1]);
 }
+
+//---------------------------------------------------------------------------------------
+// Wraps the C-Octo emulator into an IChip8Emulator so it can take part in lockstep
+// comparisons. Registers, memory and timers are read directly from the octo state,
+// the screen is converted on request into the layout the generic cores use.
+//---------------------------------------------------------------------------------------
+class OctoEmulatorAdapter : public emu::Chip8EmulatorBase
+{
+public:
+    OctoEmulatorAdapter(emu::Chip8EmulatorHost& host, emu::Chip8EmulatorOptions& options)
+        : emu::Chip8EmulatorBase(host, options, nullptr)
+    {
+        OctoEmulatorAdapter::reset();
+    }
+    std::string name() const override { return "C-Octo"; }
+    void reset() override
+    {
+        Chip8EmulatorBase::reset();
+        octo_options oopt{};
+        oopt.q_shift = _options.optJustShiftVx;
+        oopt.q_loadstore = _options.optLoadStoreDontIncI;
+        oopt.q_jump0 = _options.optJump0Bxnn;
+        oopt.q_logic = !_options.optDontResetVf;
+        oopt.q_clip = !_options.optWrapSprites;
+        char noRom = 0;
+        octo_emulator_init(&_octo, &noRom, 0, &oopt, nullptr);
+    }
+    void executeInstruction() override
+    {
+        if(_execMode == ePAUSED)
+            return;
+        octo_emulator_instruction(&_octo);
+        ++_cycleCounter;
+        if(_octo.halt)
+            _execMode = ePAUSED;
+    }
+    void executeInstructions(int numInstructions) override
+    {
+        for(int i = 0; i < numInstructions; ++i)
+            executeInstruction();
+    }
+    void handleTimer() override
+    {
+        if(_execMode != ePAUSED) {
+            ++_frameCounter;
+            if(_octo.dt)
+                --_octo.dt;
+            if(_octo.st)
+                --_octo.st;
+        }
+    }
+    std::string dumpStateLine() const override { return dumOctoStateLine(const_cast<octo_emulator*>(&_octo)); }
+    uint8_t getV(uint8_t index) const override { return _octo.v[index & 15]; }
+    uint32_t getPC() const override { return _octo.pc; }
+    uint32_t getI() const override { return _octo.i; }
+    uint32_t getSP() const override { return _octo.rp; }
+    const uint16_t* getStackElements() const override { return _octo.ret; }
+    uint8_t delayTimer() const override { return _octo.dt; }
+    uint8_t soundTimer() const override { return _octo.st; }
+    uint8_t* memory() override { return _octo.ram; }
+    uint8_t getMemoryByte(uint32_t addr) const override { return _octo.ram[addr & 0xffff]; }
+    const VideoType* getScreen() const override
+    {
+        auto width = getCurrentScreenWidth();
+        auto height = getCurrentScreenHeight();
+        for(int y = 0; y < height; ++y) {
+            for(int x = 0; x < width; ++x) {
+                // lores pixels are doubled when hires is supported, like the generic cores do
+                auto pixel = (!_options.optAllowHires || _octo.hires) ? _octo.px[y * width + x] : _octo.px[(y >> 1) * 64 + (x >> 1)];
+                _octoScreen.setPixel(x, y, pixel);
+            }
+        }
+        return &_octoScreen;
+    }
+    bool saveState(std::vector<uint8_t>& state) const override
+    {
+        state.resize(sizeof(octo_emulator) + 2 * sizeof(int64_t));
+        std::memcpy(state.data(), &_octo, sizeof(octo_emulator));
+        int64_t counters[2] = {_cycleCounter, _frameCounter};
+        std::memcpy(state.data() + sizeof(octo_emulator), counters, sizeof(counters));
+        return true;
+    }
+    bool loadState(const uint8_t* data, size_t size) override
+    {
+        if(size != sizeof(octo_emulator) + 2 * sizeof(int64_t))
+            return false;
+        std::memcpy(&_octo, data, sizeof(octo_emulator));
+        int64_t counters[2];
+        std::memcpy(counters, data + sizeof(octo_emulator), sizeof(counters));
+        _cycleCounter = counters[0];
+        _frameCounter = int(counters[1]);
+        _execMode = _octo.halt ? ePAUSED : eRUNNING;
+        return true;
+    }
+
+private:
+    octo_emulator _octo{};
+    mutable VideoType _octoScreen;
+};
 #endif
 
 std::string chip8EmuScreen(emu::IChip8Emulator& chip8)
@@ -2541,20 +2790,6 @@ std::string chip8EmuScreenANSI(emu::IChip8Emulator& chip8)
     return result;
 }
 
-#ifndef PLATFORM_WEB
-std::string octoScreen(octo_emulator& octo)
-{
-    std::string result;
-    result.reserve(65*32+1);
-    for(int y = 0; y < 32; ++y) {
-        for(int x = 0; x < 64; ++x) {
-            result.push_back(octo.px[y*64 + x] ? '#' : ' ');
-        }
-        result.push_back('\n');
-    }
-    return result;
-}
-#endif
 
 #ifdef PLATFORM_WEBx
 extern "C" {
@@ -2571,21 +2806,9 @@ EMSCRIPTEN_KEEPALIVE int load_file(uint8_t *buffer, size_t size) {
 }
 #endif
 
-std::string formatOpcodeString(emu::OpcodeType type, uint16_t opcode)
-{
-    static std::string patterns[] = {"FFFF", "FFFn", "FFnn", "Fnnn", "FxyF", "FxFF", "Fxyn", "Fxnn", "FFyF"};
-    //                              0xFFFF, 0xFFF0, 0xFF00, 0xF000, 0xF00F, 0xF0FF, 0xF000, 0xF000, 0xFF0F
-    auto opStr = fmt::format("{:04X}", opcode);
-    for(size_t i = 0; i <4; ++i) {
-        if(std::islower((uint8_t)patterns[type][i]))
-            opStr[i] = patterns[type][i];
-    }
-    return opStr;
-}
-
 std::string formatOpcode(emu::OpcodeType type, uint16_t opcode)
 {
-    auto opStr = formatOpcodeString(type, opcode);
+    auto opStr = emu::Chip8OpcodeDisassembler::opcodePattern(type, opcode);
     auto dst = opStr;
     std::transform(dst.begin(), dst.end(), dst.begin(), [](unsigned char c){ return std::tolower(c); });
     return fmt::format("<a href=\"https://chip8.gulrak.net/reference/opcodes/{}\">{}</a>", dst, opStr);
@@ -2673,7 +2896,7 @@ void dumpOpcodeJSON(std::ostream& os, emu::Chip8Variant variants = (emu::Chip8Va
     for(const auto& info : emu::detail::opcodes) {
         if(uint64_t(info.variants & variants) != 0) {
             auto obj = ordered_json::object({});
-            obj["opcode"] = formatOpcodeString(info.type, info.opcode);
+            obj["opcode"] = emu::Chip8OpcodeDisassembler::opcodePattern(info.type, info.opcode);
             obj["mask"] = emu::detail::opcodeMasks[info.type];
             obj["size"] = info.size;
             obj["octo"] = info.octo;
@@ -2783,6 +3006,10 @@ int main(int argc, char* argv[])
     ghc::CLI cli(argc, argv);
     int64_t traceLines = -1;
     bool compareRun = false;
+    bool compareInstructions = false;
+    int64_t compareFrames = 3600;
+    std::string compareEngines = "fp,octo";
+    std::string compareReport;
     int64_t benchmark= 0;
     bool showHelp = false;
     bool opcodeTable = false;
@@ -2791,6 +3018,13 @@ int main(int argc, char* argv[])
     bool startRom = false;
     bool screenDump = false;
     bool drawDump = false;
+    bool rewind = false;
+    bool vipHle = false;
+    std::string replayFile;
+    std::string traceFile;
+    std::string opcodeProfile;
+    std::string heatmapFile;
+    std::string metricsFile;
     std::string dumpInterpreter;
     emu::Chip8EmulatorOptions options;
     int64_t execSpeed = -1;
@@ -2802,7 +3036,12 @@ int main(int argc, char* argv[])
     cli.category("General Options");
     cli.option({"-h", "--help"}, showHelp, "Show this help text");
     cli.option({"-t", "--trace"}, traceLines, "Run headless and dump given number of trace lines");
-    cli.option({"-c", "--compare"}, compareRun, "Run and compare with reference engine, trace until diff");
+    cli.option({"--trace-file"}, traceFile, "When in trace mode, stream compressed binary trace records into the given file instead of text to stdout (see c8trace tool)");
+    cli.option({"-c", "--compare"}, compareRun, "Run the ROM on multiple engines in lockstep and report the first instruction where they diverge");
+    cli.option({"--compare-engines"}, compareEngines, "Comma separated engines to compare (ts, fp, strict, vip, dream or octo), default: fp,octo");
+    cli.option({"--compare-frames"}, compareFrames, "Maximum number of frames to compare, default: 3600");
+    cli.option({"--compare-instructions"}, compareInstructions, "Compare after every instruction instead of every frame, implied when real cores are compared");
+    cli.option({"--compare-report"}, compareReport, "Write the compare result with the structured state difference as JSON into the given file");
     cli.option({"-r", "--run"}, startRom, "if a ROM is given (positional) start it");
     cli.option({"-b", "--benchmark"}, benchmark, "Run given number of cycles as benchmark");
     cli.option({"-p", "--preset"}, presetName, "Select CHIP-8 preset to use: chip-8, chip-10, chip-48, schip1.0, schip1.1, megachip8, xo-chip of vip-chip-8", [&](){
@@ -2820,12 +3059,18 @@ int main(int argc, char* argv[])
     cli.option({"-s", "--exec-speed"}, execSpeed, "Set execution speed in instructions per frame (0-500000, 0: unlimited)");
     cli.option({"--random-gen"}, randomGen, "Select a predictable random generator used for trace log mode (rand-lgc or counting)");
     cli.option({"--random-seed"}, randomSeed, "Select a random seed for use in combination with --random-gen, default: 12345");
+    cli.option({"--replay"}, replayFile, "Run headless, replay the given input recording (`.c8rec`) on the ROM and verify the end state");
     cli.option({"--screen-dump"}, screenDump, "When in trace mode, dump the final screen content to the console");
     cli.option({"--draw-dump"}, drawDump, "Dump screen after every draw when in trace mode.");
+    cli.option({"--heatmap"}, heatmapFile, "When in benchmark or trace mode, count executions, reads and writes per address and write them as JSON into the given file");
+    cli.option({"--rewind"}, rewind, "When in benchmark mode, capture a rewind snapshot every frame and report its cost");
+    cli.option({"--vip-hle"}, vipHle, "When running headless on the VIP core with the standard interpreter, execute CHIP-8 instructions natively with VIP timing (faster batch runs)");
     cli.option({"--test-suite-menu"}, testSuiteMenuVal, "Sets 0x1ff to the given value before starting emulation in trace mode, useful for test suite runs.");
     cli.option({"--trace-log"}, options.optTraceLog, "If true, enable trace logging into log-view");
     //cli.option({"--opcode-table"}, opcodeTable, "Dump an opcode table to stdout");
+    cli.option({"--metrics-csv"}, metricsFile, "When in benchmark or replay mode, write per frame timing metrics as CSV into the given file");
     cli.option({"--opcode-json"}, opcodeJSON, "Dump opcode information as JSON to stdout");
+    cli.option({"--opcode-profile"}, opcodeProfile, "When in benchmark or trace mode, count executed opcodes and write the profile as JSON into the given file");
 #ifndef NDEBUG
     cli.option({"--dump-interpreter"}, dumpInterpreter, "Dump the given interpreter in a local file named '<interpreter>.ram' and exit");
     cli.option({"--dump-library-nickel"}, dumpLibNickel, "Dump library table for Nickel");
@@ -2898,7 +3143,15 @@ int main(int argc, char* argv[])
     if(execSpeed >= 0) {
         options.instructionsPerFrame = execSpeed;
     }
-    if(traceLines < 0 && !compareRun && !benchmark) {
+    if(!traceFile.empty() && traceLines < 0) {
+        std::cerr << "ERROR: a trace file can only be written in trace mode (--trace)" << std::endl;
+        exit(1);
+    }
+    if(!replayFile.empty() && romFile.empty()) {
+        std::cerr << "ERROR: replaying an input recording needs the ROM/source file it was recorded with" << std::endl;
+        exit(1);
+    }
+    if(traceLines < 0 && !compareRun && !benchmark && replayFile.empty()) {
 #else
     ghc::CLI cli(argc, argv);
     std::string presetName = "schipc";
@@ -3001,52 +3254,155 @@ int main(int argc, char* argv[])
             });
             options.updatedAdvanced();
         }
+        if(vipHle) {
+            options.advanced["hle"] = true;
+            options.updatedAdvanced();
+        }
+        if(!traceFile.empty()) {
+            options.optTraceLog = true;
+        }
         host.updateEmulatorOptions(options);
         auto& chip8 = host.chipEmu();
+        if(!opcodeProfile.empty())
+            chip8.setOpcodeProfiling(true);
+        if(!heatmapFile.empty())
+            chip8.setMemoryHeatmap(true);
         std::clog << "Engine1: " << chip8.name() << ", active variant: " << emu::Chip8EmulatorOptions::nameOfPreset(options.behaviorBase) << std::endl;
-        octo_emulator octo;
-        octo_options oopt{};
-        oopt.q_clip = 1;
-        //oopt.q_loadstore = 1;
-
         chip8.reset();
+        std::vector<uint8_t> romImage;
         if(!romFile.empty()) {
             int size = 0;
             uint8_t* data = LoadFileData(romFile.front().c_str(), &size);
             if (size < chip8.memSize() - 512) {
                 std::memcpy(chip8.memory() + 512, data, size);
+                romImage.assign(data, data + size);
             }
             UnloadFileData(data);
             //chip8.loadRom(romFile.c_str());
         }
-        octo_emulator_init(&octo, (char*)chip8.memory() + 512, 4096 - 512, &oopt, nullptr);
         int64_t i = 0;
-        if(compareRun) {
-            std::clog << "Engine2: C-Octo" << std::endl;
-            do {
-                if ((i & 7) == 0) {
-                    chip8.handleTimer();
-                    if (octo.dt)
-                        --octo.dt;
-                    if (octo.st)
-                        --octo.st;
+        std::ofstream metricsOut;
+        if(!metricsFile.empty()) {
+            metricsOut.open(metricsFile);
+            if(!metricsOut) {
+                std::cerr << "ERROR: could not create metrics file '" << metricsFile << "'" << std::endl;
+                exit(1);
+            }
+            emu::FrameMetrics::writeCSVHeader(metricsOut);
+        }
+        // headless frames have no conversion or drawing, so only emulation time and throughput are recorded
+        auto tickWithMetrics = [&](int instructionsPerFrame) {
+            // a replay loads its ROM through the host, so the core is looked up every time
+            auto& core = host.chipEmu();
+            if(!metricsOut.is_open()) {
+                core.tick(instructionsPerFrame);
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+            auto cyclesBefore = core.getCycles();
+            core.tick(instructionsPerFrame);
+            emu::FrameMetrics::Sample sample;
+            sample.frame = core.frames();
+            sample.emulationTime = sample.frameTime = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+            sample.instructions = core.getCycles() - cyclesBefore;
+            emu::FrameMetrics::writeCSVLine(metricsOut, sample);
+        };
+        if(!replayFile.empty()) {
+            emu::InputRecording recording;
+            if(!recording.load(replayFile)) {
+                std::cerr << "ERROR: could not load input recording '" << replayFile << "'" << std::endl;
+                exit(1);
+            }
+            if(!host.loadRom(romFile.front().c_str(), emu::Chip8HeadlessHost::LoadOptions::DontChangeOptions) || !host.startInputPlayback(recording)) {
+                std::cerr << "ERROR: input recording '" << replayFile << "' doesn't belong to the given ROM" << std::endl;
+                exit(1);
+            }
+            auto startReplay = std::chrono::steady_clock::now();
+            while(host.nextFrameInput()) {
+                tickWithMetrics(host.options().instructionsPerFrame);
+            }
+            auto durationReplay = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startReplay);
+            auto& emu = host.chipEmu();
+            if(screenDump) {
+                std::cout << chip8EmuScreenANSI(emu);
+            }
+            bool matches = recording.matchesEnd(emu);
+            std::cout << "Replayed frames: " << recording.frames() << ", executed instructions: " << emu.getCycles() << ", " << durationReplay.count() << "us" << std::endl;
+            std::cout << "End state " << (matches ? "matches" : "DIFFERS from") << " the recording" << std::endl;
+            return matches ? 0 : 1;
+        }
+        else if(compareRun) {
+            emu::LockstepRunner::Options lockstepOptions;
+            lockstepOptions.instructionsPerFrame = options.instructionsPerFrame ? options.instructionsPerFrame : 15;
+            lockstepOptions.memoryStart = options.startAddress;
+            lockstepOptions.granularity = compareInstructions ? emu::LockstepRunner::eINSTRUCTION : emu::LockstepRunner::eFRAME;
+            std::vector<std::unique_ptr<emu::IChip8Emulator>> engines;
+            std::vector<std::string> engineNames;
+            std::istringstream engineList(compareEngines);
+            std::string engineName;
+            while(std::getline(engineList, engineName, ',')) {
+                std::unique_ptr<emu::IChip8Emulator> engine;
+                if(engineName == "octo")
+                    engine = std::make_unique<OctoEmulatorAdapter>(host, options);
+                else if(engineName == "ts")
+                    engine = emu::Chip8EmuHostEx::createEngine(host, emu::IChip8Emulator::eCHIP8TS, options);
+                else if(engineName == "fp")
+                    engine = emu::Chip8EmuHostEx::createEngine(host, emu::IChip8Emulator::eCHIP8MPT, options);
+                else if(engineName == "strict")
+                    engine = emu::Chip8EmuHostEx::createEngine(host, emu::IChip8Emulator::eCHIP8STRICT, options);
+                else if(engineName == "vip")
+                    engine = emu::Chip8EmuHostEx::createEngine(host, emu::IChip8Emulator::eCHIP8VIP, options);
+                else if(engineName == "dream")
+                    engine = emu::Chip8EmuHostEx::createEngine(host, emu::IChip8Emulator::eCHIP8DREAM, options);
+                else {
+                    std::cerr << "ERROR: unknown compare engine '" << engineName << "', use ts, fp, strict, vip, dream or octo" << std::endl;
+                    exit(1);
                 }
-                chip8.executeInstruction();
-                octo_emulator_instruction(&octo);
-                if (!(i % 500000)) {
-                    std::clog << i << ": " << chip8.dumpStateLine() << std::endl;
-                    std::clog << i << "| " << dumOctoStateLine(&octo) << std::endl;
+                engine->reset();
+                if(romImage.size() < size_t(engine->memSize() - options.startAddress))
+                    std::memcpy(engine->memory() + options.startAddress, romImage.data(), romImage.size());
+                // real cores run their own timers in machine cycles, so only per instruction state is comparable
+                if(!engine->isGenericEmulation()) {
+                    lockstepOptions.granularity = emu::LockstepRunner::eINSTRUCTION;
+                    lockstepOptions.compareTimers = false;
                 }
-                if(!(i % 500000)) {
-                    std::cout << chip8EmuScreen(chip8);
+                std::clog << "Engine" << (engines.size() + 1) << ": " << engine->name() << std::endl;
+                engineNames.push_back(engineName);
+                engines.push_back(std::move(engine));
+            }
+            if(engines.size() < 2) {
+                std::cerr << "ERROR: comparing needs at least two engines" << std::endl;
+                exit(1);
+            }
+            emu::LockstepRunner lockstep(lockstepOptions);
+            for(size_t n = 0; n < engines.size(); ++n) {
+                lockstep.addCore(engineNames[n], *engines[n]);
+            }
+            auto startCompare = std::chrono::steady_clock::now();
+            bool same = lockstep.run(compareFrames);
+            auto durationCompare = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startCompare);
+            std::clog << "Compared frames: " << lockstep.frames() << ", instructions: " << lockstep.steps() << ", " << durationCompare.count() << "us" << std::endl;
+            if(!compareReport.empty()) {
+                auto report = nlohmann::ordered_json::object();
+                report["engines"] = engineNames;
+                report["frames"] = lockstep.frames();
+                report["instructions"] = lockstep.steps();
+                report["divergence"] = same ? nlohmann::ordered_json() : lockstep.divergence()->toJSON();
+                std::ofstream out(compareReport);
+                if(!(out << report.dump(2) << std::endl)) {
+                    std::cerr << "ERROR: could not write compare report '" << compareReport << "'" << std::endl;
+                    exit(1);
                 }
-                ++i;
-            } while ((i & 0xfff) || (chip8.dumpStateLine() == dumOctoStateLine(&octo) && chip8EmuScreen(chip8) == octoScreen(octo)));
-            std::clog << i << ": " << chip8.dumpStateLine() << std::endl;
-            std::clog << i << "| " << dumOctoStateLine(&octo) << std::endl;
-            std::cerr << chip8EmuScreen(chip8);
-            std::cerr << "---" << std::endl;
-            std::cerr << octoScreen(octo) << std::endl;
+            }
+            if(!same) {
+                std::cerr << lockstep.divergence()->format();
+                for(const auto& engine : engines) {
+                    std::cerr << "--- " << engine->name() << std::endl;
+                    std::cerr << chip8EmuScreen(*engine);
+                }
+                return 1;
+            }
+            std::cout << "No divergence found" << std::endl;
         }
         else if(benchmark > 0) {
             uint64_t instructions = benchmark;
@@ -3054,7 +3410,9 @@ int main(int argc, char* argv[])
             auto startChip8 = std::chrono::steady_clock::now();
             auto ticks = uint64_t(instructions / options.instructionsPerFrame);
             for(i = 0; i < ticks; ++i) {
-                chip8.tick(options.instructionsPerFrame);
+                tickWithMetrics(options.instructionsPerFrame);
+                if(rewind)
+                    host.captureRewindFrame();
             }
             chip8.handleTimer();
             int64_t lastCycles = -1;
@@ -3069,32 +3427,77 @@ int main(int argc, char* argv[])
             }
             std::cout << "Executed instructions: " << chip8.getCycles() << std::endl;
             std::cout << "Cadmium: " << durationChip8.count() << "us, " << int(double(chip8.getCycles())/durationChip8.count()) << "MIPS" << std::endl;
+            if(rewind) {
+                const auto& rewindBuffer = host.rewindBuffer();
+                std::cout << "Rewind frames: " << rewindBuffer.frames() << ", " << rewindBuffer.memoryUsage() << " bytes" << std::endl;
+            }
         }
         else if(traceLines >= 0) {
             chip8.memory()[0x1ff] = testSuiteMenuVal & 0xff;
+            emu::TraceWriter traceWriter;
+            if(!traceFile.empty()) {
+                if(!traceWriter.open(traceFile)) {
+                    std::cerr << "ERROR: could not create trace file '" << traceFile << "'" << std::endl;
+                    exit(1);
+                }
+                emu::Logger::setLogger(&traceWriter);
+            }
+            auto startTrace = std::chrono::steady_clock::now();
             size_t waits = 0;
             do {
                 bool isDraw = (chip8.opcode() & 0xF000) == 0xD000;
                 bool isWait = !(!isDraw || options.optInstantDxyn || (chip8.getCycles() % options.instructionsPerFrame == 0));
                 if ((chip8.getCycles() % options.instructionsPerFrame) == 0) {
-                    std::cout << "--- handle timer ---" << std::endl;
+                    if(!traceWriter.isOpen())
+                        std::cout << "--- handle timer ---\n";
                     chip8.handleTimer();
                 }
-                std::cout << (i - waits) << "/" << chip8.getCycles() << ": " << chip8.dumpStateLine() << (isWait ? " (WAIT)" : "") << std::endl;
+                if(!traceWriter.isOpen())
+                    std::cout << (i - waits) << "/" << chip8.getCycles() << ": " << chip8.dumpStateLine() << (isWait ? " (WAIT)" : "") << "\n";
                 if(isWait) ++waits;
                 uint16_t opcode = chip8.opcode();
                 chip8.executeInstruction();
                 if(chip8.needsScreenUpdate()) {
-                    std::cout << chip8EmuScreen(chip8);
+                    if(drawDump)
+                        std::cout << chip8EmuScreen(chip8);
                 }
                 else if((opcode & 0xF0FF) == 0xF00A)
                     break;
                 ++i;
             } while (i <= traceLines && chip8.getExecMode() == emu::IChip8Emulator::ExecMode::eRUNNING);
+            std::cout << std::flush;
+            if(traceWriter.isOpen()) {
+                emu::Logger::setLogger(nullptr);
+                auto records = traceWriter.records();
+                if(!traceWriter.close()) {
+                    std::cerr << "ERROR: writing trace file '" << traceFile << "' failed" << std::endl;
+                    exit(1);
+                }
+                auto durationTrace = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTrace);
+                std::clog << "Traced instructions: " << records << " into '" << traceFile << "', " << durationTrace.count() << "us" << std::endl;
+            }
             if(screenDump) {
                 std::cout << chip8EmuScreenANSI(chip8);
             }
         }
+        if(!opcodeProfile.empty()) {
+            auto profile = emu::OpcodeProfiler::toJSON(chip8.opcodeProfile());
+            profile["core"] = chip8.name();
+            std::ofstream out(opcodeProfile);
+            if(!(out << profile.dump(2) << std::endl)) {
+                std::cerr << "ERROR: could not write opcode profile '" << opcodeProfile << "'" << std::endl;
+                exit(1);
+            }
+        }
+        if(!heatmapFile.empty()) {
+            auto heatmap = chip8.memoryHeatmap()->toJSON();
+            heatmap["core"] = chip8.name();
+            std::ofstream out(heatmapFile);
+            if(!(out << heatmap.dump(2) << std::endl)) {
+                std::cerr << "ERROR: could not write heatmap '" << heatmapFile << "'" << std::endl;
+                exit(1);
+            }
+        }
     }
 #endif
     return 0;
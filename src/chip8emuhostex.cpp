@@ -89,36 +89,40 @@ std::unique_ptr<IChip8Emulator> Chip8EmuHostEx::create(Chip8EmulatorOptions& opt
     else if (_options.behaviorBase == Chip8EmulatorOptions::eCHIP8DREAM ||_options.behaviorBase == Chip8EmulatorOptions::eC8D68CHIPOSLO)
         engine = IChip8Emulator::eCHIP8DREAM;
     else if(_options.behaviorBase == Chip8EmulatorOptions::eCHIP8TE)
-        return std::make_unique<Chip8StrictEmulator>(*this, _options, _chipEmu.get());
+        engine = IChip8Emulator::eCHIP8STRICT;
+    return createEngine(*this, engine, options, iother);
+}
 
+std::unique_ptr<IChip8Emulator> Chip8EmuHostEx::createEngine(Chip8EmulatorHost& host, IChip8Emulator::Engine engine, Chip8EmulatorOptions& options, IChip8Emulator* iother)
+{
     if(engine == emu::IChip8Emulator::eCHIP8TS) {
         if (options.optAllowHires) {
             if (options.optHas16BitAddr) {
                 if (options.optAllowColors) {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<16, HiresSupport | MultiColor | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, HiresSupport | MultiColor | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<16, HiresSupport | MultiColor>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, HiresSupport | MultiColor>>(host, options, iother);
                 }
                 else {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<16, HiresSupport | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, HiresSupport | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<16, HiresSupport>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, HiresSupport>>(host, options, iother);
                 }
             }
             else {
                 if (options.optAllowColors) {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<12, HiresSupport | MultiColor | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, HiresSupport | MultiColor | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<12, HiresSupport | MultiColor>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, HiresSupport | MultiColor>>(host, options, iother);
                 }
                 else {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<12, HiresSupport | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, HiresSupport | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<12, HiresSupport>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, HiresSupport>>(host, options, iother);
                 }
             }
         }
@@ -126,43 +130,46 @@ std::unique_ptr<IChip8Emulator> Chip8EmuHostEx::create(Chip8EmulatorOptions& opt
             if (options.optHas16BitAddr) {
                 if (options.optAllowColors) {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<16, MultiColor | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, MultiColor | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<16, MultiColor>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, MultiColor>>(host, options, iother);
                 }
                 else {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<16, WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<16, 0>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<16, 0>>(host, options, iother);
                 }
             }
             else {
                 if (options.optAllowColors) {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<12, MultiColor | WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, MultiColor | WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<12, MultiColor>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, MultiColor>>(host, options, iother);
                 }
                 else {
                     if (options.optWrapSprites)
-                        return std::make_unique<Chip8Emulator<12, WrapSprite>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, WrapSprite>>(host, options, iother);
                     else
-                        return std::make_unique<Chip8Emulator<12, 0>>(*this, options, iother);
+                        return std::make_unique<Chip8Emulator<12, 0>>(host, options, iother);
                 }
             }
         }
     }
+    else if(engine == IChip8Emulator::eCHIP8STRICT) {
+        return std::make_unique<Chip8StrictEmulator>(host, options, iother);
+    }
     else if(engine == IChip8Emulator::eCHIP8MPT) {
-        return std::make_unique<Chip8EmulatorFP>(*this, options, iother);
+        return std::make_unique<Chip8EmulatorFP>(host, options, iother);
     }
     else if(engine == IChip8Emulator::eCHIP8VIP) {
-        return std::make_unique<Chip8VIP>(*this, options, iother);
+        return std::make_unique<Chip8VIP>(host, options, iother);
     }
     else if(engine == IChip8Emulator::eCHIP8DREAM) {
-        return std::make_unique<Chip8Dream>(*this, options, iother);
+        return std::make_unique<Chip8Dream>(host, options, iother);
     }
-    return std::make_unique<Chip8EmulatorVIP>(*this, options, iother);
+    return std::make_unique<Chip8EmulatorVIP>(host, options, iother);
 }
 
 
@@ -173,6 +180,8 @@ void Chip8EmuHostEx::updateEmulatorOptions(const Chip8EmulatorOptions& options)
             _options = options;
         _previousOptions = _options.clone();
         _chipEmu = create(_options, _chipEmu.get());
+        _rewindBuffer.clear();
+        cancelInputMode();
         //
         auto tmpOpt = emu::Chip8EmulatorOptions::optionsOfPreset(options.behaviorBase);
         if(tmpOpt.hasColors()) {
@@ -199,10 +208,277 @@ void Chip8EmuHostEx::updateEmulatorOptions(const Chip8EmulatorOptions& options)
     }
 }
 
+bool Chip8EmuHostEx::captureRewindFrame()
+{
+    if(!_chipEmu)
+        return false;
+    auto* realCore = dynamic_cast<Chip8RealCoreBase*>(_chipEmu.get());
+    auto cycles = _chipEmu->getCycles();
+    return _rewindBuffer.capture(*_chipEmu, {cycles, realCore ? realCore->getBackendCpu().getCycles() : cycles, frameKeyMask()});
+}
+
+bool Chip8EmuHostEx::rewindFrame()
+{
+    if(!_chipEmu || _inputMode != eINPUT_LIVE || !_rewindBuffer.stepBack(*_chipEmu))
+        return false;
+    updateScreen();
+    return true;
+}
+
+bool Chip8EmuHostEx::reverseStep(bool backend)
+{
+    return reverseSearch(backend, eREVERSE_STEP);
+}
+
+bool Chip8EmuHostEx::reverseContinue(bool backend)
+{
+    return reverseSearch(backend, eREVERSE_BREAKPOINT);
+}
+
+bool Chip8EmuHostEx::reverseToMemoryWrite(uint32_t address, bool backend)
+{
+    return reverseSearch(backend, eREVERSE_CHANGE, [address](GenericCpu& cpu) { return uint32_t(cpu.getMemoryByte(address)); });
+}
+
+bool Chip8EmuHostEx::reverseToRegisterWrite(size_t index, bool backend)
+{
+    return reverseSearch(backend, eREVERSE_CHANGE, [index](GenericCpu& cpu) { return cpu.getRegister(index).value; });
+}
+
+void Chip8EmuHostEx::setReplayKeyMask(uint16_t mask)
+{
+    _replayKeyMask = mask;
+    for(int i = 0; i < 16; ++i) {
+        _replayKeyStates[i] = (mask >> i) & 1;
+    }
+}
+
+//---------------------------------------------------------------------------------------
+// While recording or playing back, the core sees the keys through the frame key mask
+// in both cases, so both runs get identical input down to the Fx0A handling
+//---------------------------------------------------------------------------------------
+bool Chip8EmuHostEx::startInputRecording()
+{
+    if(!_chipEmu || _romImage.empty())
+        return false;
+    reloadRom();
+    _inputRecording.start(_options, _romSha1Hex, _chipEmu->getRandomSeed(), _chipEmu->getRandomState());
+    _inputMode = eINPUT_RECORDING;
+    _inputReplay = true;
+    _replayWaitKey = 0;
+    return true;
+}
+
+void Chip8EmuHostEx::stopInputRecording()
+{
+    if(_inputMode == eINPUT_RECORDING)
+        _inputRecording.finish(*_chipEmu);
+    cancelInputMode();
+}
+
+bool Chip8EmuHostEx::startInputPlayback(const InputRecording& recording)
+{
+    if(!_chipEmu || _romImage.empty() || recording.romSha1Hex() != _romSha1Hex)
+        return false;
+    updateEmulatorOptions(recording.options());
+    reloadRom();
+    _chipEmu->setRandomSeed(recording.randomSeed());
+    _chipEmu->setRandomState(recording.randomState());
+    _inputRecording = recording;
+    _inputFrame = 0;
+    _inputMode = eINPUT_PLAYBACK;
+    _inputReplay = true;
+    _replayWaitKey = 0;
+    return true;
+}
+
+// Sets up the keys for the next emulated frame, returns false when a playback just ran out of frames
+bool Chip8EmuHostEx::nextFrameInput()
+{
+    if(_inputMode == eINPUT_RECORDING) {
+        setReplayKeyMask(currentKeyMask());
+        _inputRecording.addFrame(_replayKeyMask);
+    }
+    else if(_inputMode == eINPUT_PLAYBACK) {
+        if(_inputFrame >= _inputRecording.frames()) {
+            cancelInputMode();
+            return false;
+        }
+        setReplayKeyMask(_inputRecording.keysForFrame(_inputFrame++));
+    }
+    return true;
+}
+
+void Chip8EmuHostEx::cancelInputMode()
+{
+    _inputMode = eINPUT_LIVE;
+    _inputReplay = false;
+    setReplayKeyMask(0);
+}
+
+int Chip8EmuHostEx::replayKeyPressed()
+{
+    if(_replayWaitKey) {
+        if(replayKeyDown(_replayWaitKey - 1))
+            return -1;
+        auto key = _replayWaitKey;
+        _replayWaitKey = 0;
+        return key;
+    }
+    for(int i = 0; i < 16; ++i) {
+        if(replayKeyDown(i)) {
+            _replayWaitKey = i + 1;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void Chip8EmuHostEx::replaySteps(bool backend, int steps)
+{
+    auto* realCore = backend ? dynamic_cast<Chip8RealCoreBase*>(_chipEmu.get()) : nullptr;
+    for(int i = 0; i < steps; ++i) {
+        if(realCore)
+            realCore->setBackendExecMode(GenericCpu::eSTEP);
+        else
+            _chipEmu->setExecMode(GenericCpu::eSTEP);
+        _chipEmu->tick(_options.instructionsPerFrame);
+    }
+}
+
+//---------------------------------------------------------------------------------------
+// Walks the rewind snapshots backwards, each one is restored and the frame following
+// it is replayed instruction by instruction with the recorded keys, until a frame
+// contains a position matching the target. The emulator is then left at the latest
+// matching position and the now obsolete future snapshots are dropped.
+// Breakpoints are suspended while replaying, hits are counted by the search instead:
+// a breakpoint only matches where its hit count would have passed the ignore count,
+// and the hit counts of the searched cpu are rolled back to the new position (those
+// of the other cpu of a real core stay as they are).
+//---------------------------------------------------------------------------------------
+bool Chip8EmuHostEx::reverseSearch(bool backend, ReverseTarget target, const std::function<uint32_t(GenericCpu&)>& probe)
+{
+    if(!_chipEmu || !_rewindBuffer.frames() || _inputMode != eINPUT_LIVE)
+        return false;
+    auto* realCore = dynamic_cast<Chip8RealCoreBase*>(_chipEmu.get());
+    if(!realCore && _options.instructionsPerFrame <= 0)
+        return false; // unlimited speed is wall-clock driven and can't be replayed
+    backend = backend && realCore;
+    GenericCpu& cpu = backend ? realCore->getBackendCpu() : *_chipEmu;
+    auto frameCycles = [&](size_t frame) {
+        const auto& info = _rewindBuffer.frameInfo(frame);
+        return backend ? info.backendCycles : info.cycles;
+    };
+    std::vector<uint8_t> current;
+    auto frame = _rewindBuffer.frames() - 1;
+    if(!_chipEmu->saveState(current) || !_rewindBuffer.stateAt(frame, _reverseState))
+        return false;
+    auto now = cpu.getCycles();
+    int found = -1;
+    struct Hit { int steps; uint32_t address; bool candidate; };
+    std::vector<Hit> hits;
+    std::map<uint32_t,int64_t> laterHits;
+    auto suspendBreakpoints = [&](bool suspend) {
+        _chipEmu->suspendBreakpoints(suspend);
+        if(realCore)
+            realCore->getBackendCpu().suspendBreakpoints(suspend);
+    };
+    suspendBreakpoints(true);
+    _inputReplay = true;
+    while(true) {
+        auto end = frame + 1 < _rewindBuffer.frames() ? std::min(frameCycles(frame + 1), now) : now;
+        if(frameCycles(frame) < end) {
+            setReplayKeyMask(frame + 1 < _rewindBuffer.frames() ? _rewindBuffer.frameInfo(frame + 1).keys : currentKeyMask());
+            _replayWaitKey = 0;
+            if(!_chipEmu->loadState(_reverseState.data(), _reverseState.size()))
+                break;
+            auto value = probe ? probe(cpu) : 0;
+            hits.clear();
+            for(int steps = 1; cpu.getCycles() < end; ++steps) {
+                auto before = cpu.getCycles();
+                replaySteps(backend, 1);
+                if(cpu.getCycles() == before)
+                    break;
+                if(cpu.getCycles() <= now) {
+                    const auto* bpi = cpu.findBreakpoint(cpu.getPC());
+                    if(bpi && bpi->isEnabled && bpi->condition.isTrue(cpu))
+                        hits.push_back({steps, cpu.getPC(), !bpi->isTracepoint && cpu.getCycles() < now});
+                }
+                if(target == eREVERSE_STEP) {
+                    if(cpu.getCycles() < now)
+                        found = steps;
+                }
+                else if(target != eREVERSE_BREAKPOINT) {
+                    auto newValue = probe(cpu);
+                    if(newValue != value)
+                        found = steps - 1;
+                    value = newValue;
+                }
+            }
+            // the live run counted every hit up to now, so a hit had the count of the
+            // breakpoint minus the hits that came after it
+            for(auto hit = hits.rbegin(); hit != hits.rend(); ++hit) {
+                if(target == eREVERSE_BREAKPOINT && hit->candidate) {
+                    const auto* bpi = cpu.findBreakpoint(hit->address);
+                    if(bpi->hitCount - laterHits[hit->address] > bpi->ignoreCount) {
+                        found = hit->steps;
+                        break;
+                    }
+                }
+                else if(hit->steps <= found)
+                    break;
+                ++laterHits[hit->address];
+            }
+            if(found >= 0)
+                break;
+        }
+        if(!frame || !_rewindBuffer.previousState(frame, _reverseState))
+            break;
+        --frame;
+    }
+    if(found >= 0) {
+        _replayWaitKey = 0;
+        _chipEmu->loadState(_reverseState.data(), _reverseState.size());
+        replaySteps(backend, found);
+        _rewindBuffer.truncate(frame + 1);
+        for(auto& [address, count] : laterHits) {
+            if(auto* bpi = cpu.findBreakpoint(address))
+                bpi->hitCount -= count;
+        }
+    }
+    else {
+        _chipEmu->loadState(current.data(), current.size());
+    }
+    _inputReplay = false;
+    suspendBreakpoints(false);
+    _chipEmu->isBreakpointTriggered();
+    if(realCore)
+        realCore->setBackendExecMode(GenericCpu::ePAUSED);
+    _chipEmu->setExecMode(GenericCpu::ePAUSED);
+    updateScreen();
+    return found >= 0;
+}
+
+void Chip8EmuHostEx::reloadRom()
+{
+    if(!_chipEmu || _romImage.empty())
+        return;
+    _chipEmu->reset();
+    _rewindBuffer.clear();
+    if(Librarian::isPrefixedTPDRom(_romImage.data(), _romImage.size()))
+        std::memcpy(_chipEmu->memory() + 512, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - 512)));
+    else
+        std::memcpy(_chipEmu->memory() + _options.startAddress, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - _options.startAddress)));
+}
+
 bool Chip8EmuHostEx::loadRom(const char* filename, LoadOptions loadOpt)
 {
     std::error_code ec;
     if (strlen(filename) < 4095 && fs::exists(filename, ec)) {
+        if(endsWith(filename, ".c8rec")) {
+            InputRecording recording;
+            return recording.load(filename) && startInputPlayback(recording);
+        }
         unsigned int size = 0;
         _customPalette = false;
         _colorPalette = _defaultPalette;
@@ -453,11 +729,8 @@ bool Chip8EmuHostEx::loadBinary(std::string filename, const uint8_t* data, size_
         _romIsWellKnown = isKnown;
         if(isKnown && knownOptions.behaviorBase != Chip8EmulatorOptions::ePORTABLE)
             _romWellKnownOptions = knownOptions;
-        _chipEmu->reset();
-        if(Librarian::isPrefixedTPDRom(_romImage.data(), _romImage.size()))
-            std::memcpy(_chipEmu->memory() + 512, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - 512)));
-        else
-            std::memcpy(_chipEmu->memory() + _options.startAddress, _romImage.data(), std::min(_romImage.size(),size_t(_chipEmu->memSize() - _options.startAddress)));
+        cancelInputMode();
+        Chip8EmuHostEx::reloadRom();
         _chipEmu->removeAllBreakpoints();
         if(!_options.hasColors()) {
             setPalette({0x1a1c2cff, 0xf4f4f4ff, 0x94b0c2ff, 0x333c57ff, 0xb13e53ff, 0xa7f070ff, 0x3b5dc9ff, 0xffcd75ff, 0x5d275dff, 0x38b764ff, 0x29366fff, 0x566c86ff, 0xef7d57ff, 0x73eff7ff, 0x41a6f6ff, 0x257179ff});
@@ -27,16 +27,20 @@
 
 #include <emulation/chip8emulatorhost.hpp>
 #include <emulation/chip8options.hpp>
+#include <emulation/inputrecording.hpp>
+#include <emulation/rewindbuffer.hpp>
 #include <chiplet/octocompiler.hpp>
 #include <ghc/bitenum.hpp>
 #include <librarian.hpp>
 
 #include <array>
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace emu {
 
+class GenericCpu;
 class IChip8Emulator;
 
 /*
@@ -73,13 +77,42 @@ public:
     //virtual void updatePalette(const std::vector<uint32_t>& palette, size_t offset) = 0;
     virtual bool loadRom(const char* filename, LoadOptions loadOpt);
     virtual bool loadBinary(std::string filename, const uint8_t* data, size_t size, LoadOptions loadOpt);
+    virtual void reloadRom();
     void updateEmulatorOptions(const Chip8EmulatorOptions& options);
+    // creates the given engine independent of the preset, e.g. for lockstep comparisons
+    static std::unique_ptr<IChip8Emulator> createEngine(Chip8EmulatorHost& host, IChip8Emulator::Engine engine, Chip8EmulatorOptions& options, IChip8Emulator* iother = nullptr);
     void setPalette(const std::vector<uint32_t>& colors, size_t offset = 0);
+    bool captureRewindFrame();
+    bool rewindFrame();
+    bool reverseStep(bool backend = false);
+    bool reverseContinue(bool backend = false);
+    bool reverseToMemoryWrite(uint32_t address, bool backend = false);
+    bool reverseToRegisterWrite(size_t index, bool backend = false);
+    const RewindBuffer& rewindBuffer() const { return _rewindBuffer; }
+    bool startInputRecording();
+    void stopInputRecording();
+    bool startInputPlayback(const InputRecording& recording);
+    bool nextFrameInput();
+    bool isRecordingInput() const { return _inputMode == eINPUT_RECORDING; }
+    bool isPlayingInput() const { return _inputMode == eINPUT_PLAYBACK; }
+    const InputRecording& inputRecording() const { return _inputRecording; }
 
 protected:
     std::unique_ptr<IChip8Emulator> create(Chip8EmulatorOptions& options, IChip8Emulator* iother = nullptr);
     virtual void whenRomLoaded(const std::string& filename, bool autoRun, emu::OctoCompiler* compiler, const std::string& source) {}
     virtual void whenEmuChanged(IChip8Emulator& emu) {}
+    virtual uint16_t currentKeyMask() const { return 0; }
+    bool isReplayingInput() const { return _inputReplay; }
+    bool replayKeyDown(uint8_t key) const { return (_replayKeyMask >> (key & 0xF)) & 1; }
+    const std::array<bool,16>& replayKeyStates() const { return _replayKeyStates; }
+    int replayKeyPressed();
+    void setReplayKeyMask(uint16_t mask);
+    uint16_t frameKeyMask() const { return _inputReplay ? _replayKeyMask : currentKeyMask(); }
+    void cancelInputMode();
+    enum InputMode { eINPUT_LIVE, eINPUT_RECORDING, eINPUT_PLAYBACK };
+    enum ReverseTarget { eREVERSE_STEP, eREVERSE_BREAKPOINT, eREVERSE_CHANGE };
+    bool reverseSearch(bool backend, ReverseTarget target, const std::function<uint32_t(GenericCpu&)>& probe = {});
+    void replaySteps(bool backend, int steps);
     CadmiumConfiguration _cfg;
     std::string _cfgPath;
     std::string _databaseDirectory;
@@ -97,6 +130,15 @@ protected:
     emu::Chip8EmulatorOptions _options;
     emu::Chip8EmulatorOptions _romWellKnownOptions;
     emu::Chip8EmulatorOptions _previousOptions;
+    RewindBuffer _rewindBuffer;
+    std::vector<uint8_t> _reverseState;
+    bool _inputReplay{false};
+    uint16_t _replayKeyMask{0};
+    std::array<bool,16> _replayKeyStates{};
+    InputMode _inputMode{eINPUT_LIVE};
+    InputRecording _inputRecording;
+    uint64_t _inputFrame{0};
+    int _replayWaitKey{0};
 };
 
 GHC_ENUM_ENABLE_BIT_OPERATIONS(Chip8EmuHostEx::LoadOptions)
@@ -110,9 +152,9 @@ public:
     Chip8EmulatorOptions& options() { return _options; }
     IChip8Emulator& chipEmu() { return *_chipEmu; }
     bool isHeadless() const override { return true; }
-    int getKeyPressed() override { return 0; }
-    bool isKeyDown(uint8_t key) override { return false; }
-    const std::array<bool,16>& getKeyStates() const override { static const std::array<bool,16> keys{}; return keys; }
+    int getKeyPressed() override { return isReplayingInput() ? replayKeyPressed() : 0; }
+    bool isKeyDown(uint8_t key) override { return isReplayingInput() && replayKeyDown(key); }
+    const std::array<bool,16>& getKeyStates() const override { return replayKeyStates(); }
     void updateScreen() override {}
     void vblank() override {}
     void updatePalette(const std::array<uint8_t,16>& palette) override {}
@@ -29,6 +29,9 @@
 #include <stylemanager.hpp>
 #include "debugger.hpp"
 
+#include <cmath>
+#include <optional>
+
 void Debugger::setExecMode(ExecMode mode)
 {
     if(!_realCore || _visibleCpu == CHIP8_CORE)
@@ -47,6 +50,8 @@ void Debugger::updateCore(emu::IChip8Emulator* core)
     _instructionOffset[CHIP8_CORE] = -1;
     _instructionOffset[BACKEND_CORE] = -1;
     _activeInstructionsTab = 0;
+    _profileSummary.clear();
+    _profileOffset = 0;
     // ensure cached data has the correct size by actually forcing a capture
     _core->fetchAllRegisters(_chip8State);
     if(_backend)
@@ -57,7 +62,7 @@ void Debugger::updateCore(emu::IChip8Emulator* core)
 void Debugger::captureStates()
 {
     _memBackup.resize(_core->memSize());
-    std::memcpy(_memBackup.data(), _core->memory(), _core->memSize());
+    std::memcpy(_memBackup.data(), _core->memoryView(), _core->memSize());
     _chip8StackBackup.resize(_core->stackSize());
     std::memcpy(_chip8StackBackup.data(), _core->getStackElements(), sizeof(uint16_t) * _core->stackSize());
     _core->fetchAllRegisters(_chip8StateBackup);
@@ -78,6 +83,9 @@ void Debugger::render(Font& font, std::function<void(Rectangle,int)> drawScreen)
     auto lightgrayCol = StyleManager::mappedColor(LIGHTGRAY);
     auto yellowCol = StyleManager::mappedColor(YELLOW);
     auto brownCol = StyleManager::mappedColor({ 203, 199, 0, 255 });
+    // a right click on a memory cell or register runs back to the instruction that last changed it
+    bool reverseClick = _reverseHandler && !GuiIsLocked() && IsMouseButtonPressed(MOUSE_BUTTON_RIGHT);
+    std::optional<std::pair<ReverseTarget, uint32_t>> reverseRequest;
     if(_core->getExecMode() != emu::GenericCpu::ePAUSED) {
         _instructionOffset[CHIP8_CORE] = -1;
         _instructionOffset[BACKEND_CORE] = -1;
@@ -111,18 +119,31 @@ void Debugger::render(Font& font, std::function<void(Rectangle,int)> drawScreen)
             showInstructions(*_backend, font, lineSpacing);
             EndTab();
         }
+        if(BeginTab("Profile", {5, 0})) {
+            _visibleCpu = CHIP8_CORE;
+            showOpcodeProfile(font, lineSpacing);
+            EndTab();
+        }
         EndTabView();
     }
-    else {
-        BeginPanel("Instructions", {5, 0});
-        if(_realCore && !_realCore->hybridChipMode()) {
-            _visibleCpu = BACKEND_CORE;
-            showInstructions(*_backend, font, lineSpacing);
-        }
-        else {
+    else if(!_realCore) {
+        BeginTabView(&_activeInstructionsTab);
+        if(BeginTab("Instructions", {5, 0})) {
             _visibleCpu = CHIP8_CORE;
             showInstructions(*_core, font, lineSpacing);
+            EndTab();
+        }
+        if(BeginTab("Profile", {5, 0})) {
+            _visibleCpu = CHIP8_CORE;
+            showOpcodeProfile(font, lineSpacing);
+            EndTab();
         }
+        EndTabView();
+    }
+    else {
+        BeginPanel("Instructions", {5, 0});
+        _visibleCpu = BACKEND_CORE;
+        showInstructions(*_backend, font, lineSpacing);
         EndPanel();
     }
     End();
@@ -133,12 +154,15 @@ void Debugger::render(Font& font, std::function<void(Rectangle,int)> drawScreen)
         auto area = GetContentAvailable();
         pos.x += 0;
         Space(area.height);
+        int reg;
         if(_visibleCpu == CHIP8_CORE) {
-            showGenericRegs(*_core, _chip8State, _chip8StateBackup, font, lineSpacing, pos);
+            reg = showGenericRegs(*_core, _chip8State, _chip8StateBackup, font, lineSpacing, pos);
         }
         else {
-            showGenericRegs(*_backend, _backendState, _backendStateBackup, font, lineSpacing, pos);
+            reg = showGenericRegs(*_backend, _backendState, _backendStateBackup, font, lineSpacing, pos);
         }
+        if(reverseClick && reg >= 0)
+            reverseRequest = {eREGISTER_WRITE, uint32_t(reg)};
     }
     EndPanel();
     SetNextWidth(44);
@@ -180,6 +204,12 @@ void Debugger::render(Font& font, std::function<void(Rectangle,int)> drawScreen)
         auto pos = GetCurrentPos();
         auto area = GetContentAvailable();
         GuiCheckBox({pos.x + 108, pos.y - 13, 10, 10}, "Follow", &_memViewFollow);
+        bool showHeat = _core->memoryHeatmap() != nullptr;
+        GuiCheckBox({pos.x + 160, pos.y - 13, 10, 10}, "Heat", &showHeat);
+        if(showHeat != (_core->memoryHeatmap() != nullptr))
+            _core->setMemoryHeatmap(showHeat);
+        const auto* heatmap = _core->memoryHeatmap();
+        int hoveredAddr = -1;
         pos.x += 4;
         pos.y -= lineSpacing / 2;
         SetStyle(DEFAULT, BORDER_WIDTH, 0);
@@ -194,21 +224,53 @@ void Debugger::render(Font& font, std::function<void(Rectangle,int)> drawScreen)
             if(addr + i * 8 >= 0 && addr + i * 8 < _core->memSize()) {
                 DrawTextEx(font, TextFormat("%04X", (addr + i * 8) & 0xFFFF), {pos.x, pos.y + i * lineSpacing}, 8, 0, lightgrayCol);
                 for (int j = 0; j < 8; ++j) {
-                    if (!showChipCPU || addr + i * 8 + j > _core->memSize() || _core->memory()[addr + i * 8 + j] == _memBackup[addr + i * 8 + j]) {
-                        DrawTextEx(font, TextFormat("%02X", _core->memory()[addr + i * 8 + j]), {pos.x + 30 + j * 16, pos.y + i * lineSpacing}, 8, 0, j & 1 ? lightgrayCol : grayCol);
+                    if(reverseClick && CheckCollisionPointRec(GetMousePosition(), {pos.x + 30 + j * 16, pos.y + i * lineSpacing, 14, 8}))
+                        reverseRequest = {eMEMORY_WRITE, uint32_t(addr + i * 8 + j)};
+                    if(heatmap) {
+                        auto cell = heatmap->cell(addr + i * 8 + j);
+                        if(cell.exec || cell.reads || cell.writes)
+                            DrawRectangle(pos.x + 29 + j * 16, pos.y + i * lineSpacing - 1, 14, 10, heatColor(*heatmap, cell));
+                        if(!GuiIsLocked() && CheckCollisionPointRec(GetMousePosition(), {pos.x + 30 + j * 16, pos.y + i * lineSpacing, 14, 8}))
+                            hoveredAddr = addr + i * 8 + j;
+                    }
+                    if (!showChipCPU || addr + i * 8 + j > _core->memSize() || _core->memoryView()[addr + i * 8 + j] == _memBackup[addr + i * 8 + j]) {
+                        DrawTextEx(font, TextFormat("%02X", _core->memoryView()[addr + i * 8 + j]), {pos.x + 30 + j * 16, pos.y + i * lineSpacing}, 8, 0, j & 1 ? lightgrayCol : grayCol);
                     }
                     else {
-                        DrawTextEx(font, TextFormat("%02X", _core->memory()[addr + i * 8 + j]), {pos.x + 30 + j * 16, pos.y + i * lineSpacing}, 8, 0, j & 1 ? yellowCol : brownCol);
+                        DrawTextEx(font, TextFormat("%02X", _core->memoryView()[addr + i * 8 + j]), {pos.x + 30 + j * 16, pos.y + i * lineSpacing}, 8, 0, j & 1 ? yellowCol : brownCol);
                     }
                 }
             }
         }
         EndScrollPanel();
         SetStyle(DEFAULT, BORDER_WIDTH, 1);
+        if(heatmap && hoveredAddr >= 0 && CheckCollisionPointRec(GetMousePosition(), {pos.x, pos.y, area.width, area.height})) {
+            auto cell = heatmap->cell(hoveredAddr);
+            int line = _sourceLineResolver ? _sourceLineResolver(hoveredAddr) : -1;
+            auto info = line >= 0 ? TextFormat("%04X E:%u R:%u W:%u L%d", hoveredAddr & 0xFFFF, cell.exec, cell.reads, cell.writes, line + 1)
+                                  : TextFormat("%04X E:%u R:%u W:%u", hoveredAddr & 0xFFFF, cell.exec, cell.reads, cell.writes);
+            auto mouse = GetMousePosition();
+            auto width = MeasureTextEx(font, info, 8, 0).x + 4;
+            auto x = std::min(mouse.x + 8, pos.x + area.width - width);
+            DrawRectangle(x, mouse.y + 10, width, 11, StyleManager::getStyleColor(Style::BASE_COLOR_NORMAL));
+            DrawTextEx(font, info, {x + 2, mouse.y + 12}, 8, 0, lightgrayCol);
+        }
     }
     EndPanel();
     EndColumns();
     SetStyle(LISTVIEW, SCROLLBAR_WIDTH, 6);
+    if(reverseRequest)
+        _reverseHandler(reverseRequest->first, reverseRequest->second, _visibleCpu == BACKEND_CORE);
+}
+
+Color Debugger::heatColor(const emu::MemoryHeatmap& heatmap, const emu::MemoryHeatmap::Cell& cell)
+{
+    // logarithmic scale, otherwise a tight loop makes everything else invisible
+    auto level = [&](uint32_t count, emu::MemoryHeatmap::Access access) {
+        auto max = heatmap.maxCount(access);
+        return count && max ? (unsigned char)(64 + 191 * std::log1p(count) / std::log1p(max)) : (unsigned char)0;
+    };
+    return {level(cell.exec, emu::MemoryHeatmap::eEXEC), level(cell.reads, emu::MemoryHeatmap::eREAD), level(cell.writes, emu::MemoryHeatmap::eWRITE), 144};
 }
 
 void Debugger::showInstructions(emu::GenericCpu& cpu, Font& font, const int lineSpacing)
@@ -273,8 +335,62 @@ void Debugger::showInstructions(emu::GenericCpu& cpu, Font& font, const int line
     EndScissorMode();
 }
 
-void Debugger::showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const RegPack& oldRegs, Font& font, const int lineSpacing, const Vector2& pos) const
+void Debugger::showOpcodeProfile(Font& font, const int lineSpacing)
+{
+    using namespace gui;
+    auto lightgrayCol = StyleManager::getStyleColor(Style::TEXT_COLOR_FOCUSED);
+    auto grayCol = StyleManager::mappedColor(GRAY);
+    auto area = GetContentAvailable();
+    Space(area.height);
+    bool profiling = _core->opcodeProfiler() != nullptr;
+    GuiCheckBox({area.x, area.y, 10, 10}, "Profile", &profiling);
+    if(profiling != (_core->opcodeProfiler() != nullptr)) {
+        _core->setOpcodeProfiling(profiling);
+        _profileSummary.clear();
+        _profileOffset = 0;
+    }
+    auto* profiler = _core->opcodeProfiler();
+    if(!profiler) {
+        DrawTextEx(font, "Enable to count executed opcodes.", {area.x, area.y + 2 * lineSpacing}, 8, 0, grayCol);
+        return;
+    }
+    if(GuiButton({area.x + area.width - 40, area.y - 1, 40, 12}, "Clear")) {
+        profiler->clear();
+        _profileSummary.clear();
+        _profileOffset = 0;
+    }
+    // summarizing walks the whole opcode table, so only refresh it a few times per second
+    if(_profileSummary.empty() || ++_profileRefresh >= 15) {
+        _profileSummary = _core->opcodeProfile();
+        _profileRefresh = 0;
+    }
+    auto total = profiler->totalCount();
+    auto cycles = profiler->totalCycles();
+    DrawTextEx(font, TextFormat("%llu instr.", (unsigned long long)total), {area.x + 70, area.y + 1}, 8, 0, grayCol);
+    auto listY = area.y + lineSpacing + 4;
+    auto visibleLines = int((area.y + area.height - listY) / lineSpacing);
+    if(!GuiIsLocked() && CheckCollisionPointRec(GetMousePosition(), GetLastWidgetRect())) {
+        auto wheel = GetMouseWheelMoveV();
+        if(wheel.y >= 0.5f) --_profileOffset;
+        else if(wheel.y <= -0.5f) ++_profileOffset;
+    }
+    _profileOffset = std::clamp(_profileOffset, 0, std::max(0, int(_profileSummary.size()) - visibleLines));
+    BeginScissorMode(area.x, listY, area.width, area.y + area.height - listY);
+    for(int i = 0; i < visibleLines && _profileOffset + i < _profileSummary.size(); ++i) {
+        const auto& entry = _profileSummary[_profileOffset + i];
+        auto ypos = listY + i * lineSpacing;
+        double share = total ? 100.0 * entry.count / total : 0.0;
+        if(cycles)
+            DrawTextEx(font, TextFormat("%-6s %9llu %5.1f%% %5.1f %s", entry.pattern.c_str(), (unsigned long long)entry.count, share, entry.count ? double(entry.cycles) / entry.count : 0.0, entry.name.c_str()), {area.x, ypos}, 8, 0, lightgrayCol);
+        else
+            DrawTextEx(font, TextFormat("%-6s %9llu %5.1f%% %s", entry.pattern.c_str(), (unsigned long long)entry.count, share, entry.name.c_str()), {area.x, ypos}, 8, 0, lightgrayCol);
+    }
+    EndScissorMode();
+}
+
+int Debugger::showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const RegPack& oldRegs, Font& font, const int lineSpacing, const Vector2& pos) const
 {
+    int hovered = -1;
     auto lightgrayCol = StyleManager::getStyleColor(Style::TEXT_COLOR_FOCUSED);//StyleManager::mappedColor(LIGHTGRAY);
     auto yellowCol = StyleManager::mappedColor(YELLOW);
     int i, line = 0, lastSize = 0;
@@ -283,6 +399,8 @@ void Debugger::showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const
         if(i && reg.size != lastSize)
             ++line;
         auto col = reg.value == oldRegs[i].value ? lightgrayCol : yellowCol;
+        if(CheckCollisionPointRec(GetMousePosition(), {pos.x, pos.y + line * lineSpacing, 44, float(reg.size == 24 ? 2 * lineSpacing : lineSpacing)}))
+            hovered = i;
         switch(reg.size) {
             case 1:
             case 4:
@@ -309,6 +427,7 @@ void Debugger::showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const
     }
     ++line;
     //DrawTextEx(font, TextFormat("Scr: %s", rcb->isDisplayEnabled() ? "ON" : "OFF"), {pos.x, pos.y + line * lineSpacing}, 8, 0, LIGHTGRAY);
+    return hovered;
 }
 
 const std::vector<std::pair<uint32_t,std::string>>& Debugger::disassembleNLinesBackwardsGeneric(emu::GenericCpu& cpu, uint32_t addr, int n)
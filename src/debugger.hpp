@@ -31,11 +31,16 @@
 
 #include <raylib.h>
 
+#include <functional>
+
 class Debugger
 {
 public:
     using ExecMode = emu::GenericCpu::ExecMode;
     using RegPack = emu::GenericCpu::RegisterPack;
+    enum ReverseTarget { eMEMORY_WRITE, eREGISTER_WRITE };
+    using ReverseHandler = std::function<void(ReverseTarget target, uint32_t value, bool backend)>;
+    using SourceLineResolver = emu::MemoryHeatmap::LineResolver;
     Debugger() = default;
 
     void setExecMode(ExecMode mode);
@@ -45,9 +50,14 @@ public:
     void updateOctoBreakpoints(const emu::OctoCompiler& compiler);
     bool supportsStepOver() const;
     bool isControllingChip8() const { return _backend == nullptr || _visibleCpu == CHIP8_CORE; }
+    void setReverseHandler(ReverseHandler handler) { _reverseHandler = std::move(handler); }
+    // maps an address to a zero based source line or -1, used for the heatmap info
+    void setSourceLineResolver(SourceLineResolver resolver) { _sourceLineResolver = std::move(resolver); }
 private:
     void showInstructions(emu::GenericCpu& cpu, Font& font, const int lineSpacing);
-    void showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const RegPack& oldRegs, Font& font, const int lineSpacing, const Vector2& pos) const;
+    void showOpcodeProfile(Font& font, const int lineSpacing);
+    static Color heatColor(const emu::MemoryHeatmap& heatmap, const emu::MemoryHeatmap::Cell& cell);
+    int showGenericRegs(emu::GenericCpu& cpu, const RegPack& regs, const RegPack& oldRegs, Font& font, const int lineSpacing, const Vector2& pos) const;
     const std::vector<std::pair<uint32_t,std::string>>& disassembleNLinesBackwardsGeneric(emu::GenericCpu& cpu, uint32_t addr, int n);
     void toggleBreakpoint(emu::GenericCpu& cpu, uint32_t address);
     enum Core { CHIP8_CORE, BACKEND_CORE };
@@ -64,5 +74,10 @@ private:
     RegPack _backendStateBackup;
     std::vector<uint16_t> _chip8StackBackup;
     std::vector<uint8_t> _memBackup;
+    ReverseHandler _reverseHandler;
+    SourceLineResolver _sourceLineResolver;
+    std::vector<emu::OpcodeProfiler::Summary> _profileSummary;
+    int _profileOffset{0};
+    int _profileRefresh{0};
 };
 
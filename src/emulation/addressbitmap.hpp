@@ -0,0 +1,183 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/addressbitmap.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Sparse bit set over the full 32 bit address space, used for breakpoints and
+// watchpoints. The top level is indexed by the upper 16 bits of an address and
+// only grows as far as the highest marked page, each page holds the 64K bits
+// of its lower half and is only allocated once a bit in it gets set. Testing an
+// address in an empty bitmap is a single size compare.
+//---------------------------------------------------------------------------------------
+class AddressBitmap
+{
+public:
+    bool test(uint32_t address) const
+    {
+        auto index = address >> PAGE_BITS;
+        if(index >= _pages.size())
+            return false;
+        const auto& page = _pages[index];
+        return !page.empty() && (page[(address & PAGE_MASK) >> 6] & (uint64_t(1) << (address & 63)));
+    }
+    bool testRange(uint32_t address, uint32_t size) const
+    {
+        while(size && (address >> PAGE_BITS) < _pages.size()) {
+            const auto& page = _pages[address >> PAGE_BITS];
+            auto offset = address & PAGE_MASK;
+            auto length = std::min(size, PAGE_MASK + 1 - offset);
+            if(!page.empty()) {
+                for(auto end = offset + length; offset < end; ++offset) {
+                    if(page[offset >> 6] & (uint64_t(1) << (offset & 63)))
+                        return true;
+                }
+            }
+            address += length;
+            size -= length;
+        }
+        return false;
+    }
+    void set(uint32_t address)
+    {
+        auto index = address >> PAGE_BITS;
+        if(index >= _pages.size())
+            _pages.resize(index + 1);
+        auto& page = _pages[index];
+        if(page.empty())
+            page.resize(PAGE_WORDS, 0);
+        auto& word = page[(address & PAGE_MASK) >> 6];
+        auto bit = uint64_t(1) << (address & 63);
+        if(!(word & bit)) {
+            word |= bit;
+            ++_count;
+        }
+    }
+    void clear(uint32_t address)
+    {
+        if(!test(address))
+            return;
+        _pages[address >> PAGE_BITS][(address & PAGE_MASK) >> 6] &= ~(uint64_t(1) << (address & 63));
+        if(!--_count)
+            _pages.clear();
+    }
+    void clearAll()
+    {
+        _pages.clear();
+        _count = 0;
+    }
+    bool empty() const { return !_count; }
+    size_t count() const { return _count; }
+
+private:
+    static constexpr uint32_t PAGE_BITS = 16;
+    static constexpr uint32_t PAGE_MASK = (1u << PAGE_BITS) - 1;
+    static constexpr uint32_t PAGE_WORDS = (1u << PAGE_BITS) / 64;
+    std::vector<std::vector<uint64_t>> _pages;
+    size_t _count{0};
+};
+
+//---------------------------------------------------------------------------------------
+// Dense bit set with one bit per 256 byte memory page, the cores record written
+// pages in it for IChip8Emulator::takeWrittenPages(). While it is empty, set()
+// does nothing, so write paths don't need to check if tracking is enabled.
+// take() only visits the words between the lowest and highest one touched.
+//---------------------------------------------------------------------------------------
+class PageBitmap
+{
+public:
+    static constexpr uint32_t PAGE_BITS = 8;
+    void resize(size_t memorySize)
+    {
+        _pages = uint32_t((memorySize + (1u << PAGE_BITS) - 1) >> PAGE_BITS);
+        _words.assign((_pages + 63) / 64, 0);
+        _low = uint32_t(_words.size());
+        _high = 0;
+    }
+    void clear()
+    {
+        _words.clear();
+        _pages = _low = _high = 0;
+    }
+    bool empty() const { return _words.empty(); }
+    bool test(uint32_t address) const
+    {
+        auto page = address >> PAGE_BITS;
+        return page < _pages && (_words[page >> 6] & (uint64_t(1) << (page & 63)));
+    }
+    void set(uint32_t address)
+    {
+        auto page = address >> PAGE_BITS;
+        if(page < _pages) {
+            _words[page >> 6] |= uint64_t(1) << (page & 63);
+            _low = std::min(_low, page >> 6);
+            _high = std::max(_high, (page >> 6) + 1);
+        }
+    }
+    void setRange(uint32_t address, uint32_t size)
+    {
+        if(!size)
+            return;
+        for(auto page = address >> PAGE_BITS; page <= (address + size - 1) >> PAGE_BITS; ++page)
+            set(page << PAGE_BITS);
+    }
+    void setAll()
+    {
+        std::fill(_words.begin(), _words.end(), ~uint64_t(0));
+        if(_pages & 63)
+            _words.back() = (uint64_t(1) << (_pages & 63)) - 1;
+        _low = 0;
+        _high = uint32_t(_words.size());
+    }
+    // moves the indices of all set pages to the list and clears them
+    void take(std::vector<uint32_t>& pages)
+    {
+        pages.clear();
+        for(auto word = _low; word < _high; ++word) {
+            auto page = word * 64;
+            for(auto bits = _words[word]; bits; bits >>= 1, ++page) {
+                if(bits & 1)
+                    pages.push_back(page);
+            }
+            _words[word] = 0;
+        }
+        _low = uint32_t(_words.size());
+        _high = 0;
+    }
+
+private:
+    std::vector<uint64_t> _words;
+    uint32_t _pages{0};
+    uint32_t _low{0};
+    uint32_t _high{0};
+};
+
+}  // namespace emu
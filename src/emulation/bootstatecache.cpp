@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/bootstatecache.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/bootstatecache.hpp>
+#include <emulation/ichip8.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace emu {
+
+static std::mutex g_bootStateMutex;
+static std::map<std::string, std::vector<uint8_t>> g_bootStates;
+
+std::string BootStateCache::makeKey(const std::string& coreName, const Chip8EmulatorOptions& options, const Properties& properties)
+{
+    nlohmann::json j;
+    j["core"] = coreName;
+    j["options"] = options;
+    j["properties"] = properties;
+    return j.dump();
+}
+
+bool BootStateCache::restore(const std::string& key, IChip8Emulator& emu)
+{
+    std::lock_guard<std::mutex> guard(g_bootStateMutex);
+    auto iter = g_bootStates.find(key);
+    return iter != g_bootStates.end() && emu.loadState(iter->second.data(), iter->second.size());
+}
+
+void BootStateCache::store(const std::string& key, const IChip8Emulator& emu)
+{
+    std::vector<uint8_t> state;
+    if(!emu.saveState(state))
+        return;
+    std::lock_guard<std::mutex> guard(g_bootStateMutex);
+    if(g_bootStates.size() >= MAX_ENTRIES && !g_bootStates.count(key))
+        g_bootStates.clear();
+    g_bootStates[key] = std::move(state);
+}
+
+void BootStateCache::clear()
+{
+    std::lock_guard<std::mutex> guard(g_bootStateMutex);
+    g_bootStates.clear();
+}
+
+}
@@ -0,0 +1,53 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/bootstatecache.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/chip8options.hpp>
+#include <emulation/properties.hpp>
+
+#include <string>
+
+namespace emu {
+
+class IChip8Emulator;
+
+//---------------------------------------------------------------------------------------
+// Process wide cache of the machine state real cores reach after running their
+// interpreter boot code. The key combines the core name, the options and the core
+// properties, so any change that could influence the boot leads to a fresh boot.
+// Restoring uses the save-state API of the core, so a reset costs a state copy
+// instead of emulating the boot sequence again.
+//---------------------------------------------------------------------------------------
+class BootStateCache
+{
+public:
+    static constexpr size_t MAX_ENTRIES = 32;
+    static std::string makeKey(const std::string& coreName, const Chip8EmulatorOptions& options, const Properties& properties);
+    static bool restore(const std::string& key, IChip8Emulator& emu);
+    static void store(const std::string& key, const IChip8Emulator& emu);
+    static void clear();
+};
+
+}
@@ -287,16 +287,6 @@ void Chip8EmulatorFP::setHandler()
 
 Chip8EmulatorFP::~Chip8EmulatorFP()
 {
-#ifdef GEN_OPCODE_STATS
-    std::vector<std::pair<uint16_t,int64_t>> result;
-    for(const auto& p : _opcodeStats)
-        result.push_back(p);
-    std::sort(result.begin(), result.end(), [](const auto& p1, const auto& p2){ return p1.second < p2.second;});
-    std::cout << "Opcode statistics:" << std::endl;
-    for(const auto& p : result) {
-        std::cout << fmt::format("{:04X}: {}", p.first, p.second) << std::endl;
-    }
-#endif
 }
 
 void Chip8EmulatorFP::reset()
@@ -314,9 +304,21 @@ inline void Chip8EmulatorFP::executeInstructionNoBreakpoints()
     uint16_t opcode = (_memory[_rPC] << 8) | _memory[_rPC + 1];
     ++_cycleCounter;
     _rPC = (_rPC + 2) & ADDRESS_MASK;
+    if(_opcodeProfiler)
+        _opcodeProfiler->count(opcode);
     (this->*_opcodeHandler[opcode])(opcode);
 }
 
+// plain run with breakpoints armed, only the bitmap is checked after each instruction
+inline void Chip8EmulatorFP::executeInstructionCheckingBreakpoints()
+{
+    executeInstructionNoBreakpoints();
+    if(GenericCpu::hasBreakPoint(_rPC) && triggerBreakpoint(_rPC)) {
+        _execMode = ePAUSED;
+        _breakpointTriggered = true;
+    }
+}
+
 void Chip8EmulatorFP::executeInstructions(int numInstructions)
 {
     if(_execMode == ePAUSED)
@@ -326,8 +328,12 @@ void Chip8EmulatorFP::executeInstructions(int numInstructions)
         if(_execMode == eRUNNING) {
             auto end = _cycleCounter + numInstructions;
             while (_execMode == eRUNNING && _cycleCounter < end) {
-                if (_breakpoints.empty() && !_options.optTraceLog)
-                    Chip8EmulatorFP::executeInstructionNoBreakpoints();
+                if (!hasWatchpoints() && !_options.optTraceLog && !_memoryHeatmap) {
+                    if(_breakpoints.empty())
+                        Chip8EmulatorFP::executeInstructionNoBreakpoints();
+                    else
+                        Chip8EmulatorFP::executeInstructionCheckingBreakpoints();
+                }
                 else
                     Chip8EmulatorFP::executeInstruction();
             }
@@ -338,19 +344,12 @@ void Chip8EmulatorFP::executeInstructions(int numInstructions)
         }
     }
     else if(_isInstantDxyn) {
-        if(_execMode ==  eRUNNING && _breakpoints.empty() && !_options.optTraceLog) {
+        if(_execMode ==  eRUNNING && _breakpoints.empty() && !hasWatchpoints() && !_options.optTraceLog && !_memoryHeatmap) {
             for (int i = 0; i < numInstructions; ++i) {
                 uint16_t opcode = (_memory[_rPC] << 8) | _memory[_rPC + 1];
                 _rPC = (_rPC + 2) & ADDRESS_MASK;
-#ifdef GEN_OPCODE_STATS
-                if((opcode & 0xF000) == 0xD000)
-                    _opcodeStats[opcode & 0xF00F]++;
-                else {
-                    const auto* info = _opcodeSet.getOpcodeInfo(opcode);
-                    if(info)
-                        _opcodeStats[info->opcode]++;
-                }
-#endif
+                if(_opcodeProfiler)
+                    _opcodeProfiler->count(opcode);
                 (this->*_opcodeHandler[opcode])(opcode);
                 if(_cpuState == eWAITING) {
                     _cycleCounter += numInstructions - i;
@@ -373,8 +372,12 @@ void Chip8EmulatorFP::executeInstructions(int numInstructions)
             //    _systemTime.addCycles(_cycleCounter - start);
             //    return;
             //}
-            if(_execMode == eRUNNING && _breakpoints.empty() && !_options.optTraceLog)
-                Chip8EmulatorFP::executeInstructionNoBreakpoints();
+            if(_execMode == eRUNNING && !hasWatchpoints() && !_options.optTraceLog && !_memoryHeatmap) {
+                if(_breakpoints.empty())
+                    Chip8EmulatorFP::executeInstructionNoBreakpoints();
+                else
+                    Chip8EmulatorFP::executeInstructionCheckingBreakpoints();
+            }
             else
                 Chip8EmulatorFP::executeInstruction();
         }
@@ -384,20 +387,17 @@ void Chip8EmulatorFP::executeInstructions(int numInstructions)
 
 inline void Chip8EmulatorFP::executeInstruction()
 {
+    bool watched = false;
     if(_execMode == eRUNNING) {
         if(_options.optTraceLog && _cpuState != eWAITING)
-            Logger::log(Logger::eCHIP8, _cycleCounter, {_frameCounter, int(_cycleCounter % 9999)}, dumpStateLine().c_str());
+            traceInstruction();
         uint16_t opcode = (_memory[_rPC] << 8) | _memory[_rPC + 1];
+        if(_memoryHeatmap && _cpuState != eWAITING)
+            countMemoryAccesses(_rPC, opcode);
+        watched = hasWatchpoints() && _cpuState != eWAITING && accessesWatchpoint(opcode);
         _rPC = (_rPC + 2) & ADDRESS_MASK;
-#ifdef GEN_OPCODE_STATS
-        if((opcode & 0xF000) == 0xD000)
-            _opcodeStats[opcode & 0xF00F]++;
-        else {
-            const auto* info = _opcodeSet.getOpcodeInfo(opcode);
-            if(info)
-                _opcodeStats[info->opcode]++;
-        }
-#endif
+        if(_opcodeProfiler)
+            _opcodeProfiler->count(opcode);
         (this->*_opcodeHandler[opcode])(opcode);
         ++_cycleCounter;
     }
@@ -405,20 +405,25 @@ inline void Chip8EmulatorFP::executeInstruction()
         if (_execMode == ePAUSED || _cpuState == eERROR)
             return;
         if(_options.optTraceLog)
-            Logger::log(Logger::eCHIP8, _cycleCounter, {_frameCounter, int(_cycleCounter % 9999)}, dumpStateLine().c_str());
+            traceInstruction();
         uint16_t opcode = (_memory[_rPC] << 8) | _memory[_rPC + 1];
+        if(_memoryHeatmap)
+            countMemoryAccesses(_rPC, opcode);
+        watched = hasWatchpoints() && accessesWatchpoint(opcode);
         _rPC = (_rPC + 2) & ADDRESS_MASK;
+        if(_opcodeProfiler)
+            _opcodeProfiler->count(opcode);
         (this->*_opcodeHandler[opcode])(opcode);
         ++_cycleCounter;
         if (_execMode == eSTEP || (_execMode == eSTEPOVER && _rSP <= _stepOverSP)) {
             _execMode = ePAUSED;
         }
     }
-    if(hasBreakPoint(_rPC)) {
-        if(Chip8EmulatorBase::findBreakpoint(_rPC)) {
-            _execMode = ePAUSED;
-            _breakpointTriggered = true;
-        }
+    if(watched)
+        watchpointHit();
+    if(hasBreakPoint(_rPC) && triggerBreakpoint(_rPC)) {
+        _execMode = ePAUSED;
+        _breakpointTriggered = true;
     }
 }
 
@@ -1191,7 +1196,8 @@ void Chip8EmulatorFP::opCxnn(uint16_t opcode)
         _rV[(opcode >> 8) & 0xF] = result;
     }
     else {
-        _rV[(opcode >> 8) & 0xF] = (rand() >> 4) & (opcode & 0xFF);
+        // seeded per core instead of libc rand(), so replays and save states are exact
+        _rV[(opcode >> 8) & 0xF] = classicRand(_simpleRandState) & (opcode & 0xFF);
     }
 }
 
@@ -74,12 +74,30 @@ public:
     }
 
     void executeInstruction() override
+    {
+        if(_execMode == ePAUSED || _cpuState == eERROR)
+            return;
+        if(_memoryHeatmap)
+            countMemoryAccesses(_rPC, readWord(_rPC));
+        bool watched = hasWatchpoints() && accessesWatchpoint(readWord(_rPC));
+        executeInstructionNoHeatmap();
+        if(watched)
+            watchpointHit();
+        if(hasBreakPoint(_rPC) && triggerBreakpoint(_rPC)) {
+            _execMode = ePAUSED;
+            _breakpointTriggered = true;
+        }
+    }
+
+    void executeInstructionNoHeatmap()
     {
         if (_execMode == ePAUSED || _cpuState == eERROR)
             return;
         uint16_t opcode = readWord(_rPC);
         _rPC = (_rPC + 2) & ADDRESS_MASK;
         ++_cycleCounter;
+        if(_opcodeProfiler)
+            _opcodeProfiler->count(opcode);
         switch (opcode >> 12) {
             case 0:
                 if((opcode & 0xfff0) == 0x00C0) { // scroll-down
@@ -415,16 +433,33 @@ public:
     }
 
     void executeInstructions(int numInstructions) override
+    {
+        // decided once per slice, so the plain run loop doesn't pay for the heatmap, breakpoints or watchpoints
+        if(_memoryHeatmap || hasWatchpoints() || !_breakpoints.empty())
+            executeInstructionSlice<true>(numInstructions);
+        else
+            executeInstructionSlice<false>(numInstructions);
+    }
+
+    template<bool withChecks>
+    void executeInstructionSlice(int numInstructions)
     {
         if(_options.optInstantDxyn) {
-            for (int i = 0; i < numInstructions; ++i)
-                Chip8Emulator::executeInstruction();
+            for (int i = 0; i < numInstructions; ++i) {
+                if constexpr (withChecks)
+                    Chip8Emulator::executeInstruction();
+                else
+                    Chip8Emulator::executeInstructionNoHeatmap();
+            }
         }
         else {
             for (int i = 0; i < numInstructions; ++i) {
                 if (i && (((_memory[_rPC] << 8) | _memory[_rPC + 1]) & 0xF000) == 0xD000)
                     return;
-                Chip8Emulator::executeInstruction();
+                if constexpr (withChecks)
+                    Chip8Emulator::executeInstruction();
+                else
+                    Chip8Emulator::executeInstructionNoHeatmap();
             }
         }
     }
@@ -487,8 +522,10 @@ public:
 private:
     void write(const uint32_t addr, uint8_t val)
     {
-        if(addr <= ADDRESS_MASK)
+        if(addr <= ADDRESS_MASK) {
             _memory[addr] = val;
+            _writtenPages.set(addr);
+        }
     }
 };
 
@@ -516,8 +553,11 @@ public:
     }
 
     void reset() override;
+    uint32_t getRandomState() const override { return _simpleRandState; }
+    void setRandomState(uint32_t state) override { _simpleRandState = state; }
     void executeInstruction() override;
     void executeInstructionNoBreakpoints();
+    void executeInstructionCheckingBreakpoints();
     void executeInstructions(int numInstructions) override;
 
     uint8_t getNextMCSample() override;
@@ -818,6 +858,22 @@ public:
 
     void renderAudio(int16_t* samples, size_t frames, int sampleFrequency) override;
 
+protected:
+    void saveCoreState(StateWriter& writer) const override
+    {
+        writer.write(_simpleRandSeed);
+        writer.write(_simpleRandState);
+        writer.write(int32_t(_chip8xBackgroundColor));
+        writer.write(_vp595Frequency);
+    }
+    void loadCoreState(StateReader& reader) override
+    {
+        reader.read(_simpleRandSeed);
+        reader.read(_simpleRandState);
+        _chip8xBackgroundColor = reader.read<int32_t>();
+        reader.read(_vp595Frequency);
+    }
+
 private:
     uint8_t read(const uint32_t addr) const
     {
@@ -827,17 +883,16 @@ private:
     }
     void write(const uint32_t addr, uint8_t val)
     {
-        if(addr <= ADDRESS_MASK)
+        if(addr <= ADDRESS_MASK) {
             _memory[addr] = val;
+            _writtenPages.set(addr);
+        }
     }
     std::vector<OpcodeHandler> _opcodeHandler;
     uint32_t _simpleRandSeed{12345};
     uint32_t _simpleRandState{12345};
     int _chip8xBackgroundColor{0};
     uint8_t _vp595Frequency{0x80};
-#ifdef GEN_OPCODE_STATS
-    std::map<uint16_t,int64_t> _opcodeStats;
-#endif
 };
 
 
@@ -25,7 +25,9 @@
 //---------------------------------------------------------------------------------------
 
 #include <emulation/chip8dream.hpp>
+#include <emulation/bootstatecache.hpp>
 #include <emulation/logger.hpp>
+#include <emulation/scheduler.hpp>
 #include <emulation/hardware/mc682x.hpp>
 #include <emulation/hardware/keymatrix.hpp>
 #include <chiplet/utility.hpp>
@@ -49,8 +51,9 @@ static const std::string PROP_ROM_NAME = "ROM Name";
 
 class Chip8Dream::Private {
 public:
+    using Cpu = M6800<uint8_t, uint16_t, uint32_t, flags8_t, Chip8Dream>;
     static constexpr uint16_t FETCH_LOOP_ENTRY = 0xC00C;
-    explicit Private(Chip8EmulatorHost& host, M6800Bus<>& bus, Chip8EmulatorOptions& options)
+    explicit Private(Chip8EmulatorHost& host, Chip8Dream& bus, Chip8EmulatorOptions& options)
         : _host(host)
         , _cpu(bus)/*, _video(Cdp186x::eCDP1861, _cpu, options)*/
         , _properties(options.properties)
@@ -71,10 +74,83 @@ public:
         }
         _memorySize = std::stoul(_properties[PROP_RAM].getSelectedText());
         _ram.resize(_memorySize, 0);
+        updateMemoryMap(bus);
     }
+    // Builds the 256 byte page table of the cpu bus, RAM and the 1k CHIPOS ROM
+    // mirrored over 0xC000-0xFFFF. A nullptr page is handled by the slow path
+    // of the bus functions (PIA at 0x8010-0x801F, unmapped regions, RAM pages
+    // holding a watchpoint and, while writes are tracked, RAM pages not written
+    // since the last takeWrittenPages()), rebuilt when watchpoints change.
+    void updateMemoryMap(const GenericCpu& watches)
+    {
+        _readMap.fill(nullptr);
+        _writeMap.fill(nullptr);
+        for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+            _readMap[page] = _ram.data() + (page << 8);
+            _writeMap[page] = _ram.data() + (page << 8);
+        }
+        for(uint32_t page = 0xC0; page < 0x100; ++page) {
+            _readMap[page] = _rom.data() + ((page << 8) & 0x3ff);
+        }
+        // display RAM, writes take the slow path to track what the VDG has to redraw
+        _writeMap[0x01] = nullptr;
+        if(watches.hasWatchpoints()) {
+            for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+                if(watches.hasReadWatchpoint(page << 8, 256))
+                    _readMap[page] = nullptr;
+                if(watches.hasWriteWatchpoint(page << 8, 256))
+                    _writeMap[page] = nullptr;
+            }
+        }
+        if(!_writtenPages.empty()) {
+            for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+                if(!_writtenPages.test(page << 8))
+                    _writeMap[page] = nullptr;
+            }
+        }
+    }
+    // records a write to RAM from the slow path, the page can use the fast path
+    // again unless it is the display page
+    void markWritten(uint16_t addr, const GenericCpu& watches)
+    {
+        if(_writtenPages.empty())
+            return;
+        _writtenPages.set(addr);
+        auto page = addr >> 8;
+        if(page != 0x01 && !watches.hasWriteWatchpoint(page << 8, 256))
+            _writeMap[page] = _ram.data() + (page << 8);
+    }
+    // one bit per display byte, by 8 byte display row, plus a summary bit per row
+    void markVideoDirty(uint16_t addr)
+    {
+        auto row = (addr >> 3) & 31;
+        _dirtyVideo[row] |= 1 << (addr & 7);
+        _dirtyVideoRows |= 1u << row;
+    }
+    void markAllVideoDirty()
+    {
+        _dirtyVideo.fill(0xff);
+        _dirtyVideoRows = 0xffffffff;
+    }
+    // the interpreter keeps its registers in ram at 0x20-0x3F, pc at 0x22
+    uint16_t chip8PC() const { return (_ram[0x22] << 8) | _ram[0x23]; }
+    uint16_t chip8Opcode() const
+    {
+        auto pc = chip8PC();
+        return pc + 1u < _memorySize ? (_ram[pc] << 8) | _ram[pc + 1] : 0;
+    }
+    // raw interpreter registers as they were at the last fetch
+    struct FetchLatch
+    {
+        int64_t cycles;
+        int frameCycle;
+        std::array<uint8_t,32> regs;
+    };
     Chip8EmulatorHost& _host;
     uint32_t _memorySize{4096};
-    CadmiumM6800 _cpu;
+    Scheduler _scheduler;
+    Scheduler::EventId _vdgEvent{};
+    Cpu _cpu;
     MC682x _pia;
     KeyMatrix<4,4> _keyMatrix;
     bool _ic20aNAnd{false};
@@ -82,9 +158,17 @@ public:
     bool _lowFreq{true};
     int64_t _irqStart{0};
     int64_t _nextFrame{0};
+    int _lastFrameCycle{0};
     std::atomic<float> _wavePhase{0};
     std::vector<uint8_t> _ram{};
     std::array<uint8_t,1024> _rom{};
+    std::array<const uint8_t*,256> _readMap{};
+    std::array<uint8_t*,256> _writeMap{};
+    PageBitmap _writtenPages;
+    std::array<uint8_t,32> _dirtyVideo{};
+    uint32_t _dirtyVideoRows{0};
+    bool _screenChanged{true};
+    FetchLatch _fetched{};
     IChip8Emulator::VideoType _screen;
     Properties& _properties;
 };
@@ -221,6 +305,7 @@ Chip8Dream::Chip8Dream(Chip8EmulatorHost& host, Chip8EmulatorOptions& options, I
         auto [value, conn] = _impl->_keyMatrix.getCols(0xF);
         return 0xF == (((value & conn) | ~conn) & 0xF) ? false : true;
     };
+    _impl->_vdgEvent = _impl->_scheduler.registerEvent([this](cycles_t) { executeVDG(); });
     Chip8Dream::reset();
     if(other) {
         std::memcpy(_impl->_ram.data() + 0x200, other->memory() + 0x200, std::min(_impl->_ram.size() - 0x200, (size_t)other->memSize()));
@@ -254,30 +339,96 @@ void Chip8Dream::reset()
         std::generate(_impl->_ram.begin(), _impl->_ram.end(), rnd);
     }
     _impl->_screen.setAll(0);
+    _impl->markAllVideoDirty();
+    _impl->_writtenPages.setAll();
     _impl->_cpu.reset();
-    _impl->_ram[0x006] = 0xC0;
-    _impl->_ram[0x007] = 0x00;
-    setExecMode(eRUNNING);
-    while(!executeM6800() && (_impl->_cpu.getRegisterByName("SR").value & CadmiumM6800::I));
-    flushScreen();
-    M6800State state;
-    _impl->_ram[0x026] = 0x00;
-    _impl->_ram[0x027] = 0x00;
-    std::memset(&_impl->_ram[0x30], 0, 16);
-    _impl->_cpu.getState(state);
-    state.pc = 0xC000;
-    state.sp = 0x007f;
-    _impl->_cpu.setState(state);
-    _cycles = 0;
-    _frames = 0;
+    _skippedCycles = 0;
     _impl->_nextFrame = 0;
-    _cpuState = eNORMAL;
-    while(!executeM6800() || getPC() != 0x200); // fast-forward to fetch/decode loop
+    _impl->_lastFrameCycle = 0;
+    _impl->_scheduler.schedule(_impl->_vdgEvent, _impl->_nextFrame);
+    // CHIPOS init is only emulated once per configuration, trace logging wants to see it every time
+    auto bootKey = BootStateCache::makeKey(name(), _options, _impl->_properties);
+    if(_options.optTraceLog || !BootStateCache::restore(bootKey, *this)) {
+        _impl->_ram[0x006] = 0xC0;
+        _impl->_ram[0x007] = 0x00;
+        setExecMode(eRUNNING);
+        while(_impl->_cpu.getExecMode() == eRUNNING && !executeM6800() && (_impl->_cpu.getRegisterByName("SR").value & Private::Cpu::I));
+        flushScreen();
+        M6800State state;
+        _impl->_ram[0x026] = 0x00;
+        _impl->_ram[0x027] = 0x00;
+        std::memset(&_impl->_ram[0x30], 0, 16);
+        _impl->_cpu.getState(state);
+        state.pc = 0xC000;
+        state.sp = 0x007f;
+        _impl->_cpu.setState(state);
+        _cycles = 0;
+        _frames = 0;
+        _cpuState = eNORMAL;
+        while(_impl->_cpu.getExecMode() == eRUNNING && (!executeM6800() || _impl->chip8PC() != 0x200)); // fast-forward to fetch/decode loop
+        // a boot stopped by a breakpoint or an error must not be restored by later resets
+        if(_impl->_cpu.getExecMode() == eRUNNING && _cpuState != eERROR)
+            BootStateCache::store(bootKey, *this);
+    }
     setExecMode(_impl->_host.isHeadless() ? eRUNNING : ePAUSED);
     if(_options.optTraceLog)
         Logger::log(Logger::eBACKEND_EMU, _impl->_cpu.getCycles(), {_frames, frameCycle()}, fmt::format("End of reset: {}/{}", _impl->_cpu.getCycles(), frameCycle()).c_str());
 }
 
+bool Chip8Dream::saveState(std::vector<uint8_t>& state) const
+{
+    StateWriter writer(state, name());
+    saveBaseState(writer);
+    writer.beginChunk(stateTag("DRM6"));
+    writer.write(_impl->_ic20aNAnd);
+    writer.write(_impl->_soundEnabled);
+    writer.write(_impl->_lowFreq);
+    writer.write(_impl->_irqStart);
+    writer.write(_impl->_nextFrame);
+    writer.write(int32_t(_impl->_lastFrameCycle));
+    _impl->_keyMatrix.saveState(writer);
+    writer.endChunk();
+    writer.beginChunk(stateTag("6800"));
+    _impl->_cpu.saveState(writer);
+    writer.endChunk();
+    _impl->_pia.saveState(writer);
+    writer.beginChunk(stateTag("SCRN"));
+    _impl->_screen.saveState(writer);
+    writer.endChunk();
+    writer.writeMemory(_impl->_ram.data(), _impl->_ram.size());
+    return true;
+}
+
+bool Chip8Dream::loadState(const uint8_t* data, size_t size)
+{
+    StateReader reader(data, size, name());
+    if(!reader.isValid() || reader.memorySize() != _impl->_ram.size())
+        return false;
+    loadBaseState(reader);
+    reader.beginChunk(stateTag("DRM6"));
+    reader.read(_impl->_ic20aNAnd);
+    reader.read(_impl->_soundEnabled);
+    reader.read(_impl->_lowFreq);
+    reader.read(_impl->_irqStart);
+    reader.read(_impl->_nextFrame);
+    _impl->_lastFrameCycle = reader.read<int32_t>();
+    _impl->_keyMatrix.loadState(reader);
+    reader.endChunk();
+    _impl->_scheduler.schedule(_impl->_vdgEvent, _impl->_nextFrame);
+    reader.beginChunk(stateTag("6800"));
+    _impl->_cpu.loadState(reader);
+    reader.endChunk();
+    _impl->_pia.loadState(reader);
+    reader.beginChunk(stateTag("SCRN"));
+    _impl->_screen.loadState(reader);
+    reader.endChunk();
+    reader.readMemory(_impl->_ram.data(), _impl->_ram.size());
+    _impl->markAllVideoDirty();
+    _impl->_writtenPages.setAll();
+    _impl->_screenChanged = true;
+    return reader.isValid();
+}
+
 std::string Chip8Dream::name() const
 {
     return "DREAM6800";
@@ -295,14 +446,26 @@ void Chip8Dream::updateProperties(Property& changedProp)
 
 void Chip8Dream::fetchState()
 {
-    _state.cycles = _cycles;
-    _state.frameCycle = frameCycle();
-    std::memcpy(_state.v.data(), &_impl->_ram[0x30], 16);
-    _state.i = (_impl->_ram[0x26]<<8) | _impl->_ram[0x27];
-    _state.pc = (_impl->_ram[0x22]<<8) | _impl->_ram[0x23];
-    _state.sp = (0x05F - ((_impl->_ram[0x24]<<8) | _impl->_ram[0x25])) >> 1;
-    _state.dt = _impl->_ram[0x20];
-    _state.st = _impl->_ram[0x21];
+    auto& latch = _impl->_fetched;
+    latch.cycles = _cycles;
+    latch.frameCycle = frameCycle();
+    std::memcpy(latch.regs.data(), &_impl->_ram[0x20], latch.regs.size());
+    invalidateState();
+}
+
+void Chip8Dream::decodeState() const
+{
+    const auto& latch = _impl->_fetched;
+    auto reg = [&latch](int addr) { return latch.regs[addr - 0x20]; };
+    _state.cycles = latch.cycles;
+    _state.frameCycle = latch.frameCycle;
+    std::memcpy(_state.v.data(), &latch.regs[0x10], 16);
+    _state.i = (reg(0x26)<<8) | reg(0x27);
+    _state.pc = (reg(0x22)<<8) | reg(0x23);
+    _state.sp = (0x05F - ((reg(0x24)<<8) | reg(0x25))) >> 1;
+    _state.dt = reg(0x20);
+    _state.st = reg(0x21);
+    // entries below the stack pointer are not touched by an instruction in flight
     for(int i = 0; i < stackSize() && i < _state.sp; ++i) {
         _state.s[i] = (_impl->_ram[0x05F - i*2 - 1] << 8) | _impl->_ram[0x05F - i*2];
     }
@@ -312,6 +475,7 @@ void Chip8Dream::forceState()
 {
     _state.cycles = _cycles;
     _state.frameCycle = frameCycle();
+    _impl->_writtenPages.setAll();
     std::memcpy(&_impl->_ram[0x30], _state.v.data(), 16);
     _impl->_ram[0x26] = (_state.i >> 8); _impl->_ram[0x27] = _state.i & 0xFF;
     _impl->_ram[0x22] = (_state.pc >> 8); _impl->_ram[0x22] = _state.pc & 0xFF;
@@ -323,6 +487,7 @@ void Chip8Dream::forceState()
         _impl->_ram[sp - i*2 - 1] = _state.s[i] >> 8;
         _impl->_ram[sp - i*2] = _state.s[i] & 0xFF;
     }
+    validateState();
 }
 
 int64_t Chip8Dream::getMachineCycles() const
@@ -330,46 +495,120 @@ int64_t Chip8Dream::getMachineCycles() const
     return _impl->_cpu.getCycles();
 }
 
-int Chip8Dream::executeVDG()
-{
-    static int lastFC = 312*64 + 1;
-    auto fc = frameCycle();
-    if(fc < lastFC) {
-        flushScreen();
-        // CPU is halted for 124*64 Cycles while video frame is generated
-        _impl->_cpu.addCycles(128*64);
-        ++_frames;
-        // Trigger RTC/VSYNC on PIA (Will trigger IRQ on CPU)
-        _impl->_pia.pinCB1(true);
-        _impl->_pia.pinCB1(false);
-        _impl->_keyMatrix.updateKeys(_host.getKeyStates());
-        _host.vblank();
-    }
-    lastFC = fc;
-    return fc;
-}
+//---------------------------------------------------------------------------
+// Scheduled at the start of every frame, _nextFrame holds the due cycle so
+// it survives save states taken between the frame start and this event.
 
+void Chip8Dream::executeVDG()
+{
+    flushScreen();
+    // CPU is halted for 124*64 Cycles while video frame is generated
+    _impl->_cpu.addCycles(128*64);
+    ++_frames;
+    // Trigger RTC/VSYNC on PIA (Will trigger IRQ on CPU)
+    _impl->_pia.pinCB1(true);
+    _impl->_pia.pinCB1(false);
+    _impl->_keyMatrix.updateKeys(_host.getKeyStates());
+    _host.vblank();
+    _impl->_nextFrame = nextFrame();
+    _impl->_scheduler.schedule(_impl->_vdgEvent, _impl->_nextFrame);
+}
+
+// Only display bytes written since the last frame are expanded again, each
+// byte is 8 pixels wide and 4 lines high.
 void Chip8Dream::flushScreen()
 {
-    for(int y = 0; y < 32*4; ++y) {
-        for (int i = 0; i < 8; ++i) {
-            auto data = _impl->_ram[0x100 + (y>>2)*8 + i];
-            for (int j = 0; j < 8; ++j) {
-                _impl->_screen.setPixel(i * 8 + j, y, (data >> (7 - j)) & 1);
+    static const auto byteToPixels = []() {
+        std::array<std::array<uint8_t,8>,256> table{};
+        for(int data = 0; data < 256; ++data) {
+            for(int j = 0; j < 8; ++j)
+                table[data][j] = (data >> (7 - j)) & 1;
+        }
+        return table;
+    }();
+    auto rows = _impl->_dirtyVideoRows;
+    if(!rows)
+        return;
+    _impl->_dirtyVideoRows = 0;
+    for(int row = 0; row < 32; ++row) {
+        if(!(rows & (1u << row)))
+            continue;
+        auto dirty = _impl->_dirtyVideo[row];
+        _impl->_dirtyVideo[row] = 0;
+        for(int i = 0; i < 8; ++i) {
+            if(dirty & (1 << i)) {
+                const auto& pixels = byteToPixels[_impl->_ram[0x100 + row * 8 + i]];
+                for(int line = 0; line < 4; ++line)
+                    std::memcpy(&_impl->_screen.getPixelRef(i * 8, row * 4 + line), pixels.data(), 8);
             }
         }
     }
+    _impl->_screenChanged = true;
+}
+
+bool Chip8Dream::needsScreenUpdate()
+{
+    auto changed = _impl->_screenChanged;
+    _impl->_screenChanged = false;
+    return changed;
+}
+
+std::string Chip8Dream::formatM6800TraceRecord(const TraceRecord& record, const IChip8Emulator*)
+{
+    const auto& r = record.m6800;
+    auto [size, instruction] = CadmiumM6800::disassembleInstruction(record.code, record.code + 3, record.pc);
+    std::string text;
+    switch (size) {
+        case 2: text = fmt::format("{:04X}: {:02X} {:02X}     {}", record.pc, record.code[0], record.code[1], instruction); break;
+        case 3: text = fmt::format("{:04X}: {:02X} {:02X} {:02X}  {}", record.pc, record.code[0], record.code[1], record.code[2], instruction); break;
+        default: text = fmt::format("{:04X}: {:02X}        {}", record.pc, record.code[0], instruction); break;
+    }
+    std::string flags = "HINZVC";
+    for(int i = 0; i < 6; ++i) {
+        if(!(r.cc & (32 >> i)))
+            flags[i] = '-';
+    }
+    return fmt::format("{:28} ; A:{:02X} B:{:02X} X:{:04X} SP:{:04X} PC:{:04X} SR:{}", text, r.a, r.b, r.ix, r.sp, record.pc, flags);
+}
+
+void Chip8Dream::traceM6800(int frameCycle) const
+{
+    M6800State state;
+    _impl->_cpu.getState(state);
+    TraceRecord record{};
+    record.formatter = &formatM6800TraceRecord;
+    record.cycle = _impl->_cpu.getCycles();
+    record.frame = _frames;
+    record.frameCycle = frameCycle;
+    record.source = Logger::eBACKEND_EMU;
+    record.pc = state.pc;
+    for(int i = 0; i < 3; ++i)
+        record.code[i] = readDebugByte(state.pc + i);
+    record.m6800 = {state.ix, state.sp, state.a, state.b, state.cc};
+    Logger::trace(record);
 }
 
 bool Chip8Dream::executeM6800()
 {
-    static int lastFC = 0;
-    auto fc = executeVDG();
-    if(_options.optTraceLog  && _impl->_cpu.getCpuState() == CadmiumM6800::eNORMAL)
-        Logger::log(Logger::eBACKEND_EMU, _impl->_cpu.getCycles(), {_frames, fc}, fmt::format("{:28} ; {}", _impl->_cpu.disassembleInstructionWithBytes(-1, nullptr), _impl->_cpu.dumpRegisterState()).c_str());
+    auto cycles = _impl->_cpu.getCycles();
+    if(_impl->_scheduler.isDue(cycles))
+        _impl->_scheduler.runDue(cycles);
+    if(_impl->_cpu.getCpuState() == Private::Cpu::eWAIT && _impl->_cpu.getExecMode() == eRUNNING && _impl->_scheduler.nextDue() != Scheduler::NEVER) {
+        // WAI only ends with an interrupt, and that is raised by a scheduled event
+        if(auto skipped = _impl->_cpu.skipWaitUntil(int64_t(_impl->_scheduler.nextDue()))) {
+            _skippedCycles += skipped;
+            return false;
+        }
+    }
+    if(_options.optTraceLog  && _impl->_cpu.getCpuState() == Private::Cpu::eNORMAL)
+        traceM6800(int(cycles % 19968));
     if(_impl->_cpu.getPC() == Private::FETCH_LOOP_ENTRY) {
+        if(_opcodeProfiler)
+            profileChip8Instruction();
+        if(_memoryHeatmap)
+            countChip8MemoryAccesses();
         if(_options.optTraceLog)
-            Logger::log(Logger::eCHIP8, _cycles, {_frames, fc}, fmt::format("CHIP8: {:30} ; {}", disassembleInstructionWithBytes(-1, nullptr), dumpStateLine()).c_str());
+            traceChip8Instruction(int(cycles % 19968));
     }
     _impl->_cpu.executeInstruction();
 
@@ -383,19 +622,19 @@ bool Chip8Dream::executeM6800()
         else if (_execMode == eSTEP || (_execMode == eSTEPOVER && getSP() <= _stepOverSP)) {
             setExecMode(ePAUSED);
         }
-        auto nextOp = opcode();
-        bool newFrame = lastFC > fc;
-        lastFC = fc;
-        if(newFrame && (nextOp & 0xF000) == 0x1000 && (opcode() & 0xFFF) == getPC()) {
+        auto pc = _impl->chip8PC();
+        auto nextOp = _impl->chip8Opcode();
+        auto fc = int(cycles % 19968);
+        bool newFrame = _impl->_lastFrameCycle > fc;
+        _impl->_lastFrameCycle = fc;
+        if(newFrame && (nextOp & 0xF000) == 0x1000 && (nextOp & 0xFFF) == pc) {
             flushScreen();
             _host.updateScreen();
             setExecMode(ePAUSED);
         }
-        if(hasBreakPoint(getPC())) {
-            if(Chip8Dream::findBreakpoint(getPC())) {
-                setExecMode(ePAUSED);
-                _breakpointTriggered = true;
-            }
+        if(hasBreakPoint(pc) && triggerBreakpoint(pc)) {
+            setExecMode(ePAUSED);
+            _breakpointTriggered = true;
         }
         return true;
     }
@@ -433,6 +672,11 @@ inline int Chip8Dream::frameCycle() const
     return _impl->_cpu.getCycles() % 19968;
 }
 
+Logger::FrameTime Chip8Dream::logFrameTime() const
+{
+    return {_frames, frameCycle()};
+}
+
 inline cycles_t Chip8Dream::nextFrame() const
 {
     return ((_impl->_cpu.getCycles() + 19968) / 19968) * 19968;
@@ -454,12 +698,12 @@ void Chip8Dream::tick(int)
 int64_t Chip8Dream::executeFor(int64_t microseconds)
 {
     if(_execMode != ePAUSED) {
-        auto cpuTime = _impl->_cpu.getTime();
-        auto endTime = cpuTime + Time::fromMicroseconds(microseconds);
-        while(_execMode != GenericCpu::ePAUSED && _impl->_cpu.getTime() < endTime) {
+        const auto& cpuTime = _impl->_cpu.getTime();
+        auto endCycles = _impl->_cpu.getCycles() + cpuTime.cyclesFromMicroseconds(microseconds);
+        while(_execMode != GenericCpu::ePAUSED && _impl->_cpu.getCycles() < endCycles) {
             executeInstruction();
         }
-        return _impl->_cpu.getTime().difference_us(endTime);
+        return cpuTime.microsecondsFromCycles(_impl->_cpu.getCycles() - endCycles);
     }
     return 0;
 }
@@ -470,6 +714,14 @@ bool Chip8Dream::isDisplayEnabled() const
 }
 
 uint8_t* Chip8Dream::memory()
+{
+    // the caller might write to display RAM, bypassing the bus
+    _impl->markAllVideoDirty();
+    _impl->_writtenPages.setAll();
+    return _impl->_ram.data();
+}
+
+const uint8_t* Chip8Dream::memoryView() const
 {
     return _impl->_ram.data();
 }
@@ -481,7 +733,7 @@ int Chip8Dream::memSize() const
 
 uint8_t Chip8Dream::soundTimer() const
 {
-    return (_impl->_pia.portB() & 64) ? _state.st : 0;
+    return (_impl->_pia.portB() & 64) ? chip8State().st : 0;
 }
 
 /*float Chip8Dream::getAudioPhase() const
@@ -539,26 +791,54 @@ GenericCpu& Chip8Dream::getBackendCpu()
     return _impl->_cpu;
 }
 
+void Chip8Dream::watchpointsChanged()
+{
+    _impl->updateMemoryMap(*this);
+}
+
+bool Chip8Dream::setWriteTracking(bool enable)
+{
+    if(enable) {
+        _impl->_writtenPages.resize(_impl->_memorySize);
+        _impl->_writtenPages.setAll();
+    }
+    else {
+        _impl->_writtenPages.clear();
+    }
+    _impl->updateMemoryMap(*this);
+    return true;
+}
+
+void Chip8Dream::takeWrittenPages(std::vector<uint32_t>& pages)
+{
+    _impl->_writtenPages.take(pages);
+    // the next write to any of these has to take the slow path to get recorded
+    for(auto page : pages)
+        _impl->_writeMap[page] = nullptr;
+}
+
 uint8_t Chip8Dream::readByte(uint16_t addr) const
 {
-    if(addr < _impl->_ram.size())
+    if(const auto* page = _impl->_readMap[addr >> 8])
+        return page[addr & 0xff];
+    if(addr < _impl->_ram.size()) {
+        checkReadWatch(addr);
         return _impl->_ram[addr];
+    }
     if(addr >= 0x8010 && addr < 0x8020)
         return _impl->_pia.readByte(addr & 3);
-    if(addr >= 0xC000)
-        return _impl->_rom[addr & 0x3ff];
     _cpuState = eERROR;
     return 0;
 }
 
 uint8_t Chip8Dream::readDebugByte(uint16_t addr) const
 {
+    if(const auto* page = _impl->_readMap[addr >> 8])
+        return page[addr & 0xff];
     if(addr < _impl->_ram.size())
         return _impl->_ram[addr];
     if(addr >= 0x8010 && addr < 0x8020)
         return _impl->_pia.readByte(addr & 3);
-    if(addr >= 0xC000)
-        return _impl->_rom[addr & 0x3ff];
     return 0;
 }
 
@@ -569,8 +849,15 @@ uint8_t Chip8Dream::getMemoryByte(uint32_t addr) const
 
 void Chip8Dream::writeByte(uint16_t addr, uint8_t val)
 {
-    if(addr < _impl->_ram.size())
+    if(auto* page = _impl->_writeMap[addr >> 8])
+        page[addr & 0xff] = val;
+    else if(addr < _impl->_ram.size()) {
+        checkWriteWatch(addr);
+        if((addr & 0xFF00) == 0x100 && _impl->_ram[addr] != val)
+            _impl->markVideoDirty(addr);
         _impl->_ram[addr] = val;
+        _impl->markWritten(addr, *this);
+    }
     else if(addr >= 0x8010 && addr < 0x8020)
         _impl->_pia.writeByte(addr & 3, val);
     else {
@@ -31,7 +31,7 @@
 
 namespace emu {
 
-class Chip8Dream : public Chip8RealCoreBase, public M6800Bus<>
+class Chip8Dream : public Chip8RealCoreBase
 {
 public:
 public:
@@ -42,6 +42,8 @@ public:
     ~Chip8Dream() override;
 
     void reset() override;
+    bool saveState(std::vector<uint8_t>& state) const override;
+    bool loadState(const uint8_t* data, size_t size) override;
     std::string name() const override;
     int64_t executeFor(int64_t microseconds) override;
     void executeInstruction() override;
@@ -51,7 +53,10 @@ public:
     int64_t getMachineCycles() const override;
 
     uint8_t* memory() override;
+    const uint8_t* memoryView() const override;
     int memSize() const override;
+    bool setWriteTracking(bool enable) override;
+    void takeWrittenPages(std::vector<uint32_t>& pages) override;
 
     bool isGenericEmulation() const override { return false; }
 
@@ -60,17 +65,18 @@ public:
     uint16_t getMaxScreenWidth() const override;
     uint16_t getMaxScreenHeight() const override;
     const VideoType* getScreen() const override;
+    bool needsScreenUpdate() override;
 
     uint8_t soundTimer() const override;
     //float getAudioPhase() const override;
     //void setAudioPhase(float phase) override;
     void renderAudio(int16_t* samples, size_t frames, int sampleFrequency) override;
 
-    // M6800-Bus
-    uint8_t readByte(uint16_t addr) const override;
-    uint8_t readDebugByte(uint16_t addr) const override;
+    // M6800-Bus, used directly as the bus type of the cpu
+    uint8_t readByte(uint16_t addr) const;
+    uint8_t readDebugByte(uint16_t addr) const;
     uint8_t getMemoryByte(uint32_t addr) const override;
-    void writeByte(uint16_t addr, uint8_t val) override;
+    void writeByte(uint16_t addr, uint8_t val);
 
     bool isDisplayEnabled() const override;
 
@@ -78,15 +84,22 @@ public:
 
     Properties& getProperties() override;
     void updateProperties(Property& changedProp) override;
+    Logger::Source logSource() const override { return Logger::eCHIP8; }
+    Logger::FrameTime logFrameTime() const override;
+
+    static std::string formatM6800TraceRecord(const TraceRecord& record, const IChip8Emulator* chip8);
 
 private:
     int frameCycle() const;
     cycles_t nextFrame() const;
     //int videoLine() const;
     bool executeM6800();
-    int executeVDG();
+    void traceM6800(int frameCycle) const;
+    void executeVDG();
     void flushScreen();
     void fetchState();
+    void watchpointsChanged() override;
+    void decodeState() const override;
     void forceState();
     class Private;
     std::unique_ptr<Private> _impl;
@@ -29,6 +29,8 @@
 #include <emulation/logger.hpp>
 #include <emulation/properties.hpp>
 
+#include <algorithm>
+
 namespace emu {
 
 static uint8_t g_chip8VipFont[] = {
@@ -351,6 +353,7 @@ void Chip8EmulatorBase::reset()
     _rST = 0;
     std::memset(_rV.data(), 0, 16);
     std::memset(_memory.data(), 0, _memory.size());
+    _writtenPages.setAll();
     auto [smallFont, smallSize] = getSmallFontData();
     std::memcpy(_memory.data(), smallFont, smallSize);
     auto [bigFont, bigSize] = getBigFontData();
@@ -387,6 +390,227 @@ void Chip8EmulatorBase::reset()
     _mcPalette[254] = 0xffffffff;
 }
 
+void Chip8EmulatorBase::traceInstruction() const
+{
+    TraceRecord record{};
+    record.formatter = &Chip8EmulatorBase::formatTraceRecord;
+    record.cycle = _cycleCounter;
+    record.frame = _frameCounter;
+    record.frameCycle = _cycleCounter % 9999;
+    record.source = Logger::eCHIP8;
+    record.pc = _rPC;
+    record.code[0] = _memory[_rPC & (memSize() - 1)];
+    record.code[1] = _memory[(_rPC + 1) & (memSize() - 1)];
+    std::memcpy(record.chip8.v, _rV.data(), 16);
+    record.chip8.i = _rI;
+    record.chip8.sp = _rSP;
+    Logger::trace(record);
+}
+
+uint32_t Chip8EmulatorBase::spriteBytes(uint16_t opcode) const
+{
+    if(_isMegaChipMode && _rI >= 0x100)
+        return _spriteWidth * _spriteHeight;
+    uint32_t bytes = opcode & 0xF;
+    if(!bytes && !_isMegaChipMode) {
+        if(_options.optLoresDxy0Is16x16 || (_isHires && !_options.optOnlyHires))
+            bytes = 32;
+        else if(_options.optLoresDxy0Is8x16)
+            bytes = 16;
+    }
+    int planes = 0;
+    for(auto p = _planes & 0xF; p; p &= p - 1)
+        ++planes;
+    return bytes * planes;
+}
+
+void Chip8EmulatorBase::countMemoryAccesses(uint32_t pc, uint16_t opcode)
+{
+    _memoryHeatmap->countChip8Instruction(pc, opcode, _rI, (opcode & 0xF000) == 0xD000 ? spriteBytes(opcode) : 0);
+    if(_isMegaChipMode && (opcode & 0xFF00) == 0x0200)
+        _memoryHeatmap->countRead(_rI, (opcode & 0xFF) * 4);
+}
+
+bool Chip8EmulatorBase::accessesWatchpoint(uint16_t opcode) const
+{
+    auto x = (opcode >> 8) & 0xF;
+    auto y = (opcode >> 4) & 0xF;
+    // I based loads and stores wrap at the end of memory, so a range can continue at zero
+    auto watched = [this](bool write, uint32_t size) {
+        auto address = uint32_t(_rI) & (memSize() - 1);
+        auto head = std::min(size, uint32_t(memSize()) - address);
+        auto test = [&](uint32_t from, uint32_t length) { return write ? hasWriteWatchpoint(from, length) : hasReadWatchpoint(from, length); };
+        return test(address, head) || (size > head && test(0, size - head));
+    };
+    switch(opcode >> 12) {
+        case 0x0:
+            return _isMegaChipMode && (opcode & 0xFF00) == 0x0200 && hasReadWatchpoint(_rI, (opcode & 0xFF) * 4);
+        case 0x5: {
+            // only XO-CHIP style variants have the 5xy2/5xy3 range ops, CHIP-8E only counts upwards
+            auto preset = _options.behaviorBase;
+            if(preset != Chip8EmulatorOptions::eXOCHIP && preset != Chip8EmulatorOptions::eCHICUEYI && (preset != Chip8EmulatorOptions::eCHIP8E || x >= y))
+                return false;
+            if((opcode & 0xF) == 2)
+                return watched(true, (x > y ? x - y : y - x) + 1);
+            if((opcode & 0xF) == 3)
+                return watched(false, (x > y ? x - y : y - x) + 1);
+            return false;
+        }
+        case 0xD:
+            return hasReadWatchpoint(_rI, spriteBytes(opcode));
+        case 0xF:
+            switch(opcode & 0xFF) {
+                case 0x02:
+                    return opcode == 0xF002 && hasReadWatchpoint(_rI, 16);
+                case 0x33:
+                    return watched(true, 3);
+                case 0x55:
+                    return watched(true, x + 1);
+                case 0x65:
+                    return watched(false, x + 1);
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+std::string Chip8EmulatorBase::formatTraceRecord(const TraceRecord& record, const IChip8Emulator* chip8)
+{
+    const auto& r = record.chip8;
+    return fmt::format("V0:{:02x} V1:{:02x} V2:{:02x} V3:{:02x} V4:{:02x} V5:{:02x} V6:{:02x} V7:{:02x} V8:{:02x} V9:{:02x} VA:{:02x} VB:{:02x} VC:{:02x} VD:{:02x} VE:{:02x} VF:{:02x} I:{:04x} SP:{:1x} PC:{:04x} O:{:04x}", r.v[0], r.v[1], r.v[2],
+                       r.v[3], r.v[4], r.v[5], r.v[6], r.v[7], r.v[8], r.v[9], r.v[10], r.v[11], r.v[12], r.v[13], r.v[14], r.v[15], r.i, r.sp, record.pc, (record.code[0] << 8) | record.code[1]);
+}
+
+bool Chip8EmulatorBase::saveState(std::vector<uint8_t>& state) const
+{
+    StateWriter writer(state, name());
+    writer.beginChunk(stateTag("C8EB"));
+    writer.write(_cpuState);
+    writer.writeString(_errorMessage);
+    writer.write(_isHires);
+    writer.write(_isInstantDxyn);
+    writer.write(_isMegaChipMode);
+    writer.write(_screenNeedsUpdate);
+    writer.write(_planes);
+    writer.write(_screenAlpha);
+    writer.write(_cycleCounter);
+    writer.write(_nextFrame);
+    writer.write(int32_t(_frameCounter));
+    writer.write(int32_t(_clearCounter));
+    writer.writeTime(_systemTime);
+    writer.write(_rI);
+    writer.write(_rPC);
+    writer.write(_stack);
+    writer.write(_rSP);
+    writer.write(_rDT);
+    writer.write(_rST.load());
+    writer.write(_rV);
+    writer.write(_randomSeed);
+    writer.write(_xoAudioPattern);
+    writer.write(_xoSilencePattern);
+    writer.write(_xoPitch.load());
+    writer.write(_sampleStep.load());
+    writer.write(_sampleStart.load());
+    writer.write(_sampleLength.load());
+    writer.write(_sampleLoop);
+    writer.write(_mcSamplePos.load());
+    writer.write(_xxoPalette);
+    writer.write(_mcPalette);
+    writer.write(_spriteWidth);
+    writer.write(_spriteHeight);
+    writer.write(_collisionColor);
+    writer.write(_blendMode);
+    writer.endChunk();
+    writer.beginChunk(stateTag("SCRN"));
+    _screen.saveState(writer);
+    if(_isMegaChipMode) {
+        writer.write(_screenRGBA == &_screenRGBA2);
+        _screenRGBA1.saveState(writer);
+        _screenRGBA2.saveState(writer);
+    }
+    writer.endChunk();
+    writer.writeMemory(_memory.data(), _memory.size());
+    writer.beginChunk(stateTag("CORE"));
+    saveCoreState(writer);
+    writer.endChunk();
+    return true;
+}
+
+bool Chip8EmulatorBase::loadState(const uint8_t* data, size_t size)
+{
+    StateReader reader(data, size, name());
+    if(!reader.isValid() || reader.memorySize() != _memory.size())
+        return false;
+    reader.beginChunk(stateTag("C8EB"));
+    reader.read(_cpuState);
+    _errorMessage = reader.readString();
+    reader.read(_isHires);
+    reader.read(_isInstantDxyn);
+    reader.read(_isMegaChipMode);
+    reader.read(_screenNeedsUpdate);
+    reader.read(_planes);
+    reader.read(_screenAlpha);
+    reader.read(_cycleCounter);
+    reader.read(_nextFrame);
+    _frameCounter = reader.read<int32_t>();
+    _clearCounter = reader.read<int32_t>();
+    reader.readTime(_systemTime);
+    reader.read(_rI);
+    reader.read(_rPC);
+    reader.read(_stack);
+    reader.read(_rSP);
+    reader.read(_rDT);
+    _rST = reader.read<uint8_t>();
+    reader.read(_rV);
+    reader.read(_randomSeed);
+    reader.read(_xoAudioPattern);
+    reader.read(_xoSilencePattern);
+    _xoPitch = reader.read<uint8_t>();
+    _sampleStep = reader.read<float>();
+    _sampleStart = reader.read<uint32_t>();
+    _sampleLength = reader.read<uint32_t>();
+    reader.read(_sampleLoop);
+    _mcSamplePos = reader.read<double>();
+    reader.read(_xxoPalette);
+    reader.read(_mcPalette);
+    reader.read(_spriteWidth);
+    reader.read(_spriteHeight);
+    reader.read(_collisionColor);
+    reader.read(_blendMode);
+    reader.endChunk();
+    reader.beginChunk(stateTag("SCRN"));
+    _screen.loadState(reader);
+    if(_isMegaChipMode) {
+        auto secondIsFront = reader.read<bool>();
+        _screenRGBA1.loadState(reader);
+        _screenRGBA2.loadState(reader);
+        _screenRGBA = secondIsFront ? &_screenRGBA2 : &_screenRGBA1;
+        _workRGBA = secondIsFront ? &_screenRGBA1 : &_screenRGBA2;
+    }
+    reader.endChunk();
+    reader.readMemory(_memory.data(), _memory.size());
+    _writtenPages.setAll();
+    reader.beginChunk(stateTag("CORE"));
+    loadCoreState(reader);
+    reader.endChunk();
+    _screenNeedsUpdate = true;
+    return reader.isValid();
+}
+
+bool Chip8EmulatorBase::setWriteTracking(bool enable)
+{
+    if(enable) {
+        _writtenPages.resize(_memory.size());
+        _writtenPages.setAll();
+    }
+    else {
+        _writtenPages.clear();
+    }
+    return true;
+}
+
 int64_t Chip8EmulatorBase::executeFor(int64_t micros)
 {
     if (_execMode == ePAUSED || _cpuState == eERROR) {
@@ -394,9 +618,8 @@ int64_t Chip8EmulatorBase::executeFor(int64_t micros)
         return 0;
     }
     if(_options.instructionsPerFrame) {
-        auto startTime = _cycleCounter;
-        auto microsPerCycle = 1000000.0 / ((int64_t)_options.instructionsPerFrame * _options.frameRate);
-        auto endCycles = startTime + int64_t(micros/microsPerCycle);
+        auto cyclesPerSecond = (int64_t)_options.instructionsPerFrame * _options.frameRate;
+        auto endCycles = _cycleCounter + micros * cyclesPerSecond / 1000000;
         auto nextFrame = calcNextFrame();
         while(_execMode != ePAUSED && nextFrame <= endCycles) {
             executeInstructions(nextFrame - _cycleCounter);
@@ -408,7 +631,7 @@ int64_t Chip8EmulatorBase::executeFor(int64_t micros)
         while (_execMode != ePAUSED && _cycleCounter < endCycles) {
             executeInstruction();
         }
-        auto excessTime = int64_t((endCycles - _cycleCounter) * microsPerCycle);
+        auto excessTime = (endCycles - _cycleCounter) * 1000000 / cyclesPerSecond;
         return excessTime;// > 0 ? excessTime : 0;
     }
     else {
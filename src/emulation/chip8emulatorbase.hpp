@@ -29,6 +29,8 @@
 #include <emulation/chip8options.hpp>
 #include <emulation/chip8vip.hpp>
 #include <emulation/chip8opcodedisass.hpp>
+#include <emulation/statestream.hpp>
+#include <emulation/tracebuffer.hpp>
 #include <emulation/time.hpp>
 #include <emulation/videoscreen.hpp>
 
@@ -102,8 +104,10 @@ public:
             _xxoPalette = other->_xxoPalette;
             _mcPalette = other->_mcPalette;
             _randomSeed = other->_randomSeed;
-            std::memcpy(_breakMap.data(), other->_breakMap.data(), 4096);
+            _breakMap = other->_breakMap;
             _breakpoints = other->_breakpoints;
+            _readWatchMap = other->_readWatchMap;
+            _writeWatchMap = other->_writeWatchMap;
             _spriteWidth = other->_spriteWidth;
             _spriteHeight = other->_spriteHeight;
             _collisionColor = other->_collisionColor;
@@ -216,11 +220,20 @@ public:
     CpuState cpuState() const override { return _cpuState; }
     uint8_t delayTimer() const override { return _rDT; }
     uint8_t soundTimer() const override { return _rST; }
-    uint8_t* memory() override { return _memory.data(); }
+    uint8_t* memory() override { _writtenPages.setAll(); return _memory.data(); }
+    const uint8_t* memoryView() const override { return _memory.data(); }
     int memSize() const override { return _memSize; }
     void reset() override;
+    bool saveState(std::vector<uint8_t>& state) const override;
+    bool loadState(const uint8_t* data, size_t size) override;
+    bool setWriteTracking(bool enable) override;
+    void takeWrittenPages(std::vector<uint32_t>& pages) override { _writtenPages.take(pages); }
+    uint32_t getRandomSeed() const override { return _randomSeed; }
+    void setRandomSeed(uint32_t seed) override { _randomSeed = uint16_t(seed); }
     int64_t getCycles() const override { return _cycleCounter; }
     int64_t frames() const override { return _frameCounter; }
+    Logger::Source logSource() const override { return Logger::eCHIP8; }
+    Logger::FrameTime logFrameTime() const override { return {_frameCounter, int(_cycleCounter % 9999)}; }
     const ClockedTime& getTime() const override { return _systemTime; }
     const std::string& errorMessage() const override { return _errorMessage; }
 
@@ -289,10 +302,21 @@ public:
 
     static std::pair<const uint8_t*, size_t> smallFontData(Chip8Font font = Chip8Font::C8F5_COSMAC);
     static std::pair<const uint8_t*, size_t> bigFontData(Chip8BigFont font = Chip8BigFont::C8F10_SCHIP11);
+    static std::string formatTraceRecord(const TraceRecord& record, const IChip8Emulator* chip8);
 
 protected:
     inline int instructionsPerFrame() const { return _options.instructionsPerFrame ? _options.instructionsPerFrame : _systemTime.getClockFreq() / _options.frameRate; }
     virtual int64_t calcNextFrame() const { return ((_cycleCounter + _options.instructionsPerFrame) / _options.instructionsPerFrame) * _options.instructionsPerFrame; }
+    // hooks for cores with additional state, called inside the core chunk of saveState/loadState
+    virtual void saveCoreState(StateWriter& writer) const {}
+    virtual void loadCoreState(StateReader& reader) {}
+    // binary trace record of the state before the instruction at PC, formatted like dumpStateLine()
+    void traceInstruction() const;
+    // feeds the heatmap with the execution at pc and the memory the opcode will access
+    void countMemoryAccesses(uint32_t pc, uint16_t opcode);
+    // true if the opcode is about to read or write a watched address
+    bool accessesWatchpoint(uint16_t opcode) const;
+    uint32_t spriteBytes(uint16_t opcode) const;
     void swapMegaSchreens() {
         std::swap(_screenRGBA, _workRGBA);
     }
@@ -341,6 +365,7 @@ protected:
     uint16_t _randomSeed{0};
     std::vector<uint8_t> _memory{};
     int _memSize{};
+    PageBitmap _writtenPages;
     inline static const uint8_t _chip8_cosmac_vip[0x200] = {
         0x91, 0xbb, 0xff, 0x01, 0xb2, 0xb6, 0xf8, 0xcf, 0xa2, 0xf8, 0x81, 0xb1, 0xf8, 0x46, 0xa1, 0x90, 0xb4, 0xf8, 0x1b, 0xa4, 0xf8, 0x01, 0xb5, 0xf8, 0xfc, 0xa5, 0xd4, 0x96, 0xb7, 0xe2, 0x94, 0xbc, 0x45, 0xaf, 0xf6, 0xf6, 0xf6, 0xf6, 0x32, 0x44,
         0xf9, 0x50, 0xac, 0x8f, 0xfa, 0x0f, 0xf9, 0xf0, 0xa6, 0x05, 0xf6, 0xf6, 0xf6, 0xf6, 0xf9, 0xf0, 0xa7, 0x4c, 0xb3, 0x8c, 0xfc, 0x0f, 0xac, 0x0c, 0xa3, 0xd3, 0x30, 0x1b, 0x8f, 0xfa, 0x0f, 0xb3, 0x45, 0x30, 0x40, 0x22, 0x69, 0x12, 0xd4, 0x00,
@@ -7,6 +7,8 @@
 
 #include <fmt/format.h>
 
+#include <cctype>
+
 namespace emu {
 
 Chip8OpcodeDisassembler::Chip8OpcodeDisassembler(Chip8EmulatorOptions& options)
@@ -16,6 +18,45 @@ Chip8OpcodeDisassembler::Chip8OpcodeDisassembler(Chip8EmulatorOptions& options)
     _labelOrAddress = [](uint16_t addr){ return fmt::format("0x{:04X}", addr); };
 }
 
+void Chip8OpcodeDisassembler::setOpcodeProfiling(bool enable)
+{
+    if(!enable)
+        _opcodeProfiler.reset();
+    else if(!_opcodeProfiler)
+        _opcodeProfiler = std::make_unique<OpcodeProfiler>();
+}
+
+void Chip8OpcodeDisassembler::setMemoryHeatmap(bool enable)
+{
+    if(!enable)
+        _memoryHeatmap.reset();
+    else if(!_memoryHeatmap)
+        _memoryHeatmap = std::make_unique<MemoryHeatmap>(memSize());
+}
+
+std::vector<OpcodeProfiler::Summary> Chip8OpcodeDisassembler::opcodeProfile() const
+{
+    if(!_opcodeProfiler)
+        return {};
+    return _opcodeProfiler->summarize([this](uint16_t opcode) {
+        const auto* info = _opcodeSet.getOpcodeInfo(opcode);
+        if(!info)
+            return OpcodeProfiler::OpcodeClass{0x10000u | opcode, fmt::format("{:04X}", opcode), "invalid"};
+        return OpcodeProfiler::OpcodeClass{(uint32_t(info->type) << 17) | info->opcode, opcodePattern(info->type, info->opcode), info->octo};
+    });
+}
+
+std::string Chip8OpcodeDisassembler::opcodePattern(OpcodeType type, uint16_t opcode)
+{
+    static std::string patterns[] = {"FFFF", "FFFn", "FFnn", "Fnnn", "FxyF", "FxFF", "Fxyn", "Fxnn", "FFyF"};
+    auto opStr = fmt::format("{:04X}", opcode);
+    for(size_t i = 0; i < 4; ++i) {
+        if(std::islower((uint8_t)patterns[type][i]))
+            opStr[i] = patterns[type][i];
+    }
+    return opStr;
+}
+
 std::tuple<uint16_t, uint16_t, std::string> Chip8OpcodeDisassembler::disassembleInstruction(const uint8_t* code, const uint8_t* end) const
 {
     auto opcode = (*code << 8) | *(code + 1);
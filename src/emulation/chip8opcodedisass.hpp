@@ -32,6 +32,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -43,10 +44,19 @@ public:
     using SymbolResolver = std::function<std::string(uint16_t)>;
     Chip8OpcodeDisassembler(Chip8EmulatorOptions& options);
     std::tuple<uint16_t, uint16_t, std::string> disassembleInstruction(const uint8_t* code, const uint8_t* end) const override;
+    void setOpcodeProfiling(bool enable) override;
+    OpcodeProfiler* opcodeProfiler() override { return _opcodeProfiler.get(); }
+    std::vector<OpcodeProfiler::Summary> opcodeProfile() const override;
+    void setMemoryHeatmap(bool enable) override;
+    MemoryHeatmap* memoryHeatmap() override { return _memoryHeatmap.get(); }
+    // opcode pattern as used in the opcode table, e.g. "6xnn"
+    static std::string opcodePattern(OpcodeType type, uint16_t opcode);
 protected:
     Chip8EmulatorOptions& _options;
     SymbolResolver _labelOrAddress;
     detail::OpcodeSet _opcodeSet;
+    std::unique_ptr<OpcodeProfiler> _opcodeProfiler;
+    std::unique_ptr<MemoryHeatmap> _memoryHeatmap;
 };
 
 }
@@ -28,7 +28,9 @@
 #include <emulation/chip8emulatorhost.hpp>
 #include <emulation/chip8opcodedisass.hpp>
 #include <emulation/hardware/genericcpu.hpp>
+#include <emulation/logger.hpp>
 #include <emulation/properties.hpp>
+#include <emulation/statestream.hpp>
 
 #include <fmt/format.h>
 
@@ -82,11 +84,18 @@ public:
             getBackendCpu().setExecMode(mode);
         }
     }
+    void setOpcodeProfiling(bool enable) override
+    {
+        Chip8OpcodeDisassembler::setOpcodeProfiling(enable);
+        _profiledOpcode = -1;
+    }
     bool inErrorState() const override { return _cpuState == eERROR; }
     CpuState cpuState() const override { return _cpuState; }
     bool hybridChipMode() const { return _isHybridChipMode; }
     int64_t getCycles() const override { return _cycles; }
     int64_t frames() const override { return _frames; }
+    // backend machine cycles that were fast-forwarded while the cpu was idle (IDL/WAI)
+    int64_t skippedCycles() const { return _skippedCycles; }
     const ClockedTime& getTime() const override { return getBackendCpu().getTime(); }
 
     virtual GenericCpu& getBackendCpu() = 0;
@@ -104,14 +113,14 @@ public:
                            getV(3), getV(4), getV(5), getV(6), getV(7), getV(8), getV(9), getV(10), getV(11), getV(12), getV(13), getV(14), getV(15), getI(), getSP(), getPC(), op);
     }
 
-    uint8_t getV(uint8_t index) const override { return _state.v[index & 0xF]; }
-    uint32_t getPC() const override { auto pcstr = std::to_string(_state.pc); return _state.pc; }
-    uint32_t getI() const override { return _state.i; }
-    uint32_t getSP() const override { return _state.sp; }
+    uint8_t getV(uint8_t index) const override { return chip8State().v[index & 0xF]; }
+    uint32_t getPC() const override { return chip8State().pc; }
+    uint32_t getI() const override { return chip8State().i; }
+    uint32_t getSP() const override { return chip8State().sp; }
     uint8_t stackSize() const override { return 12; }
-    const uint16_t* getStackElements() const override { return _state.s.data(); }
-    uint8_t delayTimer() const override { return _state.dt; }
-    uint8_t soundTimer() const override { return _state.st; }
+    const uint16_t* getStackElements() const override { return chip8State().s.data(); }
+    uint8_t delayTimer() const override { return chip8State().dt; }
+    uint8_t soundTimer() const override { return chip8State().st; }
 
     virtual bool isDisplayEnabled() const = 0;
 
@@ -143,17 +152,18 @@ public:
 
     GenericCpu::RegisterValue getRegister(size_t index) const override
     {
+        const auto& state = chip8State();
         if(index < 16)
-            return {_state.v[index], 8};
+            return {state.v[index], 8};
         if(index == 16)
-            return {(uint32_t)_state.i, 16};
+            return {(uint32_t)state.i, 16};
         else if(index == 17)
-            return {(uint32_t)_state.dt, 8};
+            return {(uint32_t)state.dt, 8};
         else if(index == 18)
-            return {(uint32_t)_state.st, 8};
+            return {(uint32_t)state.st, 8};
         else if(index == 19)
-            return {(uint32_t)_state.pc, 16};
-        return {(uint32_t)_state.sp, 8};
+            return {(uint32_t)state.pc, 16};
+        return {(uint32_t)state.sp, 8};
     }
 
     void setRegister(size_t index, uint32_t value) override
@@ -179,16 +189,125 @@ public:
     }
     const std::string& errorMessage() const override { return _errorMessage; }
     bool isBreakpointTriggered() override { return GenericCpu::isBreakpointTriggered() || getBackendCpu().isBreakpointTriggered(); }
+    static std::string formatChip8TraceRecord(const TraceRecord& record, const IChip8Emulator* chip8)
+    {
+        const auto& r = record.chip8;
+        auto opcode = (record.code[0] << 8) | record.code[1];
+        std::string disassembly;
+        if(chip8) {
+            auto [size, op, instruction] = chip8->disassembleInstruction(record.code, record.code + 4);
+            if(size == 2)
+                disassembly = fmt::format("{:04X}: {:04X}  {}", record.pc, opcode, instruction);
+            else
+                disassembly = fmt::format("{:04X}: {:04X} {:04X}  {}", record.pc, opcode, (record.code[2] << 8) | record.code[3], instruction);
+        }
+        else {
+            disassembly = fmt::format("{:04X}: {:04X}", record.pc, opcode);
+        }
+        return fmt::format("CHIP8: {:30} ; V0:{:02x} V1:{:02x} V2:{:02x} V3:{:02x} V4:{:02x} V5:{:02x} V6:{:02x} V7:{:02x} V8:{:02x} V9:{:02x} VA:{:02x} VB:{:02x} VC:{:02x} VD:{:02x} VE:{:02x} VF:{:02x} I:{:04x} SP:{:1x} PC:{:04x} O:{:04x}", disassembly,
+                           r.v[0], r.v[1], r.v[2], r.v[3], r.v[4], r.v[5], r.v[6], r.v[7], r.v[8], r.v[9], r.v[10], r.v[11], r.v[12], r.v[13], r.v[14], r.v[15], r.i, r.sp, record.pc, opcode);
+    }
 protected:
+    // The CHIP-8 view of the interpreter state is only decoded when someone asks for
+    // it, the fetch loop just latches the raw backend values and calls invalidateState().
+    virtual void decodeState() const = 0;
+    void invalidateState() { ++_stateVersion; }
+    void validateState() const { _decodedVersion = _stateVersion; }
+    const Chip8State& chip8State() const
+    {
+        if(_decodedVersion != _stateVersion) {
+            decodeState();
+            validateState();
+        }
+        return _state;
+    }
+    // called at the interpreter fetch loop, the machine cycles since the previous fetch
+    // (including interrupts and DMA) are attributed to the previous CHIP-8 opcode
+    void profileChip8Instruction()
+    {
+        auto machineCycles = getMachineCycles();
+        if(_profiledOpcode >= 0 && machineCycles >= _profiledCycles)
+            _opcodeProfiler->count(uint16_t(_profiledOpcode), machineCycles - _profiledCycles);
+        _profiledOpcode = opcode();
+        _profiledCycles = machineCycles;
+    }
+    // the classic interpreters only draw n bytes high sprites and have no planes
+    void countChip8MemoryAccesses()
+    {
+        auto op = opcode();
+        _memoryHeatmap->countChip8Instruction(getPC(), op, getI(), op & 0xF);
+    }
+    // binary trace record of the CHIP-8 state at the interpreter fetch loop, the text is
+    // only generated when displayed, formatted like the "CHIP8: <disassembly> ; <state>" lines
+    void traceChip8Instruction(int frameCycle) const
+    {
+        TraceRecord record{};
+        record.formatter = &Chip8RealCoreBase::formatChip8TraceRecord;
+        record.cycle = _cycles;
+        record.frame = _frames;
+        record.frameCycle = frameCycle;
+        record.source = Logger::eCHIP8;
+        record.pc = getPC();
+        for(int i = 0; i < 4; ++i)
+            record.code[i] = getMemoryByte(record.pc + i);
+        const auto& state = chip8State();
+        std::memcpy(record.chip8.v, state.v.data(), 16);
+        record.chip8.i = state.i;
+        record.chip8.sp = state.sp;
+        Logger::trace(record);
+    }
+    void saveBaseState(StateWriter& writer) const
+    {
+        chip8State();
+        writer.beginChunk(stateTag("C8RC"));
+        writer.write(_state.cycles);
+        writer.write(int32_t(_state.frameCycle));
+        writer.write(_state.v);
+        writer.write(_state.s);
+        writer.write(int32_t(_state.i));
+        writer.write(int32_t(_state.pc));
+        writer.write(int32_t(_state.sp));
+        writer.write(int32_t(_state.dt));
+        writer.write(int32_t(_state.st));
+        writer.write(_cycles);
+        writer.write(int32_t(_frames));
+        writer.write(_isHybridChipMode);
+        writer.write(_cpuState);
+        writer.writeString(_errorMessage);
+        writer.endChunk();
+    }
+    void loadBaseState(StateReader& reader)
+    {
+        reader.beginChunk(stateTag("C8RC"));
+        reader.read(_state.cycles);
+        _state.frameCycle = reader.read<int32_t>();
+        reader.read(_state.v);
+        reader.read(_state.s);
+        _state.i = reader.read<int32_t>();
+        _state.pc = reader.read<int32_t>();
+        _state.sp = reader.read<int32_t>();
+        _state.dt = reader.read<int32_t>();
+        _state.st = reader.read<int32_t>();
+        reader.read(_cycles);
+        _frames = reader.read<int32_t>();
+        reader.read(_isHybridChipMode);
+        reader.read(_cpuState);
+        _errorMessage = reader.readString();
+        reader.endChunk();
+        validateState();
+    }
     Chip8EmulatorHost& _host;
-    Chip8State _state;
+    mutable Chip8State _state;
+    uint64_t _stateVersion{0};
+    mutable uint64_t _decodedVersion{0};
     int64_t _cycles{0};
     int _frames{0};
+    int64_t _skippedCycles{0};
     bool _backendStopped{false};
     bool _isHybridChipMode{true};
+    int32_t _profiledOpcode{-1};
+    int64_t _profiledCycles{0};
     mutable CpuState _cpuState{eNORMAL};
-    std::array<uint8_t,4096> _breakMap;
-    std::map<uint32_t,BreakpointInfo> _breakpoints;
     std::string _errorMessage;
 };
 
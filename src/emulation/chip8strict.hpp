@@ -47,6 +47,7 @@ public:
     constexpr static int SCREEN_WIDTH = 64;
     constexpr static int SCREEN_HEIGHT = 32;
     static constexpr uint64_t CPU_CLOCK_FREQUENCY = 1760640;
+    static constexpr int64_t BOOT_MACHINE_CYCLES = 3250; // machine cycles a VIP needs to reach the start of the program
 
     Chip8StrictEmulator(Chip8EmulatorHost& host, Chip8EmulatorOptions& options, IChip8Emulator* other = nullptr)
         : Chip8EmulatorBase(host, options, other)
@@ -65,7 +66,7 @@ public:
     {
         Chip8EmulatorBase::reset();
         std::memcpy(_memory.data(), _chip8_cvip, 512);
-        _machineCycles = 3250;  // This is the amount of cycles a VIP needs to get to the start of the program
+        _machineCycles = BOOT_MACHINE_CYCLES;  // the boot is not emulated, this core starts in the post-boot state
         _nextFrame = calcNextFrame();
         _cycleCounter = 2;
         _systemTime.reset();
@@ -82,11 +83,11 @@ public:
     int64_t executeFor(int64_t microseconds) override
     {
         if(_execMode != ePAUSED) {
-            auto endTime = _systemTime + Time::fromMicroseconds(microseconds);
-            while(_execMode != GenericCpu::ePAUSED && _systemTime < endTime) {
+            auto endCycles = _machineCycles + _systemTime.cyclesFromMicroseconds(microseconds);
+            while(_execMode != GenericCpu::ePAUSED && _machineCycles < endCycles) {
                 executeInstruction();
             }
-            return _systemTime.difference_us(endTime);
+            return _systemTime.microsecondsFromCycles(_machineCycles - endCycles);
         }
         return 0;
     }
@@ -107,7 +108,11 @@ public:
     {
         if (_execMode == ePAUSED || _cpuState == eERROR)
             return;
+        auto startCycles = _machineCycles;
         uint16_t opcode = readWord(_rPC);
+        if(_memoryHeatmap && _cpuState != eWAITING)
+            countMemoryAccesses(_rPC, opcode);
+        bool watched = hasWatchpoints() && _cpuState != eWAITING && accessesWatchpoint(opcode);
         _rPC = uint16_t(_rPC + 2);
         if(_cpuState != eWAITING) {
             ++_cycleCounter;
@@ -418,15 +423,17 @@ public:
                 break;
             }
         }
+        if(_opcodeProfiler)
+            _opcodeProfiler->count(opcode, _machineCycles - startCycles);
         if (_execMode == eSTEP || (_execMode == eSTEPOVER && _rSP <= _stepOverSP)) {
             if(_cpuState != eWAITING)
                 _execMode = ePAUSED;
         }
-        if(hasBreakPoint(_rPC)) {
-            if(Chip8EmulatorBase::findBreakpoint(_rPC)) {
-                _execMode = ePAUSED;
-                _breakpointTriggered = true;
-            }
+        if(watched)
+            watchpointHit();
+        if(hasBreakPoint(_rPC) && triggerBreakpoint(_rPC)) {
+            _execMode = ePAUSED;
+            _breakpointTriggered = true;
         }
     }
 
@@ -482,6 +489,18 @@ public:
     }
 
 protected:
+    void saveCoreState(StateWriter& writer) const override
+    {
+        writer.write(_machineCycles);
+        writer.write(_nextFrame);
+        writer.write(int32_t(_instructionCycles));
+    }
+    void loadCoreState(StateReader& reader) override
+    {
+        reader.read(_machineCycles);
+        reader.read(_nextFrame);
+        _instructionCycles = reader.read<int32_t>();
+    }
     void wait(int instructionCycles = 0)
     {
         _rPC -= 2;
@@ -507,6 +526,7 @@ protected:
     {
         if(addr < 0x1000) {
             _memory[addr] = val;
+            _writtenPages.set(addr);
         }
     }
     int64_t calcNextFrame() const override { return ((_machineCycles + 2572) / 3668) * 3668 + 1096; }
@@ -1,6 +1,8 @@
 #include <emulation/chip8vip.hpp>
+#include <emulation/bootstatecache.hpp>
 #include <emulation/logger.hpp>
 #include <emulation/hardware/cdp186x.hpp>
+#include <emulation/scheduler.hpp>
 #include <chiplet/utility.hpp>
 
 #include <fmt/format.h>
@@ -40,12 +42,13 @@ static const RealCoreSetupInfo defaultSetups[] = {
 
 class Chip8VIP::Private {
 public:
+    using Cpu = Cdp1802<Chip8VIP>;
     uint16_t FETCH_LOOP_ENTRY{0x01B};
     static constexpr uint64_t CPU_CLOCK_FREQUENCY = 1760640;
-    explicit Private(Chip8EmulatorHost& host, Cdp1802Bus& bus, Chip8EmulatorOptions& options)
+    explicit Private(Chip8EmulatorHost& host, Chip8VIP& bus, Chip8EmulatorOptions& options)
         : _host(host)
         , _cpu(bus, CPU_CLOCK_FREQUENCY)
-        , _video(options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP || options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP_TPD || options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP_FPD ? Cdp186x::eVP590 : Cdp186x::eCDP1861, _cpu, options)
+        , _video(options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP || options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP_TPD || options.behaviorBase == Chip8EmulatorOptions::eCHIP8XVIP_FPD ? Cdp186xBase::eVP590 : Cdp186xBase::eCDP1861, _cpu, _scheduler, options)
         , _properties(options.properties)
     {
         using namespace std::string_literals;
@@ -65,7 +68,7 @@ public:
             }
             _properties = prop;
         }
-        if(_video.getType() == Cdp186x::eVP590 && options.behaviorBase != Chip8EmulatorOptions::eCHIP8XVIP) {
+        if(_video.getType() == Cdp186xBase::eVP590 && options.behaviorBase != Chip8EmulatorOptions::eCHIP8XVIP) {
             _colorRamMask = 0x3ff;
             _colorRamMaskLores = 0x3e7;
         }
@@ -75,17 +78,17 @@ public:
         _properties[PROP_INTERPRETER].setSelectedText("CHIP8");
         _properties[PROP_INTERPRETER].setAdditionalInfo(fmt::format("(sha1: {})", calculateSha1(_chip8_cvip, 512).to_hex().substr(0,8)));
         switch(_video.getType()) {
-            case Cdp186x::eCDP1861_C10:
+            case Cdp186xBase::eCDP1861_C10:
                 _properties[PROP_VIDEO].setSelectedIndex(1);
                 break;
-            case Cdp186x::eVP590:
+            case Cdp186xBase::eVP590:
                 _properties[PROP_VIDEO].setSelectedIndex(2);
                 _properties[PROP_AUDIO].setSelectedIndex(1);
                 break;
-            case Cdp186x::eCDP1864:
+            case Cdp186xBase::eCDP1864:
                 _properties[PROP_VIDEO].setSelectedIndex(3);
                 break;
-            case Cdp186x::eCDP1861:
+            case Cdp186xBase::eCDP1861:
             default:
                 _properties[PROP_VIDEO].setSelectedIndex(0);
                 _properties[PROP_AUDIO].setSelectedIndex(0);
@@ -93,13 +96,87 @@ public:
         }
         _memorySize = std::stoul(_properties[PROP_RAM].getSelectedText());
         _ram.resize(_memorySize, 0);
+        updateMemoryMap(bus);
     }
+    // Rebuilds the 256 byte page table of the cpu bus, needs to be called when
+    // the ROM is unmapped from the low addresses (OUT 4) or that changes back
+    // and when watchpoints change. A nullptr page is handled by the slow path
+    // of the bus functions (lores color RAM, color RAM writes, unmapped regions,
+    // RAM pages holding a watchpoint and, while writes are tracked, RAM pages
+    // not written since the last takeWrittenPages()).
+    void updateMemoryMap(const GenericCpu& watches)
+    {
+        _readMap.fill(nullptr);
+        _writeMap.fill(nullptr);
+        for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+            _readMap[page] = _ram.data() + (page << 8);
+            _writeMap[page] = _ram.data() + (page << 8);
+        }
+        for(uint32_t page = 0; page < (_rom.size() >> 8); ++page) {
+            if(!_mapRam)
+                _readMap[page] = _rom.data() + (page << 8);
+            _readMap[0x80 + page] = _rom.data() + (page << 8);
+        }
+        for(uint32_t page = 0xD0; page < 0xE0; ++page) {
+            _readMap[page] = _colorRam.data() + ((page << 8) & _colorRamMask);
+        }
+        if(watches.hasWatchpoints()) {
+            for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+                if(_readMap[page] == _ram.data() + (page << 8) && watches.hasReadWatchpoint(page << 8, 256))
+                    _readMap[page] = nullptr;
+                if(watches.hasWriteWatchpoint(page << 8, 256))
+                    _writeMap[page] = nullptr;
+            }
+        }
+        if(!_writtenPages.empty()) {
+            for(uint32_t page = 0; page < (_memorySize >> 8); ++page) {
+                if(!_writtenPages.test(page << 8))
+                    _writeMap[page] = nullptr;
+            }
+        }
+    }
+    // records a write to RAM from the slow path, the page can use the fast path again
+    void markWritten(uint16_t addr, const GenericCpu& watches)
+    {
+        if(_writtenPages.empty())
+            return;
+        _writtenPages.set(addr);
+        auto page = addr >> 8;
+        if(!watches.hasWriteWatchpoint(page << 8, 256))
+            _writeMap[page] = _ram.data() + (page << 8);
+    }
+    // The native CHIP-8 fast path is only valid as long as the low 512 bytes
+    // hold the unmodified standard interpreter.
+    bool hasStandardInterpreter() const
+    {
+        return std::memcmp(_ram.data(), _chip8_cvip, sizeof(_chip8_cvip)) == 0;
+    }
+    // opcode at the CHIP-8 pc in R5, only meaningful at the fetch loop
+    uint16_t chip8Opcode() const
+    {
+        auto pc = _cpu.getR(5);
+        return pc + 1u < _memorySize ? (_ram[pc] << 8) | _ram[pc + 1] : 0;
+    }
+    // raw interpreter registers as they were at the last fetch
+    struct FetchLatch
+    {
+        int64_t cycles;
+        int frameCycle;
+        std::array<uint8_t,16> v;
+        uint16_t i;
+        uint16_t pc;
+        uint16_t r2;
+        uint16_t timers;
+    };
     Chip8EmulatorHost& _host;
     uint32_t _memorySize{4096};
-    Cdp1802 _cpu;
-    Cdp186x _video;
+    Scheduler _scheduler;
+    Cpu _cpu;
+    Cdp186x<Cpu> _video;
     int64_t _irqStart{0};
     int64_t _nextFrame{0};
+    int _lastFrameCycle{0};
+    int _endlessLoops{0};
     uint8_t _keyLatch{0};
     uint8_t _frequencyLatch{0};
     uint16_t _lastOpcode{0};
@@ -108,10 +185,17 @@ public:
     uint16_t _colorRamMask{0xff};
     uint16_t _colorRamMaskLores{0xe7};
     bool _mapRam{false};
+    bool _hle{false};
+    cycles_t _nativeCycles{0};
+    uint16_t _nativeTimerOp{0};
+    FetchLatch _fetched{};
     float _wavePhase{0};
     std::vector<uint8_t> _ram{};
     std::array<uint8_t,1024> _colorRam{};
     std::array<uint8_t,512> _rom{};
+    std::array<const uint8_t*,256> _readMap{};
+    std::array<uint8_t*,256> _writeMap{};
+    PageBitmap _writtenPages;
     VideoType _screen;
     Properties& _properties;
 };
@@ -452,45 +536,7 @@ Chip8VIP::Chip8VIP(Chip8EmulatorHost& host, Chip8EmulatorOptions& options, IChip
     if(_impl->_ram.size() > 4096) {
         _impl->_rom[0x10] = (_impl->_ram.size() >> 8) - 1;
     }
-    _impl->_cpu.setInputHandler([this](uint8_t port) {
-        if(port == 1)
-            _impl->_video.enableDisplay();
-        return 0;
-    });
-    _impl->_cpu.setOutputHandler([this](uint8_t port, uint8_t val) {
-        switch (port) {
-        case 1:
-            _impl->_video.disableDisplay();
-            break;
-        case 2:
-            _impl->_keyLatch = val & 0xf;
-            break;
-        case 3:
-            _impl->_frequencyLatch = val ? val : 0x80;
-            break;
-        case 4:
-            _impl->_mapRam = true;
-            break;
-        case 5:
-            if(_impl->_video.getType() == Cdp186x::eVP590)
-                _impl->_video.incrementBackground();
-            break;
-        default:
-            break;
-        }
-    });
-    _impl->_cpu.setNEFInputHandler([this](uint8_t idx) {
-       switch(idx) {
-           case 0: { // EF1 is set from four machine cycles before the video line to four before the end
-               return _impl->_video.getNEFX();
-           }
-           case 2: {
-               return _impl->_host.isKeyDown(_impl->_keyLatch);
-           }
-           default:
-               return true;
-       }
-    });
+    _impl->_video.vsyncHandler = [this]() { _host.vblank(); };
     Chip8VIP::reset();
     if(other && false) {
         std::memcpy(_impl->_ram.data() + 0x200, other->memory() + 0x200, std::min(_impl->_ram.size() - 0x200 - 0x170, (size_t)other->memSize()));
@@ -533,6 +579,7 @@ void Chip8VIP::reset()
         ghc::RandomLCG rnd(42);
         std::generate(_impl->_ram.begin(), _impl->_ram.end(), rnd);
     }
+    _impl->_writtenPages.setAll();
     std::memset(_impl->_colorRam.data(), 0, _impl->_colorRam.size());
     if(_isHybridChipMode) {
         std::memcpy(_impl->_ram.data(), _chip8_cvip, sizeof(_chip8_cvip));
@@ -548,35 +595,109 @@ void Chip8VIP::reset()
         _impl->_properties[PROP_INTERPRETER].setSelectedText("NONE");
         _impl->_properties[PROP_INTERPRETER].setAdditionalInfo("No CHIP-8 interpreter used");
     }
+    _impl->_hle = _isHybridChipMode && _options.advanced.contains("hle") && _options.advanced.at("hle") == true && _impl->hasStandardInterpreter();
     _impl->_screen.setAll(0);
     _impl->_video.reset();
     _impl->_cpu.reset();
     _cycles = 0;
     _frames = 0;
+    _skippedCycles = 0;
     _impl->_nextFrame = 0;
+    _impl->_lastFrameCycle = 0;
+    _impl->_endlessLoops = 0;
     _impl->_lastOpcode = 0;
     _impl->_initialChip8SP = 0;
+    _impl->_nativeCycles = 0;
+    _impl->_nativeTimerOp = 0;
     _impl->_frequencyLatch = 0x80;
     _impl->_mapRam = false;
+    _impl->updateMemoryMap(*this);
     _impl->_wavePhase = 0;
     _cpuState = eNORMAL;
     _errorMessage.clear();
-    if (_isHybridChipMode) {
-        setExecMode(eRUNNING);
-        while (_impl->_cpu.getExecMode() == eRUNNING && (!executeCdp1802() || getPC() != _options.startAddress))
-            ;  // fast-forward to fetch/decode loop
-    }
-    else {
-        setExecMode(eRUNNING);
-        while (_impl->_cpu.getExecMode() == eRUNNING && !executeCdp1802())
-            if(_impl->_cpu.getR(_impl->_cpu.getP()) == 0)
-                break;  // fast-forward to fetch/decode loop
+    // the boot is only emulated once per configuration, trace logging wants to see it every time
+    auto bootKey = BootStateCache::makeKey(name(), _options, _impl->_properties);
+    if(_options.optTraceLog || !BootStateCache::restore(bootKey, *this)) {
+        if (_isHybridChipMode) {
+            setExecMode(eRUNNING);
+            while (_impl->_cpu.getExecMode() == eRUNNING && (!executeCdp1802() || getPC() != _options.startAddress))
+                ;  // fast-forward to fetch/decode loop
+        }
+        else {
+            setExecMode(eRUNNING);
+            while (_impl->_cpu.getExecMode() == eRUNNING && !executeCdp1802())
+                if(_impl->_cpu.getR(_impl->_cpu.getP()) == 0)
+                    break;  // fast-forward to fetch/decode loop
+        }
+        if(_impl->_cpu.getExecMode() == eRUNNING && _cpuState != eERROR)
+            BootStateCache::store(bootKey, *this);
     }
     setExecMode(_impl->_host.isHeadless() ? eRUNNING : ePAUSED);
     if(_options.optTraceLog)
         Logger::log(Logger::eBACKEND_EMU, _impl->_cpu.getCycles(), {_frames, frameCycle()}, fmt::format("End of reset: {}/{}", _impl->_cpu.getCycles(), frameCycle()).c_str());
 }
 
+bool Chip8VIP::saveState(std::vector<uint8_t>& state) const
+{
+    StateWriter writer(state, name());
+    saveBaseState(writer);
+    writer.beginChunk(stateTag("RVIP"));
+    writer.write(_impl->_irqStart);
+    writer.write(_impl->_nextFrame);
+    writer.write(int32_t(_impl->_lastFrameCycle));
+    writer.write(int32_t(_impl->_endlessLoops));
+    writer.write(_impl->_keyLatch);
+    writer.write(_impl->_frequencyLatch);
+    writer.write(_impl->_lastOpcode);
+    writer.write(_impl->_currentOpcode);
+    writer.write(_impl->_initialChip8SP);
+    writer.write(_impl->_mapRam);
+    writer.write(_impl->_colorRam);
+    writer.write(_impl->_nativeCycles);
+    writer.write(_impl->_nativeTimerOp);
+    writer.write(_impl->_hle);
+    writer.endChunk();
+    writer.beginChunk(stateTag("1802"));
+    _impl->_cpu.saveState(writer);
+    writer.endChunk();
+    _impl->_video.saveState(writer);
+    writer.writeMemory(_impl->_ram.data(), _impl->_ram.size());
+    return true;
+}
+
+bool Chip8VIP::loadState(const uint8_t* data, size_t size)
+{
+    StateReader reader(data, size, name());
+    if(!reader.isValid() || reader.memorySize() != _impl->_ram.size())
+        return false;
+    loadBaseState(reader);
+    reader.beginChunk(stateTag("RVIP"));
+    reader.read(_impl->_irqStart);
+    reader.read(_impl->_nextFrame);
+    _impl->_lastFrameCycle = reader.read<int32_t>();
+    _impl->_endlessLoops = reader.read<int32_t>();
+    reader.read(_impl->_keyLatch);
+    reader.read(_impl->_frequencyLatch);
+    reader.read(_impl->_lastOpcode);
+    reader.read(_impl->_currentOpcode);
+    reader.read(_impl->_initialChip8SP);
+    reader.read(_impl->_mapRam);
+    reader.read(_impl->_colorRam);
+    reader.read(_impl->_nativeCycles);
+    reader.read(_impl->_nativeTimerOp);
+    // the fast path can have been disabled at runtime, so it isn't derived from the options
+    reader.read(_impl->_hle);
+    reader.endChunk();
+    _impl->_writtenPages.setAll();
+    _impl->updateMemoryMap(*this);
+    reader.beginChunk(stateTag("1802"));
+    _impl->_cpu.loadState(reader);
+    reader.endChunk();
+    _impl->_video.loadState(reader);
+    reader.readMemory(_impl->_ram.data(), _impl->_ram.size());
+    return reader.isValid();
+}
+
 uint16_t Chip8VIP::patchRAM(std::string name, uint8_t* ram, size_t size)
 {
     auto iter = g_patchSets.find(name);
@@ -602,27 +723,42 @@ void Chip8VIP::updateProperties(Property& changedProp)
 
 void Chip8VIP::fetchState()
 {
-    _state.cycles = _cycles;
-    _state.frameCycle = frameCycle();
+    auto& latch = _impl->_fetched;
+    latch.cycles = _cycles;
+    latch.frameCycle = frameCycle();
     if(!_impl->_initialChip8SP)
         _impl->_initialChip8SP = _impl->_cpu.getR(2);
     auto base = _impl->_initialChip8SP & 0xFF00;
     if(base + 0x100 <= _impl->_memorySize)
-        std::memcpy(_state.v.data(), &_impl->_ram[base + 0xF0], 16);
+        std::memcpy(latch.v.data(), &_impl->_ram[base + 0xF0], 16);
     else
         _impl->_cpu.setExecMode(GenericCpu::ePAUSED), _cpuState = eERROR, _errorMessage = "BASE ADDRESS OUT OF RAM";
-    _state.i = _impl->_cpu.getR(0xA);
-    _state.pc = _impl->_cpu.getR(5);
-    _state.sp = ((_impl->_initialChip8SP - _impl->_cpu.getR(2)) >> 1) & 0xffff;
-    _state.dt = _impl->_cpu.getR(8) >> 8;
-    _state.st = _impl->_cpu.getR(8) & 0xff;
+    latch.i = _impl->_cpu.getR(0xA);
+    latch.pc = _impl->_cpu.getR(5);
+    latch.r2 = _impl->_cpu.getR(2);
+    latch.timers = _impl->_cpu.getR(8);
+    if(_impl->_initialChip8SP >= _impl->_memorySize || _impl->_initialChip8SP <= stackSize() * 2)
+        _impl->_cpu.setExecMode(GenericCpu::ePAUSED), _cpuState = eERROR, _errorMessage = "BASE ADDRESS OUT OF RAM";
+    invalidateState();
+}
+
+void Chip8VIP::decodeState() const
+{
+    const auto& latch = _impl->_fetched;
+    _state.cycles = latch.cycles;
+    _state.frameCycle = latch.frameCycle;
+    _state.v = latch.v;
+    _state.i = latch.i;
+    _state.pc = latch.pc;
+    _state.sp = ((_impl->_initialChip8SP - latch.r2) >> 1) & 0xffff;
+    _state.dt = latch.timers >> 8;
+    _state.st = latch.timers & 0xff;
+    // entries below the stack pointer are not touched by an instruction in flight
     if(_impl->_initialChip8SP < _impl->_memorySize && _impl->_initialChip8SP > stackSize() * 2) {
         for (int i = 0; i < stackSize() && i < _state.sp; ++i) {
             _state.s[i] = (_impl->_ram[_impl->_initialChip8SP - i * 2 - 2] << 8) | _impl->_ram[_impl->_initialChip8SP - i * 2 - 1];
         }
     }
-    else
-        _impl->_cpu.setExecMode(GenericCpu::ePAUSED), _cpuState = eERROR, _errorMessage = "BASE ADDRESS OUT OF RAM";
 }
 
 void Chip8VIP::forceState()
@@ -632,6 +768,7 @@ void Chip8VIP::forceState()
     if(!_impl->_initialChip8SP)
         _impl->_initialChip8SP = _impl->_cpu.getR(2);
     auto base = _impl->_initialChip8SP & 0xFF00;
+    _impl->_writtenPages.setAll();
     std::memcpy(&_impl->_ram[base + 0xF0], _state.v.data(), 16);
     _impl->_cpu.setR(0xA, (uint16_t)_state.i);
     _impl->_cpu.setR(0x5, (uint16_t)_state.pc);
@@ -641,6 +778,7 @@ void Chip8VIP::forceState()
         _impl->_ram[_impl->_initialChip8SP - i*2 - 2] = _state.s[i] >> 8;
         _impl->_ram[_impl->_initialChip8SP - i*2 - 1] = _state.s[i] & 0xFF;
     }
+    validateState();
 }
 
 int64_t Chip8VIP::getMachineCycles() const
@@ -648,24 +786,278 @@ int64_t Chip8VIP::getMachineCycles() const
     return _impl->_cpu.getCycles() >> 3;
 }
 
+//---------------------------------------------------------------------------------------
+// High level fast path for the standard interpreter: executes the CHIP-8 instruction
+// waiting at the fetch loop directly on the interpreter state in RAM and 1802
+// registers, the machine cycles the genuine code would need for it (the same costs
+// the strict core uses) are then burned by advanceNativeInstruction(). Returns false
+// for everything that depends on the 1802 side (machine code calls, drawing, random,
+// keys, invalid opcodes) or would write into the interpreter, those are left to the
+// real code.
+//---------------------------------------------------------------------------------------
+bool Chip8VIP::executeChip8Native(uint16_t opcode)
+{
+    auto& cpu = _impl->_cpu;
+    auto vBase = (_impl->_initialChip8SP & 0xFF00) + 0xF0;
+    if(cpu.getExecMode() == ePAUSED || cpu.getCpuState() != Private::Cpu::eNORMAL || !_impl->_initialChip8SP || vBase + 16 > _impl->_memorySize || hasWatchpoints())
+        return false;
+    auto peek = [this](uint16_t addr, uint8_t& val) {
+        if(auto* page = _impl->_readMap[addr >> 8]) {
+            val = page[addr & 0xFF];
+            return true;
+        }
+        return false;
+    };
+    auto isWritable = [this](uint16_t addr, int size) {
+        return addr >= 0x200 && addr + size <= _impl->_memorySize;
+    };
+    uint8_t* V = &_impl->_ram[vBase];
+    // writes here bypass the bus, the V registers are assumed to change
+    _impl->_writtenPages.set(vBase);
+    auto x = (opcode >> 8) & 0xF;
+    auto y = (opcode >> 4) & 0xF;
+    uint16_t pc = cpu.getR(5) + 2;
+    uint16_t i = cpu.getR(0xA);
+    uint16_t sp = cpu.getR(2);
+    int cycles = (opcode & 0xF000) ? 68 : 40;
+    switch(opcode >> 12) {
+        case 0:
+            if(opcode == 0x00E0) {
+                auto page = cpu.getR(0xB) & 0xFF00;
+                if(page + 0x100 > _impl->_memorySize)
+                    return false;
+                std::memset(&_impl->_ram[page], 0, 0x100);
+                _impl->_writtenPages.set(page);
+                cycles += 3078;
+            }
+            else if(opcode == 0x00EE) {
+                if(sp >= _impl->_initialChip8SP || sp + 2 > _impl->_memorySize)
+                    return false;
+                pc = (_impl->_ram[sp] << 8) | _impl->_ram[sp + 1];
+                cpu.setR(2, sp + 2);
+                cycles += 10;
+            }
+            else {
+                // the start code at 01FC uses 004B to enable the display, machine code
+                // called by the program might rely on or change anything though
+                if(cpu.getR(5) >= 0x200)
+                    _impl->_hle = false;
+                return false;
+            }
+            break;
+        case 1:
+            pc = opcode & 0xFFF;
+            cycles += 12;
+            break;
+        case 2:
+            if(!isWritable(sp - 2, 2))
+                return false;
+            _impl->_ram[sp - 2] = pc >> 8;
+            _impl->_ram[sp - 1] = pc & 0xFF;
+            _impl->_writtenPages.setRange(sp - 2, 2);
+            cpu.setR(2, sp - 2);
+            pc = opcode & 0xFFF;
+            cycles += 26;
+            break;
+        case 3:
+        case 4:
+            if((V[x] == (opcode & 0xFF)) == ((opcode >> 12) == 3)) {
+                pc += 2;
+                cycles += 14;
+            }
+            else {
+                cycles += 10;
+            }
+            break;
+        case 5:
+        case 9:
+            if(opcode & 0xF)
+                return false;
+            if((V[x] == V[y]) == ((opcode >> 12) == 5)) {
+                pc += 2;
+                cycles += 18;
+            }
+            else {
+                cycles += 14;
+            }
+            break;
+        case 6:
+            V[x] = opcode & 0xFF;
+            cycles += 6;
+            break;
+        case 7:
+            V[x] += opcode & 0xFF;
+            cycles += 10;
+            break;
+        case 8: {
+            uint16_t result;
+            uint8_t flag;
+            switch(opcode & 0xF) {
+                case 0: V[x] = V[y]; cycles += 12; break;
+                case 1: V[x] |= V[y]; V[0xF] = 0; cycles += 44; break;
+                case 2: V[x] &= V[y]; V[0xF] = 0; cycles += 44; break;
+                case 3: V[x] ^= V[y]; V[0xF] = 0; cycles += 44; break;
+                case 4: result = V[x] + V[y]; V[x] = result; V[0xF] = result >> 8; cycles += 44; break;
+                case 5: result = V[x] - V[y]; V[x] = result; V[0xF] = result > 255 ? 0 : 1; cycles += 44; break;
+                case 6: flag = V[y] & 1; V[x] = V[y] >> 1; V[0xF] = flag; cycles += 44; break;
+                case 7: result = V[y] - V[x]; V[x] = result; V[0xF] = result > 255 ? 0 : 1; cycles += 44; break;
+                case 0xE: flag = V[y] >> 7; V[x] = V[y] << 1; V[0xF] = flag; cycles += 44; break;
+                default: return false;
+            }
+            break;
+        }
+        case 0xA:
+            i = opcode & 0xFFF;
+            cycles += 12;
+            break;
+        case 0xB: {
+            auto target = opcode & 0xFFF;
+            pc = target + V[0];
+            cycles += ((pc ^ target) & 0xFF00) ? 24 : 22;
+            break;
+        }
+        case 0xF:
+            cycles += 4;
+            switch(opcode & 0xFF) {
+                // the timers are accessed by the last instructions of these, so that is
+                // deferred to let an interrupt before it see the old values
+                case 0x07:
+                case 0x15:
+                case 0x18:
+                    _impl->_nativeTimerOp = opcode;
+                    cycles += 6;
+                    break;
+                case 0x1E: {
+                    auto oldIH = i >> 8;
+                    i += V[x];
+                    cycles += (i >> 8) != oldIH ? 18 : 12;
+                    break;
+                }
+                case 0x29:
+                    i = 0x8100 + _impl->_rom[0x100 + (V[x] & 0xF)];
+                    cycles += 16;
+                    break;
+                case 0x33: {
+                    if(!isWritable(i, 3)) {
+                        _impl->_hle = false;
+                        return false;
+                    }
+                    uint8_t val = V[x];
+                    auto a = val / 100, b = (val / 10) % 10, c = val % 10;
+                    _impl->_ram[i] = a;
+                    _impl->_ram[i + 1] = b;
+                    _impl->_ram[i + 2] = c;
+                    _impl->_writtenPages.setRange(i, 3);
+                    cycles += 80 + (a + b + c) * 16;
+                    break;
+                }
+                case 0x55:
+                    if(!isWritable(i, x + 1)) {
+                        _impl->_hle = false;
+                        return false;
+                    }
+                    for(int n = 0; n <= x; ++n)
+                        _impl->_ram[i + n] = V[n];
+                    _impl->_writtenPages.setRange(i, x + 1);
+                    i += x + 1;
+                    cycles += 14 + (x + 1) * 14;
+                    break;
+                case 0x65: {
+                    uint8_t data[16];
+                    for(int n = 0; n <= x; ++n) {
+                        if(!peek(i + n, data[n]))
+                            return false;
+                    }
+                    std::memcpy(V, data, x + 1);
+                    i += x + 1;
+                    cycles += 14 + (x + 1) * 14;
+                    break;
+                }
+                default:
+                    return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    cpu.setR(5, pc);
+    cpu.setR(0xA, i);
+    _impl->_nativeCycles = cycles_t(cycles) << 3;
+    return true;
+}
+
+// Remaining cycles of Fx07/Fx15/Fx18 when the genuine code accesses R8
+static cycles_t nativeTimerAccess(uint16_t opcode)
+{
+    return cycles_t((opcode & 0xFF) == 0x07 ? 6 : 4) << 3;
+}
+
+// Lets the time of a natively executed instruction pass up to the next scheduled
+// event, returns true when it is completed. An interrupt in between is served by
+// the real interrupt routine, so DMA and interrupt cycles stretch the instruction
+// like on the VIP.
+bool Chip8VIP::advanceNativeInstruction()
+{
+    auto& cpu = _impl->_cpu;
+    auto timerAccess = _impl->_nativeTimerOp ? nativeTimerAccess(_impl->_nativeTimerOp) : 0;
+    auto step = std::min(_impl->_nativeCycles - timerAccess, std::max<cycles_t>(8, (_impl->_scheduler.nextDue() - cpu.getCycles() + 7) & ~cycles_t(7)));
+    cpu.addCycles(step);
+    _skippedCycles += step >> 3;
+    _impl->_nativeCycles -= step;
+    if(_impl->_nativeTimerOp && _impl->_nativeCycles == timerAccess) {
+        auto vxAddr = (_impl->_initialChip8SP & 0xFF00) + 0xF0 + ((_impl->_nativeTimerOp >> 8) & 0xF);
+        auto& vx = _impl->_ram[vxAddr];
+        _impl->_writtenPages.set(vxAddr);
+        switch(_impl->_nativeTimerOp & 0xFF) {
+            case 0x07: vx = cpu.getR(8) >> 8; break;
+            case 0x15: cpu.setR(8, (vx << 8) | (cpu.getR(8) & 0xFF)); break;
+            default: cpu.setR(8, (cpu.getR(8) & 0xFF00) | vx); break;
+        }
+        _impl->_nativeTimerOp = 0;
+    }
+    return !_impl->_nativeCycles;
+}
+
 bool Chip8VIP::executeCdp1802()
 {
-    static int lastFC = 0;
-    static int endlessLoops = 0;
-    auto [fc,vsync] = _impl->_video.executeStep();
-    if(vsync)
-        _host.vblank();
-    if(_options.optTraceLog  && _impl->_cpu.getCpuState() != Cdp1802::eIDLE)
-        Logger::log(Logger::eBACKEND_EMU, _impl->_cpu.getCycles(), {_frames, fc}, fmt::format("{:24} ; {}", _impl->_cpu.disassembleInstructionWithBytes(-1, nullptr), _impl->_cpu.dumpStateLine()).c_str());
-    if(_isHybridChipMode && _impl->_cpu.PC() == _impl->FETCH_LOOP_ENTRY) {
-        _cycles++;
-        //std::cout << fmt::format("{:06d}:{:04x}", _impl->_cpu.getCycles()>>3, opcode()) << std::endl;
-        _impl->_currentOpcode = opcode();
-        if(_options.optTraceLog)
-            Logger::log(Logger::eCHIP8, _cycles, {_frames, fc}, fmt::format("CHIP8: {:30} ; {}", disassembleInstructionWithBytes(-1, nullptr), dumpStateLine()).c_str());
+    if(_impl->_scheduler.isDue(_impl->_cpu.getCycles())) {
+        _impl->_scheduler.runDue(_impl->_cpu.getCycles());
+        // the video chip counts the frames, all trace records have to share its counter
+        _frames = _impl->_video.frames();
+    }
+    auto cycles = _impl->_cpu.getCycles();
+    if(_impl->_nativeCycles && _impl->_cpu.getIE()) {
+        if(!advanceNativeInstruction())
+            return false;
+    }
+    else {
+        if(_impl->_cpu.getCpuState() == Private::Cpu::eIDLE && _impl->_cpu.getExecMode() == eRUNNING && !(_isHybridChipMode && _impl->_cpu.PC() == _impl->FETCH_LOOP_ENTRY)) {
+            // only DMA or an interrupt ends IDL and both come from scheduled events
+            auto skipped = _impl->_cpu.skipIdleUntil(std::max<cycles_t>(_impl->_scheduler.nextDue(), cycles + 8));
+            _skippedCycles += skipped >> 3;
+            if(!_isHybridChipMode)
+                _cycles += skipped >> 3;
+            return false;
+        }
+        if(_options.optTraceLog  && _impl->_cpu.getCpuState() != Private::Cpu::eIDLE)
+            _impl->_cpu.trace(_frames, Cdp186xBase::frameCycle(cycles));
+        bool native = false;
+        if(_isHybridChipMode && _impl->_cpu.PC() == _impl->FETCH_LOOP_ENTRY && !_impl->_nativeCycles) {
+            _cycles++;
+            //std::cout << fmt::format("{:06d}:{:04x}", _impl->_cpu.getCycles()>>3, opcode()) << std::endl;
+            _impl->_currentOpcode = _impl->chip8Opcode();
+            if(_opcodeProfiler)
+                profileChip8Instruction();
+            if(_memoryHeatmap)
+                countChip8MemoryAccesses();
+            if(_options.optTraceLog)
+                traceChip8Instruction(Cdp186xBase::frameCycle(cycles));
+            native = _impl->_hle && !_options.optTraceLog && executeChip8Native(_impl->_currentOpcode);
+        }
+        if(!native)
+            _impl->_cpu.executeInstruction();
     }
-    _impl->_cpu.executeInstruction();
-    if(_isHybridChipMode && _impl->_cpu.PC() == _impl->FETCH_LOOP_ENTRY) {
+    if(_isHybridChipMode && _impl->_cpu.PC() == _impl->FETCH_LOOP_ENTRY && !_impl->_nativeCycles) {
         _impl->_lastOpcode = _impl->_currentOpcode;
 #ifdef DIFFERENTIATE_CYCLES
         static int64_t lastCycles{}, lastIdle{}, lastIrq{};
@@ -680,7 +1072,7 @@ bool Chip8VIP::executeCdp1802()
             int64_t nonCode = idleTime + irqTime;
             int64_t betweenDraws = (_impl->_cpu.getCycles() - lastDrawCycle) >> 3;
             int fetchTime = (_impl->_lastOpcode&0xF000)?68:40;
-            std::cout << fmt::format("{:04x},{},{},{},{},{},{},{},{},{},{}", _impl->_lastOpcode, _state.v[(_impl->_lastOpcode&0xF00)>>8], _state.v[(_impl->_lastOpcode&0xF0)>>4], _impl->_lastOpcode&0xF,
+            std::cout << fmt::format("{:04x},{},{},{},{},{},{},{},{},{},{}", _impl->_lastOpcode, chip8State().v[(_impl->_lastOpcode&0xF00)>>8], chip8State().v[(_impl->_lastOpcode&0xF0)>>4], _impl->_lastOpcode&0xF,
                                      fetchTime, ((machineCycles - nonCode)>>3) - fetchTime,
                                      (machineCycles - nonCode)>>3, idleTime>>3, irqTime>>3, machineCycles>>3, betweenDraws) << std::endl;
             lastDrawCycle = _impl->_cpu.getCycles();
@@ -696,30 +1088,30 @@ bool Chip8VIP::executeCdp1802()
         else if (_execMode == eSTEP || (_execMode == eSTEPOVER && getSP() <= _stepOverSP)) {
             setExecMode(ePAUSED);
         }
-        auto nextOp = opcode();
-        bool newFrame = lastFC > fc;
-        lastFC = fc;
+        auto pc = _impl->_cpu.getR(5);
+        auto nextOp = _impl->chip8Opcode();
+        auto fc = Cdp186xBase::frameCycle(cycles);
+        bool newFrame = _impl->_lastFrameCycle > fc;
+        _impl->_lastFrameCycle = fc;
         if(newFrame) {
             _host.updateScreen();
-            if ((nextOp & 0xF000) == 0x1000 && (opcode() & 0xFFF) == getPC()) {
-                if (++endlessLoops > 2) {
+            if ((nextOp & 0xF000) == 0x1000 && (nextOp & 0xFFF) == pc) {
+                if (++_impl->_endlessLoops > 2) {
                     setExecMode(ePAUSED);
-                    endlessLoops = 0;
+                    _impl->_endlessLoops = 0;
                 }
             }
             else {
-                endlessLoops = 0;
+                _impl->_endlessLoops = 0;
             }
         }
-        if(hasBreakPoint(getPC())) {
-            if(Chip8VIP::findBreakpoint(getPC())) {
-                setExecMode(ePAUSED);
-                _breakpointTriggered = true;
-            }
+        if(hasBreakPoint(pc) && triggerBreakpoint(pc)) {
+            setExecMode(ePAUSED);
+            _breakpointTriggered = true;
         }
         return true;
     }
-    else if(_impl->_cpu.getExecMode() == ePAUSED || _impl->_cpu.getCpuState() == Cdp1802::eERROR) {
+    else if(_impl->_cpu.getExecMode() == ePAUSED || _impl->_cpu.getCpuState() == Private::Cpu::eERROR) {
         setExecMode(ePAUSED);
         _backendStopped = true;
     }
@@ -752,12 +1144,17 @@ void Chip8VIP::executeInstructions(int numInstructions)
 
 inline int Chip8VIP::frameCycle() const
 {
-    return Cdp186x::frameCycle(_impl->_cpu.getCycles()); // _impl->_irqStart ? ((_impl->_cpu.getCycles() >> 3) - _impl->_irqStart) : 0;
+    return Cdp186xBase::frameCycle(_impl->_cpu.getCycles()); // _impl->_irqStart ? ((_impl->_cpu.getCycles() >> 3) - _impl->_irqStart) : 0;
+}
+
+Logger::FrameTime Chip8VIP::logFrameTime() const
+{
+    return {_frames, frameCycle()};
 }
 
 inline int Chip8VIP::videoLine() const
 {
-    return Cdp186x::videoLine(_impl->_cpu.getCycles()); // (frameCycle() + (78*14)) % 3668) / 14;
+    return Cdp186xBase::videoLine(_impl->_cpu.getCycles()); // (frameCycle() + (78*14)) % 3668) / 14;
 }
 
 void Chip8VIP::tick(int)
@@ -766,7 +1163,7 @@ void Chip8VIP::tick(int)
         setExecMode(ePAUSED);
         return;
     }
-    auto nextFrame = Cdp186x::nextFrame(_impl->_cpu.getCycles());
+    auto nextFrame = Cdp186xBase::nextFrame(_impl->_cpu.getCycles());
     while(_execMode != ePAUSED && _impl->_cpu.getCycles() < nextFrame) {
         executeCdp1802();
     }
@@ -775,12 +1172,12 @@ void Chip8VIP::tick(int)
 int64_t Chip8VIP::executeFor(int64_t microseconds)
 {
     if(_execMode != ePAUSED) {
-        auto cpuTime = _impl->_cpu.getTime();
-        auto endTime = cpuTime + Time::fromMicroseconds(microseconds);
-        while(_execMode != GenericCpu::ePAUSED && _impl->_cpu.getTime() < endTime) {
+        const auto& cpuTime = _impl->_cpu.getTime();
+        auto endCycles = _impl->_cpu.getCycles() + cpuTime.cyclesFromMicroseconds(microseconds);
+        while(_execMode != GenericCpu::ePAUSED && _impl->_cpu.getCycles() < endCycles) {
             executeInstruction();
         }
-        return _impl->_cpu.getTime().difference_us(endTime);
+        return cpuTime.microsecondsFromCycles(_impl->_cpu.getCycles() - endCycles);
     }
     return 0;
 }
@@ -791,6 +1188,13 @@ bool Chip8VIP::isDisplayEnabled() const
 }
 
 uint8_t* Chip8VIP::memory()
+{
+    // the caller might write anywhere, bypassing the bus
+    _impl->_writtenPages.setAll();
+    return _impl->_ram.data();
+}
+
+const uint8_t* Chip8VIP::memoryView() const
 {
     return _impl->_ram.data();
 }
@@ -818,13 +1222,13 @@ void Chip8VIP::setAudioPhase(float phase)
 
 float Chip8VIP::getAudioFrequency() const
 {
-    return _impl->_video.getType() == Cdp186x::eVP590 ? 27535.0f / ((unsigned)_impl->_frequencyLatch + 1) : 1400.0f;
+    return _impl->_video.getType() == Cdp186xBase::eVP590 ? 27535.0f / ((unsigned)_impl->_frequencyLatch + 1) : 1400.0f;
 }
 */
 void Chip8VIP::renderAudio(int16_t* samples, size_t frames, int sampleFrequency)
 {
     if(_impl->_cpu.getQ()) {
-        auto audioFrequency = _impl->_video.getType() == Cdp186x::eVP590 ? 27535.0f / ((unsigned)_impl->_frequencyLatch + 1) : 1400.0f;
+        auto audioFrequency = _impl->_video.getType() == Cdp186xBase::eVP590 ? 27535.0f / ((unsigned)_impl->_frequencyLatch + 1) : 1400.0f;
         const float step = audioFrequency / sampleFrequency;
         for (int i = 0; i < frames; ++i) {
             *samples++ = (_impl->_wavePhase > 0.5f) ? 16384 : -16384;
@@ -868,34 +1272,52 @@ GenericCpu& Chip8VIP::getBackendCpu()
     return _impl->_cpu;
 }
 
+void Chip8VIP::watchpointsChanged()
+{
+    _impl->updateMemoryMap(*this);
+}
+
+bool Chip8VIP::setWriteTracking(bool enable)
+{
+    if(enable) {
+        _impl->_writtenPages.resize(_impl->_memorySize);
+        _impl->_writtenPages.setAll();
+    }
+    else {
+        _impl->_writtenPages.clear();
+    }
+    _impl->updateMemoryMap(*this);
+    return true;
+}
+
+void Chip8VIP::takeWrittenPages(std::vector<uint32_t>& pages)
+{
+    _impl->_writtenPages.take(pages);
+    // the next write to any of these has to take the slow path to get recorded
+    for(auto page : pages)
+        _impl->_writeMap[page] = nullptr;
+}
+
 uint8_t Chip8VIP::readByte(uint16_t addr) const
 {
+    if(const auto* page = _impl->_readMap[addr >> 8])
+        return page[addr & 0xff];
     if(addr < _impl->_memorySize) {
-        if(_impl->_mapRam || addr > _impl->_rom.size())
-            return _impl->_ram[addr];
-        return _impl->_rom[addr & (_impl->_rom.size() - 1)];
+        checkReadWatch(addr);
+        return _impl->_ram[addr];
     }
     if(addr >= 0xC000 && addr < 0xD000)
         return _impl->_colorRam[addr & _impl->_colorRamMaskLores];
-    if(addr >= 0xD000 && addr < 0xE000)
-        return _impl->_colorRam[addr & _impl->_colorRamMask];
-    if(addr >= 0x8000 && addr < 0x8200)
-        return _impl->_rom[addr & 0x1ff];
     //_cpuState = eERROR;
     return 0;
 }
 
 uint8_t Chip8VIP::readByteDMA(uint16_t addr) const
 {
+    // DMA always sees the RAM, even while the ROM is mapped over it
     if(addr < _impl->_memorySize)
         return _impl->_ram[addr];
-    if(addr >= 0xC000 && addr < 0xD000)
-        return _impl->_colorRam[addr & _impl->_colorRamMaskLores];
-    if(addr >= 0xD000 && addr < 0xE000)
-        return _impl->_colorRam[addr & _impl->_colorRamMask];
-    if(addr >= 0x8000 && addr < 0x8200)
-        return _impl->_rom[addr & 0x1ff];
-    return 0;
+    return readByte(addr);
 }
 
 uint8_t Chip8VIP::getMemoryByte(uint32_t addr) const
@@ -905,17 +1327,22 @@ uint8_t Chip8VIP::getMemoryByte(uint32_t addr) const
 
 void Chip8VIP::writeByte(uint16_t addr, uint8_t val)
 {
-    if(addr < _impl->_memorySize)
+    if(auto* page = _impl->_writeMap[addr >> 8])
+        page[addr & 0xff] = val;
+    else if(addr < _impl->_memorySize) {
+        checkWriteWatch(addr);
         _impl->_ram[addr] = val;
-    else if(_impl->_video.getType() == Cdp186x::eVP590 && addr >= 0xC000 && addr < 0xE000) {
+        _impl->markWritten(addr, *this);
+    }
+    else if(_impl->_video.getType() == Cdp186xBase::eVP590 && addr >= 0xC000 && addr < 0xE000) {
         if(addr < 0xD000) {
             _impl->_colorRam[addr & _impl->_colorRamMaskLores] = val & 7;
-            _impl->_video.setSubMode(Cdp186x::eVP590_LORES);
+            _impl->_video.setSubMode(Cdp186xBase::eVP590_LORES);
         }
         else {
             //std::cout << fmt::format("color {:04x} = {:02x}", addr, val) << std::endl;
             _impl->_colorRam[addr & _impl->_colorRamMask] = val & 7;
-            _impl->_video.setSubMode(Cdp186x::eVP590_HIRES);
+            _impl->_video.setSubMode(Cdp186xBase::eVP590_HIRES);
         }
     }
     else {
@@ -924,6 +1351,52 @@ void Chip8VIP::writeByte(uint16_t addr, uint8_t val)
     }
 }
 
+void Chip8VIP::output(uint8_t port, uint8_t val)
+{
+    switch (port) {
+        case 1:
+            _impl->_video.disableDisplay();
+            break;
+        case 2:
+            _impl->_keyLatch = val & 0xf;
+            break;
+        case 3:
+            _impl->_frequencyLatch = val ? val : 0x80;
+            break;
+        case 4:
+            _impl->_mapRam = true;
+            _impl->updateMemoryMap(*this);
+            break;
+        case 5:
+            if(_impl->_video.getType() == Cdp186xBase::eVP590)
+                _impl->_video.incrementBackground();
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t Chip8VIP::input(uint8_t port)
+{
+    if(port == 1)
+        _impl->_video.enableDisplay();
+    return 0;
+}
+
+bool Chip8VIP::inputNEF(uint8_t idx) const
+{
+    switch(idx) {
+        case 0: { // EF1 is set from four machine cycles before the video line to four before the end
+            return _impl->_video.getNEFX();
+        }
+        case 2: {
+            return _impl->_host.isKeyDown(_impl->_keyLatch);
+        }
+        default:
+            return true;
+    }
+}
+
 std::vector<uint8_t> Chip8VIP::getInterpreterCode(const std::string& name)
 {
     std::vector<uint8_t> memory;
@@ -36,13 +36,15 @@ namespace emu {
 extern const uint8_t _chip8_cvip[0x200];
 extern const uint8_t _rom_cvip[0x200];
 
-class Chip8VIP : public Chip8RealCoreBase, public Cdp1802Bus
+class Chip8VIP : public Chip8RealCoreBase
 {
 public:
     Chip8VIP(Chip8EmulatorHost& host, Chip8EmulatorOptions& options, IChip8Emulator* other = nullptr);
     ~Chip8VIP() override;
 
     void reset() override;
+    bool saveState(std::vector<uint8_t>& state) const override;
+    bool loadState(const uint8_t* data, size_t size) override;
     std::string name() const override;
     int64_t executeFor(int64_t microseconds) override;
     void executeInstruction() override;
@@ -52,7 +54,10 @@ public:
     int64_t getMachineCycles() const override;
 
     uint8_t* memory() override;
+    const uint8_t* memoryView() const override;
     int memSize() const override;
+    bool setWriteTracking(bool enable) override;
+    void takeWrittenPages(std::vector<uint32_t>& pages) override;
 
     int64_t frames() const override;
 
@@ -71,16 +76,22 @@ public:
     //float getAudioFrequency() const override;
     void renderAudio(int16_t* samples, size_t frames, int sampleFrequency) override;
 
-    // CDP1802-Bus
-    uint8_t readByte(uint16_t addr) const override;
-    uint8_t readByteDMA(uint16_t addr) const override;
+    // CDP1802-Bus, used directly as template parameter of the Cdp1802
+    uint8_t readByte(uint16_t addr) const;
+    uint8_t readByteDMA(uint16_t addr) const;
+    void writeByte(uint16_t addr, uint8_t val);
+    void output(uint8_t port, uint8_t val);
+    uint8_t input(uint8_t port);
+    bool inputNEF(uint8_t idx) const;
+
     uint8_t getMemoryByte(uint32_t addr) const override;
-    void writeByte(uint16_t addr, uint8_t val) override;
 
     GenericCpu& getBackendCpu() override;
 
     Properties& getProperties() override;
     void updateProperties(Property& changedProp) override;
+    Logger::Source logSource() const override { return Logger::eCHIP8; }
+    Logger::FrameTime logFrameTime() const override;
 
     static std::vector<uint8_t> getInterpreterCode(const std::string& name);
 
@@ -89,7 +100,11 @@ private:
     int frameCycle() const;
     int videoLine() const;
     bool executeCdp1802();
+    bool executeChip8Native(uint16_t opcode);
+    bool advanceNativeInstruction();
     void fetchState();
+    void watchpointsChanged() override;
+    void decodeState() const override;
     void forceState();
     class Private;
     std::unique_ptr<Private> _impl;
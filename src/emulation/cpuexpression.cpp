@@ -0,0 +1,349 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/cpuexpression.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+
+#include <emulation/cpuexpression.hpp>
+#include <emulation/hardware/genericcpu.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace emu {
+
+class ExpressionParser
+{
+public:
+    using Op = CpuExpression::Op;
+    ExpressionParser(const std::string& source, const GenericCpu& cpu, std::vector<Op>& code)
+        : _source(source)
+        , _cpu(cpu)
+        , _code(code)
+    {
+    }
+    bool parse(std::string& error)
+    {
+        if(!parseBinary(0)) {
+            error = _error;
+            return false;
+        }
+        skipSpace();
+        if(_pos < _source.size()) {
+            error = fmt::format("unexpected '{}' at position {}", _source[_pos], _pos + 1);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct BinaryOperator
+    {
+        const char* token;
+        int precedence;
+        CpuExpression::OpCode code;
+    };
+    static const BinaryOperator* matchOperator(const std::string& source, size_t pos)
+    {
+        // two character operators first, so "<<" is not taken for "<"
+        static const BinaryOperator operators[] = {
+            {"||", 1, CpuExpression::eJUMP_IF_TRUE}, {"&&", 2, CpuExpression::eJUMP_IF_FALSE}, {"==", 6, CpuExpression::eEQ}, {"!=", 6, CpuExpression::eNE},
+            {"<=", 7, CpuExpression::eLE}, {">=", 7, CpuExpression::eGE}, {"<<", 8, CpuExpression::eSHL}, {">>", 8, CpuExpression::eSHR},
+            {"|", 3, CpuExpression::eOR}, {"^", 4, CpuExpression::eXOR}, {"&", 5, CpuExpression::eAND}, {"<", 7, CpuExpression::eLT},
+            {">", 7, CpuExpression::eGT}, {"+", 9, CpuExpression::eADD}, {"-", 9, CpuExpression::eSUB}, {"*", 10, CpuExpression::eMUL},
+            {"/", 10, CpuExpression::eDIV}, {"%", 10, CpuExpression::eMOD}
+        };
+        for(const auto& op : operators) {
+            if(source.compare(pos, std::strlen(op.token), op.token) == 0)
+                return &op;
+        }
+        return nullptr;
+    }
+    void skipSpace()
+    {
+        while(_pos < _source.size() && std::isspace(static_cast<unsigned char>(_source[_pos])))
+            ++_pos;
+    }
+    bool fail(const std::string& message)
+    {
+        if(_error.empty())
+            _error = message;
+        return false;
+    }
+    bool emit(CpuExpression::OpCode code, int64_t operand = 0)
+    {
+        auto* last = _code.empty() ? nullptr : &_code.back();
+        bool lastIsConst = last && last->code == CpuExpression::eCONST && !last->immediate;
+        if(code == CpuExpression::eCONST || code == CpuExpression::eREGISTER) {
+            if(++_depth > CpuExpression::MAX_STACK_DEPTH)
+                return fail("expression too complex");
+        }
+        else if(lastIsConst && (code == CpuExpression::eNEG || code == CpuExpression::eNOT || code == CpuExpression::eCOMPL)) {
+            last->operand = code == CpuExpression::eNEG ? -last->operand : code == CpuExpression::eNOT ? !last->operand : ~last->operand;
+            return true;
+        }
+        else if(lastIsConst && (code == CpuExpression::eMEMORY || code >= CpuExpression::eMUL)) {
+            // the constant is replaced by the instruction that uses it
+            if(code != CpuExpression::eMEMORY)
+                --_depth;
+            *last = {code, true, last->operand};
+            return true;
+        }
+        else if(code == CpuExpression::eJUMP_IF_FALSE || code == CpuExpression::eJUMP_IF_TRUE || code >= CpuExpression::eMUL) {
+            --_depth;
+        }
+        _code.push_back({code, false, operand});
+        return true;
+    }
+    bool parseBinary(int minPrecedence)
+    {
+        if(!parseUnary())
+            return false;
+        while(true) {
+            skipSpace();
+            const auto* op = _pos < _source.size() ? matchOperator(_source, _pos) : nullptr;
+            if(!op || op->precedence < minPrecedence)
+                return true;
+            _pos += std::strlen(op->token);
+            if(op->code == CpuExpression::eJUMP_IF_FALSE || op->code == CpuExpression::eJUMP_IF_TRUE) {
+                // the jump keeps the deciding left value, otherwise the right side is evaluated
+                auto jump = _code.size();
+                if(!emit(op->code) || !parseBinary(op->precedence + 1) || !emit(CpuExpression::eBOOL))
+                    return false;
+                _code[jump].operand = int64_t(_code.size());
+            }
+            else if(!parseBinary(op->precedence + 1) || !emit(op->code)) {
+                return false;
+            }
+        }
+    }
+    bool parseUnary()
+    {
+        skipSpace();
+        if(_pos >= _source.size())
+            return fail("unexpected end of expression");
+        switch(_source[_pos]) {
+            case '-':
+                ++_pos;
+                return parseUnary() && emit(CpuExpression::eNEG);
+            case '!':
+                ++_pos;
+                return parseUnary() && emit(CpuExpression::eNOT);
+            case '~':
+                ++_pos;
+                return parseUnary() && emit(CpuExpression::eCOMPL);
+            case '+':
+                ++_pos;
+                return parseUnary();
+            default:
+                return parsePrimary();
+        }
+    }
+    bool parsePrimary()
+    {
+        auto c = _source[_pos];
+        if(c == '(' || c == '[') {
+            ++_pos;
+            if(!parseBinary(0))
+                return false;
+            skipSpace();
+            auto closing = c == '(' ? ')' : ']';
+            if(_pos >= _source.size() || _source[_pos] != closing)
+                return fail(fmt::format("missing '{}'", closing));
+            ++_pos;
+            return c == '(' || emit(CpuExpression::eMEMORY);
+        }
+        if(std::isdigit(static_cast<unsigned char>(c)) || c == '$')
+            return parseNumber();
+        if(std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+            return parseRegister();
+        return fail(fmt::format("unexpected '{}' at position {}", c, _pos + 1));
+    }
+    bool parseNumber()
+    {
+        int base = 10;
+        if(_source[_pos] == '$') {
+            base = 16;
+            ++_pos;
+        }
+        else if(_source[_pos] == '0' && _pos + 1 < _source.size() && (_source[_pos + 1] == 'x' || _source[_pos + 1] == 'X' || _source[_pos + 1] == 'b' || _source[_pos + 1] == 'B')) {
+            base = std::tolower(_source[_pos + 1]) == 'x' ? 16 : 2;
+            _pos += 2;
+        }
+        auto start = _pos;
+        int64_t value = 0;
+        while(_pos < _source.size() && std::isxdigit(static_cast<unsigned char>(_source[_pos]))) {
+            auto c = std::tolower(_source[_pos]);
+            int digit = c <= '9' ? c - '0' : c - 'a' + 10;
+            if(digit >= base)
+                return fail(fmt::format("invalid digit '{}' at position {}", _source[_pos], _pos + 1));
+            value = value * base + digit;
+            ++_pos;
+        }
+        if(_pos == start)
+            return fail(fmt::format("missing digits at position {}", _pos + 1));
+        return emit(CpuExpression::eCONST, value);
+    }
+    bool parseRegister()
+    {
+        auto start = _pos;
+        while(_pos < _source.size() && (std::isalnum(static_cast<unsigned char>(_source[_pos])) || _source[_pos] == '_'))
+            ++_pos;
+        auto name = _source.substr(start, _pos - start);
+        const auto& names = _cpu.getRegisterNames();
+        auto iter = std::find_if(names.begin(), names.end(), [&name](const std::string& regName) {
+            return regName.size() == name.size() && std::equal(regName.begin(), regName.end(), name.begin(), [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+        });
+        if(iter == names.end())
+            return fail(fmt::format("unknown register '{}'", name));
+        return emit(CpuExpression::eREGISTER, iter - names.begin());
+    }
+
+    const std::string& _source;
+    const GenericCpu& _cpu;
+    std::vector<Op>& _code;
+    std::string _error;
+    size_t _pos{0};
+    int _depth{0};
+};
+
+bool CpuExpression::compile(const std::string& source, const GenericCpu& cpu, std::string& error)
+{
+    std::vector<Op> code;
+    ExpressionParser parser(source, cpu, code);
+    if(!parser.parse(error))
+        return false;
+    _code = std::move(code);
+    _source = source;
+    return true;
+}
+
+int64_t CpuExpression::evaluate(const GenericCpu& cpu) const
+{
+    int64_t stack[MAX_STACK_DEPTH];
+    int sp = 0;
+    const auto* code = _code.data();
+    for(size_t pc = 0, end = _code.size(); pc < end; ++pc) {
+        const auto& op = code[pc];
+        switch(op.code) {
+            case eCONST: stack[sp++] = op.operand; continue;
+            case eREGISTER: stack[sp++] = cpu.getRegister(op.operand).value; continue;
+            case eMEMORY:
+                if(op.immediate)
+                    stack[sp++] = cpu.getMemoryByte(uint32_t(op.operand));
+                else
+                    stack[sp - 1] = cpu.getMemoryByte(uint32_t(stack[sp - 1]));
+                continue;
+            case eNEG: stack[sp - 1] = -stack[sp - 1]; continue;
+            case eNOT: stack[sp - 1] = !stack[sp - 1]; continue;
+            case eCOMPL: stack[sp - 1] = ~stack[sp - 1]; continue;
+            case eBOOL: stack[sp - 1] = stack[sp - 1] != 0; continue;
+            case eJUMP_IF_FALSE:
+                if(!stack[sp - 1])
+                    pc = op.operand - 1;
+                else
+                    --sp;
+                continue;
+            case eJUMP_IF_TRUE:
+                if(stack[sp - 1]) {
+                    stack[sp - 1] = 1;
+                    pc = op.operand - 1;
+                }
+                else
+                    --sp;
+                continue;
+            default: break;
+        }
+        auto b = op.immediate ? op.operand : stack[--sp];
+        auto& a = stack[sp - 1];
+        switch(op.code) {
+            case eMUL: a *= b; break;
+            case eDIV: a = b ? a / b : 0; break;
+            case eMOD: a = b ? a % b : 0; break;
+            case eADD: a += b; break;
+            case eSUB: a -= b; break;
+            case eSHL: a = int64_t(uint64_t(a) << (b & 63)); break;
+            case eSHR: a = int64_t(uint64_t(a) >> (b & 63)); break;
+            case eLT: a = a < b; break;
+            case eLE: a = a <= b; break;
+            case eGT: a = a > b; break;
+            case eGE: a = a >= b; break;
+            case eEQ: a = a == b; break;
+            case eNE: a = a != b; break;
+            case eAND: a &= b; break;
+            case eXOR: a ^= b; break;
+            case eOR: a |= b; break;
+            default: break;
+        }
+    }
+    return sp ? stack[0] : 0;
+}
+
+bool CpuLogFormat::compile(const std::string& format, const GenericCpu& cpu, std::string& error)
+{
+    std::vector<std::pair<std::string, CpuExpression>> parts;
+    std::string text;
+    for(size_t pos = 0; pos < format.size(); ++pos) {
+        if((format[pos] == '{' || format[pos] == '}') && pos + 1 < format.size() && format[pos + 1] == format[pos]) {
+            text += format[pos];
+            ++pos;
+        }
+        else if(format[pos] == '{') {
+            auto end = format.find('}', pos);
+            if(end == std::string::npos) {
+                error = "missing '}' in log message";
+                return false;
+            }
+            CpuExpression expression;
+            if(!expression.compile(format.substr(pos + 1, end - pos - 1), cpu, error))
+                return false;
+            parts.emplace_back(std::move(text), std::move(expression));
+            text.clear();
+            pos = end;
+        }
+        else {
+            text += format[pos];
+        }
+    }
+    if(!text.empty())
+        parts.emplace_back(std::move(text), CpuExpression{});
+    _parts = std::move(parts);
+    _source = format;
+    return true;
+}
+
+std::string CpuLogFormat::format(const GenericCpu& cpu) const
+{
+    std::string result;
+    for(const auto& [text, expression] : _parts) {
+        result += text;
+        if(!expression.empty())
+            result += fmt::format("{:x}", expression.evaluate(cpu));
+    }
+    return result;
+}
+
+}  // namespace emu
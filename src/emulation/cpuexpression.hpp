@@ -0,0 +1,92 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/cpuexpression.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace emu {
+
+class GenericCpu;
+
+//---------------------------------------------------------------------------------------
+// Integer expression over the registers and memory of a GenericCpu, used for breakpoint
+// conditions. It is parsed once by compile() into a small postfix program with the
+// register names already resolved to indices, constant operands folded into the
+// instruction using them and && / || short circuiting, so the usual false condition
+// on a hot loop costs only a few steps of evaluate(). Supports C operators (without
+// assignment and ?:), decimal, 0x/$ hex and 0b binary literals, register names of
+// the cpu (case insensitive) and [expr] to read a memory byte.
+//---------------------------------------------------------------------------------------
+class CpuExpression
+{
+public:
+    static constexpr int MAX_STACK_DEPTH = 32;
+    bool compile(const std::string& source, const GenericCpu& cpu, std::string& error);
+    int64_t evaluate(const GenericCpu& cpu) const;
+    bool isTrue(const GenericCpu& cpu) const { return _code.empty() || evaluate(cpu) != 0; }
+    bool empty() const { return _code.empty(); }
+    const std::string& source() const { return _source; }
+    void clear()
+    {
+        _code.clear();
+        _source.clear();
+    }
+
+private:
+    // everything from eMUL on is a binary operator, immediate ones take the right operand from the instruction
+    enum OpCode : uint8_t { eCONST, eREGISTER, eMEMORY, eNEG, eNOT, eCOMPL, eBOOL, eJUMP_IF_FALSE, eJUMP_IF_TRUE, eMUL, eDIV, eMOD, eADD, eSUB, eSHL, eSHR, eLT, eLE, eGT, eGE, eEQ, eNE, eAND, eXOR, eOR };
+    struct Op
+    {
+        OpCode code;
+        bool immediate;
+        int64_t operand;
+    };
+    friend class ExpressionParser;
+    std::vector<Op> _code;
+    std::string _source;
+};
+
+//---------------------------------------------------------------------------------------
+// Message of a tracepoint, text with {expr} placeholders that are compiled like a
+// CpuExpression and replaced by the hex value on every hit, {{ and }} are literal braces.
+//---------------------------------------------------------------------------------------
+class CpuLogFormat
+{
+public:
+    bool compile(const std::string& format, const GenericCpu& cpu, std::string& error);
+    std::string format(const GenericCpu& cpu) const;
+    bool empty() const { return _parts.empty(); }
+    const std::string& source() const { return _source; }
+
+private:
+    std::vector<std::pair<std::string, CpuExpression>> _parts;
+    std::string _source;
+};
+
+}  // namespace emu
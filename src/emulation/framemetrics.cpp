@@ -0,0 +1,71 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/framemetrics.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/framemetrics.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <ostream>
+
+namespace emu {
+
+void FrameMetrics::add(const Sample& sample)
+{
+    _samples[_next] = sample;
+    _next = (_next + 1) % HISTORY_SIZE;
+    if(_fill < HISTORY_SIZE)
+        ++_fill;
+    ++_histogram[std::min(sample.frameTime / HISTOGRAM_BUCKET_US, uint32_t(HISTOGRAM_BUCKETS - 1))];
+    _maxFrameTime = std::max(_maxFrameTime, sample.frameTime);
+}
+
+void FrameMetrics::clear()
+{
+    _next = _fill = 0;
+    _histogram.fill(0);
+    _maxFrameTime = 0;
+}
+
+bool FrameMetrics::writeCSV(std::ostream& out) const
+{
+    writeCSVHeader(out);
+    for(size_t i = 0; i < _fill; ++i)
+        writeCSVLine(out, (*this)[i]);
+    return bool(out);
+}
+
+void FrameMetrics::writeCSVHeader(std::ostream& out)
+{
+    out << "frame,frame_us,emulation_us,convert_us,draw_us,instructions,mips,audio_fill,audio_underruns,audio_overruns\n";
+}
+
+void FrameMetrics::writeCSVLine(std::ostream& out, const Sample& sample)
+{
+    out << fmt::format("{},{},{},{},{},{},{:.3f},{},{},{}\n", sample.frame, sample.frameTime, sample.emulationTime, sample.convertTime, sample.drawTime, sample.instructions, sample.mips(), sample.audioFill, sample.audioUnderruns,
+                       sample.audioOverruns);
+}
+
+}
@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/framemetrics.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Per frame timing and throughput samples, kept in a ring buffer for an overlay and
+// CSV export, plus a frame time histogram over everything added since the last clear.
+// Times are in microseconds, the audio counters are the events seen during the frame.
+//---------------------------------------------------------------------------------------
+class FrameMetrics
+{
+public:
+    static constexpr size_t HISTORY_SIZE = 1024;
+    static constexpr int HISTOGRAM_BUCKETS = 34;
+    static constexpr int HISTOGRAM_BUCKET_US = 1000;
+    struct Sample
+    {
+        int64_t frame{0};
+        uint32_t frameTime{0};
+        uint32_t emulationTime{0};
+        uint32_t convertTime{0};
+        uint32_t drawTime{0};
+        int64_t instructions{0};
+        uint32_t audioFill{0};
+        uint32_t audioUnderruns{0};
+        uint32_t audioOverruns{0};
+        double mips() const { return emulationTime ? double(instructions) / emulationTime : 0.0; }
+    };
+
+    FrameMetrics() : _samples(HISTORY_SIZE) {}
+    void add(const Sample& sample);
+    void clear();
+    size_t size() const { return _fill; }
+    // index 0 is the oldest sample still in the history
+    const Sample& operator[](size_t index) const { return _samples[(_next + HISTORY_SIZE - _fill + index) % HISTORY_SIZE]; }
+    const Sample& last() const { return (*this)[_fill - 1]; }
+    const std::array<uint32_t, HISTOGRAM_BUCKETS>& histogram() const { return _histogram; }
+    uint32_t maxFrameTime() const { return _maxFrameTime; }
+    bool writeCSV(std::ostream& out) const;
+    static void writeCSVHeader(std::ostream& out);
+    static void writeCSVLine(std::ostream& out, const Sample& sample);
+
+private:
+    std::vector<Sample> _samples;
+    size_t _next{0};
+    size_t _fill{0};
+    std::array<uint32_t, HISTOGRAM_BUCKETS> _histogram{};
+    uint32_t _maxFrameTime{0};
+};
+
+}
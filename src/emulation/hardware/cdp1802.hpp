@@ -31,12 +31,15 @@
 #include <emulation/time.hpp>
 #endif
 
+#include <emulation/logger.hpp>
+
 #include <fmt/format.h>
 
 #include <cstdint>
-#include <functional>
+#include <cstring>
 #include <utility>
 #include <iostream>
+#include <type_traits>
 
 #ifndef NDEBUG
 //#define DIFFERENTIATE_CYCLES
@@ -50,6 +53,11 @@
 
 namespace emu {
 
+// The bus a Cdp1802 is connected to, besides memory it serves the I/O lines
+// (OUT/INP with N lines 1-7 and the four EF flags). Cdp1802 is a template
+// over its bus type, so a system can pass its own (non-virtual, ideally
+// final) class with these members to have all accesses inlined, this
+// virtual interface is only the default for generic use.
 class Cdp1802Bus
 {
 public:
@@ -57,6 +65,9 @@ public:
     virtual uint8_t readByte(uint16_t addr) const = 0;
     virtual uint8_t readByteDMA(uint16_t addr) const = 0;
     virtual void writeByte(uint16_t addr, uint8_t val) = 0;
+    virtual void output(uint8_t port, uint8_t val) {}
+    virtual uint8_t input(uint8_t port) { return 0; }
+    virtual bool inputNEF(uint8_t idx) const { return true; }
 };
 
 struct Cdp1802State
@@ -76,9 +87,11 @@ struct Cdp1802State
 
 #ifdef CADMIUM_WITH_GENERIC_CPU
 #define GENERIC_OVERRIDE override
+template<typename Bus = Cdp1802Bus>
 class Cdp1802 : public GenericCpu
 #else
 #define GENERIC_OVERRIDE
+template<typename Bus = Cdp1802Bus>
 class Cdp1802
 #endif
 {
@@ -88,16 +101,10 @@ public:
         int size;
         std::string text;
     };
-    using OutputHandler = std::function<void(uint8_t, uint8_t)>;
-    using InputHandler = std::function<uint8_t (uint8_t)>;
-    using NEFInputHandler = std::function<bool (uint8_t)>;
-    Cdp1802(Cdp1802Bus& bus, Time::ticks_t clockFreq = 3200000)
+    Cdp1802(Bus& bus, Time::ticks_t clockFreq = 3200000)
         : _bus(bus)
         , _systemTime(clockFreq)
     {
-        _output = [](uint8_t, uint8_t){};
-        _input = [](uint8_t){ return 0; };
-        _inputNEF = [](uint8_t) { return true; };
         reset();
     }
 
@@ -121,21 +128,6 @@ public:
         _cpuState = eNORMAL;
     }
 
-    void setOutputHandler(OutputHandler handler)
-    {
-        _output = std::move(handler);
-    }
-
-    void setInputHandler(InputHandler handler)
-    {
-        _input = std::move(handler);
-    }
-
-    void setNEFInputHandler(NEFInputHandler handler)
-    {
-        _inputNEF = handler;
-    }
-
     //void triggerIrq() { _irq = true; }
     uint16_t getR(uint8_t index) const { return _rR[index & 0xf]; }
     void setR(uint8_t index, uint16_t value) { _rR[index & 0xf] = value; }
@@ -185,6 +177,48 @@ public:
         _rQ = state.q;
         _cycles = state.cycles;
     }
+    template<typename Writer>
+    void saveState(Writer& writer) const
+    {
+        for(auto r : _rR)
+            writer.write(r);
+        writer.write(uint8_t(_rP | (_rX << 4)));
+        writer.write(uint8_t(_rN | (_rI << 4)));
+        writer.write(_rT);
+        writer.write(_rD);
+        writer.write(_rDF);
+        writer.write(_rIE);
+        writer.write(_rQ);
+        writer.write(_irq);
+        writer.write(_cpuState);
+        writer.write(_cycles);
+        writer.write(_idleCycles);
+        writer.write(_irqCycles);
+        writer.writeTime(_systemTime);
+    }
+    template<typename Reader>
+    void loadState(Reader& reader)
+    {
+        for(auto& r : _rR)
+            reader.read(r);
+        auto px = reader.template read<uint8_t>();
+        auto ni = reader.template read<uint8_t>();
+        _rP = px & 0xF;
+        _rX = px >> 4;
+        _rN = ni & 0xF;
+        _rI = ni >> 4;
+        reader.read(_rT);
+        reader.read(_rD);
+        reader.read(_rDF);
+        reader.read(_rIE);
+        reader.read(_rQ);
+        reader.read(_irq);
+        reader.read(_cpuState);
+        reader.read(_cycles);
+        reader.read(_idleCycles);
+        reader.read(_irqCycles);
+        reader.readTime(_systemTime);
+    }
     uint8_t readByte(uint16_t addr) { return _bus.readByte(addr); }
     uint8_t readByteDMA(uint16_t addr) { return _bus.readByteDMA(addr); }
     void writeByte(uint16_t addr, uint8_t val) { _bus.writeByte(addr, val); }
@@ -197,6 +231,17 @@ public:
             ++PC();
         }
     }
+    // An idle cpu only advances in 8 cycle steps until DMA or an interrupt, so this
+    // does all steps up to the first one at or after the given cycle at once and
+    // returns the number of cycles skipped (zero if not idle).
+    cycles_t skipIdleUntil(cycles_t cycles)
+    {
+        if(_cpuState != eIDLE || cycles <= _cycles)
+            return 0;
+        auto skipped = (cycles - _cycles + 7) & ~cycles_t(7);
+        addCycles(skipped);
+        return skipped;
+    }
     void addCycles(cycles_t cycles)
     {
         _cycles += cycles;
@@ -251,7 +296,57 @@ public:
     std::string dumpStateLine() const
     {
         return fmt::format("R0:{:04x} R1:{:04x} R2:{:04x} R3:{:04x} R4:{:04x} R5:{:04x} R6:{:04x} R7:{:04x} R8:{:04x} R9:{:04x} RA:{:04x} RB:{:04x} RC:{:04x} RD:{:04x} RE:{:04x} RF:{:04x} D:{:02x} DF:{} P:{:1x} X:{:1x} N:{:1x} I:{:1x} T:{:02x} PC:{:04x} O:{:02x} EF:{}{}{}{}", getR(0), getR(1), getR(2),
-                           getR(3), getR(4), getR(5), getR(6), getR(7), getR(8), getR(9), getR(10), getR(11), getR(12), getR(13), getR(14), getR(15), _rD, _rDF?1:0, _rP, _rX, _rN, _rI, _rT, _rR[_rP], _bus.readByte(_rR[_rP]), _inputNEF(0)?0:1, _inputNEF(1)?0:1, _inputNEF(2)?0:1, _inputNEF(3)?0:1);
+                           getR(3), getR(4), getR(5), getR(6), getR(7), getR(8), getR(9), getR(10), getR(11), getR(12), getR(13), getR(14), getR(15), _rD, _rDF?1:0, _rP, _rX, _rN, _rI, _rT, _rR[_rP], _bus.readByte(_rR[_rP]), _bus.inputNEF(0)?0:1, _bus.inputNEF(1)?0:1, _bus.inputNEF(2)?0:1, _bus.inputNEF(3)?0:1);
+    }
+
+    // logs a binary trace record of what dumpStateLine() would show, see formatTraceRecord()
+    void trace(int frame, int frameCycle, TraceRecord::Marker marker = TraceRecord::eINSTRUCTION) const
+    {
+        TraceRecord record{};
+        // all bus types share one formatter, trace files identify the cpu by it
+        record.formatter = &Cdp1802<>::formatTraceRecord;
+        record.cycle = _cycles;
+        record.frame = frame;
+        record.frameCycle = frameCycle;
+        record.source = Logger::eBACKEND_EMU;
+        record.marker = marker;
+        record.pc = _rR[_rP];
+        for(int i = 0; i < 3; ++i)
+            record.code[i] = _bus.readByte(record.pc + i);
+        auto& r = record.cdp1802;
+        std::memcpy(r.r, _rR, sizeof(r.r));
+        r.d = _rD;
+        r.df = _rDF ? 1 : 0;
+        r.p = _rP;
+        r.x = _rX;
+        r.n = _rN;
+        r.i = _rI;
+        r.t = _rT;
+        r.ef = (_bus.inputNEF(0) ? 0 : 1) | (_bus.inputNEF(1) ? 0 : 2) | (_bus.inputNEF(2) ? 0 : 4) | (_bus.inputNEF(3) ? 0 : 8);
+        Logger::trace(record);
+    }
+
+    static std::string formatTraceRecord(const TraceRecord& record, const IChip8Emulator*)
+    {
+        const auto& r = record.cdp1802;
+        std::string text;
+        switch(record.marker) {
+            case TraceRecord::eVSYNC: text = "--- VSYNC ---"; break;
+            case TraceRecord::eHSYNC: text = "--- HSYNC ---"; break;
+            case TraceRecord::eIRQ: text = "--- IRQ ---"; break;
+            default: {
+                auto [size, instruction] = disassembleInstruction(record.code, record.code + 3);
+                switch(size) {
+                    case 2:  text = fmt::format("{:04x}: {:02x} {:02x}  {}", record.pc, record.code[0], record.code[1], instruction); break;
+                    case 3:  text = fmt::format("{:04x}: {:02x} {:02x} {:02x}  {}", record.pc, record.code[0], record.code[1], record.code[2], instruction); break;
+                    default: text = fmt::format("{:04x}: {:02x}     {}", record.pc, record.code[0], instruction); break;
+                }
+                break;
+            }
+        }
+        return fmt::format("{:24} ; R0:{:04x} R1:{:04x} R2:{:04x} R3:{:04x} R4:{:04x} R5:{:04x} R6:{:04x} R7:{:04x} R8:{:04x} R9:{:04x} RA:{:04x} RB:{:04x} RC:{:04x} RD:{:04x} RE:{:04x} RF:{:04x} D:{:02x} DF:{} P:{:1x} X:{:1x} N:{:1x} I:{:1x} T:{:02x} PC:{:04x} O:{:02x} EF:{}{}{}{}", text,
+                           r.r[0], r.r[1], r.r[2], r.r[3], r.r[4], r.r[5], r.r[6], r.r[7], r.r[8], r.r[9], r.r[10], r.r[11], r.r[12], r.r[13], r.r[14], r.r[15], r.d, r.df, r.p, r.x, r.n, r.i, r.t, record.pc, record.code[0],
+                           r.ef & 1, (r.ef >> 1) & 1, (r.ef >> 2) & 1, (r.ef >> 3) & 1);
     }
 
     static Disassembled disassembleInstruction(const uint8_t* code, const uint8_t* end)
@@ -360,12 +455,11 @@ public:
     int64_t executeFor(int64_t microseconds) override
     {
         if(_execMode != GenericCpu::ePAUSED) {
-            auto startTime = _systemTime;
-            auto endTime = startTime + Time::fromMicroseconds(microseconds);
-            while (_execMode != GenericCpu::ePAUSED && _systemTime < endTime) {
+            auto endCycles = _cycles + _systemTime.cyclesFromMicroseconds(microseconds);
+            while (_execMode != GenericCpu::ePAUSED && _cycles < endCycles) {
                 executeInstruction();
             }
-            return startTime.excessTime_us(_systemTime, microseconds);
+            return _cycles > endCycles ? _systemTime.microsecondsFromCycles(_cycles - endCycles) : 0;
         }
         return 0;
     }
@@ -426,16 +520,16 @@ public:
                 branchShort(_rDF);
                 break;
             case 0x34: // B1
-                branchShort(_inputNEF(0));
+                branchShort(_bus.inputNEF(0));
                 break;
             case 0x35: // B2
-                branchShort(_inputNEF(1));
+                branchShort(_bus.inputNEF(1));
                 break;
             case 0x36: // B3
-                branchShort(_inputNEF(2));
+                branchShort(_bus.inputNEF(2));
                 break;
             case 0x37: // B4
-                branchShort(_inputNEF(3));
+                branchShort(_bus.inputNEF(3));
                 break;
             case 0x38: // SKP
                 PC()++;
@@ -450,16 +544,16 @@ public:
                 branchShort(!_rDF);
                 break;
             case 0x3c: // BN1
-                branchShort(!_inputNEF(0));
+                branchShort(!_bus.inputNEF(0));
                 break;
             case 0x3d: // BN2
-                branchShort(!_inputNEF(1));
+                branchShort(!_bus.inputNEF(1));
                 break;
             case 0x3e: // BN3
-                branchShort(!_inputNEF(2));
+                branchShort(!_bus.inputNEF(2));
                 break;
             case 0x3f: // BN4
-                branchShort(!_inputNEF(3));
+                branchShort(!_bus.inputNEF(3));
                 break;
             CASE_16(0x40): // LDA Rn ; M(R(N)) → D; R(N) + 1 → R(N)
                 _rD = readByte(RN()++);
@@ -471,12 +565,12 @@ public:
                 RX()++;
                 break;
             CASE_7(0x61): { // OUT 1/7 ; M(R(X)) → BUS; R(X) + 1 → R(X); N LINES = N
-                _output(_rN, readByte(RX()++));
+                _bus.output(_rN, readByte(RX()++));
                 break;
             }
             case 0x68: _cpuState = eERROR; PC()--; break; // ILLEGAL (still behaving as NOP on the original CDP1802)
             CASE_7(0x69): { // INP 1/7 ; BUS → M(R(X)); BUS → D; N LINES = N
-                _rD = _input(_rN&7);
+                _rD = _bus.input(_rN&7);
                 writeByte(RX(), _rD);
                 break;
             }
@@ -701,11 +795,9 @@ public:
         if (_execMode == eSTEP || (_execMode == eSTEPOVER && _rR[_rP] >= _stepOverSP)) {
             _execMode = ePAUSED;
         }
-        if(hasBreakPoint(getPC())) {
-            if(findBreakpoint(getPC())) {
-                _execMode = ePAUSED;
-                _breakpointTriggered = true;
-            }
+        if(hasBreakPoint(getPC()) && triggerBreakpoint(getPC())) {
+            _execMode = ePAUSED;
+            _breakpointTriggered = true;
         }
     }
 #ifdef CADMIUM_WITH_GENERIC_CPU
@@ -716,6 +808,14 @@ public:
     }
     bool inErrorState() const override { return _cpuState == eERROR; }
     uint32_t getCpuID() const override { return 1802; }
+    Logger::Source logSource() const override { return Logger::eBACKEND_EMU; }
+    Logger::FrameTime logFrameTime() const override
+    {
+        if constexpr(std::is_base_of_v<GenericCpu, Bus>)
+            return _bus.logFrameTime();
+        else
+            return {0, 0};
+    }
     const std::string& getName() const override { static const std::string name = "CDP1802"; return name; }
     const std::vector<std::string>& getRegisterNames() const override
     {
@@ -800,10 +900,7 @@ public:
     }
 #endif
 private:
-    Cdp1802Bus& _bus;
-    OutputHandler _output;
-    InputHandler _input;
-    NEFInputHandler _inputNEF;
+    Bus& _bus;
     CpuState _cpuState{eNORMAL};
     uint8_t _rD{};
     bool _rDF{};
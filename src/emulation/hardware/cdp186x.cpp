@@ -25,17 +25,16 @@
 //---------------------------------------------------------------------------------------
 
 #include "cdp186x.hpp"
-#include "cdp1802.hpp"
-#include <emulation/logger.hpp>
+#include <emulation/statestream.hpp>
 #include <stdendian/stdendian.h>
 
 #include <cstring>
 
 namespace emu {
 
-const uint32_t Cdp186x::_cdp1862BackgroundColors[4] = { 0x000080FF, 0x000000FF, 0x008000FF, 0x800000FF };
-Cdp186x::Cdp186x(Type type, Cdp1802& cpu, const Chip8EmulatorOptions& options)
-: _cpu(cpu)
+const uint32_t Cdp186xBase::_cdp1862BackgroundColors[4] = { 0x000080FF, 0x000000FF, 0x008000FF, 0x800000FF };
+Cdp186xBase::Cdp186xBase(Type type, Scheduler& scheduler, const Chip8EmulatorOptions& options)
+: _scheduler(scheduler)
 , _type(type)
 , _options(options)
 {
@@ -49,105 +48,122 @@ Cdp186x::Cdp186x(Type type, Cdp1802& cpu, const Chip8EmulatorOptions& options)
             _cdp1862Palette[i] = _cdp1862BackgroundColors[0];
         }
     }
-    reset();
 }
 
-void Cdp186x::reset()
+void Cdp186xBase::reset()
 {
     if(_type == eVP590) {
         _subMode = eVP590_DEFAULT;
         _screen.setPalette(_cdp1862Palette);
         _backgroundColor = 0;
-        for(int i = 0; i < 256; i += 16) {
-            _cdp1862Palette[i] = _cdp1862BackgroundColors[_backgroundColor];
-        }
-        _screen.setPalette(_cdp1862Palette);
+        updateBackgroundPalette();
     }
     _frameCounter = 0;
     _displayEnabledLatch = false;
     disableDisplay();
+    _scheduler.schedule(_event, 0);
 }
 
-void Cdp186x::enableDisplay()
+void Cdp186xBase::enableDisplay()
 {
     _displayEnabled = true;
 }
 
-void Cdp186x::disableDisplay()
+void Cdp186xBase::disableDisplay()
 {
     _screen.setAll(0);
     _displayEnabled = false;
 }
 
-bool Cdp186x::getNEFX() const
+bool Cdp186xBase::getNEFX() const
 {
     return ((_frameCycle >= (VIDEO_FIRST_VISIBLE_LINE - 4) * 14 && _frameCycle < VIDEO_FIRST_VISIBLE_LINE * 14) || (_frameCycle >= (VIDEO_FIRST_INVISIBLE_LINE - 4) * 14 && _frameCycle < VIDEO_FIRST_INVISIBLE_LINE * 14));
 }
 
-const Cdp186x::VideoType& Cdp186x::getScreen() const
+const Cdp186xBase::VideoType& Cdp186xBase::getScreen() const
 {
     return _screen;
 }
 
-std::pair<int,bool> Cdp186x::executeStep()
+//---------------------------------------------------------------------------------------
+// The next cycle executeStep needs to look at: the frame start, the EF1 edges (as
+// getNEFX uses the frame cycle of the last step), the start of the interrupt window
+// and the DMA slot of the next visible line. Inside the interrupt window and DMA slot
+// every instruction boundary counts, and with trace logging every line start.
+cycles_t Cdp186xBase::nextEventCycle(cycles_t cycles) const
 {
-    auto fc = (_cpu.getCycles() >> 3) % 3668;
-    bool vsync = false;
-    if(fc < _frameCycle) {
-        vsync = true;
-        ++_frameCounter;
-    }
-    _frameCycle = fc;
-    auto lineCycle = _frameCycle % 14;
-    if(_options.optTraceLog) {
-        if (vsync)
-            Logger::log(Logger::eBACKEND_EMU, _cpu.getCycles(), {_frameCounter, _frameCycle}, fmt::format("{:24} ; {}", "--- VSYNC ---", _cpu.dumpStateLine()).c_str());
-        else if (lineCycle == 0)
-            Logger::log(Logger::eBACKEND_EMU, _cpu.getCycles(), {_frameCounter, _frameCycle}, fmt::format("{:24} ; {}", "--- HSYNC ---", _cpu.dumpStateLine()).c_str());
-    }
-    if(_frameCycle > VIDEO_FIRST_INVISIBLE_LINE * 14 || _frameCycle < (VIDEO_FIRST_VISIBLE_LINE - 2) * 14)
-        return {_frameCycle,vsync};
-    if(_frameCycle < VIDEO_FIRST_VISIBLE_LINE * 14 && _frameCycle >= (VIDEO_FIRST_VISIBLE_LINE - 2) * 14 + 2 && _cpu.getIE()) {
-        _displayEnabledLatch = _displayEnabled;
-        if(_displayEnabled) {
-            if (_options.optTraceLog)
-                Logger::log(Logger::eBACKEND_EMU, _cpu.getCycles(), {_frameCounter, _frameCycle}, fmt::format("{:24} ; {}", "--- IRQ ---", _cpu.dumpStateLine()).c_str());
-            _cpu.triggerInterrupt();
-        }
-    }
-    else if(_frameCycle >= VIDEO_FIRST_VISIBLE_LINE * 14 && _frameCycle < VIDEO_FIRST_INVISIBLE_LINE * 14) {
-        auto line = _frameCycle / 14;
-        if(lineCycle == 4 || lineCycle == 5) {
-            auto dmaStart = _cpu.getR(0);
-            auto highBits = 0;
-            auto mask = _type == eVP590 && _subMode != eVP590_DEFAULT ? (_subMode == eVP590_HIRES ? 0x3FF : 0x3E7) : 0;
-            if(_subMode == eVP590_DEFAULT)
-                highBits = 7;
-            for (int i = 0; i < 8; ++i) {
-                auto [data, addr] = _displayEnabledLatch ? _cpu.executeDMAOut() : std::make_pair((uint8_t)0, (uint16_t)0);
-                if(mask)
-                    highBits = _cpu.readByteDMA(0xD000 | (addr & mask)) << 4;
-//                std::cout << fmt::format("{:04x}/{:04x} = {:02x}", addr, 0xD000 | (addr & mask), highBits) << std::endl;
-                for (int j = 0; j < 8; ++j) {
-                    _screen.setPixel(i * 8 + j, (line - VIDEO_FIRST_VISIBLE_LINE), highBits | ((data >> (7 - j)) & 1));
-                }
-            }
-            if (_displayEnabledLatch) {
-                if(_options.optTraceLog)
-                    Logger::log(Logger::eBACKEND_EMU, _cpu.getCycles(), {_frameCounter, _frameCycle}, fmt::format("DMA: line {:03d} 0x{:04x}-0x{:04x}", line, dmaStart, _cpu.getR(0) - 1).c_str());
-            }
-        }
+    auto mc = machineCycle(cycles);
+    auto fc = int(mc % 3668);
+    auto lineCycle = fc % 14;
+    auto lineStart = fc - lineCycle;
+    if(fc >= (VIDEO_FIRST_VISIBLE_LINE - 2) * 14 + 2 && fc < VIDEO_FIRST_VISIBLE_LINE * 14)
+        return cycles + 1;
+    if(fc >= VIDEO_FIRST_VISIBLE_LINE * 14 && fc < VIDEO_FIRST_INVISIBLE_LINE * 14 && (lineCycle == 4 || lineCycle == 5))
+        return cycles + 1;
+    int next = 3668;
+    auto candidate = [fc, &next](int frameCycle) {
+        if(frameCycle > fc && frameCycle < next)
+            next = frameCycle;
+    };
+    candidate((VIDEO_FIRST_VISIBLE_LINE - 4) * 14);
+    candidate((VIDEO_FIRST_VISIBLE_LINE - 2) * 14 + 2);
+    candidate(VIDEO_FIRST_VISIBLE_LINE * 14);
+    candidate((VIDEO_FIRST_INVISIBLE_LINE - 4) * 14);
+    candidate(VIDEO_FIRST_INVISIBLE_LINE * 14);
+    if(fc < VIDEO_FIRST_VISIBLE_LINE * 14)
+        candidate(VIDEO_FIRST_VISIBLE_LINE * 14 + 4);
+    else if(fc < VIDEO_FIRST_INVISIBLE_LINE * 14) {
+        candidate(lineStart + 4);
+        if(lineStart + 14 < VIDEO_FIRST_INVISIBLE_LINE * 14)
+            candidate(lineStart + 14 + 4);
     }
-    return {(_cpu.getCycles() >> 3) % 3668, vsync};
+    if(_options.optTraceLog)
+        candidate(lineStart + 14);
+    return cycles_t(mc - fc + next) << 3;
 }
 
-void Cdp186x::incrementBackground()
+void Cdp186xBase::incrementBackground()
 {
     _backgroundColor = (_backgroundColor + 1) & 3;
+    updateBackgroundPalette();
+}
+
+void Cdp186xBase::updateBackgroundPalette()
+{
     for(int i = 0; i < 256; i += 16) {
         _cdp1862Palette[i] = _cdp1862BackgroundColors[_backgroundColor];
     }
     _screen.setPalette(_cdp1862Palette);
 }
 
+void Cdp186xBase::saveState(StateWriter& writer) const
+{
+    writer.beginChunk(stateTag("186X"));
+    writer.write(_subMode);
+    writer.write(int32_t(_frameCycle));
+    writer.write(int32_t(_frameCounter));
+    writer.write(uint8_t(_backgroundColor));
+    writer.write(_displayEnabled);
+    writer.write(_displayEnabledLatch);
+    _screen.saveState(writer);
+    writer.endChunk();
+}
+
+void Cdp186xBase::loadState(StateReader& reader)
+{
+    reader.beginChunk(stateTag("186X"));
+    reader.read(_subMode);
+    _frameCycle = reader.read<int32_t>();
+    _frameCounter = reader.read<int32_t>();
+    _backgroundColor = reader.read<uint8_t>() & 3;
+    reader.read(_displayEnabled);
+    reader.read(_displayEnabledLatch);
+    _screen.loadState(reader);
+    if(_type == eVP590) {
+        updateBackgroundPalette();
+    }
+    reader.endChunk();
+    _scheduler.schedule(_event, 0);
+}
+
 }
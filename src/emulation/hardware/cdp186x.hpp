@@ -27,9 +27,14 @@
 
 #include <emulation/chip8options.hpp>
 #include <emulation/config.hpp>
+#include <emulation/logger.hpp>
+#include <emulation/scheduler.hpp>
 #include <emulation/videoscreen.hpp>
 
+#include <fmt/format.h>
+
 #include <array>
+#include <functional>
 #include <utility>
 
 namespace emu {
@@ -37,19 +42,22 @@ namespace emu {
 #define VIDEO_FIRST_VISIBLE_LINE 80
 #define VIDEO_FIRST_INVISIBLE_LINE  208
 
-class Cdp1802;
+class StateReader;
+class StateWriter;
 
-class Cdp186x
+//---------------------------------------------------------------------------------------
+// Video chip state and timing that doesn't depend on the cpu it is wired to
+//---------------------------------------------------------------------------------------
+class Cdp186xBase
 {
 public:
     enum Type { eCDP1861, eVP590, eCDP1861_C10, eCDP1861_62, eCDP1864 };
     enum SubMode { eNONE, eVP590_DEFAULT, eVP590_LORES, eVP590_HIRES};
     using VideoType = VideoScreen<uint8_t, 256, 192>; // size for easier inter-operability with other CHIP-8 implementations, it just uses 64x128
-    Cdp186x(Type type, Cdp1802& cpu, const Chip8EmulatorOptions& options);
+    using VsyncHandler = std::function<void()>;
     void reset();
     bool getNEFX() const;
     Type getType() const { return _type; }
-    std::pair<int,bool> executeStep();
     void enableDisplay();
     void disableDisplay();
     bool isDisplayEnabled() const { return _displayEnabled; }
@@ -57,6 +65,8 @@ public:
     void incrementBackground();
     int frames() const { return _frameCounter; }
     const VideoType& getScreen() const;
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
 
     static int64_t machineCycle(cycles_t cycles)
     {
@@ -78,8 +88,13 @@ public:
         return ((cycles + 8*3668) / (8*3668)) * (8*3668);
     }
 
-private:
-    Cdp1802& _cpu;
+    VsyncHandler vsyncHandler;
+
+protected:
+    Cdp186xBase(Type type, Scheduler& scheduler, const Chip8EmulatorOptions& options);
+    cycles_t nextEventCycle(cycles_t cycles) const;
+    Scheduler& _scheduler;
+    Scheduler::EventId _event{};
     Type _type{eCDP1861};
     SubMode _subMode{eNONE};
     const Chip8EmulatorOptions& _options;
@@ -91,6 +106,83 @@ private:
     bool _displayEnabled{false};
     bool _displayEnabledLatch{false};
     static const uint32_t _cdp1862BackgroundColors[4];
+    void updateBackgroundPalette();
+};
+
+//---------------------------------------------------------------------------------------
+// CDP1861/VP-590 video chip driven by the scheduler of the machine. The cpu is a
+// template parameter like the bus of the Cdp1802, it needs getCycles(), getIE(),
+// triggerInterrupt(), getR(), executeDMAOut(), readByteDMA() and trace().
+//---------------------------------------------------------------------------------------
+template<typename Cpu>
+class Cdp186x : public Cdp186xBase
+{
+public:
+    Cdp186x(Type type, Cpu& cpu, Scheduler& scheduler, const Chip8EmulatorOptions& options)
+    : Cdp186xBase(type, scheduler, options)
+    , _cpu(cpu)
+    {
+        _event = _scheduler.registerEvent([this](cycles_t) { executeStep(); });
+        reset();
+    }
+
+private:
+    // Called by the scheduler at the instruction boundaries where something can happen,
+    // in between the state would be unchanged. Due to the instruction granularity some
+    // of those checks need to be repeated on the following boundaries (see nextEventCycle).
+    void executeStep()
+    {
+        auto fc = (_cpu.getCycles() >> 3) % 3668;
+        bool vsync = false;
+        if(fc < _frameCycle) {
+            vsync = true;
+            ++_frameCounter;
+        }
+        _frameCycle = fc;
+        auto lineCycle = _frameCycle % 14;
+        if(_options.optTraceLog) {
+            if (vsync)
+                _cpu.trace(_frameCounter, _frameCycle, TraceRecord::eVSYNC);
+            else if (lineCycle == 0)
+                _cpu.trace(_frameCounter, _frameCycle, TraceRecord::eHSYNC);
+        }
+        if(_frameCycle < VIDEO_FIRST_VISIBLE_LINE * 14 && _frameCycle >= (VIDEO_FIRST_VISIBLE_LINE - 2) * 14 + 2) {
+            if(_cpu.getIE()) {
+                _displayEnabledLatch = _displayEnabled;
+                if(_displayEnabled) {
+                    if (_options.optTraceLog)
+                        _cpu.trace(_frameCounter, _frameCycle, TraceRecord::eIRQ);
+                    _cpu.triggerInterrupt();
+                }
+            }
+        }
+        else if(_frameCycle >= VIDEO_FIRST_VISIBLE_LINE * 14 && _frameCycle < VIDEO_FIRST_INVISIBLE_LINE * 14) {
+            auto line = _frameCycle / 14;
+            if(lineCycle == 4 || lineCycle == 5) {
+                auto dmaStart = _cpu.getR(0);
+                auto highBits = 0;
+                auto mask = _type == eVP590 && _subMode != eVP590_DEFAULT ? (_subMode == eVP590_HIRES ? 0x3FF : 0x3E7) : 0;
+                if(_subMode == eVP590_DEFAULT)
+                    highBits = 7;
+                for (int i = 0; i < 8; ++i) {
+                    auto [data, addr] = _displayEnabledLatch ? _cpu.executeDMAOut() : std::make_pair((uint8_t)0, (uint16_t)0);
+                    if(mask)
+                        highBits = _cpu.readByteDMA(0xD000 | (addr & mask)) << 4;
+                    for (int j = 0; j < 8; ++j) {
+                        _screen.setPixel(i * 8 + j, (line - VIDEO_FIRST_VISIBLE_LINE), highBits | ((data >> (7 - j)) & 1));
+                    }
+                }
+                if (_displayEnabledLatch) {
+                    if(_options.optTraceLog)
+                        Logger::log(Logger::eBACKEND_EMU, _cpu.getCycles(), {_frameCounter, _frameCycle}, fmt::format("DMA: line {:03d} 0x{:04x}-0x{:04x}", line, dmaStart, _cpu.getR(0) - 1).c_str());
+                }
+            }
+        }
+        if(vsync && vsyncHandler)
+            vsyncHandler();
+        _scheduler.schedule(_event, nextEventCycle(_cpu.getCycles()));
+    }
+    Cpu& _cpu;
 };
 
 }
@@ -34,6 +34,9 @@
 #include <vector>
 #include <variant>
 #include <emulation/time.hpp>
+#include <emulation/addressbitmap.hpp>
+#include <emulation/cpuexpression.hpp>
+#include <emulation/logger.hpp>
 
 namespace emu
 {
@@ -42,11 +45,17 @@ class GenericCpu
 {
 public:
     enum ExecMode { ePAUSED, eRUNNING, eSTEP, eSTEPOVER, eSTEPOUT };
+    enum WatchAccess { eWATCH_READ = 1, eWATCH_WRITE = 2, eWATCH_ACCESS = 3 };
     struct BreakpointInfo {
         enum Type { eTRANSIENT, eCODED };
         std::string label;
         Type type{eTRANSIENT};
         bool isEnabled{true};
+        CpuExpression condition;      // only hits while this is non-zero, empty means always
+        int64_t ignoreCount{0};       // hits passed before the breakpoint pauses or logs
+        int64_t hitCount{0};
+        bool isTracepoint{false};     // logs logMessage on a hit instead of pausing
+        CpuLogFormat logMessage;
     };
     struct RegisterValue {
         uint32_t value{};
@@ -84,24 +93,16 @@ public:
     virtual void setBreakpoint(uint32_t address, const BreakpointInfo& bpi)
     {
         _breakpoints[address] = bpi;
-        _breakMap[address & 0xFFF] = 1;
+        _breakMap.set(address);
     }
     virtual void removeBreakpoint(uint32_t address)
     {
         _breakpoints.erase(address);
-        size_t count = 0;
-        uint32_t masked = address & 0xFFF;
-        for(const auto& [addr, bpi] : _breakpoints) {
-            if((addr & 0xFFF) == masked) {
-                _breakMap[masked] = 1;
-                return;
-            }
-        }
-        _breakMap[masked] = 0;
+        _breakMap.clear(address);
     }
     virtual BreakpointInfo* findBreakpoint(uint32_t address)
     {
-        if(_breakMap[address & 0xFFF]) {
+        if(_breakMap.test(address)) {
             auto iter = _breakpoints.find(address);
             if(iter != _breakpoints.end())
                 return &iter->second;
@@ -122,13 +123,67 @@ public:
     }
     virtual void removeAllBreakpoints()
     {
-        std::memset(_breakMap.data(), 0, 4096);
+        _breakMap.clearAll();
         _breakpoints.clear();
     }
     virtual bool hasBreakPoint(uint32_t address) const
     {
-        return _breakMap[address&0xfff] != 0;
+        return _breakMap.test(address);
+    }
+    // Called by the cores when execution reaches an address flagged by hasBreakPoint(),
+    // evaluates the condition, counts the hit and returns true if the cpu should pause.
+    bool triggerBreakpoint(uint32_t address)
+    {
+        if(_breakpointsSuspended)
+            return false;
+        auto iter = _breakpoints.find(address);
+        if(iter == _breakpoints.end())
+            return false;
+        auto& bpi = iter->second;
+        if(!bpi.isEnabled || !bpi.condition.isTrue(*this) || ++bpi.hitCount <= bpi.ignoreCount)
+            return false;
+        if(bpi.isTracepoint) {
+            auto message = bpi.logMessage.empty() ? bpi.label : bpi.label + ": " + bpi.logMessage.format(*this);
+            Logger::log(logSource(), getCycles(), logFrameTime(), message.c_str());
+            return false;
+        }
+        return true;
+    }
+    // while suspended, breakpoints neither count hits, log nor pause, for replaying
+    // code that already ran
+    void suspendBreakpoints(bool suspend) { _breakpointsSuspended = suspend; }
+    // source and frame position of messages the cpu logs itself (tracepoints)
+    virtual Logger::Source logSource() const { return Logger::eHOST; }
+    virtual Logger::FrameTime logFrameTime() const { return {0, 0}; }
+    void setWatchpoint(uint32_t address, int access)
+    {
+        if(access & eWATCH_READ)
+            _readWatchMap.set(address);
+        if(access & eWATCH_WRITE)
+            _writeWatchMap.set(address);
+        watchpointsChanged();
     }
+    void removeWatchpoint(uint32_t address, int access = eWATCH_ACCESS)
+    {
+        if(access & eWATCH_READ)
+            _readWatchMap.clear(address);
+        if(access & eWATCH_WRITE)
+            _writeWatchMap.clear(address);
+        watchpointsChanged();
+    }
+    void removeAllWatchpoints()
+    {
+        _readWatchMap.clearAll();
+        _writeWatchMap.clearAll();
+        watchpointsChanged();
+    }
+    int getWatchpoint(uint32_t address) const
+    {
+        return (_readWatchMap.test(address) ? eWATCH_READ : 0) | (_writeWatchMap.test(address) ? eWATCH_WRITE : 0);
+    }
+    bool hasWatchpoints() const { return !_readWatchMap.empty() || !_writeWatchMap.empty(); }
+    bool hasReadWatchpoint(uint32_t address, uint32_t size = 1) const { return _readWatchMap.testRange(address, size); }
+    bool hasWriteWatchpoint(uint32_t address, uint32_t size = 1) const { return _writeWatchMap.testRange(address, size); }
     RegisterValue getRegisterByName(const std::string& name) const
     {
         static const auto& regNames = getRegisterNames();
@@ -140,11 +195,30 @@ public:
     }
     virtual bool isBreakpointTriggered() { auto result = _breakpointTriggered; _breakpointTriggered = false; return result; }
 protected:
+    virtual void watchpointsChanged() {}
+    void checkReadWatch(uint32_t address, uint32_t size = 1) const
+    {
+        if(hasReadWatchpoint(address, size))
+            watchpointHit();
+    }
+    void checkWriteWatch(uint32_t address, uint32_t size = 1) const
+    {
+        if(hasWriteWatchpoint(address, size))
+            watchpointHit();
+    }
+    void watchpointHit() const
+    {
+        _execMode = ePAUSED;
+        _breakpointTriggered = true;
+    }
     mutable ExecMode _execMode{eRUNNING};
     uint32_t _stepOverSP{};
-    std::array<uint8_t,4096> _breakMap;
+    AddressBitmap _breakMap;
+    AddressBitmap _readWatchMap;
+    AddressBitmap _writeWatchMap;
     std::map<uint32_t,BreakpointInfo> _breakpoints;
-    bool _breakpointTriggered{false};
+    mutable bool _breakpointTriggered{false};
+    bool _breakpointsSuspended{false};
 };
 
 }
\ No newline at end of file
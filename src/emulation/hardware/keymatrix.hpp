@@ -102,7 +102,38 @@ public:
         _switchStates = keys;
         updateStates();
     }
+    template<typename Writer>
+    void saveState(Writer& writer) const
+    {
+        for(const auto& state : _rowStates)
+            writer.write(pinState(state));
+        for(const auto& state : _colStates)
+            writer.write(pinState(state));
+        for(auto key : _switchStates)
+            writer.write(key);
+    }
+    template<typename Reader>
+    void loadState(Reader& reader)
+    {
+        for(auto& state : _rowStates)
+            setPinState(state, reader.template read<uint8_t>());
+        for(auto& state : _colStates)
+            setPinState(state, reader.template read<uint8_t>());
+        for(auto& key : _switchStates)
+            reader.read(key);
+    }
 private:
+    struct Pin;
+    // packs each optional level into two bits: bit 1 is "has value", bit 0 the level
+    static uint8_t pinState(const Pin& pin)
+    {
+        return (pin.input ? (2 | *pin.input) : 0) | ((pin.output ? (2 | *pin.output) : 0) << 2);
+    }
+    static void setPinState(Pin& pin, uint8_t val)
+    {
+        pin.input = (val & 2) ? std::optional<bool>(val & 1) : std::nullopt;
+        pin.output = (val & 8) ? std::optional<bool>(val & 4) : std::nullopt;
+    }
     void updateStates()
     {
         int row = 0;
@@ -39,7 +39,14 @@
 //          opcodes, thus accessing memory more often than needed for
 //          minimal functionality. These accesses are done at cycle counts
 //          that would match a real CPU, to allow external hardware to
-//          emulate the matching time difference where needed.
+//          emulate the matching time difference where needed. The
+//          passive cycles are only forwarded to buses that have a
+//          dummyRead member, for all others they compile away.
+//
+//        * The bus is a template parameter too, M6800Bus is only the
+//          virtual default, a system can pass its own (ideally final)
+//          class with readByte/writeByte/readDebugByte members to have
+//          all accesses inlined.
 //---------------------------------------------------------------------------------------
 #pragma once
 
@@ -52,6 +59,8 @@
 
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 #ifdef USE_STD_FORMAT
 #include <format>
@@ -139,6 +148,12 @@ public:
     virtual void writeByte(word_t addr, byte_t val) = 0;
 };
 
+template<typename Bus, typename = void>
+struct M6800BusHasDummyRead : std::false_type {};
+
+template<typename Bus>
+struct M6800BusHasDummyRead<Bus, std::void_t<decltype(std::declval<const Bus&>().dummyRead(0))>> : std::true_type {};
+
 struct M6800State
 {
     uint8_t a{};
@@ -166,7 +181,7 @@ inline bool operator==(const M6800State& s1, const M6800State& s2)
 
 #ifndef M6800_STATE_BUS_ONLY
 
-template<typename byte_t = uint8_t, typename word_t = uint16_t, typename long_t = uint32_t, typename ccflags_t = flags8_t>
+template<typename byte_t = uint8_t, typename word_t = uint16_t, typename long_t = uint32_t, typename ccflags_t = flags8_t, typename bus_t = M6800Bus<byte_t, word_t>>
 #ifdef CADMIUM_WITH_GENERIC_CPU
 #define GENERIC_OVERRIDE override
 class M6800 : public GenericCpu
@@ -176,7 +191,7 @@ class M6800
 #endif
 {
 public:
-    using Bus = M6800Bus<byte_t, word_t>;
+    using Bus = bus_t;
     using ByteType = byte_t;
     using WordType = word_t;
     using LongType = long_t;
@@ -212,12 +227,12 @@ public:
     };
 
 #ifdef M6800_WITH_TIME
-    M6800(M6800Bus<byte_t, word_t>& bus, Time::ticks_t clockSpeed = 1000000)
+    M6800(Bus& bus, Time::ticks_t clockSpeed = 1000000)
         : _bus(bus)
         , _clockSpeed(clockSpeed)
         , _systemTime(clockSpeed)
 #else
-    M6800(M6800Bus<byte_t, word_t>& bus)
+    M6800(Bus& bus)
         : _bus(bus)
 #endif
     {
@@ -258,6 +273,18 @@ public:
         _cpuState = _halt ? eHALT : eNORMAL;
     }
 
+    // A cpu in WAI does nothing until an interrupt it can take, so this moves the
+    // cycle counter directly to the given cycle and returns the cycles skipped
+    // (zero if not waiting or such an interrupt is already pending).
+    int64_t skipWaitUntil(int64_t cycles)
+    {
+        if(_cpuState != eWAIT || _nmi || (_irq && _rCC.isUnset(I)) || cycles <= _cycles)
+            return 0;
+        auto skipped = cycles - _cycles;
+        addCycles(int(skipped));
+        return skipped;
+    }
+
 #ifdef M6800_WITH_TIME
     const ClockedTime& getTime() const override
     {
@@ -333,11 +360,56 @@ public:
         _instructions = state.instruction;
     }
 
+    template<typename Writer>
+    void saveState(Writer& writer) const
+    {
+        writer.write(uint8_t(asNativeInt(_rA)));
+        writer.write(uint8_t(asNativeInt(_rB)));
+        writer.write(uint16_t(asNativeInt(_rIX)));
+        writer.write(uint16_t(asNativeInt(_rSP)));
+        writer.write(uint16_t(asNativeInt(_rPC)));
+        writer.write(uint8_t(_rCC.asNumber()));
+        writer.write(_cycles);
+        writer.write(_instructions);
+        writer.write(_cpuState);
+        writer.write(_irq);
+        writer.write(_nmi);
+        writer.write(_halt);
+#ifdef M6800_WITH_TIME
+        writer.writeTime(_systemTime);
+#endif
+    }
+
+    template<typename Reader>
+    void loadState(Reader& reader)
+    {
+        _rA = reader.template read<uint8_t>();
+        _rB = reader.template read<uint8_t>();
+        _rIX = reader.template read<uint16_t>();
+        _rSP = reader.template read<uint16_t>();
+        _rPC = reader.template read<uint16_t>();
+        _rCC.setFromVal(0xFF, reader.template read<uint8_t>());
+        reader.read(_cycles);
+        reader.read(_instructions);
+        reader.read(_cpuState);
+        reader.read(_irq);
+        reader.read(_nmi);
+        reader.read(_halt);
+#ifdef M6800_WITH_TIME
+        reader.readTime(_systemTime);
+#endif
+    }
+
     byte_t readByte(word_t addr) { auto val = _bus.readByte(addr); addCycles(1); return val; }
     word_t readWord(word_t addr) { auto t = readByte(addr); return (t << 8) | readByte(addr + 1); }
     void writeByte(word_t addr, byte_t val) { _bus.writeByte(addr, val); addCycles(1); }
     void writeWord(word_t addr, word_t val) { writeByte(addr, val>>8); writeByte(addr + 1, val & 0xff); }
-    void dummyReadByte(word_t addr) { _bus.dummyRead(addr); addCycles(1); }
+    void dummyReadByte(word_t addr)
+    {
+        if constexpr(M6800BusHasDummyRead<Bus>::value)
+            _bus.dummyRead(addr);
+        addCycles(1);
+    }
     void dummyReadWord(word_t addr) { addCycles(2); }
     void dummyWriteByte(word_t addr, word_t val) { addCycles(1); }
     void addCycles(int cycles)
@@ -436,12 +508,11 @@ public:
     int64_t executeFor(int64_t microseconds) override
     {
         if(_execMode != GenericCpu::ePAUSED) {
-            auto startTime = _systemTime;
-            auto endTime = _systemTime + Time::fromMicroseconds(microseconds);
-            while (_execMode != GenericCpu::ePAUSED && _systemTime < endTime) {
+            auto endCycles = _cycles + _systemTime.cyclesFromMicroseconds(microseconds);
+            while (_execMode != GenericCpu::ePAUSED && _cycles < endCycles) {
                 executeInstruction();
             }
-            return startTime.excessTime_us(_systemTime, microseconds);
+            return _cycles > endCycles ? _systemTime.microsecondsFromCycles(_cycles - endCycles) : 0;
         }
         return 0;
     }
@@ -466,19 +537,16 @@ public:
             handleIRQ();
         if(_cpuState == eNORMAL) {
             _opcode = readByte(_rPC++);
-            _info = &_opcodes[_opcode];
-            (this->*_info->handler)();
+            (this->*_opcodes[_opcode].handler)();
             ++_instructions;
         }
 #ifdef CADMIUM_WITH_GENERIC_CPU
         if (_execMode == eSTEP || (_execMode == eSTEPOVER && _rSP >= _stepOverSP)) {
             _execMode = ePAUSED;
         }
-        if(hasBreakPoint(getPC())) {
-            if(findBreakpoint(getPC())) {
-                _execMode = ePAUSED;
-                _breakpointTriggered = true;
-            }
+        if(hasBreakPoint(getPC()) && triggerBreakpoint(getPC())) {
+            _execMode = ePAUSED;
+            _breakpointTriggered = true;
         }
 #endif
     }
@@ -506,6 +574,14 @@ public:
     }
     bool inErrorState() const override { return _cpuState == eERROR; }
     uint32_t getCpuID() const override { return 6800; }
+    Logger::Source logSource() const override { return Logger::eBACKEND_EMU; }
+    Logger::FrameTime logFrameTime() const override
+    {
+        if constexpr(std::is_base_of_v<GenericCpu, Bus>)
+            return _bus.logFrameTime();
+        else
+            return {0, 0};
+    }
     const std::string& getName() const override { static const std::string name = "M6800"; return name; }
     const std::vector<std::string>& getRegisterNames() const override
     {
@@ -602,34 +678,38 @@ private:
     void ccSetFlagsCNZV(byte_t v1, byte_t v2, word_t res) { auto r8 = static_cast<byte_t>(res); ccSetC(res); ccSetN(r8); ccSetZ(r8); ccSetV(v1, v2, res); }
     void ccSetFlagsCNZV(word_t v1, word_t v2, long_t res) { auto r16 = static_cast<word_t>(res); ccSetC(res); ccSetN(r16); ccSetZ(r16); ccSetV(v1, v2, res); }
 
-    word_t getEA(int mode)
+    template<int MODE>
+    word_t getEA()
     {
-        uint8_t t;
-        switch(mode & 7) {
-            case IMMEDIATE:
-                _rPC++;
-                return _rPC - 1;
-            case IMMEDIATE16:
-                _rPC += 2;
-                return _rPC - 2;
-            case DIRECT:
-                return readByte(_rPC++);
-            case EXTENDED:
-                t = readByte(_rPC++);
-                return (t<<8) | readByte(_rPC++);
-            case RELATIVE:
-                t = readByte(_rPC++);
-                return isValidInt(t) ? _rPC + (int8_t)asNativeInt(t) : word_t();
-            case INDEXED:
-                t = readByte(_rPC++);
-                _rIXwoc = (_rIX & 0xFF00) | (static_cast<byte_t>(_rIX) + t);
-                return _rIX + t;
-            default:
-                return 0;
+        if constexpr((MODE & 7) == IMMEDIATE) {
+            _rPC++;
+            return _rPC - 1;
+        }
+        else if constexpr((MODE & 7) == IMMEDIATE16) {
+            _rPC += 2;
+            return _rPC - 2;
+        }
+        else if constexpr((MODE & 7) == DIRECT) {
+            return readByte(_rPC++);
+        }
+        else if constexpr((MODE & 7) == EXTENDED) {
+            uint8_t t = readByte(_rPC++);
+            return (t<<8) | readByte(_rPC++);
+        }
+        else if constexpr((MODE & 7) == RELATIVE) {
+            uint8_t t = readByte(_rPC++);
+            return isValidInt(t) ? _rPC + (int8_t)asNativeInt(t) : word_t();
+        }
+        else if constexpr((MODE & 7) == INDEXED) {
+            uint8_t t = readByte(_rPC++);
+            _rIXwoc = (_rIX & 0xFF00) | (static_cast<byte_t>(_rIX) + t);
+            return _rIX + t;
+        }
+        else {
+            return 0;
         }
     }
 
-
     void handleIRQ()
     {
         if(_cpuState == eWAIT)
@@ -664,10 +744,12 @@ private:
         addCycles(1);
     }
 
+    template<int MODE>
     void opINVALID()
     {
         // TODO: Currently NOP, but shouldn't
     }
+    template<int MODE>
     void opABA()
     {
         word_t sum = _rA + _rB;
@@ -676,11 +758,12 @@ private:
         ccSetFlagsCNZV(_rA, _rB, sum);
         _rA = sum;
     }
+    template<int MODE>
     void opADC()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -690,11 +773,12 @@ private:
         ccSetFlagsCNZV(accu, val, sum);
         accu = sum;
     }
+    template<int MODE>
     void opADD()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -704,11 +788,12 @@ private:
         ccSetFlagsCNZV(accu, val, sum);
         accu = sum;
     }
+    template<int MODE>
     void opAND()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -716,10 +801,11 @@ private:
         accu &= val;
         ccSetNZv(accu);
     }
+    template<int MODE>
     void opASL()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             _rCC.setFromBool(C, accu & 0x80);
             accu <<= 1;
             ccSetNZ(accu);
@@ -727,8 +813,8 @@ private:
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -741,10 +827,11 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opASR()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             _rCC.setFromBool(C, accu & 1);
             accu = (accu >> 1) | (accu & 0x80);
             ccSetNZ(accu);
@@ -752,8 +839,8 @@ private:
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -766,59 +853,66 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opBCC()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(C))
             _rPC = ea;
     }
+    template<int MODE>
     void opBCS()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(C))
             _rPC = ea;
     }
+    template<int MODE>
     void opBEQ()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(Z))
             _rPC = ea;
     }
+    template<int MODE>
     void opBGE()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isValue(N|V,N|V) || _rCC.isValue(N|V,0))
             _rPC = ea;
     }
+    template<int MODE>
     void opBGT()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(Z) && (_rCC.isValue(N|V,N|V) || _rCC.isValue(N|V,0)))
             _rPC = ea;
     }
+    template<int MODE>
     void opBHI()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(C|Z))
             _rPC = ea;
     }
+    template<int MODE>
     void opBIT()
     {
-        auto ea = getEA(_info->addrMode);
-        auto accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -826,64 +920,72 @@ private:
         accu &= val;
         ccSetNZv(accu);
     }
+    template<int MODE>
     void opBLE()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(Z) || _rCC.isValue(N|V,N) || _rCC.isValue(N|V,V))
             _rPC = ea;
     }
+    template<int MODE>
     void opBLS()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(C) || _rCC.isSet(Z))
             _rPC = ea;
     }
+    template<int MODE>
     void opBLT()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isValue(N|V,N) || _rCC.isValue(N|V,V))
             _rPC = ea;
     }
+    template<int MODE>
     void opBMI()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(N))
             _rPC = ea;
     }
+    template<int MODE>
     void opBNE()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(Z))
             _rPC = ea;
     }
+    template<int MODE>
     void opBPL()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(N))
             _rPC = ea;
     }
+    template<int MODE>
     void opBRA()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         _rPC = ea;
     }
+    template<int MODE>
     void opBSR()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         pushWord(_rPC);
         dummyReadByte(_rSP);
@@ -891,48 +993,54 @@ private:
         dummyReadByte(ea);
         _rPC = ea;
     }
+    template<int MODE>
     void opBVC()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isUnset(V))
             _rPC = ea;
     }
+    template<int MODE>
     void opBVS()
     {
-        auto ea = getEA(RELATIVE);
+        auto ea = getEA<RELATIVE>();
         dummyReadByte(_rPC);
         dummyReadByte(ea);
         if(_rCC.isSet(V))
             _rPC = ea;
     }
+    template<int MODE>
     void opCBA()
     {
         readByte(_rPC);
         word_t res = _rA - _rB;
         ccSetFlagsCNZV(_rA, _rB, res);
     }
+    template<int MODE>
     void opCLC()
     {
         _rCC.clear(C);
         readByte(_rPC);
     }
+    template<int MODE>
     void opCLI()
     {
         _rCC.clear(I);
         readByte(_rPC);
     }
+    template<int MODE>
     void opCLR()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             readByte(_rPC);
             accu = 0;
         }
         else{
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -942,16 +1050,18 @@ private:
         }
         _rCC.setFromVal(N|Z|C|V,Z);
     }
+    template<int MODE>
     void opCLV()
     {
         _rCC.clear(V);
         readByte(_rPC);
     }
+    template<int MODE>
     void opCMP()
     {
-        auto accu = _info->addrMode & ACCUA ? _rA : _rB;
-        auto ea = getEA(_info->addrMode);
-        if((_info->addrMode & 7) == INDEXED) {
+        auto accu = MODE & ACCUA ? _rA : _rB;
+        auto ea = getEA<MODE>();
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -959,10 +1069,11 @@ private:
         word_t res = accu - val;
         ccSetFlagsCNZV(accu, val, res);
     }
+    template<int MODE>
     void opCOM()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu;
             accu = 0xFF - accu;
             ccSetNZ(accu);
@@ -970,8 +1081,8 @@ private:
             dummyReadByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -984,10 +1095,11 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opCPX()
     {
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == INDEXED) {
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -998,6 +1110,7 @@ private:
         ccSetZ(resw);
         _rCC.setFromBool(V, ((_rIX & 0x8000) && !(val & 0x8000) && !(resw & 0x8000)) || (!(_rIX & 0x8000) && (val & 0x8000) && (resw & 0x8000)));
     }
+    template<int MODE>
     void opDAA()
     {
         readByte(_rPC);
@@ -1012,18 +1125,19 @@ private:
         }
         ccSetNZ(_rA);
     }
+    template<int MODE>
     void opDEC()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu--;
             ccSetNZ(accu);
             _rCC.setFromBool(V, old == 0x80);
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1035,6 +1149,7 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opDES()
     {
         readByte(_rPC);
@@ -1042,6 +1157,7 @@ private:
         --_rSP;
         dummyReadByte(_rSP);
     }
+    template<int MODE>
     void opDEX()
     {
         readByte(_rPC);
@@ -1050,11 +1166,12 @@ private:
         ccSetZ(_rIX);
         dummyReadByte(_rIX);
     }
+    template<int MODE>
     void opEOR()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -1062,18 +1179,19 @@ private:
         accu ^= val;
         ccSetNZv(accu);
     }
+    template<int MODE>
     void opINC()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu++;
             ccSetNZ(accu);
             _rCC.setFromBool(V, old == 0x7F);
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1085,6 +1203,7 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opINS()
     {
         readByte(_rPC);
@@ -1092,6 +1211,7 @@ private:
         ++_rSP;
         dummyReadByte(_rSP);
     }
+    template<int MODE>
     void opINX()
     {
         readByte(_rPC);
@@ -1100,19 +1220,21 @@ private:
         ccSetZ(_rIX);
         dummyReadByte(_rIX);
     }
+    template<int MODE>
     void opJMP()
     {
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == INDEXED) {
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
         _rPC = ea;
     }
+    template<int MODE>
     void opJSR()
     {
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == EXTENDED) {
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == EXTENDED) {
             readByte(ea);
             pushWord(_rPC);
             dummyReadByte(_rSP);
@@ -1128,41 +1250,45 @@ private:
         }
         _rPC = ea;
     }
+    template<int MODE>
     void opLDA()
     {
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        auto ea = getEA(_info->addrMode);
-        if((_info->addrMode & 7) == INDEXED) {
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        auto ea = getEA<MODE>();
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(ea);
         }
         accu = readByte(ea);
         ccSetNZv(accu);
     }
+    template<int MODE>
     void opLDS()
     {
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == INDEXED) {
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
         _rSP = readWord(ea);
         ccSetNZv(_rSP);
     }
+    template<int MODE>
     void opLDX()
     {
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == INDEXED) {
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
         _rIX = readWord(ea);
         ccSetNZv(_rIX);
     }
+    template<int MODE>
     void opLSR()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             _rCC.setFromBool(C, accu & 1);
             accu >>= 1;
             ccSetNZ(accu);
@@ -1170,8 +1296,8 @@ private:
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1184,11 +1310,13 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opNBA() {}
+    template<int MODE>
     void opNEG()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu;
             accu = -accu;
             ccSetNZ(accu);
@@ -1197,8 +1325,8 @@ private:
             dummyReadByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1212,15 +1340,17 @@ private:
             writeByte(ea, val);
         }
     }
+    template<int MODE>
     void opNOP()
     {
         readByte(_rPC);
     }
+    template<int MODE>
     void opORA()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -1228,24 +1358,27 @@ private:
         accu |= val;
         ccSetNZv(accu);
     }
+    template<int MODE>
     void opPSH()
     {
-        auto accu = _info->addrMode & ACCUA ? _rA : _rB;
+        auto accu = MODE & ACCUA ? _rA : _rB;
         readByte(_rPC);
         pushByte(accu);
         dummyReadByte(_rSP);
     }
+    template<int MODE>
     void opPUL()
     {
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        auto& accu = MODE & ACCUA ? _rA : _rB;
         readByte(_rPC);
         accu = pullByte();
         readByte(_rSP);
     }
+    template<int MODE>
     void opROL()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu;
             accu = (accu << 1) | (_rCC.isSet(C) ? 1 : 0);
             _rCC.setFromBool(C, old & 0x80);
@@ -1253,8 +1386,8 @@ private:
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1268,10 +1401,11 @@ private:
         }
         _rCC.setFromBool(V, _rCC.isValue(N|C, N) || _rCC.isValue(N|C, C));
     }
+    template<int MODE>
     void opROR()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INHERENT) {
+            auto& accu = MODE & ACCUA ? _rA : _rB;
             auto old = accu;
             accu = (accu >> 1) | (_rCC.isSet(C) ? 0x80 : 0);
             _rCC.setFromBool(C, old & 1);
@@ -1279,8 +1413,8 @@ private:
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1294,6 +1428,7 @@ private:
         }
         _rCC.setFromBool(V, _rCC.isValue(N|C, N) || _rCC.isValue(N|C, C));
     }
+    template<int MODE>
     void opRTI()
     {
         readByte(_rPC);
@@ -1304,12 +1439,14 @@ private:
         _rIX = pullWord();
         _rPC = pullWord();
     }
+    template<int MODE>
     void opRTS()
     {
         readByte(_rPC);
         dummyReadByte(_rSP);
         _rPC = pullWord();
     }
+    template<int MODE>
     void opSBA()
     {
         word_t res = word_t(_rA) - _rB;
@@ -1317,11 +1454,12 @@ private:
         ccSetFlagsCNZV(_rA, _rB, res);
         _rA = res;
     }
+    template<int MODE>
     void opSBC()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -1330,26 +1468,30 @@ private:
         ccSetFlagsCNZV(accu, val, res);
         accu = res;
     }
+    template<int MODE>
     void opSEC()
     {
         _rCC.set(C);
         readByte(_rPC);
     }
+    template<int MODE>
     void opSEI()
     {
         _rCC.set(I);
         readByte(_rPC);
     }
+    template<int MODE>
     void opSEV()
     {
         _rCC.set(V);
         readByte(_rPC);
     }
+    template<int MODE>
     void opSTA()
     {
-        auto accu = _info->addrMode & ACCUA ? _rA : _rB;
-        auto ea = getEA(_info->addrMode);
-        if((_info->addrMode & 7) == INDEXED) {
+        auto accu = MODE & ACCUA ? _rA : _rB;
+        auto ea = getEA<MODE>();
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
             dummyReadByte(ea);
@@ -1360,37 +1502,40 @@ private:
         ccSetNZv(accu);
         writeByte(ea, accu);
     }
+    template<int MODE>
     void opSTS()
     {
         ccSetNZv(_rSP);
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == DIRECT || _info->addrMode == EXTENDED)
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == DIRECT || MODE == EXTENDED)
             dummyReadByte(ea);
-        else if(_info->addrMode == INDEXED) {
+        else if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
             dummyReadByte(ea);
         }
         writeWord(ea, _rSP);
     }
+    template<int MODE>
     void opSTX()
     {
         ccSetNZv(_rIX);
-        auto ea = getEA(_info->addrMode);
-        if(_info->addrMode == DIRECT | _info->addrMode == EXTENDED)
+        auto ea = getEA<MODE>();
+        if constexpr(MODE == DIRECT || MODE == EXTENDED)
             dummyReadByte(ea);
-        else if(_info->addrMode == INDEXED) {
+        else if constexpr(MODE == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
             readByte(ea);
         }
         writeWord(ea, _rIX);
     }
+    template<int MODE>
     void opSUB()
     {
-        auto ea = getEA(_info->addrMode);
-        auto& accu = _info->addrMode & ACCUA ? _rA : _rB;
-        if((_info->addrMode & 7) == INDEXED) {
+        auto ea = getEA<MODE>();
+        auto& accu = MODE & ACCUA ? _rA : _rB;
+        if constexpr((MODE & 7) == INDEXED) {
             dummyReadByte(_rIX);
             dummyReadByte(_rIXwoc);
         }
@@ -1399,6 +1544,7 @@ private:
         ccSetFlagsCNZV(accu, val, res);
         accu = res;
     }
+    template<int MODE>
     void opSWI()
     {
         readByte(_rPC);
@@ -1411,39 +1557,44 @@ private:
         dummyReadByte(_rSP);
         _rPC = readWord(0xFFFA);
     }
+    template<int MODE>
     void opTAB()
     {
         _rB = _rA;
         ccSetNZv(_rB);
         readByte(_rPC);
     }
+    template<int MODE>
     void opTAP()
     {
         _rCC.setFromVal(N|Z|V|C|I|H, _rA & 0x3F);
         readByte(_rPC);
     }
+    template<int MODE>
     void opTBA()
     {
         _rA = _rB;
         ccSetNZv(_rA);
         readByte(_rPC);
     }
+    template<int MODE>
     void opTPA()
     {
         if(_rCC.isValid(N|Z|V|C|H))
             _rA = _rCC.asNumber();
         readByte(_rPC);
     }
+    template<int MODE>
     void opTST()
     {
-        if((_info->addrMode & 7) == INHERENT) {
-            ccSetNZ(_info->addrMode & ACCUA ? _rA : _rB);
+        if constexpr((MODE & 7) == INHERENT) {
+            ccSetNZ(MODE & ACCUA ? _rA : _rB);
             _rCC.clear(C|V);
             readByte(_rPC);
         }
         else {
-            auto ea = getEA(_info->addrMode);
-            if(_info->addrMode == INDEXED) {
+            auto ea = getEA<MODE>();
+            if constexpr(MODE == INDEXED) {
                 dummyReadByte(_rIX);
                 dummyReadByte(_rIXwoc);
             }
@@ -1454,6 +1605,7 @@ private:
             writeByte(ea, t);
         }
     }
+    template<int MODE>
     void opTSX()
     {
         readByte(_rPC);
@@ -1461,6 +1613,7 @@ private:
         _rIX = _rSP + 1;
         dummyReadByte(_rIX);
     }
+    template<int MODE>
     void opTXS()
     {
         readByte(_rPC);
@@ -1468,6 +1621,7 @@ private:
         _rSP = _rIX - 1;
         dummyReadByte(_rSP);
     }
+    template<int MODE>
     void opWAI()
     {
         readByte(_rPC);
@@ -1478,9 +1632,8 @@ private:
         _cpuState = eWAIT;
     }
 
-    M6800Bus<byte_t, word_t>& _bus;
+    Bus& _bus;
     byte_t _opcode{};
-    const OpcodeInfo* _info;
     byte_t _rA{};
     byte_t _rB{};
     word_t _rIX{};
@@ -1498,108 +1651,111 @@ private:
     Time::ticks_t _clockSpeed{};
     ClockedTime _systemTime;
 #endif
+    // The decode table is a compile time constant, every entry points to its
+    // handler instantiated for the entry's addressing mode, so operand fetch
+    // and accumulator selection are resolved at compile time per opcode.
 #if defined(OC) || defined(OC_ILL)
 #error "Conflicting symbols defined!"
 #endif
-#define OC(x) &M6800::op##x, #x
-#define OC_ILL &M6800::opINVALID, "???"
-    static inline OpcodeInfo _opcodes[] = {
+#define OC(bytes, cycles, mode, type, x) {bytes, cycles, mode, type, &M6800::op##x<mode>, #x}
+#define OC_ILL &M6800::opINVALID<INVALID>, "???"
+    static constexpr OpcodeInfo _opcodes[] = {
         // 00-07
-        {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT, NORMAL, OC(NOP)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL},
-        {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT, NORMAL, OC(TAP)}, {1, 2, INHERENT, NORMAL, OC(TPA)},
+        {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT, NORMAL, NOP), {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL},
+        {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT, NORMAL, TAP), OC(1, 2, INHERENT, NORMAL, TPA),
         // 08-0F
-        {1, 4, INHERENT, NORMAL, OC(INX)}, {1, 4, INHERENT, NORMAL, OC(DEX)}, {1, 2, INHERENT, NORMAL, OC(CLV)}, {1, 2, INHERENT, NORMAL, OC(SEV)},
-        {1, 2, INHERENT, NORMAL, OC(CLC)}, {1, 2, INHERENT, NORMAL, OC(SEC)}, {1, 2, INHERENT, NORMAL, OC(CLI)}, {1, 2, INHERENT, NORMAL, OC(SEI)},
+        OC(1, 4, INHERENT, NORMAL, INX), OC(1, 4, INHERENT, NORMAL, DEX), OC(1, 2, INHERENT, NORMAL, CLV), OC(1, 2, INHERENT, NORMAL, SEV),
+        OC(1, 2, INHERENT, NORMAL, CLC), OC(1, 2, INHERENT, NORMAL, SEC), OC(1, 2, INHERENT, NORMAL, CLI), OC(1, 2, INHERENT, NORMAL, SEI),
         // 10-17
-        {1, 2, INHERENT, NORMAL, OC(SBA)}, {1, 2, INHERENT, NORMAL, OC(CBA)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL},
-        {1, 2, INHERENT, NORMAL|UNDOC, OC(NBA)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT, NORMAL, OC(TAB)}, {1, 2, INHERENT, NORMAL, OC(TBA)},
+        OC(1, 2, INHERENT, NORMAL, SBA), OC(1, 2, INHERENT, NORMAL, CBA), {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL},
+        OC(1, 2, INHERENT, NORMAL|UNDOC, NBA), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT, NORMAL, TAB), OC(1, 2, INHERENT, NORMAL, TBA),
         // 18-1F
-        {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT, NORMAL, OC(DAA)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT, NORMAL, OC(ABA)},
+        {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT, NORMAL, DAA), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT, NORMAL, ABA),
         {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL},
         // 20-27
-        {2, 4, RELATIVE, JUMP, OC(BRA)}, {1, 0, INVALID, HALT, OC_ILL}, {2, 4, RELATIVE, CCJUMP, OC(BHI)}, {2, 4, RELATIVE, CCJUMP, OC(BLS)},
-        {2, 4, RELATIVE, CCJUMP, OC(BCC)}, {2, 4, RELATIVE, CCJUMP, OC(BCS)}, {2, 4, RELATIVE, CCJUMP, OC(BNE)}, {2, 4, RELATIVE, CCJUMP, OC(BEQ)},
+        OC(2, 4, RELATIVE, JUMP, BRA), {1, 0, INVALID, HALT, OC_ILL}, OC(2, 4, RELATIVE, CCJUMP, BHI), OC(2, 4, RELATIVE, CCJUMP, BLS),
+        OC(2, 4, RELATIVE, CCJUMP, BCC), OC(2, 4, RELATIVE, CCJUMP, BCS), OC(2, 4, RELATIVE, CCJUMP, BNE), OC(2, 4, RELATIVE, CCJUMP, BEQ),
         // 28-2F
-        {2, 4, RELATIVE, CCJUMP, OC(BVC)}, {2, 4, RELATIVE, CCJUMP, OC(BVS)}, {2, 4, RELATIVE, CCJUMP, OC(BPL)}, {2, 4, RELATIVE, CCJUMP, OC(BMI)},
-        {2, 4, RELATIVE, CCJUMP, OC(BGE)}, {2, 4, RELATIVE, CCJUMP, OC(BLT)}, {2, 4, RELATIVE, CCJUMP, OC(BGT)}, {2, 4, RELATIVE, CCJUMP, OC(BLE)},
+        OC(2, 4, RELATIVE, CCJUMP, BVC), OC(2, 4, RELATIVE, CCJUMP, BVS), OC(2, 4, RELATIVE, CCJUMP, BPL), OC(2, 4, RELATIVE, CCJUMP, BMI),
+        OC(2, 4, RELATIVE, CCJUMP, BGE), OC(2, 4, RELATIVE, CCJUMP, BLT), OC(2, 4, RELATIVE, CCJUMP, BGT), OC(2, 4, RELATIVE, CCJUMP, BLE),
         // 30-37
-        {1, 4, INHERENT, STACK, OC(TSX)}, {1, 4, INHERENT, STACK, OC(INS)}, {1, 4, INHERENT|ACCUA, STACK, OC(PUL)}, {1, 4, INHERENT|ACCUB, STACK, OC(PUL)},
-        {1, 4, INHERENT, STACK, OC(DES)}, {1, 4, INHERENT, STACK, OC(TXS)}, {1, 4, INHERENT|ACCUA, STACK, OC(PSH)}, {1, 4, INHERENT|ACCUB, STACK, OC(PSH)},
+        OC(1, 4, INHERENT, STACK, TSX), OC(1, 4, INHERENT, STACK, INS), OC(1, 4, INHERENT|ACCUA, STACK, PUL), OC(1, 4, INHERENT|ACCUB, STACK, PUL),
+        OC(1, 4, INHERENT, STACK, DES), OC(1, 4, INHERENT, STACK, TXS), OC(1, 4, INHERENT|ACCUA, STACK, PSH), OC(1, 4, INHERENT|ACCUB, STACK, PSH),
         // 38-3F
-        {1, 0, INVALID, HALT, OC_ILL}, {1, 5, INHERENT, RETURN, OC(RTS)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 10, INHERENT, RETURN, OC(RTI)},
-        {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 9, INHERENT, STACK, OC(WAI)}, {1, 12, INHERENT, CALL, OC(SWI)},
+        {1, 0, INVALID, HALT, OC_ILL}, OC(1, 5, INHERENT, RETURN, RTS), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 10, INHERENT, RETURN, RTI),
+        {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, OC(1, 9, INHERENT, STACK, WAI), OC(1, 12, INHERENT, CALL, SWI),
         // 40-47
-        {1, 2, INHERENT|ACCUA, NORMAL, OC(NEG)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUA, NORMAL, OC(COM)},
-        {1, 2, INHERENT|ACCUA, NORMAL, OC(LSR)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUA, NORMAL, OC(ROR)}, {1, 2, INHERENT|ACCUA, NORMAL, OC(ASR)},
+        OC(1, 2, INHERENT|ACCUA, NORMAL, NEG), {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUA, NORMAL, COM),
+        OC(1, 2, INHERENT|ACCUA, NORMAL, LSR), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUA, NORMAL, ROR), OC(1, 2, INHERENT|ACCUA, NORMAL, ASR),
         // 48-4F
-        {1, 2, INHERENT|ACCUA, NORMAL, OC(ASL)}, {1, 2, INHERENT|ACCUA, NORMAL, OC(ROL)}, {1, 2, INHERENT|ACCUA, NORMAL, OC(DEC)}, {1, 0, INVALID, HALT, OC_ILL},
-        {1, 2, INHERENT|ACCUA, NORMAL, OC(INC)}, {1, 2, INHERENT|ACCUA, NORMAL, OC(TST)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUA, NORMAL, OC(CLR)},
+        OC(1, 2, INHERENT|ACCUA, NORMAL, ASL), OC(1, 2, INHERENT|ACCUA, NORMAL, ROL), OC(1, 2, INHERENT|ACCUA, NORMAL, DEC), {1, 0, INVALID, HALT, OC_ILL},
+        OC(1, 2, INHERENT|ACCUA, NORMAL, INC), OC(1, 2, INHERENT|ACCUA, NORMAL, TST), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUA, NORMAL, CLR),
         // 50-57
-        {1, 2, INHERENT|ACCUB, NORMAL, OC(NEG)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUB, NORMAL, OC(COM)},
-        {1, 2, INHERENT|ACCUB, NORMAL, OC(LSR)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUB, NORMAL, OC(ROR)}, {1, 2, INHERENT|ACCUB, NORMAL, OC(ASR)},
+        OC(1, 2, INHERENT|ACCUB, NORMAL, NEG), {1, 0, INVALID, HALT, OC_ILL}, {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUB, NORMAL, COM),
+        OC(1, 2, INHERENT|ACCUB, NORMAL, LSR), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUB, NORMAL, ROR), OC(1, 2, INHERENT|ACCUB, NORMAL, ASR),
         // 58-5F
-        {1, 2, INHERENT|ACCUB, NORMAL, OC(ASL)}, {1, 2, INHERENT|ACCUB, NORMAL, OC(ROL)}, {1, 2, INHERENT|ACCUB, NORMAL, OC(DEC)}, {1, 0, INVALID, HALT, OC_ILL},
-        {1, 2, INHERENT|ACCUB, NORMAL, OC(INC)}, {1, 2, INHERENT|ACCUB, NORMAL, OC(TST)}, {1, 0, INVALID, HALT, OC_ILL}, {1, 2, INHERENT|ACCUB, NORMAL, OC(CLR)},
+        OC(1, 2, INHERENT|ACCUB, NORMAL, ASL), OC(1, 2, INHERENT|ACCUB, NORMAL, ROL), OC(1, 2, INHERENT|ACCUB, NORMAL, DEC), {1, 0, INVALID, HALT, OC_ILL},
+        OC(1, 2, INHERENT|ACCUB, NORMAL, INC), OC(1, 2, INHERENT|ACCUB, NORMAL, TST), {1, 0, INVALID, HALT, OC_ILL}, OC(1, 2, INHERENT|ACCUB, NORMAL, CLR),
         // 60-67
-        {2, 7, INDEXED, NORMAL, OC(NEG)}, {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, {2, 7, INDEXED, NORMAL, OC(COM)},
-        {2, 7, INDEXED, NORMAL, OC(LSR)}, {2, 0, INVALID, HALT, OC_ILL}, {2, 7, INDEXED, NORMAL, OC(ROR)}, {2, 7, INDEXED, NORMAL, OC(ASR)},
+        OC(2, 7, INDEXED, NORMAL, NEG), {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, OC(2, 7, INDEXED, NORMAL, COM),
+        OC(2, 7, INDEXED, NORMAL, LSR), {2, 0, INVALID, HALT, OC_ILL}, OC(2, 7, INDEXED, NORMAL, ROR), OC(2, 7, INDEXED, NORMAL, ASR),
         // 68-6F
-        {2, 7, INDEXED, NORMAL, OC(ASL)}, {2, 7, INDEXED, NORMAL, OC(ROL)}, {2, 7, INDEXED, NORMAL, OC(DEC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 7, INDEXED, NORMAL, OC(INC)}, {2, 7, INDEXED, NORMAL, OC(TST)}, {2, 4, INDEXED, JUMP, OC(JMP)}, {2, 7, INDEXED, NORMAL, OC(CLR)},
+        OC(2, 7, INDEXED, NORMAL, ASL), OC(2, 7, INDEXED, NORMAL, ROL), OC(2, 7, INDEXED, NORMAL, DEC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 7, INDEXED, NORMAL, INC), OC(2, 7, INDEXED, NORMAL, TST), OC(2, 4, INDEXED, JUMP, JMP), OC(2, 7, INDEXED, NORMAL, CLR),
         // 70-77
-        {3, 6, EXTENDED, NORMAL, OC(NEG)}, {3, 0, INVALID, HALT, OC_ILL}, {3, 0, INVALID, HALT, OC_ILL}, {3, 6, EXTENDED, NORMAL, OC(COM)},
-        {3, 6, EXTENDED, NORMAL, OC(LSR)}, {3, 0, INVALID, HALT, OC_ILL}, {3, 6, EXTENDED, NORMAL, OC(ROR)}, {3, 6, EXTENDED, NORMAL, OC(ASR)},
+        OC(3, 6, EXTENDED, NORMAL, NEG), {3, 0, INVALID, HALT, OC_ILL}, {3, 0, INVALID, HALT, OC_ILL}, OC(3, 6, EXTENDED, NORMAL, COM),
+        OC(3, 6, EXTENDED, NORMAL, LSR), {3, 0, INVALID, HALT, OC_ILL}, OC(3, 6, EXTENDED, NORMAL, ROR), OC(3, 6, EXTENDED, NORMAL, ASR),
         // 78-7F
-        {3, 6, EXTENDED, NORMAL, OC(ASL)}, {3, 6, EXTENDED, NORMAL, OC(ROL)}, {3, 6, EXTENDED, NORMAL, OC(DEC)}, {3, 0, INVALID, HALT, OC_ILL},
-        {3, 6, EXTENDED, NORMAL, OC(INC)}, {3, 6, EXTENDED, NORMAL, OC(TST)}, {3, 3, EXTENDED, JUMP, OC(JMP)}, {3, 6, EXTENDED, NORMAL, OC(CLR)},
+        OC(3, 6, EXTENDED, NORMAL, ASL), OC(3, 6, EXTENDED, NORMAL, ROL), OC(3, 6, EXTENDED, NORMAL, DEC), {3, 0, INVALID, HALT, OC_ILL},
+        OC(3, 6, EXTENDED, NORMAL, INC), OC(3, 6, EXTENDED, NORMAL, TST), OC(3, 3, EXTENDED, JUMP, JMP), OC(3, 6, EXTENDED, NORMAL, CLR),
         // 80-87
-        {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(SUB)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(CMP)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(AND)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(BIT)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(LDA)}, {2, 2, IMMEDIATE|ACCUA, NORMAL|UNDOC, OC(STA)},
+        OC(2, 2, IMMEDIATE|ACCUA, NORMAL, SUB), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, CMP), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 2, IMMEDIATE|ACCUA, NORMAL, AND), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, BIT), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, LDA), OC(2, 2, IMMEDIATE|ACCUA, NORMAL|UNDOC, STA),
         // 88-8F
-        {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(EOR)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(ADC)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(ORA)}, {2, 2, IMMEDIATE|ACCUA, NORMAL, OC(ADD)},
-        {3, 3, IMMEDIATE16, NORMAL, OC(CPX)}, {2, 8, RELATIVE, CCCALL, OC(BSR)}, {2, 3, IMMEDIATE16, STACK, OC(LDS)}, {2, 0, IMMEDIATE16, STACK|UNDOC, OC(STS)},
+        OC(2, 2, IMMEDIATE|ACCUA, NORMAL, EOR), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, ADC), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, ORA), OC(2, 2, IMMEDIATE|ACCUA, NORMAL, ADD),
+        OC(3, 3, IMMEDIATE16, NORMAL, CPX), OC(2, 8, RELATIVE, CCCALL, BSR), OC(2, 3, IMMEDIATE16, STACK, LDS), OC(2, 0, IMMEDIATE16, STACK|UNDOC, STS),
         // 90-97
-        {2, 3, DIRECT|ACCUA, NORMAL, OC(SUB)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(CMP)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 3, DIRECT|ACCUA, NORMAL, OC(AND)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(BIT)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(LDA)}, {2, 4, DIRECT|ACCUA, NORMAL, OC(STA)},
+        OC(2, 3, DIRECT|ACCUA, NORMAL, SUB), OC(2, 3, DIRECT|ACCUA, NORMAL, CMP), OC(2, 3, DIRECT|ACCUA, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 3, DIRECT|ACCUA, NORMAL, AND), OC(2, 3, DIRECT|ACCUA, NORMAL, BIT), OC(2, 3, DIRECT|ACCUA, NORMAL, LDA), OC(2, 4, DIRECT|ACCUA, NORMAL, STA),
         // 98-9F
-        {2, 3, DIRECT|ACCUA, NORMAL, OC(EOR)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(ADC)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(ORA)}, {2, 3, DIRECT|ACCUA, NORMAL, OC(ADD)},
-        {2, 4, DIRECT, NORMAL, OC(CPX)}, {1, 0, INVALID, HALT, OC_ILL/*HCF*/}, {2, 4, DIRECT, STACK, OC(LDS)}, {2, 5, DIRECT, STACK, OC(STS)},
+        OC(2, 3, DIRECT|ACCUA, NORMAL, EOR), OC(2, 3, DIRECT|ACCUA, NORMAL, ADC), OC(2, 3, DIRECT|ACCUA, NORMAL, ORA), OC(2, 3, DIRECT|ACCUA, NORMAL, ADD),
+        OC(2, 4, DIRECT, NORMAL, CPX), {1, 0, INVALID, HALT, OC_ILL/*HCF*/}, OC(2, 4, DIRECT, STACK, LDS), OC(2, 5, DIRECT, STACK, STS),
         // A0-A7
-        {2, 5, INDEXED|ACCUA, NORMAL, OC(SUB)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(CMP)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 5, INDEXED|ACCUA, NORMAL, OC(AND)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(BIT)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(LDA)}, {2, 6, INDEXED|ACCUA, NORMAL, OC(STA)},
+        OC(2, 5, INDEXED|ACCUA, NORMAL, SUB), OC(2, 5, INDEXED|ACCUA, NORMAL, CMP), OC(2, 5, INDEXED|ACCUA, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 5, INDEXED|ACCUA, NORMAL, AND), OC(2, 5, INDEXED|ACCUA, NORMAL, BIT), OC(2, 5, INDEXED|ACCUA, NORMAL, LDA), OC(2, 6, INDEXED|ACCUA, NORMAL, STA),
         // A8-AF
-        {2, 5, INDEXED|ACCUA, NORMAL, OC(EOR)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(ADC)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(ORA)}, {2, 5, INDEXED|ACCUA, NORMAL, OC(ADD)},
-        {2, 6, INDEXED, NORMAL, OC(CPX)}, {2, 8, INDEXED, CALL, OC(JSR)}, {2, 6, INDEXED, STACK, OC(LDS)}, {2, 7, INDEXED, STACK, OC(STS)},
+        OC(2, 5, INDEXED|ACCUA, NORMAL, EOR), OC(2, 5, INDEXED|ACCUA, NORMAL, ADC), OC(2, 5, INDEXED|ACCUA, NORMAL, ORA), OC(2, 5, INDEXED|ACCUA, NORMAL, ADD),
+        OC(2, 6, INDEXED, NORMAL, CPX), OC(2, 8, INDEXED, CALL, JSR), OC(2, 6, INDEXED, STACK, LDS), OC(2, 7, INDEXED, STACK, STS),
         // B0-B7
-        {3, 4, EXTENDED|ACCUA, NORMAL, OC(SUB)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(CMP)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(SBC)}, {3, 0, INVALID, HALT, OC_ILL},
-        {3, 4, EXTENDED|ACCUA, NORMAL, OC(AND)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(BIT)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(LDA)}, {3, 5, EXTENDED|ACCUA, NORMAL, OC(STA)},
+        OC(3, 4, EXTENDED|ACCUA, NORMAL, SUB), OC(3, 4, EXTENDED|ACCUA, NORMAL, CMP), OC(3, 4, EXTENDED|ACCUA, NORMAL, SBC), {3, 0, INVALID, HALT, OC_ILL},
+        OC(3, 4, EXTENDED|ACCUA, NORMAL, AND), OC(3, 4, EXTENDED|ACCUA, NORMAL, BIT), OC(3, 4, EXTENDED|ACCUA, NORMAL, LDA), OC(3, 5, EXTENDED|ACCUA, NORMAL, STA),
         // B8-BF
-        {3, 4, EXTENDED|ACCUA, NORMAL, OC(EOR)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(ADC)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(ORA)}, {3, 4, EXTENDED|ACCUA, NORMAL, OC(ADD)},
-        {3, 5, EXTENDED, NORMAL, OC(CPX)}, {3, 9, EXTENDED, CALL, OC(JSR)}, {3, 5, EXTENDED, STACK, OC(LDS)}, {3, 6, EXTENDED, STACK, OC(STS)},
+        OC(3, 4, EXTENDED|ACCUA, NORMAL, EOR), OC(3, 4, EXTENDED|ACCUA, NORMAL, ADC), OC(3, 4, EXTENDED|ACCUA, NORMAL, ORA), OC(3, 4, EXTENDED|ACCUA, NORMAL, ADD),
+        OC(3, 5, EXTENDED, NORMAL, CPX), OC(3, 9, EXTENDED, CALL, JSR), OC(3, 5, EXTENDED, STACK, LDS), OC(3, 6, EXTENDED, STACK, STS),
         // C0-C7
-        {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(SUB)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(CMP)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(AND)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(BIT)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(LDA)}, {2, 2, IMMEDIATE|ACCUB, NORMAL|UNDOC, OC(STA)},
+        OC(2, 2, IMMEDIATE|ACCUB, NORMAL, SUB), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, CMP), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 2, IMMEDIATE|ACCUB, NORMAL, AND), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, BIT), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, LDA), OC(2, 2, IMMEDIATE|ACCUB, NORMAL|UNDOC, STA),
         // C8-CF
-        {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(EOR)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(ADC)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(ORA)}, {2, 2, IMMEDIATE|ACCUB, NORMAL, OC(ADD)},
-        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, {2, 3, IMMEDIATE16, NORMAL, OC(LDX)}, {2, 0, IMMEDIATE16, STACK|UNDOC, OC(STX)},
+        OC(2, 2, IMMEDIATE|ACCUB, NORMAL, EOR), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, ADC), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, ORA), OC(2, 2, IMMEDIATE|ACCUB, NORMAL, ADD),
+        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, OC(2, 3, IMMEDIATE16, NORMAL, LDX), OC(2, 0, IMMEDIATE16, STACK|UNDOC, STX),
         // D0-D7
-        {2, 3, DIRECT|ACCUB, NORMAL, OC(SUB)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(CMP)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 3, DIRECT|ACCUB, NORMAL, OC(AND)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(BIT)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(LDA)}, {2, 4, DIRECT|ACCUB, NORMAL, OC(STA)},
+        OC(2, 3, DIRECT|ACCUB, NORMAL, SUB), OC(2, 3, DIRECT|ACCUB, NORMAL, CMP), OC(2, 3, DIRECT|ACCUB, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 3, DIRECT|ACCUB, NORMAL, AND), OC(2, 3, DIRECT|ACCUB, NORMAL, BIT), OC(2, 3, DIRECT|ACCUB, NORMAL, LDA), OC(2, 4, DIRECT|ACCUB, NORMAL, STA),
         // D8-DF
-        {2, 3, DIRECT|ACCUB, NORMAL, OC(EOR)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(ADC)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(ORA)}, {2, 3, DIRECT|ACCUB, NORMAL, OC(ADD)},
-        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL/*HCF*/}, {2, 4, DIRECT, NORMAL, OC(LDX)}, {2, 5, DIRECT, STACK, OC(STX)},
+        OC(2, 3, DIRECT|ACCUB, NORMAL, EOR), OC(2, 3, DIRECT|ACCUB, NORMAL, ADC), OC(2, 3, DIRECT|ACCUB, NORMAL, ORA), OC(2, 3, DIRECT|ACCUB, NORMAL, ADD),
+        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL/*HCF*/}, OC(2, 4, DIRECT, NORMAL, LDX), OC(2, 5, DIRECT, STACK, STX),
         // E0-E7
-        {2, 5, INDEXED|ACCUB, NORMAL, OC(SUB)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(CMP)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(SBC)}, {2, 0, INVALID, HALT, OC_ILL},
-        {2, 5, INDEXED|ACCUB, NORMAL, OC(AND)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(BIT)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(LDA)}, {2, 6, INDEXED|ACCUB, NORMAL, OC(STA)},
+        OC(2, 5, INDEXED|ACCUB, NORMAL, SUB), OC(2, 5, INDEXED|ACCUB, NORMAL, CMP), OC(2, 5, INDEXED|ACCUB, NORMAL, SBC), {2, 0, INVALID, HALT, OC_ILL},
+        OC(2, 5, INDEXED|ACCUB, NORMAL, AND), OC(2, 5, INDEXED|ACCUB, NORMAL, BIT), OC(2, 5, INDEXED|ACCUB, NORMAL, LDA), OC(2, 6, INDEXED|ACCUB, NORMAL, STA),
         // E8-EF
-        {2, 5, INDEXED|ACCUB, NORMAL, OC(EOR)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(ADC)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(ORA)}, {2, 5, INDEXED|ACCUB, NORMAL, OC(ADD)},
-        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, {2, 6, INDEXED, NORMAL, OC(LDX)}, {2, 7, INDEXED, STACK, OC(STX)},
+        OC(2, 5, INDEXED|ACCUB, NORMAL, EOR), OC(2, 5, INDEXED|ACCUB, NORMAL, ADC), OC(2, 5, INDEXED|ACCUB, NORMAL, ORA), OC(2, 5, INDEXED|ACCUB, NORMAL, ADD),
+        {2, 0, INVALID, HALT, OC_ILL}, {2, 0, INVALID, HALT, OC_ILL}, OC(2, 6, INDEXED, NORMAL, LDX), OC(2, 7, INDEXED, STACK, STX),
         // F0-F7
-        {3, 4, EXTENDED|ACCUB, NORMAL, OC(SUB)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(CMP)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(SBC)}, {3, 0, INVALID, HALT, OC_ILL},
-        {3, 4, EXTENDED|ACCUB, NORMAL, OC(AND)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(BIT)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(LDA)}, {3, 5, EXTENDED|ACCUB, NORMAL, OC(STA)},
+        OC(3, 4, EXTENDED|ACCUB, NORMAL, SUB), OC(3, 4, EXTENDED|ACCUB, NORMAL, CMP), OC(3, 4, EXTENDED|ACCUB, NORMAL, SBC), {3, 0, INVALID, HALT, OC_ILL},
+        OC(3, 4, EXTENDED|ACCUB, NORMAL, AND), OC(3, 4, EXTENDED|ACCUB, NORMAL, BIT), OC(3, 4, EXTENDED|ACCUB, NORMAL, LDA), OC(3, 5, EXTENDED|ACCUB, NORMAL, STA),
         // F8-FF
-        {3, 4, EXTENDED|ACCUB, NORMAL, OC(EOR)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(ADC)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(ORA)}, {3, 4, EXTENDED|ACCUB, NORMAL, OC(ADD)},
-        {3, 0, INVALID, HALT, OC_ILL}, {3, 0, INVALID, HALT, OC_ILL}, {3, 5, EXTENDED, NORMAL, OC(LDX)}, {3, 6, EXTENDED, STACK, OC(STX)},
+        OC(3, 4, EXTENDED|ACCUB, NORMAL, EOR), OC(3, 4, EXTENDED|ACCUB, NORMAL, ADC), OC(3, 4, EXTENDED|ACCUB, NORMAL, ORA), OC(3, 4, EXTENDED|ACCUB, NORMAL, ADD),
+        {3, 0, INVALID, HALT, OC_ILL}, {3, 0, INVALID, HALT, OC_ILL}, OC(3, 5, EXTENDED, NORMAL, LDX), OC(3, 6, EXTENDED, STACK, STX),
     };
 #undef OC
 #undef OC_ILL
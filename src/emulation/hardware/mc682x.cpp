@@ -26,6 +26,7 @@
 #include <emulation/hardware/m6800.hpp>
 //---
 #include <emulation/hardware/mc682x.hpp>
+#include <emulation/statestream.hpp>
 
 #include <iostream>
 
@@ -56,6 +57,50 @@ void MC682x::reset()
     _irqB = false;
 }
 
+void MC682x::saveState(StateWriter& writer) const
+{
+    writer.beginChunk(stateTag("682X"));
+    writer.write(_portAIn);
+    writer.write(_portAOut);
+    writer.write(_ddrA);
+    writer.write(_ctrlA);
+    writer.write(_ca1In);
+    writer.write(_ca2In);
+    writer.write(_ca2Out);
+    writer.write(_irqA);
+    writer.write(_portBIn);
+    writer.write(_portBOut);
+    writer.write(_ddrB);
+    writer.write(_ctrlB);
+    writer.write(_cb1In);
+    writer.write(_cb2In);
+    writer.write(_cb2Out);
+    writer.write(_irqB);
+    writer.endChunk();
+}
+
+void MC682x::loadState(StateReader& reader)
+{
+    reader.beginChunk(stateTag("682X"));
+    reader.read(_portAIn);
+    reader.read(_portAOut);
+    reader.read(_ddrA);
+    reader.read(_ctrlA);
+    reader.read(_ca1In);
+    reader.read(_ca2In);
+    reader.read(_ca2Out);
+    reader.read(_irqA);
+    reader.read(_portBIn);
+    reader.read(_portBOut);
+    reader.read(_ddrB);
+    reader.read(_ctrlB);
+    reader.read(_cb1In);
+    reader.read(_cb2In);
+    reader.read(_cb2Out);
+    reader.read(_irqB);
+    reader.endChunk();
+}
+
 uint8_t MC682x::readDebugByte(uint16_t addr) const
 {
     uint8_t val = 0;
@@ -32,7 +32,10 @@
 
 namespace emu {
 
-class MC682x : public M6800Bus<>
+class StateReader;
+class StateWriter;
+
+class MC682x final : public M6800Bus<>
 {
 public:
     struct InputWithConnection { uint8_t value; uint8_t connections; };
@@ -48,6 +51,8 @@ public:
     uint8_t readByte(uint16_t addr) const override;
     uint8_t readDebugByte(uint16_t addr) const override;
     void writeByte(uint16_t addr, uint8_t val) override;
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
 
     uint8_t portA() const;
     void portA(uint8_t val);
@@ -27,12 +27,15 @@
 
 #include <emulation/config.hpp>
 #include <emulation/hardware/genericcpu.hpp>
+#include <emulation/memoryheatmap.hpp>
+#include <emulation/opcodeprofiler.hpp>
 #include <emulation/videoscreen.hpp>
 
 #include <array>
 #include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace emu
 {
@@ -53,17 +56,12 @@ struct Chip8State
 class IChip8Emulator : public GenericCpu
 {
 public:
-    struct BreakpointInfo {
-        enum Type { eTRANSIENT, eCODED };
-        std::string label;
-        Type type{eTRANSIENT};
-        bool isEnabled{true};
-    };
     enum Engine {
         eCHIP8TS,       // templated core based on nested switch - this is the fastest (ch8,ch10,ch48,sc10,sc11,xo)
         eCHIP8MPT,      // method table based core - this is the most capable one (ch8,ch10,ch48,sc10,sc11,mc8,xo)
         eCHIP8VIP,      // cdp1802 based vip core running original emulator (only supports <ch48 cores, but runs hybrids)
-        eCHIP8DREAM     // M6800 based DREAM6800 code running CHIPOS
+        eCHIP8DREAM,    // M6800 based DREAM6800 code running CHIPOS
+        eCHIP8STRICT    // VIP timing exact CHIP-8 core without emulating the 1802 (ch8)
     };
     enum CpuState { eNORMAL, eWAITING, eERROR };
     using VideoType = VideoScreen<uint8_t, 256, 192>;
@@ -102,11 +100,43 @@ public:
     // defaults for unused debugger support
     virtual CpuState cpuState() const { return eNORMAL; }
     virtual uint16_t opcode() {
-        return (memory()[getPC()] << 8) | memory()[getPC() + 1];
+        return (memoryView()[getPC()] << 8) | memoryView()[getPC() + 1];
     }
     virtual int64_t getMachineCycles() const { return getCycles(); }
     virtual const std::string& errorMessage() const { static std::string none; return none; }
 
+    // compact binary save-state of the complete emulation state (see statestream.hpp),
+    // loadState only accepts blobs of the same core and configuration and leaves
+    // the core unchanged when it rejects one
+    virtual bool saveState(std::vector<uint8_t>& state) const { return false; }
+    virtual bool loadState(const uint8_t* data, size_t size) { return false; }
+
+    // read access to memory() without its side effects, a caller might write through
+    // memory(), so cores invalidate caches and mark pages written on it
+    virtual const uint8_t* memoryView() const { return const_cast<IChip8Emulator*>(this)->memory(); }
+    // Write tracking for incremental comparisons: while enabled, the core records the
+    // 256 byte pages of memory() that might have been written, takeWrittenPages()
+    // hands out their indices and starts a new record. Enabling marks all pages. A
+    // core returning false doesn't track writes, callers have to compare all pages.
+    virtual bool setWriteTracking(bool enable) { return false; }
+    virtual void takeWrittenPages(std::vector<uint32_t>& pages) { pages.clear(); }
+
+    // state of the internal random generator, it survives reset() so input replays
+    // need to restore it to reproduce a session
+    virtual uint32_t getRandomSeed() const { return 0; }
+    virtual void setRandomSeed(uint32_t seed) {}
+    // state of the generator used by the non-VIP random variants, replays restore it too
+    virtual uint32_t getRandomState() const { return 0; }
+    virtual void setRandomState(uint32_t state) {}
+
+    // runtime opcode profiling, the profiler only exists while profiling is enabled
+    virtual void setOpcodeProfiling(bool enable) {}
+    virtual OpcodeProfiler* opcodeProfiler() { return nullptr; }
+    virtual std::vector<OpcodeProfiler::Summary> opcodeProfile() const { return {}; }
+    // per-address exec/read/write counters, only allocated while enabled
+    virtual void setMemoryHeatmap(bool enable) {}
+    virtual MemoryHeatmap* memoryHeatmap() { return nullptr; }
+
     // functions with default handling to get started with tests
     virtual void handleTimer() {}
     virtual bool needsScreenUpdate() { return true; }
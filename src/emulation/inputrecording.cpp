@@ -0,0 +1,191 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/inputrecording.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/inputrecording.hpp>
+#include <emulation/ichip8.hpp>
+#include <emulation/statestream.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace emu {
+
+static const std::string RECORDING_NAME = "INPUT-RECORDING";
+
+void InputRecording::start(const Chip8EmulatorOptions& options, const std::string& romSha1Hex, uint32_t randomSeed, uint32_t randomState)
+{
+    _options = options;
+    _romSha1Hex = romSha1Hex;
+    _randomSeed = randomSeed;
+    _randomState = randomState;
+    _frames = 0;
+    _endCycles = -1;
+    _endHash = 0;
+    _runs.clear();
+}
+
+void InputRecording::addFrame(uint16_t keys)
+{
+    if(_runs.empty() || _runs.back().keys != keys || _runs.back().count == UINT32_MAX)
+        _runs.push_back({keys, 0, _frames});
+    ++_runs.back().count;
+    ++_frames;
+}
+
+void InputRecording::finish(IChip8Emulator& emu)
+{
+    _endCycles = emu.getCycles();
+    _endHash = stateHash(emu);
+}
+
+bool InputRecording::matchesEnd(IChip8Emulator& emu) const
+{
+    return _endCycles == emu.getCycles() && _endHash == stateHash(emu);
+}
+
+uint16_t InputRecording::keysForFrame(uint64_t frame) const
+{
+    auto iter = std::upper_bound(_runs.begin(), _runs.end(), frame, [](uint64_t frame, const Run& run) { return frame < run.firstFrame; });
+    return iter == _runs.begin() || frame >= _frames ? 0 : std::prev(iter)->keys;
+}
+
+bool InputRecording::serialize(std::vector<uint8_t>& data) const
+{
+    nlohmann::json options = _options;
+    StateWriter writer(data, RECORDING_NAME);
+    writer.beginChunk(stateTag("HEAD"));
+    writer.writeString(options.dump());
+    writer.writeString(_romSha1Hex);
+    writer.write(_randomSeed);
+    writer.write(_randomState);
+    writer.write(_frames);
+    writer.write(_endCycles);
+    writer.write(_endHash);
+    writer.endChunk();
+    writer.beginChunk(stateTag("KEYS"));
+    writer.write(uint32_t(_runs.size()));
+    for(const auto& run : _runs) {
+        writer.write(run.keys);
+        writer.write(run.count);
+    }
+    writer.endChunk();
+    return true;
+}
+
+bool InputRecording::deserialize(const uint8_t* data, size_t size)
+{
+    StateReader reader(data, size, RECORDING_NAME);
+    if(!reader.isValid() || !reader.beginChunk(stateTag("HEAD"))) {
+        return false;
+    }
+    auto options = nlohmann::json::parse(reader.readString(), nullptr, false);
+    if(options.is_discarded())
+        return false;
+    try {
+        _options = options.get<Chip8EmulatorOptions>();
+    }
+    catch(...) {
+        return false;
+    }
+    _romSha1Hex = reader.readString();
+    reader.read(_randomSeed);
+    reader.read(_randomState);
+    auto frames = reader.read<uint64_t>();
+    reader.read(_endCycles);
+    reader.read(_endHash);
+    reader.endChunk();
+    _runs.clear();
+    _frames = 0;
+    if(reader.beginChunk(stateTag("KEYS"))) {
+        auto numRuns = reader.read<uint32_t>();
+        for(uint32_t i = 0; i < numRuns && reader.isValid(); ++i) {
+            auto keys = reader.read<uint16_t>();
+            auto count = reader.read<uint32_t>();
+            if(count) {
+                _runs.push_back({keys, count, _frames});
+                _frames += count;
+            }
+        }
+    }
+    reader.endChunk();
+    return reader.isValid() && _frames == frames;
+}
+
+bool InputRecording::save(const std::string& filename) const
+{
+    std::vector<uint8_t> data;
+    if(!serialize(data))
+        return false;
+    std::ofstream os(filename, std::ios::binary);
+    os.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    return bool(os);
+}
+
+bool InputRecording::load(const std::string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    if(!is)
+        return false;
+    std::vector<uint8_t> data{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    return deserialize(data.data(), data.size());
+}
+
+//---------------------------------------------------------------------------------------
+// FNV-1a over the CHIP-8 visible machine state, only using the generic interface
+// so results of different cores can be compared
+//---------------------------------------------------------------------------------------
+uint64_t InputRecording::stateHash(IChip8Emulator& emu)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](uint32_t val, int bytes) {
+        for(int i = 0; i < bytes; ++i) {
+            hash = (hash ^ ((val >> (i * 8)) & 0xff)) * 1099511628211ull;
+        }
+    };
+    for(uint8_t i = 0; i < 16; ++i)
+        add(emu.getV(i), 1);
+    add(emu.getI(), 4);
+    add(emu.getPC(), 4);
+    add(emu.getSP(), 4);
+    add(emu.delayTimer(), 1);
+    add(emu.soundTimer(), 1);
+    for(int i = 0; i < emu.stackSize(); ++i)
+        add(emu.getStackElements()[i], 2);
+    const auto* mem = emu.memory();
+    for(int i = 0; i < emu.memSize(); ++i)
+        add(mem[i], 1);
+    if(const auto* screen = emu.getScreen()) {
+        for(int y = 0; y < emu.getCurrentScreenHeight(); ++y) {
+            for(int x = 0; x < emu.getCurrentScreenWidth(); ++x)
+                add(screen->getPixel(x, y), 4);
+        }
+    }
+    return hash;
+}
+
+}
@@ -0,0 +1,90 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/inputrecording.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/chip8options.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+class IChip8Emulator;
+
+//---------------------------------------------------------------------------------------
+// Movie-style recording of a session: the options, ROM SHA-1 and random generator
+// state the session started with, plus the key mask the core saw in every frame, stored as
+// runs of identical masks. Replaying it from a ROM restart with the same options
+// reproduces the session, the final cycle count and state hash allow checking that.
+//
+// Files use the save-state container (see statestream.hpp) with a 'HEAD' chunk
+// holding the session info and a 'KEYS' chunk holding the u16 mask/u32 count runs.
+//---------------------------------------------------------------------------------------
+class InputRecording
+{
+public:
+    InputRecording() = default;
+    ~InputRecording() = default;
+
+    void start(const Chip8EmulatorOptions& options, const std::string& romSha1Hex, uint32_t randomSeed, uint32_t randomState);
+    void addFrame(uint16_t keys);
+    void finish(IChip8Emulator& emu);
+    bool matchesEnd(IChip8Emulator& emu) const;
+
+    const Chip8EmulatorOptions& options() const { return _options; }
+    const std::string& romSha1Hex() const { return _romSha1Hex; }
+    uint32_t randomSeed() const { return _randomSeed; }
+    uint32_t randomState() const { return _randomState; }
+    uint64_t frames() const { return _frames; }
+    uint16_t keysForFrame(uint64_t frame) const;
+    int64_t endCycles() const { return _endCycles; }
+    uint64_t endHash() const { return _endHash; }
+
+    bool serialize(std::vector<uint8_t>& data) const;
+    bool deserialize(const uint8_t* data, size_t size);
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+    static uint64_t stateHash(IChip8Emulator& emu);
+
+private:
+    struct Run
+    {
+        uint16_t keys{0};
+        uint32_t count{0};
+        uint64_t firstFrame{0};
+    };
+    Chip8EmulatorOptions _options;
+    std::string _romSha1Hex;
+    uint32_t _randomSeed{0};
+    uint32_t _randomState{0};
+    uint64_t _frames{0};
+    int64_t _endCycles{-1};
+    uint64_t _endHash{0};
+    std::vector<Run> _runs;
+};
+
+}
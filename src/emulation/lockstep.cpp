@@ -0,0 +1,396 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/lockstep.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/lockstep.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace emu {
+
+namespace {
+
+inline uint64_t mix(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t hashBytes(uint64_t seed, const uint8_t* data, size_t size)
+{
+    uint64_t hash = mix(0, seed);
+    while(size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        hash = mix(hash, word);
+        data += 8;
+        size -= 8;
+    }
+    uint64_t tail = uint64_t(size) << 56;
+    for(size_t i = 0; i < size; ++i)
+        tail |= uint64_t(data[i]) << (i * 8);
+    return mix(hash, tail);
+}
+
+template<typename Screen>
+uint64_t hashScreen(uint64_t hash, const Screen& screen, int width, int height)
+{
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x + 1 < width; x += 2)
+            hash = mix(hash, (uint64_t(screen.getPixel(x, y)) << 32) | screen.getPixel(x + 1, y));
+        if(width & 1)
+            hash = mix(hash, screen.getPixel(width - 1, y));
+    }
+    return hash;
+}
+
+uint64_t screenHash(IChip8Emulator& emu)
+{
+    int width = emu.getCurrentScreenWidth();
+    int height = emu.getCurrentScreenHeight();
+    uint64_t hash = mix(0, (uint64_t(width) << 16) | height);
+    if(const auto* screen = emu.getScreen())
+        return hashScreen(hash, *screen, width, height);
+    if(const auto* screen = emu.getScreenRGBA())
+        return hashScreen(hash, *screen, width, height);
+    return hash;
+}
+
+std::vector<uint32_t> screenPixels(IChip8Emulator& emu)
+{
+    std::vector<uint32_t> pixels;
+    int width = emu.getCurrentScreenWidth();
+    int height = emu.getCurrentScreenHeight();
+    const auto* screen = emu.getScreen();
+    const auto* screenRGBA = emu.getScreenRGBA();
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x)
+            pixels.push_back(screen ? screen->getPixel(x, y) : screenRGBA ? screenRGBA->getPixel(x, y) : 0);
+    }
+    return pixels;
+}
+
+}
+
+void LockstepRunner::addCore(const std::string& name, IChip8Emulator& core)
+{
+    Core entry;
+    entry.name = name;
+    entry.emu = &core;
+    _cores.push_back(std::move(entry));
+    _prepared = false;
+}
+
+LockstepRunner::~LockstepRunner()
+{
+    for(auto& core : _cores) {
+        if(core.tracked)
+            core.emu->setWriteTracking(false);
+    }
+}
+
+void LockstepRunner::prepare()
+{
+    _memoryEnd = _options.memoryEnd;
+    for(const auto& core : _cores) {
+        if(!_memoryEnd || uint32_t(core.emu->memSize()) < _memoryEnd)
+            _memoryEnd = core.emu->memSize();
+    }
+    auto size = _memoryEnd > _options.memoryStart ? _memoryEnd - _options.memoryStart : 0;
+    _firstPage = _options.memoryStart / PAGE_SIZE;
+    auto pages = size ? (_memoryEnd + PAGE_SIZE - 1) / PAGE_SIZE - _firstPage : 0;
+    for(auto& core : _cores) {
+        core.tracked = core.emu->setWriteTracking(true);
+        if(core.tracked)
+            core.emu->takeWrittenPages(_writtenPages);
+        const auto* mem = core.emu->memoryView() + _options.memoryStart;
+        if(core.tracked)
+            core.shadow.clear();
+        else
+            core.shadow.assign(mem, mem + size);
+        core.pageHashes.assign(pages, 0);
+        core.memoryHash = 0;
+        for(uint32_t page = 0; page < pages; ++page)
+            hashPage(core, _firstPage + page);
+        core.lastPC = core.emu->getPC();
+        core.lastOpcode = 0;
+    }
+    _prepared = true;
+}
+
+void LockstepRunner::hashPage(Core& core, uint32_t page)
+{
+    auto start = std::max(page * PAGE_SIZE, _options.memoryStart);
+    auto end = std::min((page + 1) * PAGE_SIZE, _memoryEnd);
+    auto hash = hashBytes(page + 1, core.emu->memoryView() + start, end - start);
+    auto& pageHash = core.pageHashes[page - _firstPage];
+    core.memoryHash += hash - pageHash;
+    pageHash = hash;
+}
+
+void LockstepRunner::updateMemoryHash(Core& core)
+{
+    if(core.tracked) {
+        core.emu->takeWrittenPages(_writtenPages);
+        for(auto page : _writtenPages) {
+            if(page >= _firstPage && page - _firstPage < core.pageHashes.size())
+                hashPage(core, page);
+        }
+        return;
+    }
+    const auto* mem = core.emu->memoryView();
+    for(uint32_t page = _firstPage; page - _firstPage < core.pageHashes.size(); ++page) {
+        auto start = std::max(page * PAGE_SIZE, _options.memoryStart);
+        auto len = std::min((page + 1) * PAGE_SIZE, _memoryEnd) - start;
+        auto* shadow = core.shadow.data() + (start - _options.memoryStart);
+        if(std::memcmp(shadow, mem + start, len) != 0) {
+            std::memcpy(shadow, mem + start, len);
+            hashPage(core, page);
+        }
+    }
+}
+
+uint64_t LockstepRunner::stateHash(Core& core, bool withScreen)
+{
+    auto& emu = *core.emu;
+    uint64_t low = 0, high = 0;
+    for(uint8_t i = 0; i < 8; ++i) {
+        low |= uint64_t(emu.getV(i)) << (i * 8);
+        high |= uint64_t(emu.getV(i + 8)) << (i * 8);
+    }
+    uint64_t hash = mix(mix(0, low), high);
+    hash = mix(hash, (uint64_t(emu.getI()) << 32) | emu.getPC());
+    hash = mix(hash, emu.getSP());
+    if(_options.compareTimers)
+        hash = mix(hash, (emu.delayTimer() << 8) | emu.soundTimer());
+    auto depth = std::min<uint32_t>(emu.getSP(), emu.stackSize());
+    for(uint32_t i = 0; i < depth; ++i)
+        hash = mix(hash, emu.getStackElements()[i]);
+    updateMemoryHash(core);
+    hash = mix(hash, core.memoryHash);
+    if(withScreen && _options.compareScreen)
+        hash = mix(hash, screenHash(emu));
+    return hash;
+}
+
+bool LockstepRunner::allEqual(bool withScreen)
+{
+    bool equal = true;
+    auto reference = stateHash(_cores.front(), withScreen);
+    for(size_t i = 1; i < _cores.size(); ++i) {
+        if(stateHash(_cores[i], withScreen) != reference)
+            equal = false;
+    }
+    return equal;
+}
+
+bool LockstepRunner::snapshotAll()
+{
+    for(auto& core : _cores) {
+        if(!core.emu->saveState(core.snapshot))
+            return false;
+    }
+    return true;
+}
+
+bool LockstepRunner::restoreAll()
+{
+    for(auto& core : _cores) {
+        if(!core.emu->loadState(core.snapshot.data(), core.snapshot.size()))
+            return false;
+    }
+    return true;
+}
+
+bool LockstepRunner::allRunning() const
+{
+    return std::all_of(_cores.begin(), _cores.end(), [](const Core& core) { return core.emu->getExecMode() != GenericCpu::ePAUSED; });
+}
+
+void LockstepRunner::stepInstruction(Core& core)
+{
+    auto& emu = *core.emu;
+    core.lastPC = emu.getPC();
+    core.lastOpcode = emu.opcode();
+    // same timer handling as Chip8EmulatorBase::tick, real cores run their own timers
+    if(emu.isGenericEmulation() && _options.instructionsPerFrame > 0 && emu.getCycles() % _options.instructionsPerFrame == 0)
+        emu.handleTimer();
+    emu.executeInstruction();
+}
+
+bool LockstepRunner::run(int64_t frames)
+{
+    if(_cores.size() < 2 || _divergence)
+        return !_divergence;
+    if(!_prepared)
+        prepare();
+    if(_frame == 0 && _step == 0 && !allEqual()) {
+        reportDivergence(true);
+        return false;
+    }
+    auto endFrame = _frame + frames;
+    while(_frame < endFrame && allRunning()) {
+        if(_options.granularity == eINSTRUCTION) {
+            for(int i = 0; i < std::max(_options.instructionsPerFrame, 1); ++i) {
+                for(auto& core : _cores)
+                    stepInstruction(core);
+                ++_step;
+                if(!allEqual(_options.screenPerInstruction)) {
+                    reportDivergence(true);
+                    return false;
+                }
+            }
+            // everything but the screen was equal after the last instruction
+            if(!_options.screenPerInstruction && !allEqual()) {
+                reportDivergence(false);
+                return false;
+            }
+        }
+        else {
+            bool canReplay = snapshotAll();
+            std::vector<int64_t> startCycles, endCycles;
+            for(auto& core : _cores) {
+                startCycles.push_back(core.emu->getCycles());
+                core.emu->tick(_options.instructionsPerFrame);
+                endCycles.push_back(core.emu->getCycles());
+            }
+            if(!allEqual()) {
+                if(!canReplay || !restoreAll()) {
+                    _step += _options.instructionsPerFrame;
+                    reportDivergence(false);
+                    return false;
+                }
+                int64_t maxSteps = 0;
+                for(size_t i = 0; i < _cores.size(); ++i)
+                    maxSteps = std::max(maxSteps, endCycles[i] - startCycles[i]);
+                for(int64_t i = 0; i < maxSteps; ++i) {
+                    for(auto& core : _cores)
+                        stepInstruction(core);
+                    ++_step;
+                    if(!allEqual()) {
+                        reportDivergence(true);
+                        return false;
+                    }
+                }
+                // the difference only shows with whole frames, e.g. because of timer handling
+                restoreAll();
+                for(auto& core : _cores)
+                    core.emu->tick(_options.instructionsPerFrame);
+                reportDivergence(false);
+                return false;
+            }
+            _step += _options.instructionsPerFrame;
+        }
+        ++_frame;
+    }
+    return true;
+}
+
+void LockstepRunner::reportDivergence(bool narrowed)
+{
+    Divergence divergence;
+    divergence.frame = _frame;
+    divergence.step = _step;
+    divergence.narrowed = narrowed;
+    for(const auto& core : _cores)
+        divergence.cores.push_back({core.name, core.emu->getCycles(), core.lastPC, core.lastOpcode, core.emu->dumpStateLine()});
+    auto compare = [&](const std::string& field, const std::function<uint32_t(IChip8Emulator&)>& value) {
+        std::vector<uint32_t> values;
+        for(auto& core : _cores)
+            values.push_back(value(*core.emu));
+        if(std::adjacent_find(values.begin(), values.end(), std::not_equal_to<>()) != values.end())
+            divergence.differences.push_back({field, std::move(values)});
+    };
+    for(uint8_t i = 0; i < 16; ++i)
+        compare(fmt::format("V{:X}", i), [i](IChip8Emulator& emu) { return emu.getV(i); });
+    compare("I", [](IChip8Emulator& emu) { return emu.getI(); });
+    compare("PC", [](IChip8Emulator& emu) { return emu.getPC(); });
+    compare("SP", [](IChip8Emulator& emu) { return emu.getSP(); });
+    if(_options.compareTimers) {
+        compare("DT", [](IChip8Emulator& emu) { return emu.delayTimer(); });
+        compare("ST", [](IChip8Emulator& emu) { return emu.soundTimer(); });
+    }
+    uint32_t depth = 0;
+    for(const auto& core : _cores)
+        depth = std::max(depth, std::min<uint32_t>(core.emu->getSP(), core.emu->stackSize()));
+    for(uint32_t i = 0; i < depth; ++i)
+        compare(fmt::format("stack[{}]", i), [i](IChip8Emulator& emu) { return i < emu.stackSize() ? emu.getStackElements()[i] : 0; });
+    int memoryDifferences = 0;
+    for(uint32_t addr = _options.memoryStart; addr < _memoryEnd && memoryDifferences < 16; ++addr) {
+        auto count = divergence.differences.size();
+        compare(fmt::format("mem[0x{:04x}]", addr), [addr](IChip8Emulator& emu) { return emu.memoryView()[addr]; });
+        if(divergence.differences.size() != count)
+            ++memoryDifferences;
+    }
+    if(_options.compareScreen) {
+        compare("screen.width", [](IChip8Emulator& emu) { return emu.getCurrentScreenWidth(); });
+        compare("screen.height", [](IChip8Emulator& emu) { return emu.getCurrentScreenHeight(); });
+        auto reference = screenPixels(*_cores.front().emu);
+        compare("screen.pixelsDiffering", [&reference](IChip8Emulator& emu) {
+            auto pixels = screenPixels(emu);
+            uint32_t count = 0;
+            for(size_t i = 0; i < std::max(pixels.size(), reference.size()); ++i) {
+                if(i >= pixels.size() || i >= reference.size() || pixels[i] != reference[i])
+                    ++count;
+            }
+            return count;
+        });
+    }
+    _divergence = std::move(divergence);
+}
+
+std::string LockstepRunner::Divergence::format() const
+{
+    std::string result = fmt::format("Cores diverged in frame {} at step {}{}\n", frame, step, narrowed ? "" : " (end of frame, not narrowed to an instruction)");
+    for(const auto& core : cores)
+        result += fmt::format("  {:<8} cycles: {:<10} last: {:04x} {:04x}  {}\n", core.name, core.cycles, core.lastPC, core.lastOpcode, core.stateLine);
+    for(const auto& diff : differences) {
+        result += fmt::format("  {:<22}", diff.field);
+        for(auto val : diff.values)
+            result += fmt::format(" {:>8x}", val);
+        result += "\n";
+    }
+    return result;
+}
+
+nlohmann::ordered_json LockstepRunner::Divergence::toJSON() const
+{
+    nlohmann::ordered_json result;
+    result["frame"] = frame;
+    result["step"] = step;
+    result["narrowed"] = narrowed;
+    auto& coreList = result["cores"] = nlohmann::ordered_json::array();
+    for(const auto& core : cores)
+        coreList.push_back({{"name", core.name}, {"cycles", core.cycles}, {"lastPC", core.lastPC}, {"lastOpcode", core.lastOpcode}, {"state", core.stateLine}});
+    auto& diffList = result["differences"] = nlohmann::ordered_json::array();
+    for(const auto& diff : differences)
+        diffList.push_back({{"field", diff.field}, {"values", diff.values}});
+    return result;
+}
+
+}
@@ -0,0 +1,132 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/lockstep.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/ichip8.hpp>
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Runs any number of CHIP-8 cores side by side and compares a 64 bit hash of their
+// CHIP-8 visible state (registers, timers, stack, memory range and screen) after every
+// frame or instruction. Memory is hashed in 256 byte pages, only pages the core reports
+// as written (IChip8Emulator::takeWrittenPages) get rehashed, cores without write
+// tracking are compared against a shadow copy. Screens are compared at frame ends,
+// unless screenPerInstruction asks for more. When a frame diverges, all cores are
+// restored from the snapshot taken before it and the frame is replayed instruction by
+// instruction, screens included, to find the first one that made them differ. The
+// cores have to outlive the runner.
+//---------------------------------------------------------------------------------------
+class LockstepRunner
+{
+public:
+    enum Granularity { eFRAME, eINSTRUCTION };
+    struct Options
+    {
+        Granularity granularity{eFRAME};
+        int instructionsPerFrame{15};
+        bool compareTimers{true};
+        bool compareScreen{true};
+        bool screenPerInstruction{false};  // eINSTRUCTION only, compare screens after every instruction
+        uint32_t memoryStart{0x200};
+        uint32_t memoryEnd{0};  // 0 means up to the smallest memory of all cores
+    };
+    struct Difference
+    {
+        std::string field;
+        std::vector<uint32_t> values;  // one per core, in the order they were added
+    };
+    struct Divergence
+    {
+        int64_t frame{0};
+        int64_t step{0};         // lockstep instruction count of the first differing state
+        bool narrowed{false};    // false if the frame could not be replayed per instruction
+        struct CoreInfo
+        {
+            std::string name;
+            int64_t cycles{0};
+            uint32_t lastPC{0};  // address of the instruction that was executed last
+            uint16_t lastOpcode{0};
+            std::string stateLine;
+        };
+        std::vector<CoreInfo> cores;
+        std::vector<Difference> differences;
+        std::string format() const;
+        nlohmann::ordered_json toJSON() const;
+    };
+
+    LockstepRunner() = default;
+    explicit LockstepRunner(const Options& options) : _options(options) {}
+    ~LockstepRunner();
+    void addCore(const std::string& name, IChip8Emulator& core);
+    // runs until the given number of frames passed, a core stops running or the cores diverge,
+    // returns false on divergence
+    bool run(int64_t frames);
+    int64_t frames() const { return _frame; }
+    int64_t steps() const { return _step; }
+    const std::optional<Divergence>& divergence() const { return _divergence; }
+
+private:
+    static constexpr uint32_t PAGE_SIZE = 256;
+    struct Core
+    {
+        std::string name;
+        IChip8Emulator* emu{nullptr};
+        bool tracked{false};
+        std::vector<uint8_t> shadow;  // only for cores without write tracking
+        std::vector<uint64_t> pageHashes;
+        uint64_t memoryHash{0};
+        std::vector<uint8_t> snapshot;
+        uint32_t lastPC{0};
+        uint16_t lastOpcode{0};
+    };
+    void prepare();
+    void stepInstruction(Core& core);
+    uint64_t stateHash(Core& core, bool withScreen);
+    void updateMemoryHash(Core& core);
+    void hashPage(Core& core, uint32_t page);
+    bool allEqual(bool withScreen = true);
+    bool snapshotAll();
+    bool restoreAll();
+    bool allRunning() const;
+    void reportDivergence(bool narrowed);
+    Options _options;
+    std::vector<Core> _cores;
+    uint32_t _memoryEnd{0};
+    uint32_t _firstPage{0};
+    std::vector<uint32_t> _writtenPages;
+    int64_t _frame{0};
+    int64_t _step{0};
+    bool _prepared{false};
+    std::optional<Divergence> _divergence;
+};
+
+}
@@ -26,6 +26,7 @@
 #pragma once
 #define FULL_CONSOLE_TRACE
 #include <emulation/config.hpp>
+#include <emulation/tracebuffer.hpp>
 
 namespace emu {
 
@@ -47,7 +48,19 @@ public:
         }
     }
 
+    static void trace(const TraceRecord& record)
+    {
+        if(_logger) {
+            _logger->doTrace(record);
+        }
+    }
+
     virtual void doLog(Source source, emu::cycles_t cycle, FrameTime frameTime, const char* msg) = 0;
+    // loggers that can keep binary records override this to format lazily
+    virtual void doTrace(const TraceRecord& record)
+    {
+        doLog(Source(record.source), record.cycle, {record.frame, record.frameCycle}, record.format().c_str());
+    }
 
 private:
     static inline Logger* _logger{nullptr};
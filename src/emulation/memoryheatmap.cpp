@@ -0,0 +1,157 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/memoryheatmap.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/memoryheatmap.hpp>
+
+#include <fmt/format.h>
+
+#include <map>
+
+namespace emu {
+
+MemoryHeatmap::MemoryHeatmap(uint32_t size)
+    : _size(size)
+    , _mask(size - 1)
+    , _pages((size + PAGE_SIZE - 1) >> PAGE_BITS)
+{
+}
+
+void MemoryHeatmap::clear()
+{
+    for(auto& page : _pages)
+        page.reset();
+    std::fill(std::begin(_max), std::end(_max), 0);
+}
+
+void MemoryHeatmap::countRead(uint32_t address, uint32_t length)
+{
+    while(length--) {
+        auto& cell = cellRef(address++);
+        if(++cell.reads > _max[eREAD])
+            _max[eREAD] = cell.reads;
+    }
+}
+
+void MemoryHeatmap::countWrite(uint32_t address, uint32_t length)
+{
+    while(length--) {
+        auto& cell = cellRef(address++);
+        if(++cell.writes > _max[eWRITE])
+            _max[eWRITE] = cell.writes;
+    }
+}
+
+void MemoryHeatmap::countChip8Instruction(uint32_t pc, uint16_t opcode, uint32_t i, uint32_t spriteBytes)
+{
+    countExec(pc);
+    auto x = (opcode >> 8) & 0xF;
+    auto y = (opcode >> 4) & 0xF;
+    switch(opcode >> 12) {
+        case 0x5:
+            if((opcode & 0xF) == 2)
+                countWrite(i, (x > y ? x - y : y - x) + 1);
+            else if((opcode & 0xF) == 3)
+                countRead(i, (x > y ? x - y : y - x) + 1);
+            break;
+        case 0xD:
+            countRead(i, spriteBytes);
+            break;
+        case 0xF:
+            switch(opcode & 0xFF) {
+                case 0x02:
+                    if(opcode == 0xF002)
+                        countRead(i, 16);
+                    break;
+                case 0x33:
+                    countWrite(i, 3);
+                    break;
+                case 0x55:
+                    countWrite(i, x + 1);
+                    break;
+                case 0x65:
+                    countRead(i, x + 1);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+MemoryHeatmap::Cell MemoryHeatmap::cell(uint32_t address) const
+{
+    address &= _mask;
+    const auto& page = _pages[address >> PAGE_BITS];
+    return page ? (*page)[address & (PAGE_SIZE - 1)] : Cell{};
+}
+
+nlohmann::ordered_json MemoryHeatmap::toJSON(const LineResolver& lineForAddress) const
+{
+    auto cells = nlohmann::ordered_json::array();
+    std::map<int, Cell> lines;
+    uint64_t executed = 0;
+    for(size_t index = 0; index < _pages.size(); ++index) {
+        if(!_pages[index])
+            continue;
+        for(uint32_t offset = 0; offset < PAGE_SIZE; ++offset) {
+            const auto& cell = (*_pages[index])[offset];
+            if(!cell.exec && !cell.reads && !cell.writes)
+                continue;
+            auto address = uint32_t(index << PAGE_BITS) + offset;
+            auto obj = nlohmann::ordered_json::object();
+            obj["address"] = fmt::format("0x{:04x}", address);
+            obj["exec"] = cell.exec;
+            obj["reads"] = cell.reads;
+            obj["writes"] = cell.writes;
+            executed += cell.exec;
+            if(lineForAddress) {
+                auto line = lineForAddress(address);
+                if(line >= 0) {
+                    obj["line"] = line;
+                    auto& sum = lines[line];
+                    sum.exec += cell.exec;
+                    sum.reads += cell.reads;
+                    sum.writes += cell.writes;
+                }
+            }
+            cells.push_back(obj);
+        }
+    }
+    auto root = nlohmann::ordered_json::object();
+    root["size"] = _size;
+    root["instructions"] = executed;
+    root["cells"] = cells;
+    if(lineForAddress) {
+        auto lineArray = nlohmann::ordered_json::array();
+        for(const auto& [line, sum] : lines)
+            lineArray.push_back({{"line", line}, {"exec", sum.exec}, {"reads", sum.reads}, {"writes", sum.writes}});
+        root["lines"] = lineArray;
+    }
+    return root;
+}
+
+}
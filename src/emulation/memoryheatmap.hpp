@@ -0,0 +1,92 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/memoryheatmap.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Per-address execution, read and write counters for the CHIP-8 address space. The
+// shadow memory is split into pages that are only allocated on first access, so even
+// the 16MB of a MegaChip core only cost what a program actually touches.
+//---------------------------------------------------------------------------------------
+class MemoryHeatmap
+{
+public:
+    enum Access { eEXEC, eREAD, eWRITE };
+    struct Cell
+    {
+        uint32_t exec{0};
+        uint32_t reads{0};
+        uint32_t writes{0};
+    };
+    using LineResolver = std::function<int(uint32_t address)>;
+
+    explicit MemoryHeatmap(uint32_t size);
+    uint32_t size() const { return _size; }
+    void clear();
+    void countExec(uint32_t address)
+    {
+        auto& cell = cellRef(address);
+        if(++cell.exec > _max[eEXEC])
+            _max[eEXEC] = cell.exec;
+    }
+    void countRead(uint32_t address, uint32_t length);
+    void countWrite(uint32_t address, uint32_t length);
+    // counts the execution at pc and derives the memory accesses the instruction is about
+    // to do from the opcode and I, spriteBytes is the number of bytes a Dxyn would read
+    void countChip8Instruction(uint32_t pc, uint16_t opcode, uint32_t i, uint32_t spriteBytes);
+    Cell cell(uint32_t address) const;
+    uint32_t maxCount(Access access) const { return _max[access]; }
+    // only addresses that have been accessed are exported, with a resolver the counters
+    // are additionally accumulated per source line
+    nlohmann::ordered_json toJSON(const LineResolver& lineForAddress = {}) const;
+
+private:
+    static constexpr int PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+    using Page = std::array<Cell, PAGE_SIZE>;
+    Cell& cellRef(uint32_t address)
+    {
+        address &= _mask;
+        auto& page = _pages[address >> PAGE_BITS];
+        if(!page)
+            page = std::make_unique<Page>();
+        return (*page)[address & (PAGE_SIZE - 1)];
+    }
+    uint32_t _size{0};
+    uint32_t _mask{0};
+    std::vector<std::unique_ptr<Page>> _pages;
+    uint32_t _max[3]{};
+};
+
+}
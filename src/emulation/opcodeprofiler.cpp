@@ -0,0 +1,101 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/opcodeprofiler.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/opcodeprofiler.hpp>
+
+#include <map>
+
+namespace emu {
+
+uint64_t OpcodeProfiler::totalCount() const
+{
+    uint64_t total = 0;
+    for(const auto& entry : _entries)
+        total += entry.count;
+    return total;
+}
+
+uint64_t OpcodeProfiler::totalCycles() const
+{
+    uint64_t total = 0;
+    for(const auto& entry : _entries)
+        total += entry.cycles;
+    return total;
+}
+
+std::vector<OpcodeProfiler::Summary> OpcodeProfiler::summarize(const Classifier& classify) const
+{
+    std::map<uint32_t, Summary> classes;
+    for(size_t opcode = 0; opcode < NUM_OPCODES; ++opcode) {
+        const auto& entry = _entries[opcode];
+        if(!entry.count)
+            continue;
+        auto opcodeClass = classify(uint16_t(opcode));
+        auto& summary = classes[opcodeClass.id];
+        if(summary.pattern.empty()) {
+            summary.pattern = opcodeClass.pattern;
+            summary.name = opcodeClass.name;
+        }
+        summary.count += entry.count;
+        summary.cycles += entry.cycles;
+    }
+    std::vector<Summary> result;
+    result.reserve(classes.size());
+    for(auto& [id, summary] : classes)
+        result.push_back(std::move(summary));
+    std::stable_sort(result.begin(), result.end(), [](const Summary& a, const Summary& b) { return a.count > b.count; });
+    return result;
+}
+
+nlohmann::ordered_json OpcodeProfiler::toJSON(const std::vector<Summary>& summary)
+{
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+    for(const auto& entry : summary) {
+        totalCount += entry.count;
+        totalCycles += entry.cycles;
+    }
+    auto opcodes = nlohmann::ordered_json::array();
+    for(const auto& entry : summary) {
+        auto obj = nlohmann::ordered_json::object();
+        obj["opcode"] = entry.pattern;
+        obj["name"] = entry.name;
+        obj["count"] = entry.count;
+        obj["share"] = totalCount ? double(entry.count) / totalCount : 0.0;
+        if(totalCycles) {
+            obj["cycles"] = entry.cycles;
+            obj["cyclesPerInstruction"] = double(entry.cycles) / entry.count;
+        }
+        opcodes.push_back(obj);
+    }
+    auto root = nlohmann::ordered_json::object();
+    root["instructions"] = totalCount;
+    if(totalCycles)
+        root["cycles"] = totalCycles;
+    root["opcodes"] = opcodes;
+    return root;
+}
+
+}
@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/opcodeprofiler.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Runtime opcode profiler, counts every executed CHIP-8 opcode in a flat table indexed
+// by the raw 16 bit opcode, so the hot path is a single increment. Cores that know how
+// many machine cycles an instruction took pass them along. Merging into instruction
+// classes (e.g. all `vx += nn`) only happens when a summary is requested.
+//---------------------------------------------------------------------------------------
+class OpcodeProfiler
+{
+public:
+    static constexpr size_t NUM_OPCODES = 0x10000;
+    struct Entry
+    {
+        uint64_t count{0};
+        uint64_t cycles{0};
+    };
+    struct OpcodeClass
+    {
+        uint32_t id{0};
+        std::string pattern;
+        std::string name;
+    };
+    struct Summary
+    {
+        std::string pattern;
+        std::string name;
+        uint64_t count{0};
+        uint64_t cycles{0};
+    };
+    using Classifier = std::function<OpcodeClass(uint16_t opcode)>;
+
+    OpcodeProfiler() : _entries(NUM_OPCODES) {}
+    void clear() { std::fill(_entries.begin(), _entries.end(), Entry{}); }
+    void count(uint16_t opcode) { ++_entries[opcode].count; }
+    void count(uint16_t opcode, int64_t cycles)
+    {
+        auto& entry = _entries[opcode];
+        ++entry.count;
+        entry.cycles += cycles;
+    }
+    const Entry& entry(uint16_t opcode) const { return _entries[opcode]; }
+    uint64_t totalCount() const;
+    uint64_t totalCycles() const;
+    // merges the counters of all opcodes of the same class, sorted by decreasing count
+    std::vector<Summary> summarize(const Classifier& classify) const;
+    static nlohmann::ordered_json toJSON(const std::vector<Summary>& summary);
+
+private:
+    std::vector<Entry> _entries;
+};
+
+}
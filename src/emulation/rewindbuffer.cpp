@@ -0,0 +1,307 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/rewindbuffer.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/rewindbuffer.hpp>
+#include <emulation/ichip8.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace emu {
+
+// A zero run shorter than this is cheaper to keep inside the literal
+static constexpr size_t MIN_ZERO_RUN = 4;
+
+static void writeVarint(std::vector<uint8_t>& out, size_t val)
+{
+    while(val >= 0x80) {
+        out.push_back(uint8_t(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(uint8_t(val));
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end, size_t& val)
+{
+    val = 0;
+    for(int shift = 0; data < end && shift < 64; shift += 7) {
+        auto byte = *data++;
+        val |= size_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// pairs of zero run length and literal bytes, trailing zeros are left out
+static void encodeRuns(const uint8_t* d, size_t size, std::vector<uint8_t>& out)
+{
+    size_t i = 0;
+    while(i < size) {
+        auto start = i;
+        while(i < size && !d[i])
+            ++i;
+        if(i == size)
+            break;
+        writeVarint(out, i - start);
+        start = i;
+        size_t zeroRun = 0;
+        while(i < size) {
+            if(d[i])
+                zeroRun = 0;
+            else if(++zeroRun == MIN_ZERO_RUN)
+                break;
+            ++i;
+        }
+        auto end = i < size ? i + 1 - MIN_ZERO_RUN : size - zeroRun;
+        writeVarint(out, end - start);
+        out.insert(out.end(), d + start, d + end);
+        i = end;
+    }
+}
+
+static bool applyRuns(uint8_t* dest, size_t size, const uint8_t* src, const uint8_t* end)
+{
+    size_t pos = 0;
+    while(src < end) {
+        size_t zeros, literal;
+        if(!readVarint(src, end, zeros) || !readVarint(src, end, literal))
+            return false;
+        pos += zeros;
+        if(pos > size || literal > size - pos || literal > size_t(end - src))
+            return false;
+        for(size_t i = 0; i < literal; ++i) {
+            dest[pos++] ^= *src++;
+        }
+    }
+    return true;
+}
+
+RewindBuffer::RewindBuffer(size_t memoryBudget, size_t keyframeInterval)
+    : _memoryBudget(memoryBudget)
+    , _keyframeInterval(std::max(keyframeInterval, size_t(1)))
+{
+}
+
+void RewindBuffer::clear()
+{
+    _entries.clear();
+    _current.clear();
+    _framesSinceKeyframe = 0;
+    _memoryUsage = 0;
+}
+
+void RewindBuffer::setMemoryBudget(size_t budget)
+{
+    _memoryBudget = budget;
+    enforceBudget();
+}
+
+bool RewindBuffer::capture(const IChip8Emulator& emu, const FrameInfo& info)
+{
+    if(!emu.saveState(_scratch) || !_next.split(_scratch.data(), _scratch.size()))
+        return false;
+    Entry entry;
+    entry.stateSize = uint32_t(_scratch.size());
+    entry.info = info;
+    if(_entries.empty() || _framesSinceKeyframe + 1 >= _keyframeInterval) {
+        static const StateMemoryPages noBase;
+        entry.keyframe = true;
+        encodeDelta(_next, noBase, entry);
+        _framesSinceKeyframe = 0;
+    }
+    else {
+        encodeDelta(_next, _current, entry);
+        ++_framesSinceKeyframe;
+    }
+    _memoryUsage += entryCost(entry);
+    _entries.push_back(std::move(entry));
+    std::swap(_current, _next);
+    enforceBudget();
+    return true;
+}
+
+bool RewindBuffer::stepBack(IChip8Emulator& emu)
+{
+    if(_entries.size() < 2)
+        return false;
+    const auto& last = _entries.back();
+    if(last.keyframe) {
+        if(!stateAt(_entries.size() - 2, _scratch) || !_next.split(_scratch.data(), _scratch.size()))
+            return false;
+    }
+    else {
+        _next = _current;
+        if(!applyDelta(_next, last, _entries[_entries.size() - 2]))
+            return false;
+        _next.join(_scratch);
+    }
+    if(!emu.loadState(_scratch.data(), _scratch.size()))
+        return false;
+    _memoryUsage -= entryCost(_entries.back());
+    _entries.pop_back();
+    std::swap(_current, _next);
+    updateKeyframeDistance();
+    return true;
+}
+
+void RewindBuffer::truncate(size_t frames)
+{
+    if(frames >= _entries.size())
+        return;
+    if(!frames || !stateAt(frames - 1, _scratch) || !_current.split(_scratch.data(), _scratch.size())) {
+        clear();
+        return;
+    }
+    while(_entries.size() > frames) {
+        _memoryUsage -= entryCost(_entries.back());
+        _entries.pop_back();
+    }
+    updateKeyframeDistance();
+}
+
+bool RewindBuffer::stateAt(size_t index, std::vector<uint8_t>& state) const
+{
+    if(index >= _entries.size())
+        return false;
+    if(index + 1 == _entries.size()) {
+        _current.join(state);
+        return true;
+    }
+    auto keyframe = index;
+    while(!_entries[keyframe].keyframe) {
+        if(!keyframe)
+            return false;
+        --keyframe;
+    }
+    StateMemoryPages pages;
+    for(auto i = keyframe; i <= index; ++i) {
+        if(!applyDelta(pages, _entries[i], _entries[i]))
+            return false;
+    }
+    pages.join(state);
+    return true;
+}
+
+bool RewindBuffer::previousState(size_t index, std::vector<uint8_t>& state) const
+{
+    if(!index || index >= _entries.size())
+        return false;
+    if(_entries[index].keyframe)
+        return stateAt(index - 1, state);
+    StateMemoryPages pages;
+    if(!pages.split(state.data(), state.size()) || !applyDelta(pages, _entries[index], _entries[index - 1]))
+        return false;
+    pages.join(state);
+    return true;
+}
+
+// The delta data holds the runs of the state without memory, followed by records of
+// page index distance, run bytes and runs for every page that differs
+void RewindBuffer::encodeDelta(const StateMemoryPages& state, const StateMemoryPages& base, Entry& entry)
+{
+    static const uint8_t zeroPage[StateMemoryPages::PAGE_SIZE]{};
+    const auto& rest = state.rest();
+    const auto& baseRest = base.rest();
+    _delta.assign(std::max(rest.size(), baseRest.size()), 0);
+    std::copy(rest.begin(), rest.end(), _delta.begin());
+    for(size_t i = 0; i < baseRest.size(); ++i) {
+        _delta[i] ^= baseRest[i];
+    }
+    entry.restSize = uint32_t(rest.size());
+    entry.memorySize = state.memorySize();
+    entry.memoryOffset = state.memoryOffset();
+    entry.data.clear();
+    encodeRuns(_delta.data(), _delta.size(), entry.data);
+    entry.restDeltaSize = uint32_t(entry.data.size());
+    size_t lastPage = 0;
+    uint8_t pageDelta[StateMemoryPages::PAGE_SIZE];
+    for(size_t page = 0; page < std::max(state.pages(), base.pages()); ++page) {
+        const auto* data = state.page(page);
+        const auto* baseData = base.page(page);
+        if(data == baseData || (data && baseData && std::memcmp(data, baseData, StateMemoryPages::PAGE_SIZE) == 0))
+            continue;
+        data = data ? data : zeroPage;
+        baseData = baseData ? baseData : zeroPage;
+        for(size_t i = 0; i < StateMemoryPages::PAGE_SIZE; ++i) {
+            pageDelta[i] = data[i] ^ baseData[i];
+        }
+        _delta.clear();
+        encodeRuns(pageDelta, StateMemoryPages::PAGE_SIZE, _delta);
+        if(_delta.empty())
+            continue;
+        writeVarint(entry.data, page - lastPage);
+        writeVarint(entry.data, _delta.size());
+        entry.data.insert(entry.data.end(), _delta.begin(), _delta.end());
+        lastPage = page;
+    }
+    entry.data.shrink_to_fit();
+}
+
+bool RewindBuffer::applyDelta(StateMemoryPages& state, const Entry& entry, const Entry& result)
+{
+    auto& rest = state.rest();
+    const auto* src = entry.data.data();
+    const auto* end = src + entry.data.size();
+    const auto* restEnd = src + entry.restDeltaSize;
+    rest.resize(std::max(rest.size(), size_t(std::max(entry.restSize, result.restSize))), 0);
+    if(restEnd > end || !applyRuns(rest.data(), rest.size(), src, restEnd))
+        return false;
+    rest.resize(result.restSize);
+    state.setLayout(std::max(entry.memorySize, result.memorySize), result.memoryOffset);
+    size_t page = 0;
+    for(src = restEnd; src < end;) {
+        size_t distance, size;
+        if(!readVarint(src, end, distance) || !readVarint(src, end, size) || size > size_t(end - src))
+            return false;
+        page += distance;
+        if(page >= state.pages() || !applyRuns(state.mutablePage(page), StateMemoryPages::PAGE_SIZE, src, src + size))
+            return false;
+        src += size;
+    }
+    state.setLayout(result.memorySize, result.memoryOffset);
+    return true;
+}
+
+void RewindBuffer::updateKeyframeDistance()
+{
+    auto keyframe = std::find_if(_entries.rbegin(), _entries.rend(), [](const Entry& entry) { return entry.keyframe; });
+    _framesSinceKeyframe = size_t(keyframe - _entries.rbegin());
+}
+
+void RewindBuffer::enforceBudget()
+{
+    while(!_entries.empty() && memoryUsage() > _memoryBudget) {
+        auto next = std::find_if(_entries.begin() + 1, _entries.end(), [](const Entry& entry) { return entry.keyframe; });
+        if(next == _entries.end())
+            break;
+        for(auto iter = _entries.begin(); iter != next; ++iter) {
+            _memoryUsage -= entryCost(*iter);
+        }
+        _entries.erase(_entries.begin(), next);
+    }
+}
+
+}
@@ -0,0 +1,113 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/rewindbuffer.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/statestream.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace emu {
+
+class IChip8Emulator;
+
+//---------------------------------------------------------------------------------------
+// Bounded history of emulator snapshots for rewinding.
+//
+// Every capture() takes a save-state of the core. Every keyframeInterval frames
+// the state is stored as a keyframe, all other frames only store the XOR of the
+// state with its predecessor, run-length encoded (zero runs vs. literal bytes),
+// so a frame that changed a handful of registers and a sprite costs a few dozen
+// bytes. Memory is XORed page by page by address (see StateMemoryPages), so a
+// page turning zero or non-zero doesn't shift the rest of the state. As XOR is
+// its own inverse, stepping back one frame is a single delta application to
+// the newest full state, any other frame is reconstructed from
+// the closest keyframe by replaying the deltas forward. When the memory budget
+// is exceeded, the oldest keyframe and its deltas are dropped as a group.
+// Each frame carries the cycle counters and the key state that was active
+// while it was emulated, so the host can deterministically replay between
+// two snapshots.
+//---------------------------------------------------------------------------------------
+class RewindBuffer
+{
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+    static constexpr size_t DEFAULT_KEYFRAME_INTERVAL = 60;
+    struct FrameInfo
+    {
+        int64_t cycles{0};
+        int64_t backendCycles{0};
+        uint16_t keys{0};
+    };
+    explicit RewindBuffer(size_t memoryBudget = DEFAULT_MEMORY_BUDGET, size_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+    ~RewindBuffer() = default;
+
+    void clear();
+    bool capture(const IChip8Emulator& emu) { return capture(emu, FrameInfo{}); }
+    bool capture(const IChip8Emulator& emu, const FrameInfo& info);
+    bool stepBack(IChip8Emulator& emu);
+    void truncate(size_t frames);
+    bool stateAt(size_t index, std::vector<uint8_t>& state) const;
+    bool previousState(size_t index, std::vector<uint8_t>& state) const;
+    const FrameInfo& frameInfo(size_t index) const { return _entries[index].info; }
+    size_t deltaSize(size_t index) const { return _entries[index].data.size(); }
+
+    size_t frames() const { return _entries.size(); }
+    size_t memoryUsage() const { return _memoryUsage + (_entries.empty() ? 0 : _entries.back().stateSize); }
+    size_t memoryBudget() const { return _memoryBudget; }
+    void setMemoryBudget(size_t budget);
+    size_t keyframeInterval() const { return _keyframeInterval; }
+
+private:
+    struct Entry
+    {
+        bool keyframe{false};
+        uint32_t stateSize{0};
+        uint32_t restSize{0};
+        uint32_t memorySize{0};
+        uint32_t memoryOffset{StateMemoryPages::NO_MEMORY};
+        uint32_t restDeltaSize{0};
+        FrameInfo info;
+        std::vector<uint8_t> data;
+    };
+    void encodeDelta(const StateMemoryPages& state, const StateMemoryPages& base, Entry& entry);
+    static bool applyDelta(StateMemoryPages& state, const Entry& entry, const Entry& result);
+    static size_t entryCost(const Entry& entry) { return entry.data.size() + sizeof(Entry); }
+    void enforceBudget();
+    void updateKeyframeDistance();
+    std::deque<Entry> _entries;
+    StateMemoryPages _current;
+    StateMemoryPages _next;
+    std::vector<uint8_t> _scratch;
+    std::vector<uint8_t> _delta;
+    size_t _memoryBudget{DEFAULT_MEMORY_BUDGET};
+    size_t _keyframeInterval{DEFAULT_KEYFRAME_INTERVAL};
+    size_t _framesSinceKeyframe{0};
+    size_t _memoryUsage{0};
+};
+
+}
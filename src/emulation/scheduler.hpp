@@ -0,0 +1,121 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/scheduler.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+#pragma once
+
+#include <emulation/config.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Cycle based event queue for the peripherals of the real hardware cores.
+// Devices register a handler once and (re)schedule it with an absolute cycle
+// stamp, the core loop only has to compare the cpu cycles against nextDue()
+// between instructions and calls runDue() when that is reached. Handlers are
+// called at the first instruction boundary at or after their due cycle, with
+// events due at the same cycle ordered by registration. Each event is queued
+// at most once, scheduling it again moves it.
+//---------------------------------------------------------------------------------------
+class Scheduler
+{
+public:
+    using EventId = int;
+    using Handler = std::function<void(cycles_t now)>;
+    static constexpr cycles_t NEVER = std::numeric_limits<cycles_t>::max();
+
+    EventId registerEvent(Handler handler)
+    {
+        _handlers.push_back(std::move(handler));
+        return EventId(_handlers.size() - 1);
+    }
+
+    void schedule(EventId id, cycles_t due)
+    {
+        removeEntry(id);
+        _queue.push_back({due, id});
+        std::push_heap(_queue.begin(), _queue.end(), Later());
+        _nextDue = _queue.front().due;
+    }
+
+    void cancel(EventId id)
+    {
+        removeEntry(id);
+        _nextDue = _queue.empty() ? NEVER : _queue.front().due;
+    }
+
+    void clear()
+    {
+        _queue.clear();
+        _nextDue = NEVER;
+    }
+
+    bool isScheduled(EventId id) const
+    {
+        return std::any_of(_queue.begin(), _queue.end(), [id](const Entry& e) { return e.id == id; });
+    }
+
+    cycles_t nextDue() const { return _nextDue; }
+    bool isDue(cycles_t now) const { return now >= _nextDue; }
+
+    void runDue(cycles_t now)
+    {
+        while(!_queue.empty() && _queue.front().due <= now) {
+            std::pop_heap(_queue.begin(), _queue.end(), Later());
+            auto id = _queue.back().id;
+            _queue.pop_back();
+            _nextDue = _queue.empty() ? NEVER : _queue.front().due;
+            _handlers[id](now);
+        }
+    }
+
+private:
+    struct Entry
+    {
+        cycles_t due;
+        EventId id;
+    };
+    struct Later
+    {
+        bool operator()(const Entry& a, const Entry& b) const { return a.due > b.due || (a.due == b.due && a.id > b.id); }
+    };
+    void removeEntry(EventId id)
+    {
+        auto iter = std::find_if(_queue.begin(), _queue.end(), [id](const Entry& e) { return e.id == id; });
+        if(iter != _queue.end()) {
+            _queue.erase(iter);
+            std::make_heap(_queue.begin(), _queue.end(), Later());
+        }
+    }
+    std::vector<Entry> _queue;
+    std::vector<Handler> _handlers;
+    cycles_t _nextDue{NEVER};
+};
+
+}  // namespace emu
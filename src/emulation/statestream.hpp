@@ -0,0 +1,514 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/statestream.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+#pragma once
+
+#include <emulation/time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Save-state blob layout (all values little endian):
+//
+//   header:  "C8SS" u16 version, u16 reserved, u32 body size, u32 body checksum
+//   body:    string core name, chunks
+//   chunk:   u32 tag, u32 payload size, payload
+//
+// Chunks can be nested, a reader always skips unread payload of a chunk
+// when leaving it, so newer writers can append fields to a chunk without
+// breaking older readers. Memory is stored as a 'MEM ' chunk containing
+// the region size followed by records of u32 page index and PAGE_SIZE
+// bytes, all-zero pages are left out. Page records of unchanged memory
+// are byte identical between snapshots, so they can be deduplicated.
+//
+// The body size and checksum are filled in when the writer is destroyed.
+// The reader verifies them and the framing of the top level chunks before
+// anything is read, so a truncated or corrupted blob is rejected before a
+// core has overwritten any of its state.
+//---------------------------------------------------------------------------------------
+constexpr uint32_t stateTag(const char (&tag)[5])
+{
+    return uint32_t(uint8_t(tag[0])) | (uint32_t(uint8_t(tag[1])) << 8) | (uint32_t(uint8_t(tag[2])) << 16) | (uint32_t(uint8_t(tag[3])) << 24);
+}
+
+// Adler-32, cheap enough to run over every snapshot
+inline uint32_t stateChecksum(const uint8_t* data, size_t size)
+{
+    constexpr uint32_t MOD_ADLER = 65521;
+    constexpr size_t BLOCK_SIZE = 5552;  // largest block that can't overflow the sums
+    uint32_t a = 1, b = 0;
+    while(size) {
+        auto len = std::min(size, BLOCK_SIZE);
+        size -= len;
+        while(len--) {
+            a += *data++;
+            b += a;
+        }
+        a %= MOD_ADLER;
+        b %= MOD_ADLER;
+    }
+    return (b << 16) | a;
+}
+
+class StateWriter
+{
+public:
+    static constexpr uint32_t MAGIC = stateTag("C8SS");
+    static constexpr uint16_t VERSION = 2;
+    static constexpr size_t PAGE_SIZE = 256;
+    static constexpr size_t HEADER_SIZE = 16;
+    StateWriter(std::vector<uint8_t>& buffer, const std::string& coreName)
+        : _buffer(buffer)
+        , _headerless(false)
+    {
+        _buffer.clear();
+        write(MAGIC);
+        write(VERSION);
+        write(uint16_t(0));
+        write(uint32_t(0));
+        write(uint32_t(0));
+        writeString(coreName);
+    }
+    // appends plain chunks to the buffer, without header, size and checksum
+    explicit StateWriter(std::vector<uint8_t>& buffer)
+        : _buffer(buffer)
+        , _headerless(true)
+    {}
+    ~StateWriter()
+    {
+        if(_headerless)
+            return;
+        auto bodySize = _buffer.size() - HEADER_SIZE;
+        writeAt(HEADER_SIZE - 8, uint32_t(bodySize));
+        writeAt(HEADER_SIZE - 4, stateChecksum(_buffer.data() + HEADER_SIZE, bodySize));
+    }
+
+    void beginChunk(uint32_t tag)
+    {
+        write(tag);
+        _chunkStack.push_back(_buffer.size());
+        write(uint32_t(0));
+    }
+    void endChunk()
+    {
+        if(_chunkStack.empty())
+            return;
+        auto sizePos = _chunkStack.back();
+        _chunkStack.pop_back();
+        writeAt(sizePos, uint32_t(_buffer.size() - sizePos - 4));
+    }
+    template<typename T>
+    void write(T value)
+    {
+        if constexpr (std::is_enum_v<T>) {
+            write(static_cast<int32_t>(value));
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            _buffer.push_back(value ? 1 : 0);
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t> bits;
+            std::memcpy(&bits, &value, sizeof(T));
+            write(bits);
+        }
+        else {
+            static_assert(std::is_integral_v<T>, "StateWriter::write only supports arithmetic and enum types");
+            using U = std::make_unsigned_t<T>;
+            auto val = static_cast<U>(value);
+            for(size_t i = 0; i < sizeof(T); ++i)
+                _buffer.push_back(uint8_t(val >> (i * 8)));
+        }
+    }
+    template<typename T, size_t N>
+    void write(const std::array<T, N>& values)
+    {
+        if constexpr (sizeof(T) == 1) {
+            writeBytes(values.data(), N);
+        }
+        else {
+            for(const auto& val : values)
+                write(val);
+        }
+    }
+    void writeBytes(const void* data, size_t size)
+    {
+        auto pos = _buffer.size();
+        _buffer.resize(pos + size);
+        std::memcpy(_buffer.data() + pos, data, size);
+    }
+    void writeString(const std::string& str)
+    {
+        write(uint32_t(str.size()));
+        writeBytes(str.data(), str.size());
+    }
+    void writeTime(const ClockedTime& time)
+    {
+        write(time.seconds());
+        write(time.ticks());
+    }
+    void writeMemory(const uint8_t* data, size_t size)
+    {
+        beginChunk(stateTag("MEM "));
+        write(uint32_t(size));
+        _buffer.reserve(_buffer.size() + size + size / PAGE_SIZE * 4 + 4);
+        for(size_t page = 0; page * PAGE_SIZE < size; ++page) {
+            auto offset = page * PAGE_SIZE;
+            writePage(uint32_t(page), data + offset, std::min(PAGE_SIZE, size - offset));
+        }
+        endChunk();
+    }
+    // one page record of a 'MEM ' chunk, all-zero pages are left out
+    void writePage(uint32_t page, const uint8_t* data, size_t len)
+    {
+        static const uint8_t zeroPage[PAGE_SIZE]{};
+        if(std::memcmp(data, zeroPage, len) == 0)
+            return;
+        write(page);
+        writeBytes(data, len);
+    }
+    size_t size() const { return _buffer.size(); }
+
+private:
+    void writeAt(size_t pos, uint32_t value)
+    {
+        for(int i = 0; i < 4; ++i)
+            _buffer[pos + i] = uint8_t(value >> (i * 8));
+    }
+    std::vector<uint8_t>& _buffer;
+    std::vector<size_t> _chunkStack;
+    bool _headerless{false};
+};
+
+class StateReader
+{
+public:
+    StateReader(const uint8_t* data, size_t size, const std::string& coreName)
+        : _data(data)
+        , _size(size)
+    {
+        if(read<uint32_t>() != StateWriter::MAGIC) {
+            _valid = false;
+            return;
+        }
+        _version = read<uint16_t>();
+        read<uint16_t>();
+        auto bodySize = read<uint32_t>();
+        auto checksum = read<uint32_t>();
+        if(!_valid || _version != StateWriter::VERSION || bodySize != _size - _pos || stateChecksum(_data + _pos, bodySize) != checksum || readString() != coreName || !checkFraming())
+            _valid = false;
+    }
+    ~StateReader() = default;
+
+    bool isValid() const { return _valid; }
+    uint16_t version() const { return _version; }
+    // size of the memory region stored in the top level 'MEM ' chunk, lets a core
+    // reject a blob of another configuration before touching its state
+    size_t memorySize() const { return _memorySize; }
+
+    bool beginChunk(uint32_t tag)
+    {
+        // on mismatch an empty chunk is entered, to keep endChunk() calls balanced
+        auto chunkTag = read<uint32_t>();
+        auto size = read<uint32_t>();
+        if(!_valid || chunkTag != tag || size > limit() - _pos) {
+            _valid = false;
+            _chunkStack.push_back(_pos);
+            return false;
+        }
+        _chunkStack.push_back(_pos + size);
+        return true;
+    }
+    void endChunk()
+    {
+        if(_chunkStack.empty())
+            return;
+        if(_pos > _chunkStack.back())
+            _valid = false;
+        _pos = _chunkStack.back();
+        _chunkStack.pop_back();
+    }
+    template<typename T>
+    T read()
+    {
+        if constexpr (std::is_enum_v<T>) {
+            return static_cast<T>(read<int32_t>());
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            return read<uint8_t>() != 0;
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            auto bits = read<std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>();
+            T value;
+            std::memcpy(&value, &bits, sizeof(T));
+            return value;
+        }
+        else {
+            static_assert(std::is_integral_v<T>, "StateReader::read only supports arithmetic and enum types");
+            using U = std::make_unsigned_t<T>;
+            if(!ensure(sizeof(T)))
+                return T{};
+            U val = 0;
+            for(size_t i = 0; i < sizeof(T); ++i)
+                val |= U(_data[_pos++]) << (i * 8);
+            return static_cast<T>(val);
+        }
+    }
+    template<typename T>
+    void read(T& value)
+    {
+        value = read<T>();
+    }
+    template<typename T, size_t N>
+    void read(std::array<T, N>& values)
+    {
+        if constexpr (sizeof(T) == 1) {
+            readBytes(values.data(), N);
+        }
+        else {
+            for(auto& val : values)
+                read(val);
+        }
+    }
+    void readBytes(void* data, size_t size)
+    {
+        if(!ensure(size)) {
+            std::memset(data, 0, size);
+            return;
+        }
+        std::memcpy(data, _data + _pos, size);
+        _pos += size;
+    }
+    std::string readString()
+    {
+        auto size = read<uint32_t>();
+        if(!ensure(size))
+            return {};
+        std::string result(reinterpret_cast<const char*>(_data + _pos), size);
+        _pos += size;
+        return result;
+    }
+    void readTime(ClockedTime& time)
+    {
+        auto seconds = read<ClockedTime::seconds_t>();
+        auto ticks = read<ClockedTime::ticks_t>();
+        time.setTime(seconds, ticks);
+    }
+    void readMemory(uint8_t* data, size_t size)
+    {
+        if(!beginChunk(stateTag("MEM "))) {
+            endChunk();
+            return;
+        }
+        if(read<uint32_t>() != size) {
+            _valid = false;
+            endChunk();
+            return;
+        }
+        std::memset(data, 0, size);
+        while(_valid && _pos < limit()) {
+            auto offset = size_t(read<uint32_t>()) * StateWriter::PAGE_SIZE;
+            if(offset >= size) {
+                _valid = false;
+                break;
+            }
+            readBytes(data + offset, std::min(StateWriter::PAGE_SIZE, size - offset));
+        }
+        endChunk();
+    }
+
+private:
+    size_t limit() const { return _chunkStack.empty() ? _size : _chunkStack.back(); }
+    uint32_t peek32(size_t pos) const
+    {
+        return uint32_t(_data[pos]) | (uint32_t(_data[pos + 1]) << 8) | (uint32_t(_data[pos + 2]) << 16) | (uint32_t(_data[pos + 3]) << 24);
+    }
+    bool checkFraming()
+    {
+        // the top level chunks have to cover the rest of the blob exactly
+        for(auto pos = _pos; pos != _size;) {
+            if(_size - pos < 8)
+                return false;
+            auto tag = peek32(pos);
+            auto size = peek32(pos + 4);
+            pos += 8;
+            if(size > _size - pos)
+                return false;
+            if(tag == stateTag("MEM ") && size >= 4)
+                _memorySize = peek32(pos);
+            pos += size;
+        }
+        return true;
+    }
+    bool ensure(size_t size)
+    {
+        if(!_valid || size > limit() - _pos) {
+            _valid = false;
+            return false;
+        }
+        return true;
+    }
+    const uint8_t* _data{nullptr};
+    size_t _size{0};
+    size_t _pos{0};
+    uint16_t _version{0};
+    size_t _memorySize{0};
+    bool _valid{true};
+    std::vector<size_t> _chunkStack;
+};
+
+//---------------------------------------------------------------------------------------
+// A save-state blob taken apart into the blob without its top level 'MEM ' chunk and
+// the memory by page, join() puts back a byte identical blob. Lets the rewind buffer
+// compare memory by address, as the blob position of a page record moves whenever a
+// page in front of it turns zero or non-zero. Only non-zero pages are held.
+//---------------------------------------------------------------------------------------
+class StateMemoryPages
+{
+public:
+    static constexpr size_t PAGE_SIZE = StateWriter::PAGE_SIZE;
+    static constexpr uint32_t NO_MEMORY = 0xFFFFFFFF;
+
+    bool split(const uint8_t* data, size_t size)
+    {
+        clear();
+        // skip the header and the core name
+        if(size < StateWriter::HEADER_SIZE + 4)
+            return false;
+        auto pos = StateWriter::HEADER_SIZE;
+        auto nameSize = get32(data + pos);
+        if(nameSize > size - pos - 4)
+            return false;
+        pos += 4 + nameSize;
+        while(pos != size) {
+            if(size - pos < 8)
+                return false;
+            auto tag = get32(data + pos);
+            auto chunkSize = get32(data + pos + 4);
+            if(chunkSize > size - pos - 8)
+                return false;
+            if(tag == stateTag("MEM ") && _memoryOffset == NO_MEMORY) {
+                if(!splitMemory(data + pos + 8, chunkSize))
+                    return false;
+                _memoryOffset = uint32_t(pos);
+                _rest.insert(_rest.end(), data, data + pos);
+                _rest.insert(_rest.end(), data + pos + 8 + chunkSize, data + size);
+                return true;
+            }
+            pos += 8 + chunkSize;
+        }
+        _rest.assign(data, data + size);
+        return true;
+    }
+    // Rebuilds the blob byte for byte: absent pages were all zero in the original and
+    // writePage() drops pages that turned zero, just like StateWriter::writeMemory()
+    void join(std::vector<uint8_t>& state) const
+    {
+        if(_memoryOffset == NO_MEMORY || _memoryOffset > _rest.size()) {
+            state = _rest;
+            return;
+        }
+        state.assign(_rest.begin(), _rest.begin() + _memoryOffset);
+        {
+            StateWriter writer(state);
+            writer.beginChunk(stateTag("MEM "));
+            writer.write(_memorySize);
+            for(size_t page = 0; page < _slots.size(); ++page) {
+                if(_slots[page] >= 0)
+                    writer.writePage(uint32_t(page), _pool.data() + _slots[page], pageLength(page));
+            }
+            writer.endChunk();
+        }
+        state.insert(state.end(), _rest.begin() + _memoryOffset, _rest.end());
+    }
+    void clear()
+    {
+        _rest.clear();
+        _slots.clear();
+        _pool.clear();
+        _memorySize = 0;
+        _memoryOffset = NO_MEMORY;
+    }
+
+    std::vector<uint8_t>& rest() { return _rest; }
+    const std::vector<uint8_t>& rest() const { return _rest; }
+    uint32_t memorySize() const { return _memorySize; }
+    uint32_t memoryOffset() const { return _memoryOffset; }
+    size_t pages() const { return _slots.size(); }
+    size_t pageLength(size_t page) const { return std::min(PAGE_SIZE, _memorySize - page * PAGE_SIZE); }
+    // nullptr for a page that is all zero
+    const uint8_t* page(size_t page) const { return page < _slots.size() && _slots[page] >= 0 ? _pool.data() + _slots[page] : nullptr; }
+    uint8_t* mutablePage(size_t page)
+    {
+        if(_slots[page] < 0) {
+            _slots[page] = int32_t(_pool.size());
+            _pool.resize(_pool.size() + PAGE_SIZE, 0);
+        }
+        return _pool.data() + _slots[page];
+    }
+    void setLayout(uint32_t memorySize, uint32_t memoryOffset)
+    {
+        _memorySize = memorySize;
+        _memoryOffset = memoryOffset;
+        _slots.resize((memorySize + PAGE_SIZE - 1) / PAGE_SIZE, -1);
+    }
+
+private:
+    static uint32_t get32(const uint8_t* data)
+    {
+        return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+    }
+    bool splitMemory(const uint8_t* data, size_t size)
+    {
+        if(size < 4)
+            return false;
+        setLayout(get32(data), NO_MEMORY);
+        _pool.reserve(size);
+        for(size_t pos = 4; pos != size;) {
+            if(size - pos < 4)
+                return false;
+            auto page = get32(data + pos);
+            if(page >= _slots.size() || _slots[page] >= 0 || pageLength(page) > size - pos - 4)
+                return false;
+            std::memcpy(mutablePage(page), data + pos + 4, pageLength(page));
+            pos += 4 + pageLength(page);
+        }
+        return true;
+    }
+    std::vector<uint8_t> _rest;
+    std::vector<int32_t> _slots;
+    std::vector<uint8_t> _pool;
+    uint32_t _memorySize{0};
+    uint32_t _memoryOffset{NO_MEMORY};
+};
+
+}  // namespace emu
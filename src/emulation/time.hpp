@@ -199,6 +199,9 @@ inline int64_t Time::differenceInClockTicks(const Time& other, uint32_t frequenc
     }
 }
 
+// A Time advancing in cycles of a clock, addCycles() only collects the cycles
+// and they are folded into the time when it is read, so cores can account
+// every bus cycle without paying for the Time arithmetic
 class ClockedTime
 {
 public:
@@ -206,55 +209,78 @@ public:
     using ticks_t = Time::ticks_t;
 
     ClockedTime() = delete;
-    explicit ClockedTime(uint32_t frequency) : _clockFreq(frequency) {}
-    void setFrequency(uint32_t frequency) { _clockFreq = frequency; }
+    explicit ClockedTime(uint32_t frequency) { setFrequency(frequency); }
+    void setFrequency(uint32_t frequency)
+    {
+        sync();
+        _clockFreq = frequency;
+        _ticksPerCycle = frequency ? Time::ticksPerSecond / frequency + (Time::ticksPerSecond % frequency != 0) : 0;
+        _excessTicksPerSecond = ticks_t(frequency) * _ticksPerCycle - Time::ticksPerSecond;
+    }
+    void setTime(seconds_t seconds, ticks_t ticks)
+    {
+        _pendingCycles = 0;
+        _time = Time(seconds, ticks);
+    }
     inline void addCycles(cycles_t cycles)
     {
-        _time.addCycles(cycles, _clockFreq);
+        _pendingCycles += cycles;
     }
     inline cycles_t asClockTicks() const
     {
+        sync();
         return _time.asClockTicks(_clockFreq);
     }
     uint32_t getClockFreq() const
     {
         return _clockFreq;
     }
+    int64_t cyclesFromMicroseconds(int64_t microseconds) const
+    {
+        return microseconds * _clockFreq / 1000000;
+    }
+    int64_t microsecondsFromCycles(int64_t cycles) const
+    {
+        return _clockFreq ? cycles * 1000000 / _clockFreq : 0;
+    }
 
-    inline bool isZero() const { return _time.isZero(); }
-    inline bool isNever() const { return _time.isNever(); }
-    inline seconds_t seconds() const { return _time.seconds(); }
-    inline seconds_t secondsRounded() const { return _time.secondsRounded(); }
-    inline ticks_t ticks() const { return _time.ticks(); }
-    inline double asSeconds() const { return _time.asSeconds(); }
+    inline bool isZero() const { sync(); return _time.isZero(); }
+    inline bool isNever() const { sync(); return _time.isNever(); }
+    inline seconds_t seconds() const { sync(); return _time.seconds(); }
+    inline seconds_t secondsRounded() const { sync(); return _time.secondsRounded(); }
+    inline ticks_t ticks() const { sync(); return _time.ticks(); }
+    inline double asSeconds() const { sync(); return _time.asSeconds(); }
 
     virtual ClockedTime operator+(const Time& other)
     {
+        sync();
         ClockedTime result{_clockFreq};
         result._time = _time + other;
         return result;
     }
 
-    bool operator<(const Time& other) const { return _time < other; }
-    bool operator<(const ClockedTime& other) const { return _time < other._time; }
+    bool operator<(const Time& other) const { sync(); return _time < other; }
+    bool operator<(const ClockedTime& other) const { sync(); other.sync(); return _time < other._time; }
 
     bool operator>=(const ClockedTime& other) const { return !(*this < other); }
     bool operator>=(const Time& other) const { return !(*this < other); }
 
     bool operator>(const ClockedTime& other) const { return other < *this; }
-    bool operator>(const Time& other) const { return other < this->_time; }
+    bool operator>(const Time& other) const { sync(); return other < this->_time; }
 
     bool operator<=(const ClockedTime& other) const { return other >= *this; }
-    bool operator<=(const Time& other) const { return other >= this->_time; }
+    bool operator<=(const Time& other) const { sync(); return other >= this->_time; }
 
-    bool operator==(const ClockedTime& other) const { return _time == other._time && _clockFreq && other._clockFreq; }
+    bool operator==(const ClockedTime& other) const { sync(); other.sync(); return _time == other._time && _clockFreq && other._clockFreq; }
 
     bool operator!=(const ClockedTime& other) const { return !(*this == other); }
 
-    std::string asString() const { return _time.asString(); }
+    std::string asString() const { sync(); return _time.asString(); }
 
     int64_t difference(const ClockedTime& other) const
     {
+        sync();
+        other.sync();
         return _time.differenceInClockTicks(other._time, _clockFreq);
     }
     int64_t difference_us(const ClockedTime& other) const
@@ -269,11 +295,25 @@ public:
     }
     void reset()
     {
+        _pendingCycles = 0;
         _time = Time::zero;
     }
 private:
+    // Adds the collected cycles exactly as adding them one call at a time would
+    void sync() const
+    {
+        if(_pendingCycles && _clockFreq) {
+            auto seconds = _pendingCycles / _clockFreq;
+            auto cycles = _pendingCycles % _clockFreq;
+            _time += Time(seconds_t(seconds), seconds * _excessTicksPerSecond + cycles * _ticksPerCycle);
+            _pendingCycles = 0;
+        }
+    }
     uint32_t _clockFreq{};
-    Time _time{};
+    ticks_t _ticksPerCycle{};
+    ticks_t _excessTicksPerSecond{};
+    mutable Time _time{};
+    mutable cycles_t _pendingCycles{};
 };
 
 class TimeGuard {
@@ -0,0 +1,110 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/tracebuffer.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/config.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace emu {
+
+class IChip8Emulator;
+
+//---------------------------------------------------------------------------------------
+// Fixed size binary trace record, written for every traced instruction instead of a
+// formatted text line. The formatter is a plain function of the producing core, so
+// records stay printable after the core is gone and text is only generated for lines
+// that are actually displayed or exported. The optional chip8 parameter is used to
+// disassemble CHIP-8 opcodes with the currently active variant.
+//---------------------------------------------------------------------------------------
+struct TraceRecord
+{
+    using Formatter = std::string (*)(const TraceRecord& record, const IChip8Emulator* chip8);
+    enum Marker : uint8_t { eINSTRUCTION, eVSYNC, eHSYNC, eIRQ };
+    struct Chip8Regs { uint8_t v[16]; uint16_t i; uint8_t sp; };
+    struct Cdp1802Regs { uint16_t r[16]; uint8_t d, df, p, x, n, i, t, ef; };
+    struct M6800Regs { uint16_t ix, sp; uint8_t a, b, cc; };
+    Formatter formatter{nullptr};
+    cycles_t cycle{0};
+    uint16_t frame{0};
+    uint16_t frameCycle{0};
+    uint8_t source{0};
+    Marker marker{eINSTRUCTION};
+    uint32_t pc{0};
+    uint8_t code[4]{};
+    union {
+        Chip8Regs chip8;
+        Cdp1802Regs cdp1802;
+        M6800Regs m6800;
+        uint64_t messageIndex;
+    };
+    std::string format(const IChip8Emulator* chip8 = nullptr) const { return formatter ? formatter(*this, chip8) : std::string(); }
+};
+
+//---------------------------------------------------------------------------------------
+// Preallocated single producer/single consumer ring of trace records, the oldest
+// records get overwritten. Records are addressed by their running index, read()
+// fails if the record was overwritten while it was copied.
+//---------------------------------------------------------------------------------------
+class TraceBuffer
+{
+public:
+    explicit TraceBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while(size < capacity)
+            size <<= 1;
+        _records.resize(size);
+        _mask = size - 1;
+    }
+    void push(const TraceRecord& record)
+    {
+        auto index = _written.load(std::memory_order_relaxed);
+        _records[index & _mask] = record;
+        _written.store(index + 1, std::memory_order_release);
+    }
+    bool read(uint64_t index, TraceRecord& record) const
+    {
+        if(index < first() || index >= written())
+            return false;
+        record = _records[index & _mask];
+        return index >= first();
+    }
+    void clear() { _written.store(0, std::memory_order_release); }
+    uint64_t written() const { return _written.load(std::memory_order_acquire); }
+    uint64_t first() const { auto count = written(); return count > _records.size() ? count - _records.size() : 0; }
+    size_t size() const { return size_t(written() - first()); }
+    size_t capacity() const { return _records.size(); }
+
+private:
+    std::vector<TraceRecord> _records;
+    uint64_t _mask{0};
+    std::atomic<uint64_t> _written{0};
+};
+
+}
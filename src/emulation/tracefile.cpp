@@ -0,0 +1,514 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/tracefile.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/tracefile.hpp>
+#include <emulation/chip8emulatorbase.hpp>
+#include <emulation/chip8realcorebase.hpp>
+#include <emulation/chip8dream.hpp>
+#include <emulation/hardware/cdp1802.hpp>
+#include <emulation/statestream.hpp>
+
+#include <miniz/miniz.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace emu {
+
+static constexpr uint32_t TRACE_MAGIC = stateTag("C8TR");
+static constexpr uint32_t CHUNK_MAGIC = stateTag("C8TC");
+static constexpr uint32_t INDEX_MAGIC = stateTag("C8TI");
+static constexpr uint32_t END_MAGIC = stateTag("C8TE");
+static constexpr size_t HEADER_SIZE = 8;
+static constexpr size_t CHUNK_HEADER_SIZE = 52;
+static constexpr size_t TRAILER_SIZE = 12;
+
+static const std::pair<TraceFile::Kind, TraceRecord::Formatter> g_traceFormatters[] = {
+    {TraceFile::eCHIP8, &Chip8EmulatorBase::formatTraceRecord},
+    {TraceFile::eCHIP8_REAL, &Chip8RealCoreBase::formatChip8TraceRecord},
+    {TraceFile::eCDP1802, &Cdp1802<>::formatTraceRecord},
+    {TraceFile::eM6800, &Chip8Dream::formatM6800TraceRecord}
+};
+
+static void put16(uint8_t* dest, uint16_t val)
+{
+    dest[0] = uint8_t(val);
+    dest[1] = uint8_t(val >> 8);
+}
+
+static void put32(uint8_t* dest, uint32_t val)
+{
+    put16(dest, uint16_t(val));
+    put16(dest + 2, uint16_t(val >> 16));
+}
+
+static void put64(uint8_t* dest, uint64_t val)
+{
+    put32(dest, uint32_t(val));
+    put32(dest + 4, uint32_t(val >> 32));
+}
+
+static uint16_t get16(const uint8_t* src)
+{
+    return uint16_t(src[0] | (src[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* src)
+{
+    return get16(src) | (uint32_t(get16(src + 2)) << 16);
+}
+
+static uint64_t get64(const uint8_t* src)
+{
+    return get32(src) | (uint64_t(get32(src + 4)) << 32);
+}
+
+static void packChunkInfo(const TraceFile::ChunkInfo& info, uint8_t* dest)
+{
+    put32(dest, CHUNK_MAGIC);
+    put32(dest + 4, info.records);
+    put32(dest + 8, info.compressedSize);
+    put64(dest + 12, info.firstRecord);
+    put64(dest + 20, info.firstCycle);
+    put64(dest + 28, info.lastCycle);
+    put64(dest + 36, info.firstFrame);
+    put64(dest + 44, info.lastFrame);
+}
+
+static bool unpackChunkInfo(const uint8_t* src, TraceFile::ChunkInfo& info)
+{
+    info.records = get32(src + 4);
+    info.compressedSize = get32(src + 8);
+    info.firstRecord = get64(src + 12);
+    info.firstCycle = get64(src + 20);
+    info.lastCycle = get64(src + 28);
+    info.firstFrame = get64(src + 36);
+    info.lastFrame = get64(src + 44);
+    return get32(src) == CHUNK_MAGIC && info.records && info.records <= TraceFile::CHUNK_RECORDS;
+}
+
+static bool seekFile(std::FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, int64_t(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t fileSize(std::FILE* file)
+{
+#ifdef _WIN32
+    _fseeki64(file, 0, SEEK_END);
+    return uint64_t(_ftelli64(file));
+#else
+    fseeko(file, 0, SEEK_END);
+    return uint64_t(ftello(file));
+#endif
+}
+
+TraceFile::Kind TraceFile::kindOf(const TraceRecord& record)
+{
+    for(const auto& [kind, formatter] : g_traceFormatters) {
+        if(record.formatter == formatter)
+            return kind;
+    }
+    return eUNKNOWN;
+}
+
+void TraceFile::packRecord(const TraceRecord& record, uint8_t* dest)
+{
+    auto kind = kindOf(record);
+    std::memset(dest, 0, RECORD_SIZE);
+    dest[0] = kind;
+    dest[1] = record.source;
+    dest[2] = record.marker;
+    put16(dest + 4, record.frame);
+    put16(dest + 6, record.frameCycle);
+    put64(dest + 8, uint64_t(record.cycle));
+    put32(dest + 16, record.pc);
+    std::memcpy(dest + 20, record.code, 4);
+    auto* regs = dest + 24;
+    switch(kind) {
+        case eCHIP8:
+        case eCHIP8_REAL:
+            std::memcpy(regs, record.chip8.v, 16);
+            put16(regs + 16, record.chip8.i);
+            regs[18] = record.chip8.sp;
+            break;
+        case eCDP1802: {
+            const auto& r = record.cdp1802;
+            for(int i = 0; i < 16; ++i)
+                put16(regs + i * 2, r.r[i]);
+            const uint8_t misc[8] = {r.d, r.df, r.p, r.x, r.n, r.i, r.t, r.ef};
+            std::memcpy(regs + 32, misc, 8);
+            break;
+        }
+        case eM6800:
+            put16(regs, record.m6800.ix);
+            put16(regs + 2, record.m6800.sp);
+            regs[4] = record.m6800.a;
+            regs[5] = record.m6800.b;
+            regs[6] = record.m6800.cc;
+            break;
+        default:
+            break;
+    }
+}
+
+bool TraceFile::unpackRecord(const uint8_t* src, TraceRecord& record)
+{
+    record = {};
+    auto kind = Kind(src[0]);
+    for(const auto& [k, formatter] : g_traceFormatters) {
+        if(k == kind)
+            record.formatter = formatter;
+    }
+    if(!record.formatter)
+        return false;
+    record.source = src[1];
+    record.marker = TraceRecord::Marker(src[2]);
+    record.frame = get16(src + 4);
+    record.frameCycle = get16(src + 6);
+    record.cycle = cycles_t(get64(src + 8));
+    record.pc = get32(src + 16);
+    std::memcpy(record.code, src + 20, 4);
+    const auto* regs = src + 24;
+    switch(kind) {
+        case eCHIP8:
+        case eCHIP8_REAL:
+            std::memcpy(record.chip8.v, regs, 16);
+            record.chip8.i = get16(regs + 16);
+            record.chip8.sp = regs[18];
+            break;
+        case eCDP1802: {
+            auto& r = record.cdp1802;
+            for(int i = 0; i < 16; ++i)
+                r.r[i] = get16(regs + i * 2);
+            r.d = regs[32]; r.df = regs[33]; r.p = regs[34]; r.x = regs[35];
+            r.n = regs[36]; r.i = regs[37]; r.t = regs[38]; r.ef = regs[39];
+            break;
+        }
+        case eM6800:
+            record.m6800 = {get16(regs), get16(regs + 2), regs[4], regs[5], regs[6]};
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+uint16_t TraceFile::opcodeOf(const TraceRecord& record)
+{
+    auto kind = kindOf(record);
+    return kind == eCHIP8 || kind == eCHIP8_REAL ? (record.code[0] << 8) | record.code[1] : record.code[0];
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(const std::string& filename)
+{
+    close();
+    _file = std::fopen(filename.c_str(), "wb");
+    if(!_file)
+        return false;
+    uint8_t header[HEADER_SIZE];
+    put32(header, TRACE_MAGIC);
+    put16(header + 4, TraceFile::VERSION);
+    put16(header + 6, TraceFile::RECORD_SIZE);
+    _failed = std::fwrite(header, 1, HEADER_SIZE, _file) != HEADER_SIZE;
+    _fileOffset = HEADER_SIZE;
+    _records = 0;
+    _frameBase = 0;
+    _lastFrame = 0;
+    _current = {};
+    _index.clear();
+    _pending.clear();
+    _finish = false;
+    _worker = std::thread([this]() { compressWorker(); });
+    return !_failed;
+}
+
+bool TraceWriter::close()
+{
+    if(!_file)
+        return true;
+    flushChunk();
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _finish = true;
+    }
+    _pendingChanged.notify_all();
+    _worker.join();
+    std::vector<uint8_t> index(8 + _index.size() * (8 + CHUNK_HEADER_SIZE) + TRAILER_SIZE);
+    put32(index.data(), INDEX_MAGIC);
+    put32(index.data() + 4, uint32_t(_index.size()));
+    auto* entry = index.data() + 8;
+    for(const auto& info : _index) {
+        put64(entry, info.offset);
+        packChunkInfo(info, entry + 8);
+        entry += 8 + CHUNK_HEADER_SIZE;
+    }
+    put64(entry, _fileOffset);
+    put32(entry + 8, END_MAGIC);
+    if(std::fwrite(index.data(), 1, index.size(), _file) != index.size())
+        _failed = true;
+    if(std::fclose(_file) != 0)
+        _failed = true;
+    _file = nullptr;
+    return !_failed;
+}
+
+void TraceWriter::write(const TraceRecord& record)
+{
+    if(!_file || TraceFile::kindOf(record) == TraceFile::eUNKNOWN)
+        return;
+    if(record.frame < _lastFrame)
+        _frameBase += 0x10000;
+    _lastFrame = record.frame;
+    auto frame = _frameBase + record.frame;
+    auto& info = _current.info;
+    if(_current.data.empty()) {
+        _current.data.reserve(TraceFile::CHUNK_RECORDS * TraceFile::RECORD_SIZE);
+        info = {};
+        info.firstRecord = _records;
+        info.firstCycle = info.lastCycle = uint64_t(record.cycle);
+        info.firstFrame = frame;
+    }
+    auto pos = _current.data.size();
+    _current.data.resize(pos + TraceFile::RECORD_SIZE);
+    TraceFile::packRecord(record, _current.data.data() + pos);
+    info.firstCycle = std::min(info.firstCycle, uint64_t(record.cycle));
+    info.lastCycle = std::max(info.lastCycle, uint64_t(record.cycle));
+    info.lastFrame = frame;
+    ++info.records;
+    ++_records;
+    if(info.records == TraceFile::CHUNK_RECORDS)
+        flushChunk();
+}
+
+void TraceWriter::flushChunk()
+{
+    if(_current.data.empty())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _pendingChanged.wait(lock, [this]() { return _pending.size() < MAX_PENDING_CHUNKS; });
+        _pending.push_back(std::move(_current));
+    }
+    _pendingChanged.notify_all();
+    _current = {};
+}
+
+void TraceWriter::compressWorker()
+{
+    std::vector<uint8_t> buffer;
+    while(true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _pendingChanged.wait(lock, [this]() { return !_pending.empty() || _finish; });
+            if(_pending.empty())
+                break;
+            chunk = std::move(_pending.front());
+            _pending.pop_front();
+        }
+        _pendingChanged.notify_all();
+        if(!writeChunk(chunk, buffer))
+            _failed = true;
+    }
+}
+
+bool TraceWriter::writeChunk(Chunk& chunk, std::vector<uint8_t>& buffer)
+{
+    auto compressedSize = mz_compressBound(mz_ulong(chunk.data.size()));
+    buffer.resize(CHUNK_HEADER_SIZE + compressedSize);
+    if(mz_compress2(buffer.data() + CHUNK_HEADER_SIZE, &compressedSize, chunk.data.data(), mz_ulong(chunk.data.size()), MZ_BEST_SPEED) != MZ_OK)
+        return false;
+    chunk.info.offset = _fileOffset;
+    chunk.info.compressedSize = uint32_t(compressedSize);
+    packChunkInfo(chunk.info, buffer.data());
+    auto size = CHUNK_HEADER_SIZE + compressedSize;
+    if(std::fwrite(buffer.data(), 1, size, _file) != size)
+        return false;
+    _fileOffset += size;
+    _index.push_back(chunk.info);
+    return true;
+}
+
+TraceReader::~TraceReader()
+{
+    close();
+}
+
+bool TraceReader::open(const std::string& filename)
+{
+    close();
+    _file = std::fopen(filename.c_str(), "rb");
+    if(!_file) {
+        _errorMessage = "Could not open trace file '" + filename + "'";
+        return false;
+    }
+    uint8_t header[HEADER_SIZE];
+    if(std::fread(header, 1, HEADER_SIZE, _file) != HEADER_SIZE || get32(header) != TRACE_MAGIC) {
+        _errorMessage = "Not a trace file: '" + filename + "'";
+        close();
+        return false;
+    }
+    if(get16(header + 4) > TraceFile::VERSION || get16(header + 6) != TraceFile::RECORD_SIZE) {
+        _errorMessage = "Unsupported trace file version";
+        close();
+        return false;
+    }
+    if(!readIndex() && !rebuildIndex()) {
+        _errorMessage = "Trace file is damaged";
+        close();
+        return false;
+    }
+    seekCycle(0);
+    return true;
+}
+
+void TraceReader::close()
+{
+    if(_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+    _index.clear();
+    _data.clear();
+    _chunk = 0;
+    _offset = 0;
+    _chunkLoaded = false;
+    _recordIndex = 0;
+}
+
+bool TraceReader::readIndex()
+{
+    auto size = fileSize(_file);
+    uint8_t trailer[TRAILER_SIZE];
+    if(size < HEADER_SIZE + TRAILER_SIZE || !seekFile(_file, size - TRAILER_SIZE) || std::fread(trailer, 1, TRAILER_SIZE, _file) != TRAILER_SIZE || get32(trailer + 8) != END_MAGIC)
+        return false;
+    auto indexOffset = get64(trailer);
+    uint8_t indexHeader[8];
+    if(indexOffset >= size || !seekFile(_file, indexOffset) || std::fread(indexHeader, 1, 8, _file) != 8 || get32(indexHeader) != INDEX_MAGIC)
+        return false;
+    auto count = get32(indexHeader + 4);
+    if(count * (8 + CHUNK_HEADER_SIZE) > size - indexOffset)
+        return false;
+    std::vector<uint8_t> entries(count * (8 + CHUNK_HEADER_SIZE));
+    if(std::fread(entries.data(), 1, entries.size(), _file) != entries.size())
+        return false;
+    _index.resize(count);
+    for(size_t i = 0; i < count; ++i) {
+        const auto* entry = entries.data() + i * (8 + CHUNK_HEADER_SIZE);
+        _index[i].offset = get64(entry);
+        if(!unpackChunkInfo(entry + 8, _index[i])) {
+            _index.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TraceReader::rebuildIndex()
+{
+    auto size = fileSize(_file);
+    uint64_t offset = HEADER_SIZE;
+    uint8_t header[CHUNK_HEADER_SIZE];
+    _index.clear();
+    while(offset + CHUNK_HEADER_SIZE <= size && seekFile(_file, offset) && std::fread(header, 1, CHUNK_HEADER_SIZE, _file) == CHUNK_HEADER_SIZE) {
+        TraceFile::ChunkInfo info;
+        if(!unpackChunkInfo(header, info) || offset + CHUNK_HEADER_SIZE + info.compressedSize > size)
+            break;
+        info.offset = offset;
+        _index.push_back(info);
+        offset += CHUNK_HEADER_SIZE + info.compressedSize;
+    }
+    return offset > HEADER_SIZE || size == HEADER_SIZE;
+}
+
+bool TraceReader::loadChunk(size_t chunk)
+{
+    const auto& info = _index[chunk];
+    _compressed.resize(info.compressedSize);
+    _data.resize(info.records * TraceFile::RECORD_SIZE);
+    auto size = mz_ulong(_data.size());
+    if(!seekFile(_file, info.offset + CHUNK_HEADER_SIZE) || std::fread(_compressed.data(), 1, _compressed.size(), _file) != _compressed.size() ||
+        mz_uncompress(_data.data(), &size, _compressed.data(), mz_ulong(_compressed.size())) != MZ_OK || size != _data.size()) {
+        _errorMessage = "Could not decompress trace chunk " + std::to_string(chunk);
+        return false;
+    }
+    _chunk = chunk;
+    _offset = 0;
+    _chunkLoaded = true;
+    _recordIndex = info.firstRecord;
+    _frameBase = info.firstFrame & ~uint64_t(0xffff);
+    _lastFrame = uint16_t(info.firstFrame);
+    return true;
+}
+
+void TraceReader::seekCycle(uint64_t cycle)
+{
+    _minCycle = cycle;
+    _minFrame = 0;
+    auto iter = std::find_if(_index.begin(), _index.end(), [cycle](const TraceFile::ChunkInfo& info) { return info.lastCycle >= cycle; });
+    _chunk = size_t(iter - _index.begin());
+    _chunkLoaded = false;
+}
+
+void TraceReader::seekFrame(uint64_t frame)
+{
+    _minCycle = 0;
+    _minFrame = frame;
+    auto iter = std::find_if(_index.begin(), _index.end(), [frame](const TraceFile::ChunkInfo& info) { return info.lastFrame >= frame; });
+    _chunk = size_t(iter - _index.begin());
+    _chunkLoaded = false;
+}
+
+bool TraceReader::next(TraceRecord& record)
+{
+    while(true) {
+        if(!_chunkLoaded || _offset >= _data.size()) {
+            auto chunk = _chunkLoaded ? _chunk + 1 : _chunk;
+            if(chunk >= _index.size() || !loadChunk(chunk))
+                return false;
+        }
+        bool valid = TraceFile::unpackRecord(_data.data() + _offset, record);
+        _offset += TraceFile::RECORD_SIZE;
+        ++_recordIndex;
+        if(record.frame < _lastFrame)
+            _frameBase += 0x10000;
+        _lastFrame = record.frame;
+        _frame = _frameBase + record.frame;
+        if(valid && uint64_t(record.cycle) >= _minCycle && _frame >= _minFrame)
+            return true;
+    }
+}
+
+}
@@ -0,0 +1,176 @@
+//---------------------------------------------------------------------------------------
+// src/emulation/tracefile.hpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+#pragma once
+
+#include <emulation/logger.hpp>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace emu {
+
+//---------------------------------------------------------------------------------------
+// Chunked binary trace file layout (all values little endian):
+//
+//   header:  "C8TR" u16 version, u16 record size
+//   chunk:   "C8TC" u32 record count, u32 compressed size, u64 first record,
+//            u64 lowest cycle, u64 highest cycle, u64 first frame, u64 last frame,
+//            deflate compressed packed records
+//   index:   "C8TI" u32 chunk count, chunk count * (u64 file offset + chunk header)
+//   trailer: u64 index offset, "C8TE"
+//
+// Frames are stored unwrapped, so the index can be searched by frame as well as by
+// cycle. The cycle unit depends on the record source (real cores count CHIP-8
+// instructions but CPU clock cycles), so a chunk stores the smallest and largest cycle
+// of all its records and cycles are only ordered within one source. A file without
+// trailer (e.g. from an aborted run) is still readable, the reader rebuilds the index
+// by walking the chunk headers.
+//---------------------------------------------------------------------------------------
+class TraceFile
+{
+public:
+    enum Kind : uint8_t { eUNKNOWN, eCHIP8, eCHIP8_REAL, eCDP1802, eM6800 };
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t RECORD_SIZE = 64;
+    static constexpr size_t CHUNK_RECORDS = 65536;
+    struct ChunkInfo
+    {
+        uint64_t offset{0};
+        uint32_t records{0};
+        uint32_t compressedSize{0};
+        uint64_t firstRecord{0};
+        uint64_t firstCycle{0};
+        uint64_t lastCycle{0};
+        uint64_t firstFrame{0};
+        uint64_t lastFrame{0};
+    };
+    static Kind kindOf(const TraceRecord& record);
+    static void packRecord(const TraceRecord& record, uint8_t* dest);
+    static bool unpackRecord(const uint8_t* src, TraceRecord& record);
+    // the opcode used for filtering, 16 bit for CHIP-8 records, the first byte otherwise
+    static uint16_t opcodeOf(const TraceRecord& record);
+};
+
+//---------------------------------------------------------------------------------------
+// Streams trace records into a trace file. Records are packed into chunks on the
+// calling thread, compression and file output happen on a background thread. The
+// number of chunks in flight is bounded, so a slow disk throttles the emulation
+// instead of growing memory. Install it as logger to capture Logger::trace() output,
+// plain text log messages are not part of the binary trace.
+//---------------------------------------------------------------------------------------
+class TraceWriter : public Logger
+{
+public:
+    static constexpr size_t MAX_PENDING_CHUNKS = 4;
+    TraceWriter() = default;
+    ~TraceWriter() override;
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const std::string& filename);
+    bool close();
+    bool isOpen() const { return _file != nullptr; }
+    void write(const TraceRecord& record);
+    uint64_t records() const { return _records; }
+
+    void doLog(Source source, emu::cycles_t cycle, FrameTime frameTime, const char* msg) override {}
+    void doTrace(const TraceRecord& record) override { write(record); }
+
+private:
+    struct Chunk
+    {
+        TraceFile::ChunkInfo info;
+        std::vector<uint8_t> data;
+    };
+    void flushChunk();
+    void compressWorker();
+    bool writeChunk(Chunk& chunk, std::vector<uint8_t>& buffer);
+    std::FILE* _file{nullptr};
+    Chunk _current;
+    uint64_t _records{0};
+    uint64_t _fileOffset{0};
+    uint64_t _frameBase{0};
+    uint16_t _lastFrame{0};
+    std::vector<TraceFile::ChunkInfo> _index;
+    std::deque<Chunk> _pending;
+    std::mutex _mutex;
+    std::condition_variable _pendingChanged;
+    std::thread _worker;
+    bool _finish{false};
+    bool _failed{false};
+};
+
+//---------------------------------------------------------------------------------------
+// Sequential reader for trace files, only one decompressed chunk is held in memory.
+// seekCycle()/seekFrame() use the chunk index to start reading near the given
+// position, records before it are skipped by next(). A cycle position is checked per
+// record, as the sources of a trace don't share the cycle unit.
+//---------------------------------------------------------------------------------------
+class TraceReader
+{
+public:
+    TraceReader() = default;
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    const std::string& errorMessage() const { return _errorMessage; }
+    const std::vector<TraceFile::ChunkInfo>& chunks() const { return _index; }
+    uint64_t records() const { return _index.empty() ? 0 : _index.back().firstRecord + _index.back().records; }
+    void seekCycle(uint64_t cycle);
+    void seekFrame(uint64_t frame);
+    bool next(TraceRecord& record);
+    // index and unwrapped frame of the record last returned by next()
+    uint64_t recordIndex() const { return _recordIndex - 1; }
+    uint64_t frame() const { return _frame; }
+
+private:
+    bool readIndex();
+    bool rebuildIndex();
+    bool loadChunk(size_t chunk);
+    std::FILE* _file{nullptr};
+    std::vector<TraceFile::ChunkInfo> _index;
+    std::vector<uint8_t> _compressed;
+    std::vector<uint8_t> _data;
+    size_t _chunk{0};
+    size_t _offset{0};
+    bool _chunkLoaded{false};
+    uint64_t _recordIndex{0};
+    uint64_t _minCycle{0};
+    uint64_t _minFrame{0};
+    uint64_t _frameBase{0};
+    uint16_t _lastFrame{0};
+    uint64_t _frame{0};
+    std::string _errorMessage;
+};
+
+}
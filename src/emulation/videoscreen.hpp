@@ -273,6 +273,28 @@ public:
     {
         _screenBuffer[y * _stride + x] &= ~mask;
     }
+    template<typename Writer>
+    void saveState(Writer& writer) const
+    {
+        writer.write(int32_t(_width));
+        writer.write(int32_t(_height));
+        writer.write(int32_t(_ratio));
+        writer.write(int32_t(_overlayCellHeight));
+        writer.write(int32_t(_overlayBackground));
+        writer.write(_colorOverlay);
+        writer.writeMemory(reinterpret_cast<const uint8_t*>(_screenBuffer.data()), _screenBuffer.size() * sizeof(PixelType));
+    }
+    template<typename Reader>
+    void loadState(Reader& reader)
+    {
+        _width = reader.template read<int32_t>();
+        _height = reader.template read<int32_t>();
+        _ratio = reader.template read<int32_t>();
+        _overlayCellHeight = reader.template read<int32_t>();
+        _overlayBackground = reader.template read<int32_t>();
+        reader.read(_colorOverlay);
+        reader.readMemory(reinterpret_cast<uint8_t*>(_screenBuffer.data()), _screenBuffer.size() * sizeof(PixelType));
+    }
 protected:
     static inline uint32_t blend(uint32_t color, uint8_t  alpha)
     {
@@ -39,7 +39,7 @@ namespace utf8 = ghc::utf8;
 
 LogView::LogView()
 {
-    _logBuffer.resize(HISTORY_SIZE);
+    _messages.resize(MESSAGE_HISTORY_SIZE);
     clear();
     setLogger(this);
 }
@@ -51,10 +51,11 @@ LogView::~LogView()
 
 void LogView::clear()
 {
-    for(auto& entry : _logBuffer) {
-        entry = {};
+    _traceBuffer.clear();
+    for(auto& message : _messages) {
+        message.clear();
     }
-    _writeIndex = 0;
+    _messageCount = 0;
     _usedSlots = 0;
     _tosLine = 0;
     _losCol = 0;
@@ -62,22 +63,44 @@ void LogView::clear()
 
 void LogView::doLog(LogView::Source source, emu::cycles_t cycle, FrameTime frameTime, const char* msg)
 {
-    auto& logEntry = _logBuffer[_writeIndex++];
-    logEntry = {cycle, frameTime, 0, source, msg};
-    if (_usedSlots < _logBuffer.size())
-        ++_usedSlots;
-    if (_writeIndex >= _logBuffer.size())
-        _writeIndex = 0;
-    _tosLine = _visibleLines >= _usedSlots ? 0 : _usedSlots - _visibleLines + 1;
+    // text messages are kept in their own ring, the trace only references them
+    _messages[_messageCount % MESSAGE_HISTORY_SIZE] = msg;
+    emu::TraceRecord record{};
+    record.cycle = cycle;
+    record.frame = frameTime.frame;
+    record.frameCycle = frameTime.cycle;
+    record.source = source;
+    record.messageIndex = _messageCount++;
+    doTrace(record);
+}
+
+void LogView::doTrace(const emu::TraceRecord& record)
+{
+    _traceBuffer.push(record);
+    _usedSlots = _traceBuffer.size();
+    updateTopLine();
 #if !defined(NDEBUG) && defined(FULL_CONSOLE_TRACE)
-    auto content = logEntry._source != eHOST ? fmt::format("[{:02x}:{:04x}] {}", (int)logEntry._frameTime.frame, (int)logEntry._frameTime.cycle, logEntry._line) : fmt::format("[    ] {}", logEntry._line);
-    std::cout << content << std::endl;
-#else
-    //auto content = logEntry._source != eHOST ? fmt::format("[{:02x}:{:04x}] {}", (int)logEntry._frameTime.frame, (int)logEntry._frameTime.cycle, logEntry._line) : fmt::format("[    ] {}", logEntry._line);
-    //std::cout << content << std::endl;
+    std::cout << formatLine(record) << std::endl;
 #endif
 }
 
+void LogView::updateTopLine()
+{
+    _tosLine = _visibleLines >= _usedSlots ? 0 : _usedSlots - _visibleLines + 1;
+}
+
+std::string LogView::formatLine(const emu::TraceRecord& record) const
+{
+    std::string text;
+    if(record.formatter) {
+        text = record.format(_disassembler);
+    }
+    else if(record.messageIndex + MESSAGE_HISTORY_SIZE >= _messageCount) {
+        text = _messages[record.messageIndex % MESSAGE_HISTORY_SIZE];
+    }
+    return record.source != eHOST ? fmt::format("[{:02x}:{:03x}] {}", record.frame & 0xff, (int)record.frameCycle, text) : fmt::format("[    ] {}", text);
+}
+
 void LogView::draw(Font& font, Rectangle rect)
 {
     using namespace gui;
@@ -114,15 +137,11 @@ Rectangle LogView::drawToolArea()
 
 void LogView::drawTextLine(Font& font, int logLine, Vector2 position, float width, int columnOffset)
 {
-    if(logLine < _usedSlots) {
-        logLine = _writeIndex - _usedSlots + logLine;
-        if(logLine < 0)
-            logLine += HISTORY_SIZE;
-
+    emu::TraceRecord record;
+    if(logLine < _usedSlots && _traceBuffer.read(_traceBuffer.first() + logLine, record)) {
         float textOffsetX = 0.0f;
         size_t index = 0;
-        auto& logEntry = _logBuffer[logLine];
-        auto content = logEntry._source != eHOST ? fmt::format("[{:02x}:{:03x}] {}", (int)logEntry._frameTime.frame, (int)logEntry._frameTime.cycle, logEntry._line) : fmt::format("[    ] {}", logEntry._line);
+        auto content = formatLine(record);
         const char* text = content.data();
         const char* end = text + content.size();
         while(text < end && textOffsetX < width && *text != '\n') {
@@ -34,6 +34,7 @@ class LogView : public emu::Logger
 {
 public:
     static constexpr size_t HISTORY_SIZE = 16384;
+    static constexpr size_t MESSAGE_HISTORY_SIZE = 1024;
     static constexpr int LINE_SIZE = 12;
     static constexpr int COLUMN_WIDTH = 6;
     LogView();
@@ -42,28 +43,28 @@ public:
     void clear();
 
     void doLog(Source source, emu::cycles_t cycle, FrameTime frameTime, const char* msg) override;
+    void doTrace(const emu::TraceRecord& record) override;
     void draw(Font& font, Rectangle rect);
+    // emulator used to disassemble CHIP-8 opcodes of trace records while formatting
+    void setDisassembler(const emu::IChip8Emulator* chip8) { _disassembler = chip8; }
 
     static LogView* instance();
 
 private:
     Rectangle drawToolArea();
     void drawTextLine(Font& font, int logLine, Vector2 position, float width, int columnOffset);
-    struct LogEntry {
-        emu::cycles_t _cycle{0};
-        FrameTime _frameTime{0,0};
-        uint64_t _hash{0};
-        Source _source{eHOST};
-        std::string _line;
-    };
-    std::vector<LogEntry> _logBuffer;
+    std::string formatLine(const emu::TraceRecord& record) const;
+    void updateTopLine();
+    emu::TraceBuffer _traceBuffer{HISTORY_SIZE};
+    std::vector<std::string> _messages;
+    uint64_t _messageCount{0};
+    const emu::IChip8Emulator* _disassembler{nullptr};
     std::string _filter;
     bool _invertedFilter{false};
     Rectangle _totalArea{};
     Rectangle _textArea{};
     Rectangle _toolArea{};
-    size_t _writeIndex;
-    size_t _usedSlots;
+    size_t _usedSlots{0};
     int _tosLine{0};
     int _losCol{0};
     uint32_t _visibleLines{0};
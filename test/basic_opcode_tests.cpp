@@ -26,9 +26,17 @@
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "chip8adapter.hpp"
 #include "chip8testhelper.hpp"
 
+#include <emulation/chip8emulatorbase.hpp>
+#include <emulation/lockstep.hpp>
+#include <emulation/opcodeprofiler.hpp>
+#include <emulation/rewindbuffer.hpp>
+
 #ifdef TEST_CHIP8DREAM
 #define TIMER_DEFAULT -1
 #else
@@ -496,4 +504,341 @@ TEST_CASE(C8CORE "Fx65 - load vx")
     CheckState(chip8, {.i = -1, .pc= 0x204, .sp = 0, .dt = TIMER_DEFAULT, .st = TIMER_DEFAULT, .v = {0x33,0x99,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0}, .stack = {}}, "load v1");
 }
 
+TEST_CASE(C8CORE "saveState()/loadState() - restore snapshot")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0x6032, 0xA400, 0x2208, 0x0000, 0x7105, 0xF155});
+    step(chip8);
+    step(chip8);
+    std::vector<uint8_t> state;
+    REQUIRE(chip8->saveState(state));
+    step(chip8);
+    step(chip8);
+    step(chip8);
+    CheckState(chip8, {.i = -1, .pc= 0x20c, .sp = 1, .dt = TIMER_DEFAULT, .st = TIMER_DEFAULT, .v = {0x32,0x05,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0}, .stack = {0x206,0}}, "after three more steps");
+    CHECK(chip8->memory()[0x401] == 0x05);
+    REQUIRE(chip8->loadState(state.data(), state.size()));
+    CheckState(chip8, {.i = 0x400, .pc= 0x204, .sp = 0, .dt = TIMER_DEFAULT, .st = TIMER_DEFAULT, .v = {0x32,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0}, .stack = {}}, "restored state");
+    CHECK(chip8->memory()[0x401] == 0);
+    step(chip8);
+    CheckState(chip8, {.i = 0x400, .pc= 0x208, .sp = 1, .dt = TIMER_DEFAULT, .st = TIMER_DEFAULT, .v = {0x32,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0}, .stack = {0x206,0}}, "call after restore");
+    // rejected blobs must not leave a partially restored core behind
+    CHECK_FALSE(chip8->loadState(state.data(), state.size() - 7));
+    auto corrupted = state;
+    corrupted[corrupted.size() / 2] ^= 0x10;
+    CHECK_FALSE(chip8->loadState(corrupted.data(), corrupted.size()));
+    CheckState(chip8, {.i = 0x400, .pc= 0x208, .sp = 1, .dt = TIMER_DEFAULT, .st = TIMER_DEFAULT, .v = {0x32,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0}, .stack = {0x206,0}}, "after rejected loads");
+    state[0] ^= 0xFF;
+    CHECK_FALSE(chip8->loadState(state.data(), state.size()));
+}
+
+TEST_CASE(C8CORE "RewindBuffer - step back through captured frames")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0x7001, 0xA400, 0xF055, 0x1200});
+    emu::RewindBuffer rewind(emu::RewindBuffer::DEFAULT_MEMORY_BUDGET, 4);
+    REQUIRE(rewind.capture(*chip8));
+    for(int i = 0; i < 10; ++i) {
+        step(chip8);
+        step(chip8);
+        step(chip8);
+        step(chip8);
+        REQUIRE(rewind.capture(*chip8));
+    }
+    CHECK(rewind.frames() == 11);
+    CHECK(chip8->getV(0) == 10);
+    std::vector<uint8_t> state;
+    REQUIRE(rewind.stateAt(2, state));
+    for(int i = 10; i > 0; --i) {
+        REQUIRE(rewind.stepBack(*chip8));
+        CHECK(chip8->getV(0) == i - 1);
+        CHECK(chip8->getPC() == 0x200);
+        CHECK(chip8->memory()[0x400] == i - 1);
+    }
+    CHECK(rewind.frames() == 1);
+    CHECK_FALSE(rewind.stepBack(*chip8));
+    REQUIRE(chip8->loadState(state.data(), state.size()));
+    CHECK(chip8->getV(0) == 2);
+}
+
+TEST_CASE(C8CORE "RewindBuffer - truncate and replay information")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0x7001, 0x1200});
+    emu::RewindBuffer rewind(emu::RewindBuffer::DEFAULT_MEMORY_BUDGET, 3);
+    for(int i = 0; i < 8; ++i) {
+        REQUIRE(rewind.capture(*chip8, {chip8->getCycles(), chip8->getCycles(), uint16_t(1 << i)}));
+        step(chip8);
+        step(chip8);
+    }
+    CHECK(rewind.frameInfo(5).keys == 0x20);
+    rewind.truncate(5);
+    CHECK(rewind.frames() == 5);
+    std::vector<uint8_t> state;
+    REQUIRE(rewind.stateAt(4, state));
+    REQUIRE(rewind.previousState(4, state));
+    REQUIRE(chip8->loadState(state.data(), state.size()));
+    CHECK(chip8->getV(0) == 3);
+    REQUIRE(rewind.capture(*chip8));
+    REQUIRE(rewind.stepBack(*chip8));
+    CHECK(chip8->getV(0) == 4);
+}
+
+TEST_CASE(C8CORE "RewindBuffer - a page turning non-zero only costs its own delta")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x600, {0x1234, 0x5678});
+    emu::RewindBuffer rewind(emu::RewindBuffer::DEFAULT_MEMORY_BUDGET, 100);
+    REQUIRE(rewind.capture(*chip8));
+    chip8->memory()[0x300] = 0x42;
+    REQUIRE(rewind.capture(*chip8));
+    chip8->memory()[0x300] = 0;
+    REQUIRE(rewind.capture(*chip8));
+    CHECK(rewind.deltaSize(1) < 32);
+    CHECK(rewind.deltaSize(2) < 32);
+    REQUIRE(rewind.stepBack(*chip8));
+    CHECK(chip8->memory()[0x300] == 0x42);
+    CHECK(chip8->memory()[0x601] == 0x34);
+    REQUIRE(rewind.stepBack(*chip8));
+    CHECK(chip8->memory()[0x300] == 0);
+    CHECK(chip8->memory()[0x601] == 0x34);
+}
+
+TEST_CASE(C8CORE "RewindBuffer - rebuilt snapshots are byte identical to saveState()")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    // i walks over pages 3 and 4, so pages turn non-zero and are cleared again below
+    write(chip8, 0x200, {0x7040, 0xA300, 0xF01E, 0xF01E, 0xF055, 0x1200});
+    emu::RewindBuffer rewind(emu::RewindBuffer::DEFAULT_MEMORY_BUDGET, 5);
+    std::vector<std::vector<uint8_t>> originals;
+    for(int i = 0; i < 24; ++i) {
+        if(i % 8 == 7)
+            std::memset(chip8->memory() + 0x300, 0, 0x200);
+        originals.emplace_back();
+        REQUIRE(chip8->saveState(originals.back()));
+        REQUIRE(rewind.capture(*chip8));
+        for(int j = 0; j < 6; ++j)
+            step(chip8);
+    }
+    std::vector<uint8_t> state;
+    for(size_t i = 0; i < originals.size(); ++i) {
+        INFO("frame " << i);
+        REQUIRE(rewind.stateAt(i, state));
+        CHECK(state == originals[i]);
+        if(i) {
+            state = originals[i];
+            REQUIRE(rewind.previousState(i, state));
+            CHECK(state == originals[i - 1]);
+        }
+    }
+}
+
+TEST_CASE(C8CORE "Reset - repeated resets reach identical post-boot state")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    std::vector<uint8_t> first, second;
+    REQUIRE(chip8->saveState(first));
+    write(chip8, 0x200, {0x7001, 0x1200});
+    step(chip8);
+    chip8->reset();
+    REQUIRE(chip8->saveState(second));
+    CHECK(first == second);
+    CHECK(chip8->getPC() == 0x200);
+}
+
+TEST_CASE(C8CORE "OpcodeProfiler - counts executed opcodes")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    CHECK(chip8->opcodeProfiler() == nullptr);
+    chip8->setOpcodeProfiling(true);
+    REQUIRE(chip8->opcodeProfiler() != nullptr);
+    write(chip8, 0x200, {0x6005, 0x7001, 0x7001, 0x7001, 0x1208});
+    for(int i = 0; i < 6; ++i)
+        step(chip8);
+    // real cores attribute an instruction on the next fetch, so keep the checks loose
+    const auto* profiler = chip8->opcodeProfiler();
+    CHECK(profiler->entry(0x7001).count >= 2);
+    CHECK(profiler->entry(0x7002).count == 0);
+    auto profile = chip8->opcodeProfile();
+    REQUIRE_FALSE(profile.empty());
+    CHECK(profile.front().pattern == "7xnn");
+    CHECK(profile.front().count == profiler->entry(0x7001).count);
+    chip8->setOpcodeProfiling(false);
+    CHECK(chip8->opcodeProfiler() == nullptr);
+    CHECK(chip8->opcodeProfile().empty());
+}
+
+TEST_CASE(C8CORE "MemoryHeatmap - counts executions, reads and writes")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    CHECK(chip8->memoryHeatmap() == nullptr);
+    chip8->setMemoryHeatmap(true);
+    REQUIRE(chip8->memoryHeatmap() != nullptr);
+    write(chip8, 0x200, {0xA300, 0xF255, 0xA300, 0xF165, 0xA300, 0xD012});
+    for(int i = 0; i < 6; ++i)
+        step(chip8);
+    const auto* heatmap = chip8->memoryHeatmap();
+    CHECK(heatmap->cell(0x200).exec == 1);
+    CHECK(heatmap->cell(0x202).exec == 1);
+    CHECK(heatmap->cell(0x201).exec == 0);
+    CHECK(heatmap->cell(0x300).writes == 1);
+    CHECK(heatmap->cell(0x302).writes == 1);
+    CHECK(heatmap->cell(0x303).writes == 0);
+    CHECK(heatmap->cell(0x300).reads == 2);
+    CHECK(heatmap->cell(0x301).reads == 2);
+    CHECK(heatmap->cell(0x302).reads == 0);
+    auto json = heatmap->toJSON([](uint32_t address) { return address < 0x300 ? int(address - 0x200) / 2 : -1; });
+    CHECK(json["lines"].size() == 6);
+    chip8->setMemoryHeatmap(false);
+    CHECK(chip8->memoryHeatmap() == nullptr);
+}
+
+TEST_CASE(C8CORE "LockstepRunner - finds first divergent instruction")
+{
+    auto chipA = createChip8Instance();
+    auto chipB = createChip8Instance();
+    chipA->reset();
+    chipB->reset();
+    write(chipA, 0x200, {0x6001, 0x7001, 0x1202});
+    write(chipB, 0x200, {0x6001, 0x7002, 0x1202});
+    chipA->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chipB->setExecMode(emu::IChip8Emulator::eRUNNING);
+    emu::LockstepRunner::Options options;
+    options.instructionsPerFrame = 10;
+    options.memoryStart = 0x300;  // keep the differing program out of the compared range
+    // real cores need to be compared per instruction, generic ones get their frame replayed
+    options.granularity = chipA->isGenericEmulation() ? emu::LockstepRunner::eFRAME : emu::LockstepRunner::eINSTRUCTION;
+    emu::LockstepRunner lockstep(options);
+    lockstep.addCore("a", *chipA);
+    lockstep.addCore("b", *chipB);
+    CHECK_FALSE(lockstep.run(10));
+    const auto& divergence = lockstep.divergence();
+    REQUIRE(divergence);
+    CHECK(divergence->narrowed);
+    CHECK(divergence->frame == 0);
+    if(chipA->isGenericEmulation()) {
+        CHECK(divergence->step == 2);
+        CHECK(divergence->cores[0].lastOpcode == 0x7001);
+        CHECK(divergence->cores[1].lastOpcode == 0x7002);
+    }
+    REQUIRE_FALSE(divergence->differences.empty());
+    CHECK(divergence->differences.front().field == "V0");
+    CHECK(divergence->toJSON()["differences"].size() == divergence->differences.size());
+}
+
+TEST_CASE(C8CORE "Write tracking - reports the pages a program writes to")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0x6042, 0xA3A0, 0xF055, 0x1206});
+    REQUIRE(chip8->setWriteTracking(true));
+    std::vector<uint32_t> pages;
+    chip8->takeWrittenPages(pages);
+    CHECK_FALSE(pages.empty());
+    step(chip8);
+    step(chip8);
+    step(chip8);
+    chip8->takeWrittenPages(pages);
+    CHECK(std::find(pages.begin(), pages.end(), 3) != pages.end());
+    CHECK(chip8->memoryView()[0x3A0] == 0x42);
+    step(chip8);
+    chip8->takeWrittenPages(pages);
+    // the real cores keep the interpreter state in RAM, so only the generic ones write nothing
+    if(chip8->isGenericEmulation())
+        CHECK(pages.empty());
+    else
+        CHECK(std::find(pages.begin(), pages.end(), 3) == pages.end());
+    chip8->setWriteTracking(false);
+}
+
+TEST_CASE(C8CORE "Watchpoints - pause after a watched data access")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0xA300, 0x6042, 0xF055, 0xA310, 0xF065, 0x7001, 0x120A});
+    // breakpoints are kept by full address, 0x1204 must not alias 0x204
+    chip8->setBreakpoint(0x1204, {"high", emu::GenericCpu::BreakpointInfo::eTRANSIENT});
+    CHECK(chip8->hasBreakPoint(0x1204));
+    CHECK_FALSE(chip8->hasBreakPoint(0x204));
+    chip8->removeAllBreakpoints();
+    CHECK_FALSE(chip8->hasWatchpoints());
+    chip8->setWatchpoint(0x300, emu::GenericCpu::eWATCH_WRITE);
+    chip8->setWatchpoint(0x310, emu::GenericCpu::eWATCH_READ);
+    CHECK(chip8->getWatchpoint(0x300) == emu::GenericCpu::eWATCH_WRITE);
+    CHECK(chip8->hasWatchpoints());
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(20000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+    CHECK(chip8->isBreakpointTriggered());
+    CHECK(chip8->memory()[0x300] == 0x42);
+    CHECK(chip8->getPC() <= 0x206);
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(20000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+    CHECK(chip8->isBreakpointTriggered());
+    CHECK(chip8->getPC() <= 0x20A);
+    chip8->removeAllWatchpoints();
+    CHECK_FALSE(chip8->hasWatchpoints());
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(20000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::eRUNNING);
+    CHECK(chip8->getPC() >= 0x20A);
+}
+
+TEST_CASE(C8CORE "Breakpoints - conditions, hit counts and tracepoints")
+{
+    auto chip8 = createChip8Instance();
+    chip8->reset();
+    write(chip8, 0x200, {0x6000, 0x7001, 0x1202});
+    std::string error;
+    emu::GenericCpu::BreakpointInfo bpi{"loop"};
+    CHECK_FALSE(bpi.condition.compile("v0 ==", *chip8, error));
+    CHECK_FALSE(bpi.condition.compile("v0 == foo", *chip8, error));
+    CHECK(error == "unknown register 'foo'");
+    REQUIRE(bpi.condition.compile("V0 == 5 && (i | [0x203]) == 1", *chip8, error));
+    CHECK(bpi.condition.evaluate(*chip8) == 0);
+    chip8->setBreakpoint(0x202, bpi);
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(100000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+    CHECK(chip8->isBreakpointTriggered());
+    CHECK(chip8->getPC() == 0x202);
+    CHECK(chip8->getV(0) == 5);
+    CHECK(chip8->findBreakpoint(0x202)->hitCount == 1);
+    chip8->removeAllBreakpoints();
+    bpi.condition.clear();
+    bpi.ignoreCount = 9;
+    chip8->setBreakpoint(0x202, bpi);
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(100000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+    CHECK(chip8->getV(0) == 15);
+    chip8->removeAllBreakpoints();
+    bpi.ignoreCount = 0;
+    bpi.isTracepoint = true;
+    REQUIRE(bpi.logMessage.compile("{{v0}}={v0}", *chip8, error));
+    CHECK(bpi.logMessage.format(*chip8) == "{v0}=f");
+    chip8->setBreakpoint(0x202, bpi);
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->executeFor(100000);
+    CHECK(chip8->getExecMode() == emu::IChip8Emulator::eRUNNING);
+    CHECK(chip8->findBreakpoint(0x202)->hitCount > 10);
+    CHECK(chip8->logSource() == emu::Logger::eCHIP8);
+    auto hits = chip8->findBreakpoint(0x202)->hitCount;
+    chip8->suspendBreakpoints(true);
+    chip8->executeFor(100000);
+    CHECK(chip8->findBreakpoint(0x202)->hitCount == hits);
+    chip8->suspendBreakpoints(false);
+    chip8->executeFor(100000);
+    CHECK(chip8->findBreakpoint(0x202)->hitCount > hits);
+}
+
 TEST_SUITE_END();
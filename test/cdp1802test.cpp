@@ -47,7 +47,7 @@ int main()
     const uint8_t* end = code + sizeof(clockAsm);
     uint16_t addr = 0x02d8;
     while (code < end) {
-        auto [size, instruction] = emu::Cdp1802::disassembleInstruction(code, end);
+        auto [size, instruction] = emu::Cdp1802<>::disassembleInstruction(code, end);
         std::cout << fmt::format("{:04X}: ", addr);
         switch(size) {
             case 1: std::cout << fmt::format("{:02X}       ", *code); break;
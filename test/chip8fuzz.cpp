@@ -0,0 +1,469 @@
+//---------------------------------------------------------------------------------------
+// test/chip8fuzz.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2023, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+//
+// Randomized differential fuzzer for the CHIP-8 cores. Every test case is a
+// ROM made of a preamble that sets V0-VF and I, a random stream of valid
+// instruction snippets for the selected preset, an endless jump as end marker
+// and a data area. It is run on all cores supporting the preset and the final
+// registers, memory and screens are compared. A failing case is minimized and
+// written as reproducer ROM.
+//
+//---------------------------------------------------------------------------------------
+#include <emulation/chip8cores.hpp>
+#include <emulation/chip8strict.hpp>
+#include <emulation/chip8vip.hpp>
+#include <emulation/utility.hpp>
+#include "chip8adapter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include <fmt/format.h>
+#include <ghc/cli.hpp>
+
+namespace {
+
+constexpr uint16_t PROGRAM_START = 0x200;
+constexpr uint16_t PROGRAM_END = 0x300;
+constexpr uint16_t DATA_START = 0x300;
+constexpr uint16_t DATA_SIZE = 0x100;
+constexpr uint16_t IMAGE_END = 0x600;  // I can leave the data area by Fx1E, so memory is compared up to here
+constexpr int MAX_STEPS = 10000;
+
+using Rng = std::mt19937_64;
+using Snippet = std::vector<uint16_t>;
+
+struct FuzzProfile
+{
+    std::string name;
+    emu::Chip8EmulatorOptions::SupportedPreset preset;
+    bool realCores{false};  // strict and VIP take part, so only opcodes with identical font/timing behavior are used
+    bool schip{false};
+    bool xochip{false};
+};
+
+struct FuzzCase
+{
+    uint64_t index{0};
+    std::array<uint8_t, 16> v{};
+    uint16_t i{DATA_START};
+    std::vector<Snippet> snippets;
+    std::vector<uint8_t> data;
+    uint16_t endAddress() const
+    {
+        size_t size = 0;
+        for(const auto& snippet : snippets)
+            size += snippet.size();
+        return uint16_t(PROGRAM_START + (17 + size) * 2);
+    }
+    std::vector<uint8_t> rom() const
+    {
+        std::vector<uint16_t> code;
+        for(int x = 0; x < 16; ++x)
+            code.push_back(0x6000 | (x << 8) | v[x]);
+        code.push_back(0xA000 | i);
+        for(const auto& snippet : snippets)
+            code.insert(code.end(), snippet.begin(), snippet.end());
+        code.push_back(0x1000 | endAddress());
+        std::vector<uint8_t> image(IMAGE_END - PROGRAM_START, 0);
+        for(size_t n = 0; n < code.size(); ++n) {
+            image[n * 2] = code[n] >> 8;
+            image[n * 2 + 1] = code[n] & 0xff;
+        }
+        std::copy(data.begin(), data.end(), image.begin() + (DATA_START - PROGRAM_START));
+        return image;
+    }
+};
+
+inline uint8_t rndNibble(Rng& rng) { return rng() & 0xf; }
+inline uint8_t rndByte(Rng& rng) { return rng() & 0xff; }
+inline uint16_t rndDataAddress(Rng& rng) { return DATA_START + (rng() % (DATA_SIZE - 16)); }
+inline uint16_t xy(uint16_t opcode, Rng& rng) { return opcode | (rndNibble(rng) << 8) | (rndNibble(rng) << 4); }
+
+Snippet randomAlu(Rng& rng)
+{
+    static const uint16_t aluOps[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+    switch(rng() % 4) {
+        case 0: return {uint16_t(0x6000 | (rndNibble(rng) << 8) | rndByte(rng))};
+        case 1: return {uint16_t(0x7000 | (rndNibble(rng) << 8) | rndByte(rng))};
+        default: return {uint16_t(xy(0x8000, rng) | aluOps[rng() % 9])};
+    }
+}
+
+// I is always set into the data area right before an instruction that accesses memory,
+// so random streams can't overwrite the program or leave the compared image
+Snippet randomSnippet(Rng& rng, const FuzzProfile& profile)
+{
+    auto setI = uint16_t(0xA000 | rndDataAddress(rng));
+    auto x = rndNibble(rng);
+    switch(rng() % (profile.xochip ? 12 : profile.schip ? 10 : 8)) {
+        case 0:
+        case 1:
+            return randomAlu(rng);
+        case 2: {
+            static const uint16_t skips[] = {0x3000, 0x4000, 0x5000, 0x9000, 0xE09E, 0xE0A1};
+            auto skip = skips[rng() % 6];
+            Snippet result{uint16_t(skip < 0x5000 ? skip | (x << 8) | rndByte(rng) : skip < 0xE000 ? xy(skip, rng) : skip | (x << 8))};
+            auto alu = randomAlu(rng);
+            result.insert(result.end(), alu.begin(), alu.end());
+            return result;
+        }
+        case 3: {
+            static const uint16_t memoryOps[] = {0xF055, 0xF065, 0xF033, 0xF01E};
+            return {setI, uint16_t(memoryOps[rng() % 4] | (x << 8))};
+        }
+        case 4:
+        case 5:
+            return {setI, uint16_t(xy(0xD000, rng) | (profile.schip ? rndNibble(rng) : 1 + rng() % 15))};
+        case 6:
+            if(profile.realCores)
+                return {0x00E0};
+            return {uint16_t(0xF029 | (x << 8)), uint16_t(xy(0xD005, rng))};
+        case 7:
+            return {0x00E0};
+        case 8: {
+            static const uint16_t scrolls[] = {0x00FB, 0x00FC, 0x00FE, 0x00FF};
+            if(rng() & 1)
+                return {uint16_t(0x00C0 | (1 + rng() % 15))};
+            return {scrolls[rng() % 4]};
+        }
+        case 9:
+            return {uint16_t(0xF030 | (x << 8)), uint16_t(xy(0xD00A, rng))};
+        case 10:
+            return {uint16_t(0xF001 | ((1 + rng() % 3) << 8)), uint16_t(0x00D0 | (1 + rng() % 15))};
+        default:
+            if(rng() & 1)
+                return {0xF000, rndDataAddress(rng), uint16_t(0xF065 | (x << 8))};
+            return {setI, uint16_t(xy(rng() & 1 ? 0x5002 : 0x5003, rng))};
+    }
+}
+
+FuzzCase randomCase(Rng& rng, const FuzzProfile& profile, uint64_t index, int maxSnippets)
+{
+    FuzzCase fc;
+    fc.index = index;
+    for(auto& reg : fc.v)
+        reg = rndByte(rng);
+    fc.i = rndDataAddress(rng);
+    fc.data.resize(DATA_SIZE);
+    for(auto& byte : fc.data)
+        byte = rndByte(rng);
+    auto count = 1 + rng() % maxSnippets;
+    size_t size = 0;
+    while(fc.snippets.size() < count) {
+        auto snippet = randomSnippet(rng, profile);
+        // preamble (17 words) and end marker must fit in front of the data area
+        if(PROGRAM_START + (18 + size + snippet.size()) * 2 > PROGRAM_END)
+            break;
+        size += snippet.size();
+        fc.snippets.push_back(std::move(snippet));
+    }
+    return fc;
+}
+
+template<int addressLines>
+std::unique_ptr<emu::IChip8Emulator> createTemplatedCore(emu::Chip8EmulatorHost& host, emu::Chip8EmulatorOptions& options)
+{
+    using namespace emu;
+    switch((options.optAllowHires ? HiresSupport : 0) | (options.optAllowColors ? MultiColor : 0) | (options.optWrapSprites ? WrapSprite : 0)) {
+        case HiresSupport | MultiColor | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | MultiColor | WrapSprite>>(host, options);
+        case HiresSupport | MultiColor: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | MultiColor>>(host, options);
+        case HiresSupport | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | WrapSprite>>(host, options);
+        case HiresSupport: return std::make_unique<Chip8Emulator<addressLines, HiresSupport>>(host, options);
+        case MultiColor | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, MultiColor | WrapSprite>>(host, options);
+        case MultiColor: return std::make_unique<Chip8Emulator<addressLines, MultiColor>>(host, options);
+        case WrapSprite: return std::make_unique<Chip8Emulator<addressLines, WrapSprite>>(host, options);
+        default: return std::make_unique<Chip8Emulator<addressLines, 0>>(host, options);
+    }
+}
+
+//---------------------------------------------------------------------------------------
+// The cores of one worker thread, created up front on the main thread. Every set has
+// its own options and properties and the cores keep all their state per instance, the
+// boot state cache they share is locked, so the sets can run on concurrent threads.
+//---------------------------------------------------------------------------------------
+class CoreSet
+{
+public:
+    explicit CoreSet(const FuzzProfile& profile)
+        : _options(emu::Chip8EmulatorOptions::optionsOfPreset(profile.preset))
+        , _vipOptions(emu::Chip8EmulatorOptions::optionsOfPreset(emu::Chip8EmulatorOptions::eCHIP8VIP))
+        , _host(_options)
+    {
+        // display wait is a timing property, the generic cores are compared on semantics
+        _options.optInstantDxyn = true;
+        add("ts", _options.optHas16BitAddr ? createTemplatedCore<16>(_host, _options) : createTemplatedCore<12>(_host, _options));
+        add("fp", std::make_unique<emu::Chip8EmulatorFP>(_host, _options));
+        if(profile.realCores) {
+            add("strict", std::make_unique<emu::Chip8StrictEmulator>(_host, _options));
+            add("vip", std::make_unique<emu::Chip8VIP>(_host, _vipOptions));
+        }
+    }
+    size_t size() const { return _cores.size(); }
+    const std::string& name(size_t index) const { return _names[index]; }
+    emu::IChip8Emulator& core(size_t index) { return *_cores[index]; }
+    // returns an empty string if all cores agree, a description of the differences otherwise
+    std::string run(const FuzzCase& fc)
+    {
+        auto rom = fc.rom();
+        auto end = fc.endAddress();
+        for(auto& core : _cores) {
+            core->reset();
+            std::memcpy(core->memory() + PROGRAM_START, rom.data(), rom.size());
+            core->setExecMode(emu::IChip8Emulator::eRUNNING);
+            for(int step = 0; step < MAX_STEPS && core->getPC() != end && core->getExecMode() != emu::IChip8Emulator::ePAUSED; ++step)
+                core->executeInstruction();
+        }
+        return compare(end);
+    }
+
+private:
+    void add(const std::string& name, std::unique_ptr<emu::IChip8Emulator> core)
+    {
+        _names.push_back(name);
+        _cores.push_back(std::move(core));
+    }
+    static uint8_t pixel(emu::IChip8Emulator& core, int x, int y, int width, int height)
+    {
+        // cores differ in screen resolution (e.g. the VIP shows every CHIP-8 row on four lines), so sample the logical grid
+        const auto* screen = core.getScreen();
+        if(!screen)
+            return 0;
+        return screen->getPixel(x * core.getCurrentScreenWidth() / width, y * core.getCurrentScreenHeight() / height);
+    }
+    std::string compare(uint16_t end)
+    {
+        std::string result;
+        auto& ref = *_cores.front();
+        for(size_t n = 0; n < _cores.size(); ++n) {
+            auto& core = *_cores[n];
+            if(core.getPC() != end)
+                result += fmt::format("{}: did not reach the end marker, PC:{:04x}{}\n", _names[n], core.getPC(), core.inErrorState() ? " (" + core.errorMessage() + ")" : "");
+        }
+        if(!result.empty())
+            return result;
+        for(size_t n = 1; n < _cores.size(); ++n) {
+            auto& core = *_cores[n];
+            auto prefix = fmt::format("{} vs {}: ", _names.front(), _names[n]);
+            for(int x = 0; x < 16; ++x) {
+                if(ref.getV(x) != core.getV(x))
+                    result += prefix + fmt::format("V{:X} {:02x} != {:02x}\n", x, ref.getV(x), core.getV(x));
+            }
+            if(ref.getI() != core.getI())
+                result += prefix + fmt::format("I {:04x} != {:04x}\n", ref.getI(), core.getI());
+            for(uint32_t addr = PROGRAM_START; addr < IMAGE_END; ++addr) {
+                if(ref.memory()[addr] != core.memory()[addr]) {
+                    result += prefix + fmt::format("mem[{:04x}] {:02x} != {:02x}\n", addr, ref.memory()[addr], core.memory()[addr]);
+                    break;
+                }
+            }
+            int width = ref.getCurrentScreenWidth(), height = ref.getCurrentScreenHeight(), differing = 0;
+            for(int y = 0; y < height; ++y) {
+                for(int x = 0; x < width; ++x) {
+                    if(pixel(ref, x, y, width, height) != pixel(core, x, y, width, height))
+                        ++differing;
+                }
+            }
+            if(differing)
+                result += prefix + fmt::format("{} pixels differ\n", differing);
+        }
+        return result;
+    }
+    emu::Chip8EmulatorOptions _options;
+    emu::Chip8EmulatorOptions _vipOptions;
+    Chip8HeadlessTestHost _host;
+    std::vector<std::string> _names;
+    std::vector<std::unique_ptr<emu::IChip8Emulator>> _cores;
+};
+
+// greedy reduction: drop snippets, then clear registers and data bytes, as long as the cores still disagree
+FuzzCase minimize(CoreSet& cores, FuzzCase fc)
+{
+    bool reduced = true;
+    while(reduced) {
+        reduced = false;
+        for(size_t n = fc.snippets.size(); n-- > 0;) {
+            auto candidate = fc;
+            candidate.snippets.erase(candidate.snippets.begin() + n);
+            if(!cores.run(candidate).empty()) {
+                fc = std::move(candidate);
+                reduced = true;
+            }
+        }
+    }
+    for(auto& reg : fc.v) {
+        auto value = std::exchange(reg, 0);
+        if(value && cores.run(fc).empty())
+            reg = value;
+    }
+    for(auto& byte : fc.data) {
+        auto value = std::exchange(byte, 0);
+        if(value && cores.run(fc).empty())
+            byte = value;
+    }
+    return fc;
+}
+
+std::string listing(emu::IChip8Emulator& core, const FuzzCase& fc)
+{
+    auto rom = fc.rom();
+    std::string result;
+    for(uint16_t addr = PROGRAM_START; addr <= fc.endAddress();) {
+        const auto* code = rom.data() + (addr - PROGRAM_START);
+        auto [size, opcode, instruction] = core.disassembleInstruction(code, code + 4);
+        result += fmt::format("    {:04x}: {:04x}  {}\n", addr, opcode, instruction);
+        addr += size;
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    ghc::CLI cli(argc, argv);
+    bool version = false;
+    bool keepGoing = false;
+    int64_t cases = 10000;
+    int64_t threads = std::max(1u, std::thread::hardware_concurrency());
+    int64_t seed = 12345;
+    int64_t maxSnippets = 24;
+    std::string presets = "chip-8,schip-1.1,xo-chip";
+    std::string outputDir = ".";
+    cli.option({"-V", "--version"}, version, "display program version");
+    cli.option({"-n", "--cases"}, cases, "number of random test cases per preset, default: 10000");
+    cli.option({"-j", "--threads"}, threads, "number of worker threads, default: number of hardware threads");
+    cli.option({"-s", "--seed"}, seed, "base seed, test case n uses a generator seeded with (seed, n), default: 12345");
+    cli.option({"-p", "--presets"}, presets, "comma separated presets to fuzz (chip-8, chip-48, schip-1.0, schip-1.1 or xo-chip), default: chip-8,schip-1.1,xo-chip");
+    cli.option({"-o", "--output-dir"}, outputDir, "directory to write minimized reproducer ROMs into, default: .");
+    cli.option({"--max-snippets"}, maxSnippets, "maximum number of random instruction snippets per test case, default: 24");
+    cli.option({"--keep-going"}, keepGoing, "don't stop on the first failing test case");
+    cli.parse();
+
+    if(version) {
+        std::cout << "Chip8Fuzz v" << CHIP8FUZZ_VERSION << " [" << CHIP8FUZZ_GIT_HASH << "]" << std::endl;
+        exit(0);
+    }
+    if(threads < 1 || maxSnippets < 1) {
+        std::cerr << "ERROR: threads and max snippets need to be at least 1" << std::endl;
+        exit(1);
+    }
+
+    std::vector<FuzzProfile> profiles;
+    std::istringstream presetList(presets);
+    std::string presetName;
+    while(std::getline(presetList, presetName, ',')) {
+        FuzzProfile profile;
+        try {
+            profile.preset = emu::Chip8EmulatorOptions::presetForName(presetName);
+        }
+        catch(std::runtime_error& e) {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+            exit(1);
+        }
+        switch(profile.preset) {
+            case emu::Chip8EmulatorOptions::eCHIP8:
+            case emu::Chip8EmulatorOptions::eCHIP10:
+            case emu::Chip8EmulatorOptions::eCHIP48:
+            case emu::Chip8EmulatorOptions::eSCHIP10:
+            case emu::Chip8EmulatorOptions::eSCHIP11:
+            case emu::Chip8EmulatorOptions::eSCHPC:
+            case emu::Chip8EmulatorOptions::eSCHIP_MODERN:
+            case emu::Chip8EmulatorOptions::eXOCHIP:
+                break;
+            default:
+                std::cerr << "ERROR: preset '" << presetName << "' is not supported by the generic cores" << std::endl;
+                exit(1);
+        }
+        auto options = emu::Chip8EmulatorOptions::optionsOfPreset(profile.preset);
+        profile.name = presetName;
+        profile.realCores = profile.preset == emu::Chip8EmulatorOptions::eCHIP8;
+        profile.schip = options.optAllowHires;
+        profile.xochip = profile.preset == emu::Chip8EmulatorOptions::eXOCHIP;
+        profiles.push_back(profile);
+    }
+
+    if(!emu::fs::exists(outputDir))
+        emu::fs::create_directories(outputDir);
+
+    std::mutex outputMutex;
+    std::atomic<uint64_t> failures{0};
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& profile : profiles) {
+        std::vector<std::unique_ptr<CoreSet>> coreSets;
+        for(int64_t t = 0; t < threads; ++t)
+            coreSets.push_back(std::make_unique<CoreSet>(profile));
+        std::atomic<uint64_t> nextCase{0};
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> workers;
+        for(int64_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                auto& cores = *coreSets[t];
+                Rng rng;
+                uint64_t index;
+                while(!stop && (index = nextCase++) < uint64_t(cases)) {
+                    std::seed_seq seedSeq{uint64_t(seed), index};
+                    rng.seed(seedSeq);
+                    auto fc = randomCase(rng, profile, index, int(maxSnippets));
+                    if(cores.run(fc).empty())
+                        continue;
+                    if(!keepGoing)
+                        stop = true;
+                    ++failures;
+                    auto minimized = minimize(cores, fc);
+                    auto differences = cores.run(minimized);
+                    auto romFile = (emu::fs::path(outputDir) / fmt::format("fuzz-{}-{}.ch8", profile.name, index)).string();
+                    auto rom = minimized.rom();
+                    std::ofstream out(romFile, std::ios::binary);
+                    out.write((const char*)rom.data(), rom.size());
+                    std::lock_guard<std::mutex> guard(outputMutex);
+                    std::cerr << "Test case " << index << " of preset '" << profile.name << "' failed (seed " << seed << "), minimized from " << fc.snippets.size() << " to " << minimized.snippets.size() << " snippets:" << std::endl;
+                    std::cerr << differences << listing(cores.core(0), minimized);
+                    std::cerr << "Reproducer ROM: " << (out ? romFile : "could not be written") << std::endl;
+                }
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+        if(failures && !keepGoing)
+            break;
+        std::clog << "Preset '" << profile.name << "': " << std::min(nextCase.load(), uint64_t(cases)) << " test cases on " << coreSets.front()->size() << " cores." << std::endl;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    if(failures) {
+        std::cerr << fmt::format("{} failing test cases. [{:.2f}s]", failures.load(), (double)duration / 1000.0) << std::endl;
+        exit(1);
+    }
+    std::clog << fmt::format("No differences found. [{:.2f}s]", (double)duration / 1000.0) << std::endl;
+    return 0;
+}
@@ -26,14 +26,33 @@
 
 #include "fuzzer.hpp"
 
+#include <cstring>
+#include <fstream>
 #include <random>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FUZZER_USE_MMAP
+#endif
+
 namespace fuzz {
 
-static std::seed_seq g_seed{3457,236};
-static std::mt19937 g_rand{g_seed};
-static std::uniform_int_distribution<uint8_t> g_randomByte{0,0xFF};
-static std::uniform_int_distribution<uint16_t> g_randomWord{0,0xFFFF};
+static std::mt19937 defaultGenerator()
+{
+    std::seed_seq seed{3457,236};
+    return std::mt19937{seed};
+}
+
+static thread_local std::mt19937 g_rand{defaultGenerator()};
+static thread_local std::uniform_int_distribution<uint16_t> g_randomByte{0,0xFF};
+static thread_local std::uniform_int_distribution<uint16_t> g_randomWord{0,0xFFFF};
 
 void rndSeed(uint64_t seed)
 {
@@ -41,9 +60,15 @@ void rndSeed(uint64_t seed)
     g_rand.seed(seedSeq);
 }
 
+void rndSeed(uint64_t seed, uint64_t stream)
+{
+    auto seedSeq = std::seed_seq({uint32_t(seed), uint32_t(seed >> 32), uint32_t(stream), uint32_t(stream >> 32)});
+    g_rand.seed(seedSeq);
+}
+
 uint8_t rndByte()
 {
-    return g_randomByte(g_rand);
+    return static_cast<uint8_t>(g_randomByte(g_rand));
 }
 
 uint16_t rndWord()
@@ -51,7 +76,114 @@ uint16_t rndWord()
     return g_randomWord(g_rand);
 }
 
+static const char g_magic[4] = {'C', 'T', 'V', 'F'};
+
+bool TestVectorWriter::save(const std::string& filename) const
+{
+    BinaryWriter header;
+    header.bytes(reinterpret_cast<const uint8_t*>(g_magic), sizeof(g_magic));
+    header.u16(VERSION);
+    header.u16(_cpuId);
+    header.u32(static_cast<uint32_t>(_offsets.size()));
+    header.u64(HEADER_SIZE + _records.size());
+    BinaryWriter index;
+    for(auto offset : _offsets)
+        index.u64(HEADER_SIZE + offset);
+    std::ofstream os(filename, std::ios::binary);
+    if(!os)
+        return false;
+    os.write(reinterpret_cast<const char*>(header.data().data()), header.size());
+    os.write(reinterpret_cast<const char*>(_records.data().data()), _records.size());
+    os.write(reinterpret_cast<const char*>(index.data().data()), index.size());
+    return os.good();
+}
+
+TestVectorFile::TestVectorFile(const std::string& filename)
+{
+#if defined(FUZZER_USE_MMAP)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw FuzzerException("couldn't open test vector file: " + filename);
+    struct stat st{};
+    if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+        auto* mapping = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED) {
+            _mapping = mapping;
+            _data = static_cast<const uint8_t*>(mapping);
+            _size = st.st_size;
+        }
+    }
+    ::close(fd);
+#elif defined(_WIN32)
+    auto file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        throw FuzzerException("couldn't open test vector file: " + filename);
+    LARGE_INTEGER fileSize{};
+    if(::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        if(auto mapHandle = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+            if(auto* view = ::MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0)) {
+                _mapping = view;
+                _data = static_cast<const uint8_t*>(view);
+                _size = static_cast<size_t>(fileSize.QuadPart);
+            }
+            ::CloseHandle(mapHandle);
+        }
+    }
+    ::CloseHandle(file);
+#endif
+    if(!_mapping) {
+        std::ifstream is(filename, std::ios::binary);
+        if(!is)
+            throw FuzzerException("couldn't open test vector file: " + filename);
+        _buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        _data = _buffer.data();
+        _size = _buffer.size();
+    }
+    if(_size < TestVectorWriter::HEADER_SIZE || std::memcmp(_data, g_magic, sizeof(g_magic)) != 0)
+        throw FuzzerException("not a test vector file: " + filename);
+    BinaryReader header(_data + sizeof(g_magic), _size - sizeof(g_magic));
+    if(header.u16() != TestVectorWriter::VERSION)
+        throw FuzzerException("unsupported test vector file version: " + filename);
+    _cpuId = header.u16();
+    _count = header.u32();
+    _indexOffset = header.u64();
+    if(_indexOffset > _size || (_size - _indexOffset) / 8 < _count)
+        throw FuzzerException("corrupt test vector file: " + filename);
+}
+
+TestVectorFile::~TestVectorFile()
+{
+#if defined(FUZZER_USE_MMAP)
+    if(_mapping)
+        ::munmap(_mapping, _size);
+#elif defined(_WIN32)
+    if(_mapping)
+        ::UnmapViewOfFile(_mapping);
+#endif
+}
+
+bool TestVectorFile::isTestVectorFile(const std::string& filename)
+{
+    char magic[sizeof(g_magic)]{};
+    std::ifstream is(filename, std::ios::binary);
+    return is.read(magic, sizeof(magic)) && std::memcmp(magic, g_magic, sizeof(g_magic)) == 0;
+}
 
+uint64_t TestVectorFile::offset(size_t index) const
+{
+    BinaryReader r(_data + _indexOffset + index * 8, 8);
+    return r.u64();
+}
 
+BinaryReader TestVectorFile::record(size_t index) const
+{
+    if(index >= _count)
+        throw FuzzerException("test vector index out of range");
+    auto start = offset(index);
+    auto end = index + 1 < _count ? offset(index + 1) : _indexOffset;
+    if(start < TestVectorWriter::HEADER_SIZE || start > end || end > _indexOffset)
+        throw FuzzerException("corrupt test vector record");
+    return BinaryReader(_data + start, end - start);
 }
 
+}
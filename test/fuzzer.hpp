@@ -25,7 +25,10 @@
 //---------------------------------------------------------------------------------------
 #pragma once
 
+#include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <fmt/format.h>
 #include <nlohmann/json.hpp>
@@ -35,7 +38,11 @@ namespace fuzz {
 
 using json = nlohmann::ordered_json;
 
+// The random generator is thread local, every thread that generates test
+// cases needs to seed its own stream, rndSeed(seed, stream) gives independent
+// and reproducible streams e.g. per opcode and chunk of rounds.
 extern void rndSeed(uint64_t seed);
+extern void rndSeed(uint64_t seed, uint64_t stream);
 extern uint8_t rndByte();
 extern uint16_t rndWord();
 
@@ -124,13 +131,10 @@ struct FuzzerMemory
     }
     void writeByte(uint16_t addr, uint8_t val)
     {
-        static int c = 0;
         AccessType type = eWRITE;
         uint8_t* data = findAddr(addr, currentRam);
         if(data) {
             *data = val;
-            if(!isGenerating)
-                ++c;
         }
         else {
             if(!isGenerating)
@@ -240,4 +244,160 @@ inline void from_json(const json& j, FuzzerMemory::BusCycle& entry) {
     }
 }
 
+//---------------------------------------------------------------------------------------
+// Binary test vectors
+//---------------------------------------------------------------------------------------
+// A test vector file consists of a 20 byte header (magic "CTVF", u16 format
+// version, u16 cpu id, u32 record count, u64 offset of the record index),
+// followed by the records and an index of u64 record offsets. All values
+// are little-endian. Records are opaque to the container, the content
+// is defined by the fuzzer using it.
+
+class BinaryWriter
+{
+public:
+    void u8(uint8_t val) { _data.push_back(val); }
+    void u16(uint16_t val) { u8(val & 0xff); u8(val >> 8); }
+    void u32(uint32_t val) { u16(val & 0xffff); u16(val >> 16); }
+    void u64(uint64_t val) { u32(val & 0xffffffff); u32(val >> 32); }
+    void str(const std::string& val)
+    {
+        if(val.size() > 255)
+            throw FuzzerException("string too long for binary test vector");
+        u8(static_cast<uint8_t>(val.size()));
+        _data.insert(_data.end(), val.begin(), val.end());
+    }
+    void bytes(const uint8_t* data, size_t size) { _data.insert(_data.end(), data, data + size); }
+    const std::vector<uint8_t>& data() const { return _data; }
+    size_t size() const { return _data.size(); }
+    void clear() { _data.clear(); }
+private:
+    std::vector<uint8_t> _data;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t* data, size_t size) : _pos(data), _end(data + size) {}
+    uint8_t u8()
+    {
+        if(_pos >= _end)
+            throw FuzzerException("truncated binary test vector");
+        return *_pos++;
+    }
+    uint16_t u16() { auto lo = u8(); return lo | (u8() << 8); }
+    uint32_t u32() { uint32_t lo = u16(); return lo | (uint32_t(u16()) << 16); }
+    uint64_t u64() { uint64_t lo = u32(); return lo | (uint64_t(u32()) << 32); }
+    std::string str()
+    {
+        auto size = u8();
+        if(_end - _pos < size)
+            throw FuzzerException("truncated binary test vector");
+        std::string result(reinterpret_cast<const char*>(_pos), size);
+        _pos += size;
+        return result;
+    }
+private:
+    const uint8_t* _pos;
+    const uint8_t* _end;
+};
+
+class TestVectorWriter
+{
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 20;
+    explicit TestVectorWriter(uint16_t cpuId) : _cpuId(cpuId) {}
+    BinaryWriter& record()
+    {
+        _offsets.push_back(_records.size());
+        return _records;
+    }
+    void append(const TestVectorWriter& other)
+    {
+        auto base = _records.size();
+        for(auto offset : other._offsets)
+            _offsets.push_back(base + offset);
+        _records.bytes(other._records.data().data(), other._records.size());
+    }
+    size_t size() const { return _offsets.size(); }
+    bool save(const std::string& filename) const;
+private:
+    uint16_t _cpuId;
+    BinaryWriter _records;
+    std::vector<uint64_t> _offsets;
+};
+
+// Read only view of a test vector file, the file is memory-mapped where
+// the platform supports it and read into a buffer otherwise, records
+// can be accessed from multiple threads concurrently.
+class TestVectorFile
+{
+public:
+    explicit TestVectorFile(const std::string& filename);
+    ~TestVectorFile();
+    TestVectorFile(const TestVectorFile&) = delete;
+    TestVectorFile& operator=(const TestVectorFile&) = delete;
+    static bool isTestVectorFile(const std::string& filename);
+    uint16_t cpuId() const { return _cpuId; }
+    size_t size() const { return _count; }
+    BinaryReader record(size_t index) const;
+private:
+    uint64_t offset(size_t index) const;
+    const uint8_t* _data{nullptr};
+    size_t _size{};
+    uint16_t _cpuId{};
+    size_t _count{};
+    uint64_t _indexOffset{};
+    std::vector<uint8_t> _buffer;
+    void* _mapping{nullptr};
+};
+
+inline void to_binary(BinaryWriter& w, const FuzzerMemory::MemEntries& entries)
+{
+    if(entries.size() > 255)
+        throw FuzzerException("too many memory entries for binary test vector");
+    w.u8(static_cast<uint8_t>(entries.size()));
+    for(const auto& entry : entries) {
+        w.u16(entry.addr);
+        w.u8(entry.data);
+    }
+}
+
+inline void from_binary(BinaryReader& r, FuzzerMemory::MemEntries& entries)
+{
+    entries.resize(r.u8());
+    for(auto& entry : entries) {
+        entry.addr = r.u16();
+        entry.data = r.u8();
+    }
+}
+
+inline void to_binary(BinaryWriter& w, const FuzzerMemory::BusCycles& cycles)
+{
+    if(cycles.size() > 255)
+        throw FuzzerException("too many bus cycles for binary test vector");
+    w.u8(static_cast<uint8_t>(cycles.size()));
+    for(const auto& cycle : cycles) {
+        w.u16(cycle.addr);
+        w.u8(cycle.data);
+        w.u8(cycle.type == FuzzerMemory::eNONE ? 'n' : (cycle.type == FuzzerMemory::eREAD || cycle.type == FuzzerMemory::eADDITIONAL_READ ? 'r' : 'w'));
+    }
+}
+
+inline void from_binary(BinaryReader& r, FuzzerMemory::BusCycles& cycles)
+{
+    cycles.resize(r.u8());
+    for(auto& cycle : cycles) {
+        cycle.addr = r.u16();
+        cycle.data = r.u8();
+        switch(r.u8()) {
+            case 'n': cycle.type = FuzzerMemory::eNONE; break;
+            case 'r': cycle.type = FuzzerMemory::eREAD; break;
+            case 'w': cycle.type = FuzzerMemory::eWRITE; break;
+            default: throw FuzzerException("invalid bus cycle type in binary test vector");
+        }
+    }
+}
+
 }
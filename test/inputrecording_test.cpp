@@ -0,0 +1,66 @@
+//---------------------------------------------------------------------------------------
+// test/inputrecording_test.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+
+#include <doctest/doctest.h>
+
+#include "chip8adapter.hpp"
+#include "chip8testhelper.hpp"
+
+#include <emulation/chip8cores.hpp>
+#include <emulation/inputrecording.hpp>
+
+TEST_CASE("InputRecording - serialize and key lookup")
+{
+    auto options = emu::Chip8EmulatorOptions::optionsOfPreset(emu::Chip8EmulatorOptions::eCHIP8);
+    Chip8HeadlessTestHost host(options);
+    std::unique_ptr<emu::IChip8Emulator> chip8 = std::make_unique<emu::Chip8EmulatorFP>(host, options);
+    chip8->reset();
+    write(chip8, 0x200, {0x7001, 0x1200});
+    emu::InputRecording recording;
+    recording.start(options, "0123456789abcdef0123456789abcdef01234567", 4711, 815);
+    for(uint16_t keys : {0, 0, 0, 0x10, 0x10, 0x8001, 0}) {
+        recording.addFrame(keys);
+        step(chip8);
+    }
+    recording.finish(*chip8);
+    CHECK(recording.frames() == 7);
+    CHECK(recording.matchesEnd(*chip8));
+    std::vector<uint8_t> data;
+    REQUIRE(recording.serialize(data));
+    emu::InputRecording loaded;
+    REQUIRE(loaded.deserialize(data.data(), data.size()));
+    CHECK(loaded.romSha1Hex() == recording.romSha1Hex());
+    CHECK(loaded.randomSeed() == 4711);
+    CHECK(loaded.randomState() == 815);
+    CHECK(loaded.frames() == 7);
+    CHECK(loaded.keysForFrame(2) == 0);
+    CHECK(loaded.keysForFrame(3) == 0x10);
+    CHECK(loaded.keysForFrame(5) == 0x8001);
+    CHECK(loaded.keysForFrame(6) == 0);
+    CHECK(loaded.matchesEnd(*chip8));
+    step(chip8);
+    CHECK_FALSE(loaded.matchesEnd(*chip8));
+}
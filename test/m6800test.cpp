@@ -16,19 +16,26 @@
 #include "fuzzer.hpp"
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <stdexcept>
+#include <thread>
 
 #include <nlohmann/json.hpp>
 #include <ghc/cli.hpp>
 
 using json = nlohmann::ordered_json;
 
+static constexpr uint16_t M6800_CPU_ID = 0x6800;
+static std::mutex g_outputMutex;
+
 static const uint8_t dream6800Rom[] = {
     0x8d, 0x77, 0xce, 0x02, 0x00, 0xdf, 0x22, 0xce, 0x00, 0x5f, 0xdf, 0x24, 0xde, 0x22, 0xee, 0x00, 0xdf, 0x28, 0xdf, 0x14, 0xbd, 0xc0, 0xd0, 0x96, 0x14, 0x84, 0x0f, 0x97, 0x14, 0x8d, 0x21, 0x97, 0x2e, 0xdf, 0x2a, 0x96, 0x29, 0x44, 0x44, 0x44,
     0x44, 0x8d, 0x15, 0x97, 0x2f, 0xce, 0xc0, 0x48, 0x96, 0x28, 0x84, 0xf0, 0x08, 0x08, 0x80, 0x10, 0x24, 0xfa, 0xee, 0x00, 0xad, 0x00, 0x20, 0xcc, 0xce, 0x00, 0x2f, 0x08, 0x4a, 0x2a, 0xfc, 0xa6, 0x00, 0x39, 0xc0, 0x6a, 0xc0, 0xa2, 0xc0, 0xac,
@@ -99,6 +106,7 @@ struct FuzzState
         , testMemory(opcode)
     {}
     FuzzState(const json& test);
+    FuzzState(fuzz::BinaryReader& test);
     void reset()
     {
         refMemory.reset();
@@ -168,6 +176,56 @@ FuzzState::FuzzState(const json& test)
     from_json(test, *this);
 }
 
+static void to_binary(fuzz::BinaryWriter& w, const M6800State& state)
+{
+    w.u16(state.pc);
+    w.u16(state.sp);
+    w.u8(state.a);
+    w.u8(state.b);
+    w.u16(state.ix);
+    w.u8(state.cc);
+}
+
+static void from_binary(fuzz::BinaryReader& r, M6800State& state)
+{
+    state.pc = r.u16();
+    state.sp = r.u16();
+    state.a = r.u8();
+    state.b = r.u8();
+    state.ix = r.u16();
+    state.cc = r.u8();
+}
+
+void to_binary(fuzz::BinaryWriter& w, const FuzzState& state)
+{
+    w.str(state.name);
+    to_binary(w, state.initialState);
+    fuzz::to_binary(w, state.refMemory.initialRam);
+    to_binary(w, state.finalState);
+    fuzz::to_binary(w, state.refMemory.currentRam);
+    fuzz::to_binary(w, state.refMemory.cycles);
+}
+
+void from_binary(fuzz::BinaryReader& r, FuzzState& state)
+{
+    state.reset();
+    state.name = r.str();
+    from_binary(r, state.initialState);
+    fuzz::from_binary(r, state.refMemory.initialRam);
+    from_binary(r, state.finalState);
+    fuzz::from_binary(r, state.refMemory.currentRam);
+    fuzz::from_binary(r, state.refMemory.cycles);
+    state.finalState.cycles = state.refMemory.cycles.size();
+    state.finalState.instruction = 1;
+}
+
+FuzzState::FuzzState(fuzz::BinaryReader& test)
+    : refMemory(0)
+    , testMemory(0)
+{
+    from_binary(test, *this);
+}
+
 template<class CpuRef, class CpuTest, int MaxInstructionLength = 3>
 class M6800Fuzzer : public emu::M6800Bus<>
 {
@@ -179,9 +237,10 @@ public:
         , _state(opcode)
     {
     }
-    M6800Fuzzer(const json& test, fuzz::FuzzerMemory::CompareType strictness = fuzz::FuzzerMemory::eMEMONLY)
+    M6800Fuzzer(const FuzzState& test, fuzz::FuzzerMemory::CompareType strictness = fuzz::FuzzerMemory::eMEMONLY)
         : _cpuRef(*this)
         , _cpuTest(*this)
+        , _strictness(strictness)
         , _state(test)
     {
     }
@@ -196,14 +255,7 @@ public:
         }
         catch(fuzz::FuzzerException& fe)
         {
-            auto j = json(_state);
-            std::cerr << "name:        " << j.at("name") << std::endl;
-            std::cerr << "initial:     " << j.at("initial") << std::endl;
-            std::cerr << "final:       " << j.at("final") << std::endl;
-            std::cerr << "test ram:    " << json(_state.testMemory.currentRam) << std::endl;
-            std::cerr << "ref cycles:  " << j.at("cycles") << std::endl;
-            std::cerr << "test cycles: " << json(_state.testMemory.cycles) << std::endl;
-            std::cerr << fe.what() << std::endl;
+            reportError(fe);
             exportTestCase();
             return true;
         }
@@ -218,14 +270,7 @@ public:
         }
         catch(fuzz::FuzzerException& fe)
         {
-            auto j = json(_state);
-            std::cerr << "name:        " << j.at("name") << std::endl;
-            std::cerr << "initial:     " << j.at("initial") << std::endl;
-            std::cerr << "final:       " << j.at("final") << std::endl;
-            std::cerr << "test ram:    " << json(_state.testMemory.currentRam) << std::endl;
-            std::cerr << "ref cycles:  " << j.at("cycles") << std::endl;
-            std::cerr << "test cycles: " << json(_state.testMemory.cycles) << std::endl;
-            std::cerr << fe.what() << std::endl;
+            reportError(fe);
             return true;
         }
         return false;
@@ -236,8 +281,20 @@ public:
     }
 private:
     enum BusMode { eRESET, eGENERATE, eTEST, eDISASSEMBLE };
-    static uint8_t rndByte() { return _randomByte(_rand); }
-    static uint16_t rndWord() { return _randomWord(_rand); }
+    static uint8_t rndByte() { return fuzz::rndByte(); }
+    static uint16_t rndWord() { return fuzz::rndWord(); }
+    void reportError(const fuzz::FuzzerException& fe) const
+    {
+        std::lock_guard<std::mutex> lock(g_outputMutex);
+        auto j = json(_state);
+        std::cerr << "name:        " << j.at("name") << std::endl;
+        std::cerr << "initial:     " << j.at("initial") << std::endl;
+        std::cerr << "final:       " << j.at("final") << std::endl;
+        std::cerr << "test ram:    " << json(_state.testMemory.currentRam) << std::endl;
+        std::cerr << "ref cycles:  " << j.at("cycles") << std::endl;
+        std::cerr << "test cycles: " << json(_state.testMemory.cycles) << std::endl;
+        std::cerr << fe.what() << std::endl;
+    }
     void reset()
     {
         _mode = eRESET;
@@ -330,12 +387,7 @@ private:
     {
         return fnv1a64(reinterpret_cast<const uint8_t*>(str.data()), str.size());
     }
-    //inline static std::mt19937 _rand{std::random_device()()};
-    inline static std::seed_seq _seed{3457,236};
-    inline static std::mt19937 _rand{_seed};
-    inline static std::uniform_int_distribution<uint8_t> _randomByte{0,0xFF};
-    inline static std::uniform_int_distribution<uint16_t> _randomWord{0,0xFFFF};
-    inline static uint8_t _opcode{};
+    uint8_t _opcode{};
     CpuRef _cpuRef;
     CpuTest _cpuTest;
     mutable int _cycle;
@@ -346,50 +398,174 @@ private:
 };
 
 }
-inline static uint64_t g_testCaseCount{};
+
+static std::atomic<uint64_t> g_testCaseCount{};
+static std::atomic<bool> g_stop{false};
+
+static constexpr uint64_t ROUNDS_PER_CHUNK = 1000;
+
+enum class ExportFormat { eBINARY, eJSON };
+
+// All rounds of an opcode are split into chunks that are generated
+// independently, each chunk uses its own random stream derived from the
+// seed, opcode and chunk index, so the generated set does not depend on
+// the number of threads used.
+struct OpcodeJob
+{
+    uint8_t opcode{};
+    std::vector<std::vector<emu::FuzzState>> chunks;
+    std::atomic<size_t> pending{};
+    bool done{false};
+};
 
 template<typename RefCore, typename TestCore>
-void testOpcode(uint8_t opcode, uint64_t numRounds = 10000, fuzz::FuzzerMemory::CompareType strictness = fuzz::FuzzerMemory::eMEMONLY, std::string outputDir = "")
+bool testOpcodeChunk(OpcodeJob& job, size_t chunk, uint64_t numRounds, uint64_t seed, fuzz::FuzzerMemory::CompareType strictness, bool keepStates)
 {
-    //emu::M6800Fuzzer<emu::BikeNomadCore, emu::M6800<>> fuzzer;
-    //emu::M6800Fuzzer<emu::M6800<>, M6800TestCore> fuzzer(opcode);
-    emu::M6800Fuzzer<RefCore, TestCore> fuzzer(opcode, strictness);
-    //emu::M6800Fuzzer<emu::ExorSimCore, emu::M6800<>> fuzzer(opcode);
-    uint64_t rounds = 0;
-    auto testSet = json::array();
-    while(rounds < numRounds) {
-        //if(opcode == 0x36)
-        //    std::cerr << "BREAK" << std::endl;
-        if(fuzzer.execute(opcode)) {
-            std::cerr << "Error after " << rounds << " rounds in opcode " << fmt::format("0x{:02X}", opcode) << "." << std::endl;
-            std::clog << g_testCaseCount << " tests run." << std::endl;
-            exit(1);
-        }
-        else if(!outputDir.empty()) {
-            testSet.push_back(json(fuzzer.refState()));
+    emu::M6800Fuzzer<RefCore, TestCore> fuzzer(job.opcode, strictness);
+    fuzz::rndSeed(seed, (uint64_t(job.opcode) << 32) | chunk);
+    auto& states = job.chunks[chunk];
+    auto firstRound = chunk * ROUNDS_PER_CHUNK;
+    auto rounds = std::min(ROUNDS_PER_CHUNK, numRounds - firstRound);
+    if(keepStates)
+        states.reserve(rounds);
+    for(uint64_t round = 0; round < rounds && !g_stop; ++round) {
+        if(fuzzer.execute(job.opcode)) {
+            std::lock_guard<std::mutex> lock(g_outputMutex);
+            std::cerr << "Error after " << (firstRound + round) << " rounds in opcode " << fmt::format("0x{:02X}", job.opcode) << "." << std::endl;
+            return false;
         }
+        if(keepStates)
+            states.push_back(fuzzer.refState());
         ++g_testCaseCount;
-        ++rounds;
-    }
-    if(!outputDir.empty()) {
-        std::ostream* pos = &std::cout;
-        std::unique_ptr<std::ofstream> ofs;
-        if(outputDir != "-") {
-            if (!std::filesystem::exists(outputDir)) {
-                std::filesystem::create_directories(outputDir);
+    }
+    return true;
+}
+
+static void exportOpcode(OpcodeJob& job, const std::string& outputDir, ExportFormat format, bool& firstOnStdout)
+{
+    if(outputDir == "-") {
+        for(const auto& states : job.chunks) {
+            for(const auto& state : states) {
+                std::cout << (firstOnStdout ? "" : ",\n") << json(state);
+                firstOnStdout = false;
             }
-            ofs = std::make_unique<std::ofstream>(std::filesystem::path(outputDir) / fmt::format("{:02X}.json", opcode));
-            pos = ofs.get();
-            (*pos) << "[" << std::endl;
         }
-        int count = 0;
-        for(const auto& test : testSet) {
-            count++;
-            (*pos) << test << (count == testSet.size() ? "" : ",") << std::endl;
+    }
+    else if(format == ExportFormat::eBINARY) {
+        fuzz::TestVectorWriter writer(M6800_CPU_ID);
+        for(const auto& states : job.chunks) {
+            for(const auto& state : states)
+                to_binary(writer.record(), state);
+        }
+        auto file = std::filesystem::path(outputDir) / fmt::format("{:02X}.bin", job.opcode);
+        if(!writer.save(file.string())) {
+            std::cerr << "Couldn't write test vectors: '" << file.string() << "'" << std::endl;
+            g_stop = true;
+        }
+    }
+    else {
+        std::ofstream os(std::filesystem::path(outputDir) / fmt::format("{:02X}.json", job.opcode));
+        os << "[" << std::endl;
+        bool first = true;
+        for(const auto& states : job.chunks) {
+            for(const auto& state : states) {
+                os << (first ? "" : ",\n") << json(state);
+                first = false;
+            }
         }
-        if(outputDir != "-")
-            (*pos) << "]";
+        os << std::endl << "]";
     }
+    job.chunks.clear();
+    job.chunks.shrink_to_fit();
+}
+
+template<typename RefCore, typename TestCore>
+bool testOpcodes(const std::vector<uint8_t>& opcodes, uint64_t numRounds, uint64_t seed, int numThreads, fuzz::FuzzerMemory::CompareType strictness, const std::string& outputDir, ExportFormat format)
+{
+    auto numChunks = (numRounds + ROUNDS_PER_CHUNK - 1) / ROUNDS_PER_CHUNK;
+    std::vector<OpcodeJob> jobs(opcodes.size());
+    std::vector<std::pair<size_t, size_t>> work;
+    for(size_t i = 0; i < opcodes.size(); ++i) {
+        jobs[i].opcode = opcodes[i];
+        jobs[i].chunks.resize(numChunks);
+        jobs[i].pending = numChunks;
+        for(size_t chunk = 0; chunk < numChunks; ++chunk)
+            work.emplace_back(i, chunk);
+    }
+    bool keepStates = !outputDir.empty();
+    if(keepStates && outputDir != "-" && !std::filesystem::exists(outputDir))
+        std::filesystem::create_directories(outputDir);
+    std::atomic<size_t> nextWork{0};
+    std::mutex exportMutex;
+    size_t nextExport = 0;
+    bool firstOnStdout = true;
+    bool success = true;
+    auto worker = [&]() {
+        size_t index;
+        while(!g_stop && (index = nextWork++) < work.size()) {
+            auto [jobIndex, chunk] = work[index];
+            auto& job = jobs[jobIndex];
+            if(!testOpcodeChunk<RefCore, TestCore>(job, chunk, numRounds, seed, strictness, keepStates)) {
+                std::lock_guard<std::mutex> lock(exportMutex);
+                success = false;
+                g_stop = true;
+                return;
+            }
+            if(--job.pending == 0) {
+                // opcodes are exported in order, so whoever finishes a job
+                // writes out all consecutive finished ones
+                std::lock_guard<std::mutex> lock(exportMutex);
+                job.done = true;
+                while(nextExport < jobs.size() && jobs[nextExport].done) {
+                    if(keepStates && !g_stop)
+                        exportOpcode(jobs[nextExport], outputDir, format, firstOnStdout);
+                    ++nextExport;
+                }
+                std::lock_guard<std::mutex> outLock(g_outputMutex);
+                std::clog << fmt::format("    Opcode: {:02x}\r", job.opcode);
+                std::clog.flush();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for(int i = 1; i < numThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads)
+        thread.join();
+    return success && !g_stop;
+}
+
+template<typename TestCore>
+bool replayTests(size_t numTests, const std::function<emu::FuzzState(size_t)>& loadTest, int numThreads, fuzz::FuzzerMemory::CompareType strictness)
+{
+    std::atomic<size_t> nextTest{0};
+    auto worker = [&]() {
+        size_t index;
+        while(!g_stop && (index = nextTest++) < numTests) {
+            try {
+                emu::M6800Fuzzer<emu::M6800<>, TestCore> fuzzer(loadTest(index), strictness);
+                if(fuzzer.execute()) {
+                    g_stop = true;
+                    return;
+                }
+            }
+            catch(fuzz::FuzzerException& fe) {
+                std::lock_guard<std::mutex> lock(g_outputMutex);
+                std::cerr << "Invalid test case " << index << ": " << fe.what() << std::endl;
+                g_stop = true;
+                return;
+            }
+            ++g_testCaseCount;
+        }
+    };
+    std::vector<std::thread> threads;
+    for(int i = 1; i < numThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads)
+        thread.join();
+    return !g_stop;
 }
 
 /*
@@ -412,16 +588,22 @@ int main(int argc, char* argv[])
     std::string tstCoreName;
     std::string strictness;
     fuzz::FuzzerMemory::CompareType strictMode{fuzz::FuzzerMemory::eMEMONLY};
+    std::string exportFormat = "binary";
     int64_t rounds = 10000;
     int64_t opcodeToTest = -1;
+    int64_t seed = 3457;
+    int64_t threads = std::max(1u, std::thread::hardware_concurrency());
     bool listCores = false;
     bool version = false;
     bool testRef = false;
 
     cli.option({"-V", "--version"}, version, "display program version");
     cli.option({"-n", "--rounds"}, rounds, "rounds per opcode");
-    cli.option({"-o", "--output-dir"}, outputDir, "export test cases to output dir");
-    cli.option({"-t", "--test-file"}, testFile, "load JSON test file and run tests");
+    cli.option({"-o", "--output-dir"}, outputDir, "export test cases to output dir (\"-\" for JSON on stdout)");
+    cli.option({"-f", "--format"}, exportFormat, "export format of test cases (binary (default), json)");
+    cli.option({"-t", "--test-file"}, testFile, "load binary or JSON test file and run tests");
+    cli.option({"-j", "--threads"}, threads, "number of threads to use (default: number of cores)");
+    cli.option({"-s", "--seed"}, seed, "seed of the random test case generation");
     cli.option({"-l", "--list-cores"}, listCores, "list embedded test cores and exit");
     cli.option({"--test-reference"}, testRef, "run tests against the reference core");
     cli.option({"--strictness"}, strictness, "validating strictness besides cycles/state (memonly, writes, full)");
@@ -457,60 +639,77 @@ int main(int argc, char* argv[])
         }
     }
 
+    ExportFormat format{ExportFormat::eBINARY};
+    if(exportFormat == "json")
+        format = ExportFormat::eJSON;
+    else if(exportFormat != "binary") {
+        std::cerr << "Unknown export format (binary, json): " << exportFormat << std::endl;
+        exit(1);
+    }
+    if(threads < 1)
+        threads = 1;
+
+    bool useRefAsTest = testRef || std::is_same_v<M6800TestCore, emu::M6800Mock>;
     if(!testFile.empty()) {
-        std::ifstream f(testFile);
-        if(!f) {
-            std::cerr << "Couldn't read test file: '" << testFile << "'" << std::endl;
-            exit(1);
-        }
-        auto data = json::parse(f);
-        uint64_t count = 0;
-        auto start = std::chrono::steady_clock::now();
-        for(const auto& element : data) {
-            if(testRef || std::is_same_v<M6800TestCore, emu::M6800Mock>) {
-                emu::M6800Fuzzer<emu::M6800<>, emu::M6800<>> fuzzer(element, strictMode);
-                if (fuzzer.execute()) {
-                    std::cerr << "Stopped on error." << std::endl;
-                    std::clog << count << " tests run." << std::endl;
-                    exit(1);
-                }
+        std::unique_ptr<fuzz::TestVectorFile> vectors;
+        json data;
+        try {
+            if(fuzz::TestVectorFile::isTestVectorFile(testFile)) {
+                vectors = std::make_unique<fuzz::TestVectorFile>(testFile);
+                if(vectors->cpuId() != M6800_CPU_ID)
+                    throw fuzz::FuzzerException("test vectors are not for the M6800");
             }
             else {
-                emu::M6800Fuzzer<emu::M6800<>, M6800TestCore> fuzzer(element, strictMode);
-                if (fuzzer.execute()) {
-                    std::cerr << "Stopped on error." << std::endl;
-                    std::clog << count << " tests run." << std::endl;
+                std::ifstream f(testFile);
+                if(!f) {
+                    std::cerr << "Couldn't read test file: '" << testFile << "'" << std::endl;
                     exit(1);
                 }
+                data = json::parse(f);
             }
-            count++;
+        }
+        catch(std::exception& ex) {
+            std::cerr << "Couldn't load test file '" << testFile << "': " << ex.what() << std::endl;
+            exit(1);
+        }
+        auto numTests = vectors ? vectors->size() : data.size();
+        auto loadTest = [&](size_t index) {
+            if(vectors) {
+                auto record = vectors->record(index);
+                return emu::FuzzState(record);
+            }
+            return emu::FuzzState(data.at(index));
+        };
+        auto start = std::chrono::steady_clock::now();
+        bool success = useRefAsTest ? replayTests<emu::M6800<>>(numTests, loadTest, threads, strictMode) : replayTests<M6800TestCore>(numTests, loadTest, threads, strictMode);
+        if(!success) {
+            std::cerr << "Stopped on error." << std::endl;
+            std::clog << g_testCaseCount << " tests run." << std::endl;
+            exit(1);
         }
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
-        std::cout << fmt::format("Executed {} test cases successfully. [{:.2f}s]", count, (double)duration / 1000.0) << std::endl;
+        std::cout << fmt::format("Executed {} test cases successfully. [{:.2f}s]", g_testCaseCount.load(), (double)duration / 1000.0) << std::endl;
     }
     else {
-        std::clog << "Running opcode fuzzing tests, 100000 fuzzed tests each, skipping invalid opcodes..." << std::endl;
-        uint8_t firstOpcode = opcodeToTest >= 0 ? opcodeToTest : 0;
-        uint8_t lastOpcode = opcodeToTest >= 0 ? opcodeToTest : 255;
+        std::clog << fmt::format("Running opcode fuzzing tests, {} fuzzed tests each, skipping invalid opcodes...", rounds) << std::endl;
+        std::vector<uint8_t> opcodes;
+        for(int opcode = 0; opcode < 256; ++opcode) {
+            if((opcodeToTest < 0 || opcode == opcodeToTest) && emu::M6800<>::isValidOpcode(opcode))
+                opcodes.push_back(opcode);
+        }
         auto start = std::chrono::steady_clock::now();
         if(outputDir == "-")
             std::cout << "[" << std::endl;
-        for (uint16_t opcode = firstOpcode; opcode <= lastOpcode; ++opcode) {
-            std::clog << fmt::format("    Opcode: {:02x}\r", opcode);
-            std::clog.flush();
-            if (emu::M6800<>::isValidOpcode(opcode)) {
-                if (testRef) {
-                    testOpcode<emu::M6800<>, emu::M6800<>>(opcode, rounds, strictMode, outputDir);
-                }
-                else {
-                    testOpcode<emu::M6800<>, M6800TestCore>(opcode, rounds, strictMode, outputDir);
-                }
-            }
-        }
+        bool success = testRef ? testOpcodes<emu::M6800<>, emu::M6800<>>(opcodes, rounds, seed, threads, strictMode, outputDir, format)
+                                    : testOpcodes<emu::M6800<>, M6800TestCore>(opcodes, rounds, seed, threads, strictMode, outputDir, format);
         if(outputDir == "-")
-            std::cout << "]" << std::endl;
+            std::cout << std::endl << "]" << std::endl;
+        if(!success) {
+            std::clog << g_testCaseCount << " tests run." << std::endl;
+            exit(1);
+        }
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
-        std::clog << fmt::format("{} tests run, no errors. [{:.2f}s]", g_testCaseCount, (double)duration / 1000.0) << std::endl;
+        std::clog << fmt::format("{} tests run, no errors. [{:.2f}s]", g_testCaseCount.load(), (double)duration / 1000.0) << std::endl;
     }
     exit(0);
 
@@ -0,0 +1,61 @@
+//---------------------------------------------------------------------------------------
+// test/scheduler_test.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+
+#include <doctest/doctest.h>
+
+#include <emulation/scheduler.hpp>
+
+#include <vector>
+
+using namespace emu;
+
+TEST_CASE("Scheduler - runs due events in cycle order")
+{
+    Scheduler scheduler;
+    std::vector<int> fired;
+    auto a = scheduler.registerEvent([&](cycles_t) { fired.push_back(0); });
+    auto b = scheduler.registerEvent([&](cycles_t) { fired.push_back(1); });
+    Scheduler::EventId c{};
+    c = scheduler.registerEvent([&](cycles_t now) { fired.push_back(2); scheduler.schedule(c, now + 100); });
+    CHECK(scheduler.nextDue() == Scheduler::NEVER);
+    scheduler.schedule(a, 50);
+    scheduler.schedule(b, 20);
+    scheduler.schedule(c, 20);
+    CHECK(scheduler.nextDue() == 20);
+    CHECK_FALSE(scheduler.isDue(19));
+    scheduler.runDue(30);
+    CHECK(fired == std::vector<int>{1, 2});
+    CHECK(scheduler.nextDue() == 50);
+    scheduler.schedule(a, 200);  // moves the event instead of queuing it twice
+    scheduler.runDue(150);
+    CHECK(fired == std::vector<int>{1, 2, 2});
+    scheduler.cancel(c);
+    CHECK_FALSE(scheduler.isScheduled(c));
+    CHECK(scheduler.isScheduled(a));
+    scheduler.runDue(1000);
+    CHECK(fired == std::vector<int>{1, 2, 2, 0});
+    CHECK(scheduler.nextDue() == Scheduler::NEVER);
+}
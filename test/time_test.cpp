@@ -86,6 +86,24 @@ TEST_CASE("Time - difference")
     }
 }
 
+TEST_CASE("Time - collected cycles")
+{
+    ClockedTime a{1760640}, b{1760640};
+    Time t;
+    for(int i = 0; i < 1000000; ++i) {
+        a.addCycles(7);
+        t.addCycles(7, 1760640);
+    }
+    b.addCycles(7000000);
+    CHECK(a.seconds() == t.seconds());
+    CHECK(a.ticks() == t.ticks());
+    CHECK(b.seconds() == t.seconds());
+    CHECK(b.ticks() == t.ticks());
+    CHECK(a.asClockTicks() == 7000000);
+    CHECK(a.cyclesFromMicroseconds(1000000) == 1760640);
+    CHECK(a.microsecondsFromCycles(1760640) == 1000000);
+}
+
 TEST_CASE("Emulation timing")
 {
     {
@@ -0,0 +1,177 @@
+//---------------------------------------------------------------------------------------
+// test/tracefile_test.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+
+#include <doctest/doctest.h>
+
+#include "chip8adapter.hpp"
+
+#include <emulation/chip8emulatorbase.hpp>
+#include <emulation/chip8realcorebase.hpp>
+#include <emulation/chip8vip.hpp>
+#include <emulation/hardware/cdp1802.hpp>
+#include <emulation/tracefile.hpp>
+#include <emulation/utility.hpp>
+
+using namespace emu;
+
+TEST_CASE("TraceFile - packed records round trip")
+{
+    TraceRecord record{};
+    record.formatter = &Chip8EmulatorBase::formatTraceRecord;
+    record.cycle = 0x123456789;
+    record.frame = 0x1234;
+    record.frameCycle = 42;
+    record.source = Logger::eCHIP8;
+    record.pc = 0x2fe;
+    record.code[0] = 0xd0;
+    record.code[1] = 0x15;
+    for(int i = 0; i < 16; ++i)
+        record.chip8.v[i] = i * 3;
+    record.chip8.i = 0x345;
+    record.chip8.sp = 2;
+    uint8_t packed[TraceFile::RECORD_SIZE];
+    TraceFile::packRecord(record, packed);
+    TraceRecord unpacked;
+    REQUIRE(TraceFile::unpackRecord(packed, unpacked));
+    CHECK(unpacked.cycle == record.cycle);
+    CHECK(unpacked.frame == record.frame);
+    CHECK(unpacked.format() == record.format());
+    CHECK(TraceFile::opcodeOf(unpacked) == 0xd015);
+    TraceFile::packRecord(TraceRecord{}, packed);
+    CHECK_FALSE(TraceFile::unpackRecord(packed, unpacked));
+}
+
+TEST_CASE("TraceFile - interleaved sources keep unwrapped frames")
+{
+    // CPU, CHIP-8 and video records of a real core share one frame counter that wraps at 16 bit
+    auto filename = (fs::temp_directory_path() / "cadmium-tracefile-test.c8t").string();
+    TraceWriter writer;
+    REQUIRE(writer.open(filename));
+    TraceRecord record{};
+    uint64_t cycle = 0;
+    for(uint32_t frame = 0xfff0; frame < 0x10010; ++frame) {
+        record.frame = uint16_t(frame);
+        record.formatter = &Cdp1802<>::formatTraceRecord;
+        record.source = Logger::eBACKEND_EMU;
+        record.marker = TraceRecord::eVSYNC;
+        record.cycle = cycle++;
+        writer.write(record);
+        for(int i = 0; i < 1000; ++i) {
+            record.formatter = &Cdp1802<>::formatTraceRecord;
+            record.marker = TraceRecord::eINSTRUCTION;
+            record.cycle = cycle++;
+            writer.write(record);
+            record.formatter = &Chip8RealCoreBase::formatChip8TraceRecord;
+            record.source = Logger::eCHIP8;
+            record.cycle = cycle++;
+            writer.write(record);
+            record.source = Logger::eBACKEND_EMU;
+        }
+    }
+    REQUIRE(writer.close());
+    TraceReader reader;
+    REQUIRE(reader.open(filename));
+    REQUIRE(reader.chunks().size() > 1);
+    CHECK(reader.chunks().front().firstFrame == 0xfff0);
+    CHECK(reader.chunks().back().lastFrame == 0x1000f);
+    uint64_t count = 0;
+    while(reader.next(record)) {
+        if(reader.frame() != 0xfff0 + (count / 2001)) {
+            FAIL("record " << count << " has frame " << reader.frame());
+        }
+        ++count;
+    }
+    CHECK(count == reader.records());
+    CHECK(count == cycle);
+    reader.seekFrame(0x10005);
+    REQUIRE(reader.next(record));
+    CHECK(reader.frame() == 0x10005);
+    CHECK(record.marker == TraceRecord::eVSYNC);
+    CHECK(uint64_t(record.cycle) == (0x10005 - 0xfff0) * 2001);
+    reader.close();
+    fs::remove(filename);
+}
+
+TEST_CASE("TraceFile - cycle ranges of a mixed VIP trace")
+{
+    // CHIP-8 records count instructions, CPU and video records count clock cycles
+    auto options = Chip8EmulatorOptions::optionsOfPreset(Chip8EmulatorOptions::eCHIP8VIP);
+    options.optTraceLog = true;
+    Chip8HeadlessTestHost host(options);
+    std::unique_ptr<IChip8Emulator> chip8 = std::make_unique<Chip8VIP>(host, options);
+    auto filename = (fs::temp_directory_path() / "cadmium-tracefile-vip-test.c8t").string();
+    TraceWriter writer;
+    REQUIRE(writer.open(filename));
+    Logger::setLogger(&writer);
+    chip8->reset();
+    chip8->memory()[0x200] = 0x70;
+    chip8->memory()[0x201] = 0x01;
+    chip8->memory()[0x202] = 0x12;
+    chip8->memory()[0x203] = 0x00;
+    chip8->setExecMode(IChip8Emulator::eRUNNING);
+    for(int frame = 0; frame < 10; ++frame)
+        chip8->tick(1);
+    Logger::setLogger(nullptr);
+    REQUIRE(writer.close());
+    TraceReader reader;
+    REQUIRE(reader.open(filename));
+    std::vector<uint64_t> chip8Cycles;
+    TraceRecord record;
+    while(reader.next(record)) {
+        if(record.source == Logger::eCHIP8)
+            chip8Cycles.push_back(uint64_t(record.cycle));
+    }
+    REQUIRE(chip8Cycles.size() > 100);
+    auto from = chip8Cycles[chip8Cycles.size() / 2], to = from + 20;
+    uint64_t expected = 0, expectedChip8 = 0;
+    reader.seekCycle(0);
+    while(reader.next(record)) {
+        if(uint64_t(record.cycle) >= from && uint64_t(record.cycle) <= to) {
+            ++expected;
+            expectedChip8 += record.source == Logger::eCHIP8;
+        }
+    }
+    CHECK(expectedChip8 == 21);
+    uint64_t found = 0, foundChip8 = 0;
+    bool passedRange = false, chip8AfterPassed = false;
+    reader.seekCycle(from);
+    while(reader.next(record)) {
+        REQUIRE(uint64_t(record.cycle) >= from);
+        if(uint64_t(record.cycle) > to) {
+            passedRange = true;
+            continue;
+        }
+        ++found;
+        foundChip8 += record.source == Logger::eCHIP8;
+        chip8AfterPassed = chip8AfterPassed || (passedRange && record.source == Logger::eCHIP8);
+    }
+    CHECK(found == expected);
+    CHECK(foundChip8 == expectedChip8);
+    // records of the clock counting sources exceed the range long before the CHIP-8 ones
+    CHECK(chip8AfterPassed);
+    reader.close();
+    fs::remove(filename);
+}
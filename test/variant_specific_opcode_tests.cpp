@@ -26,9 +26,15 @@
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
 #include "chip8adapter.hpp"
 #include "chip8testhelper.hpp"
 
+#include <emulation/inputrecording.hpp>
+
 TEST_SUITE_BEGIN(C8CORE "VariantOpcodes");
 
 TEST_CASE(C8CORE "8xy6 - vx >>= vy, lost bit in vF, this shift test expects vy to be used")
@@ -161,4 +167,77 @@ TEST_CASE(C8CORE "8xyE - vx <<= vx, lost bit in vF, this shift test expects vy t
     }
 }
 
+TEST_CASE(C8CORE "Cxnn - input replay reproduces random numbers")
+{
+    EmuCore chip8, replay;
+    SUBCASE("SUPER-CHIP 1.1") {
+        chip8 = createChip8Instance(C8TV_SC11);
+        replay = createChip8Instance(C8TV_SC11);
+    }
+    SUBCASE("XO-CHIP") {
+        chip8 = createChip8Instance(C8TV_XO);
+        replay = createChip8Instance(C8TV_XO);
+    }
+    if(chip8 && replay) {
+        // store random bytes to 0x300 and up, libc rand() must not leak into the result
+        const auto program = {0x6101, 0xA300, 0xC0FF, 0xF055, 0xF11E, 0x1204};
+        chip8->reset();
+        chip8->setRandomState(0xC0FFEE);
+        write(chip8, 0x200, program);
+        emu::InputRecording recording;
+        recording.start(emu::Chip8EmulatorOptions{}, "0123456789abcdef0123456789abcdef01234567", chip8->getRandomSeed(), chip8->getRandomState());
+        std::srand(1);
+        for(int i = 0; i < 200; ++i) {
+            recording.addFrame(0);
+            step(chip8);
+        }
+        recording.finish(*chip8);
+        std::vector<uint8_t> data;
+        REQUIRE(recording.serialize(data));
+        emu::InputRecording loaded;
+        REQUIRE(loaded.deserialize(data.data(), data.size()));
+        replay->reset();
+        replay->setRandomSeed(loaded.randomSeed());
+        replay->setRandomState(loaded.randomState());
+        write(replay, 0x200, program);
+        std::srand(2);
+        for(uint64_t frame = 0; frame < loaded.frames(); ++frame)
+            step(replay);
+        CHECK(loaded.matchesEnd(*replay));
+        CHECK(std::memcmp(chip8->memory() + 0x300, replay->memory() + 0x300, 50) == 0);
+        CHECK(std::any_of(chip8->memory() + 0x300, chip8->memory() + 0x332, [](uint8_t val) { return val != 0; }));
+    }
+    else {
+        MESSAGE("feature not supported");
+    }
+}
+
+TEST_CASE(C8CORE "Watchpoints - XO-CHIP range stores and loads")
+{
+    EmuCore chip8;
+    SUBCASE("XO-CHIP") {
+        chip8 = createChip8Instance(C8TV_XO);
+    }
+    if(chip8) {
+        chip8->reset();
+        write(chip8, 0x200, {0xA300, 0x6042, 0x6143, 0x5012, 0xA310, 0x5103, 0x120C});
+        chip8->setWatchpoint(0x301, emu::GenericCpu::eWATCH_WRITE);
+        chip8->setWatchpoint(0x311, emu::GenericCpu::eWATCH_READ);
+        chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+        chip8->executeFor(20000);
+        CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+        CHECK(chip8->isBreakpointTriggered());
+        CHECK(chip8->memory()[0x301] == 0x43);
+        CHECK(chip8->getPC() <= 0x208);
+        chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+        chip8->executeFor(20000);
+        CHECK(chip8->getExecMode() == emu::IChip8Emulator::ePAUSED);
+        CHECK(chip8->isBreakpointTriggered());
+        CHECK(chip8->getPC() <= 0x20C);
+    }
+    else {
+        MESSAGE("feature not supported");
+    }
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,127 @@
+//---------------------------------------------------------------------------------------
+// test/vip_test.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//---------------------------------------------------------------------------------------
+
+#include <doctest/doctest.h>
+
+#include "chip8adapter.hpp"
+#include "chip8testhelper.hpp"
+
+#include <emulation/chip8vip.hpp>
+#include <emulation/tracefile.hpp>
+#include <emulation/utility.hpp>
+
+#include <cstring>
+
+TEST_CASE("VIP HLE - native instructions keep interpreter state and timing")
+{
+    auto options = emu::Chip8EmulatorOptions::optionsOfPreset(emu::Chip8EmulatorOptions::eCHIP8VIP);
+    auto hleOptions = options;
+    hleOptions.advanced["hle"] = true;
+    Chip8HeadlessTestHost host(options);
+    std::unique_ptr<emu::IChip8Emulator> real = std::make_unique<emu::Chip8VIP>(host, options);
+    std::unique_ptr<emu::IChip8Emulator> hle = std::make_unique<emu::Chip8VIP>(host, hleOptions);
+    for(auto* chip8 : {&real, &hle}) {
+        (*chip8)->reset();
+        // counting loop, timers, call with ALU, BCD and register store
+        write(*chip8, 0x200, {0x6005, 0x6103, 0x7B03, 0x8CB0, 0x7CFF, 0x3C00, 0x1208, 0xF015, 0xF118, 0xF207, 0x2220, 0x1204});
+        write(*chip8, 0x220, {0x83B4, 0x84B6, 0xA400, 0xF333, 0xA410, 0xF355, 0x00EE});
+        (*chip8)->setExecMode(emu::IChip8Emulator::eRUNNING);
+    }
+    for(int frame = 0; frame < 120; ++frame) {
+        real->tick(1);
+        hle->tick(1);
+        INFO("frame " << frame);
+        REQUIRE(hle->dumpStateLine() == real->dumpStateLine());
+        REQUIRE(hle->getMachineCycles() == real->getMachineCycles());
+    }
+    CHECK(std::memcmp(hle->memory() + 0x400, real->memory() + 0x400, 0x14) == 0);
+}
+
+TEST_CASE("VIP HLE - save states keep the fast path disabled")
+{
+    auto options = emu::Chip8EmulatorOptions::optionsOfPreset(emu::Chip8EmulatorOptions::eCHIP8VIP);
+    options.advanced["hle"] = true;
+    Chip8HeadlessTestHost host(options);
+    std::unique_ptr<emu::IChip8Emulator> chip8 = std::make_unique<emu::Chip8VIP>(host, options);
+    std::unique_ptr<emu::IChip8Emulator> restored = std::make_unique<emu::Chip8VIP>(host, options);
+    chip8->reset();
+    restored->reset();
+    // calling machine code in program space turns the fast path off for the session
+    write(chip8, 0x200, {0x0206, 0x7001, 0x1202, 0xD400});
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    chip8->tick(1);
+    std::vector<uint8_t> state;
+    REQUIRE(chip8->saveState(state));
+    REQUIRE(restored->loadState(state.data(), state.size()));
+    restored->setExecMode(emu::IChip8Emulator::eRUNNING);
+    for(int frame = 0; frame < 30; ++frame) {
+        chip8->tick(1);
+        restored->tick(1);
+        INFO("frame " << frame);
+        REQUIRE(restored->dumpStateLine() == chip8->dumpStateLine());
+        REQUIRE(restored->getMachineCycles() == chip8->getMachineCycles());
+    }
+    std::vector<uint8_t> original, reloaded;
+    REQUIRE(chip8->saveState(original));
+    REQUIRE(restored->saveState(reloaded));
+    CHECK(original == reloaded);
+}
+
+TEST_CASE("VIP Trace - CPU, CHIP-8 and video records share the frame counter")
+{
+    auto options = emu::Chip8EmulatorOptions::optionsOfPreset(emu::Chip8EmulatorOptions::eCHIP8VIP);
+    options.optTraceLog = true;
+    Chip8HeadlessTestHost host(options);
+    std::unique_ptr<emu::IChip8Emulator> chip8 = std::make_unique<emu::Chip8VIP>(host, options);
+    auto filename = (emu::fs::temp_directory_path() / "cadmium-vip-trace-test.c8t").string();
+    emu::TraceWriter writer;
+    REQUIRE(writer.open(filename));
+    emu::Logger::setLogger(&writer);
+    chip8->reset();
+    write(chip8, 0x200, {0x7001, 0x1200});
+    chip8->setExecMode(emu::IChip8Emulator::eRUNNING);
+    for(int frame = 0; frame < 5; ++frame)
+        chip8->tick(1);
+    emu::Logger::setLogger(nullptr);
+    REQUIRE(writer.close());
+    emu::TraceReader reader;
+    REQUIRE(reader.open(filename));
+    emu::TraceRecord record;
+    uint64_t lastFrame = 0, vsyncs = 0, chip8Records = 0;
+    while(reader.next(record)) {
+        REQUIRE(reader.frame() >= lastFrame);
+        lastFrame = reader.frame();
+        vsyncs += record.marker == emu::TraceRecord::eVSYNC;
+        chip8Records += record.source == emu::Logger::eCHIP8;
+    }
+    CHECK(vsyncs > 0);
+    CHECK(chip8Records > 0);
+    CHECK(lastFrame == uint64_t(chip8->frames()));
+    REQUIRE_FALSE(reader.chunks().empty());
+    CHECK(reader.chunks().back().lastFrame == lastFrame);
+    reader.close();
+    emu::fs::remove(filename);
+}
@@ -0,0 +1,221 @@
+//---------------------------------------------------------------------------------------
+// tools/c8trace.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/tracefile.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ghc/cli.hpp>
+#include <fmt/format.h>
+
+struct Range
+{
+    uint64_t from{0};
+    uint64_t to{UINT64_MAX};
+    bool contains(uint64_t val) const { return val >= from && val <= to; }
+};
+
+static bool parseRange(const std::string& text, Range& range)
+{
+    if(text.empty())
+        return true;
+    char* end = nullptr;
+    range.from = std::strtoull(text.c_str(), &end, 0);
+    if(*end == '-')
+        range.to = std::strtoull(end + 1, &end, 0);
+    else
+        range.to = range.from;
+    return *end == 0 && range.from <= range.to;
+}
+
+struct Filter
+{
+    Range pc;
+    Range opcode;
+    Range cycle;
+    Range frame;
+    bool matches(const emu::TraceRecord& record, uint64_t frameVal) const
+    {
+        return pc.contains(record.pc) && opcode.contains(emu::TraceFile::opcodeOf(record)) && cycle.contains(uint64_t(record.cycle)) && frame.contains(frameVal);
+    }
+};
+
+// Only the frame ends the search early, the cycle unit differs between record sources
+// (CHIP-8 instructions vs. CPU clock cycles on the real cores), so a record past the
+// cycle range can be followed by matching records of another source.
+static bool nextMatching(emu::TraceReader& reader, const Filter& filter, emu::TraceRecord& record)
+{
+    while(reader.next(record)) {
+        if(reader.frame() > filter.frame.to)
+            return false;
+        if(filter.matches(record, reader.frame()))
+            return true;
+    }
+    return false;
+}
+
+static bool openTrace(emu::TraceReader& reader, const std::string& file, const Filter& filter)
+{
+    if(!reader.open(file)) {
+        std::cerr << "ERROR: " << reader.errorMessage() << std::endl;
+        return false;
+    }
+    if(filter.frame.from)
+        reader.seekFrame(filter.frame.from);
+    else
+        reader.seekCycle(filter.cycle.from);
+    return true;
+}
+
+static std::string formatLine(const emu::TraceReader& reader, const emu::TraceRecord& record)
+{
+    return fmt::format("{:>10} {:>8}:{:04x} {}", reader.recordIndex(), reader.frame(), record.frameCycle, record.format());
+}
+
+static int showInfo(const std::string& file)
+{
+    emu::TraceReader reader;
+    if(!reader.open(file)) {
+        std::cerr << "ERROR: " << reader.errorMessage() << std::endl;
+        return EXIT_FAILURE;
+    }
+    uint64_t compressed = 0;
+    for(const auto& chunk : reader.chunks()) {
+        compressed += chunk.compressedSize;
+    }
+    std::cout << "Records: " << reader.records() << ", chunks: " << reader.chunks().size() << ", compressed: " << compressed << " bytes" << std::endl;
+    if(!reader.chunks().empty()) {
+        const auto& first = reader.chunks().front();
+        const auto& last = reader.chunks().back();
+        uint64_t minCycle = UINT64_MAX, maxCycle = 0;
+        for(const auto& chunk : reader.chunks()) {
+            minCycle = std::min(minCycle, chunk.firstCycle);
+            maxCycle = std::max(maxCycle, chunk.lastCycle);
+        }
+        std::cout << "Cycles: " << minCycle << "-" << maxCycle << ", frames: " << first.firstFrame << "-" << last.lastFrame << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int dumpTrace(const std::string& file, const Filter& filter, int64_t limit)
+{
+    emu::TraceReader reader;
+    if(!openTrace(reader, file, filter))
+        return EXIT_FAILURE;
+    emu::TraceRecord record;
+    while((limit < 0 || limit--) && nextMatching(reader, filter, record)) {
+        std::cout << formatLine(reader, record) << "\n";
+    }
+    std::cout << std::flush;
+    return reader.errorMessage().empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool sameRecord(const emu::TraceRecord& a, const emu::TraceRecord& b)
+{
+    uint8_t packedA[emu::TraceFile::RECORD_SIZE];
+    uint8_t packedB[emu::TraceFile::RECORD_SIZE];
+    emu::TraceFile::packRecord(a, packedA);
+    emu::TraceFile::packRecord(b, packedB);
+    return std::memcmp(packedA, packedB, emu::TraceFile::RECORD_SIZE) == 0;
+}
+
+static int diffTraces(const std::string& fileA, const std::string& fileB, const Filter& filter, int64_t context)
+{
+    emu::TraceReader readerA, readerB;
+    if(!openTrace(readerA, fileA, filter) || !openTrace(readerB, fileB, filter))
+        return EXIT_FAILURE;
+    std::deque<std::string> history;
+    emu::TraceRecord recordA, recordB;
+    uint64_t compared = 0;
+    while(true) {
+        bool hasA = nextMatching(readerA, filter, recordA);
+        bool hasB = nextMatching(readerB, filter, recordB);
+        if(!hasA && !hasB) {
+            std::cout << "Traces are identical (" << compared << " records compared)" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if(hasA && hasB && sameRecord(recordA, recordB)) {
+            history.push_back(formatLine(readerA, recordA));
+            if(int64_t(history.size()) > context)
+                history.pop_front();
+            ++compared;
+            continue;
+        }
+        std::cout << "Traces differ after " << compared << " identical records:" << std::endl;
+        for(const auto& line : history) {
+            std::cout << "  " << line << std::endl;
+        }
+        std::cout << "< " << (hasA ? formatLine(readerA, recordA) : std::string("<end of trace>")) << std::endl;
+        std::cout << "> " << (hasB ? formatLine(readerB, recordB) : std::string("<end of trace>")) << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ghc::CLI cli(argc, argv);
+    std::vector<std::string> files;
+    bool info = false;
+    bool diff = false;
+    std::string pcRange, opcodeRange, cycleRange, frameRange;
+    int64_t limit = -1;
+    int64_t context = 5;
+    cli.option({"-i", "--info"}, info, "Show record count, cycle and frame range of the trace file");
+    cli.option({"-d", "--diff"}, diff, "Compare two trace files and show the first difference");
+    cli.option({"--pc"}, pcRange, "Only records with a PC in the given range (e.g. 0x200-0x2ff)");
+    cli.option({"--opcode"}, opcodeRange, "Only records with an opcode in the given range (e.g. 0xd000-0xdfff), 16 bit for CHIP-8, 8 bit for CPU records");
+    cli.option({"--cycles"}, cycleRange, "Only records within the given cycle range");
+    cli.option({"--frames"}, frameRange, "Only records within the given frame range");
+    cli.option({"-n", "--limit"}, limit, "Maximum number of records to dump");
+    cli.option({"--context"}, context, "Number of identical records shown before a difference, default: 5");
+    cli.positional(files, "trace file(s), two are needed for --diff");
+    try {
+        cli.parse();
+    }
+    catch(std::exception& ex) {
+        std::cerr << "ERROR: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    Filter filter;
+    if(!parseRange(pcRange, filter.pc) || !parseRange(opcodeRange, filter.opcode) || !parseRange(cycleRange, filter.cycle) || !parseRange(frameRange, filter.frame)) {
+        std::cerr << "ERROR: ranges must be given as <from>-<to> or a single value" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(files.size() != (diff ? 2 : 1)) {
+        std::cerr << "ERROR: " << (diff ? "two trace files are" : "a trace file is") << " needed, see --help" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(info)
+        return showInfo(files.front());
+    if(diff)
+        return diffTraces(files[0], files[1], filter, context);
+    return dumpTrace(files.front(), filter, limit);
+}
@@ -0,0 +1,497 @@
+//---------------------------------------------------------------------------------------
+// tools/cadmium-bench.cpp
+//---------------------------------------------------------------------------------------
+//
+// Copyright (c) 2024, Steffen Schümann <s.schuemann@pobox.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <emulation/chip8cores.hpp>
+#include <emulation/chip8dream.hpp>
+#include <emulation/chip8strict.hpp>
+#include <emulation/chip8vip.hpp>
+#include <emulation/utility.hpp>
+#include <chiplet/octocompiler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ghc/cli.hpp>
+#include <nlohmann/json.hpp>
+#include <fmt/format.h>
+
+using Preset = emu::Chip8EmulatorOptions::SupportedPreset;
+using Clock = std::chrono::steady_clock;
+
+static constexpr int AUDIO_SAMPLE_RATE = 44100;
+static constexpr int CONVERT_LOOPS = 100;
+
+class BenchHost : public emu::Chip8EmulatorHost
+{
+public:
+    ~BenchHost() override = default;
+    bool isHeadless() const override { return true; }
+    int getKeyPressed() override { return 0; }
+    bool isKeyDown(uint8_t key) override { return false; }
+    const std::array<bool,16>& getKeyStates() const override { static const std::array<bool,16> keys{}; return keys; }
+    void updateScreen() override {}
+    void vblank() override {}
+    void updatePalette(const std::array<uint8_t,16>& palette) override {}
+    void updatePalette(const std::vector<uint32_t>& palette, size_t offset) override {}
+};
+
+enum Engine { eFP, eTS, eSTRICT, eVIP, eDREAM, eNUM_ENGINES };
+static const char* engineNames[eNUM_ENGINES] = {"fp", "ts", "strict", "vip", "dream"};
+
+struct Workload
+{
+    std::string name;
+    std::vector<uint8_t> image;
+    Preset preset{Preset::eCHIP8};
+    int instructionsPerDraw{0};
+};
+
+struct BenchConfig
+{
+    int repetitions{5};
+    int warmup{1};
+    int frames{300};
+    int instructionsPerFrame{1000};
+    std::string engineFilter;
+    std::string presetFilter;
+};
+
+struct RunSample
+{
+    int64_t instructions{0};
+    int64_t skippedCycles{-1};
+    double createTime{0};
+    double mips{0};
+    double fps{0};
+    double drawsPerSecond{0};
+    double convertTime{0};
+    double audioTime{0};
+};
+
+//---------------------------------------------------------------------------------------
+// Core creation mirrors Chip8EmuHostEx::create but lets the engine be chosen freely
+//---------------------------------------------------------------------------------------
+template<uint16_t addressLines>
+static std::unique_ptr<emu::IChip8Emulator> createTemplatedCore(emu::Chip8EmulatorHost& host, emu::Chip8EmulatorOptions& options)
+{
+    using namespace emu;
+    switch((options.optAllowHires ? HiresSupport : 0) | (options.optAllowColors ? MultiColor : 0) | (options.optWrapSprites ? WrapSprite : 0)) {
+        case HiresSupport | MultiColor | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | MultiColor | WrapSprite>>(host, options);
+        case HiresSupport | MultiColor: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | MultiColor>>(host, options);
+        case HiresSupport | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, HiresSupport | WrapSprite>>(host, options);
+        case HiresSupport: return std::make_unique<Chip8Emulator<addressLines, HiresSupport>>(host, options);
+        case MultiColor | WrapSprite: return std::make_unique<Chip8Emulator<addressLines, MultiColor | WrapSprite>>(host, options);
+        case MultiColor: return std::make_unique<Chip8Emulator<addressLines, MultiColor>>(host, options);
+        case WrapSprite: return std::make_unique<Chip8Emulator<addressLines, WrapSprite>>(host, options);
+        default: return std::make_unique<Chip8Emulator<addressLines, 0>>(host, options);
+    }
+}
+
+static std::unique_ptr<emu::IChip8Emulator> createCore(Engine engine, emu::Chip8EmulatorHost& host, emu::Chip8EmulatorOptions& options)
+{
+    switch(engine) {
+        case eTS: return options.optHas16BitAddr ? createTemplatedCore<16>(host, options) : createTemplatedCore<12>(host, options);
+        case eSTRICT: return std::make_unique<emu::Chip8StrictEmulator>(host, options);
+        case eVIP: return std::make_unique<emu::Chip8VIP>(host, options);
+        case eDREAM: return std::make_unique<emu::Chip8Dream>(host, options);
+        default: return std::make_unique<emu::Chip8EmulatorFP>(host, options);
+    }
+}
+
+static std::vector<Engine> enginesForPreset(Preset preset)
+{
+    switch(preset) {
+        case Preset::eCHIP8:
+        case Preset::eCHIP10:
+        case Preset::eCHIP48:
+        case Preset::eSCHIP10:
+        case Preset::eSCHIP11:
+        case Preset::eSCHPC:
+        case Preset::eSCHIP_MODERN:
+        case Preset::eXOCHIP:
+            return {eFP, eTS};
+        case Preset::eCHIP8TE:
+            return {eSTRICT};
+        case Preset::eCHIP8VIP:
+        case Preset::eCHIP8VIP_TPD:
+        case Preset::eCHIP8VIP_FPD:
+        case Preset::eCHIP8EVIP:
+        case Preset::eCHIP8XVIP:
+        case Preset::eCHIP8XVIP_TPD:
+        case Preset::eCHIP8XVIP_FPD:
+        case Preset::eRAWVIP:
+            return {eVIP};
+        case Preset::eCHIP8DREAM:
+        case Preset::eC8D68CHIPOSLO:
+            return {eDREAM};
+        case Preset::ePORTABLE:
+        case Preset::eNUM_PRESETS:
+            return {};
+        default:
+            return {eFP};
+    }
+}
+
+//---------------------------------------------------------------------------------------
+// Synthetic kernels, all of them loop forever so every run executes the same code
+//---------------------------------------------------------------------------------------
+static std::vector<uint8_t> opcodeImage(std::initializer_list<uint16_t> opcodes)
+{
+    std::vector<uint8_t> image;
+    for(auto opcode : opcodes) {
+        image.push_back(opcode >> 8);
+        image.push_back(opcode & 0xff);
+    }
+    return image;
+}
+
+static std::vector<Workload> syntheticKernels()
+{
+    std::vector<Workload> kernels;
+    // register arithmetic only
+    kernels.push_back({"kernel/alu", opcodeImage({0x6001, 0x6103, 0x8014, 0x8105, 0x8206, 0x7201, 0x8E23, 0x1204})});
+    // one 8x15 sprite every four instructions, the code itself is the sprite data
+    kernels.push_back({"kernel/draw", opcodeImage({0xA200, 0xD01F, 0x7003, 0x7105, 0x1202}), Preset::eCHIP8, 4});
+    // bulk register stores/loads and a subroutine call
+    kernels.push_back({"kernel/memory", opcodeImage({0xA300, 0xF355, 0xF365, 0x2210, 0x1200, 0x0000, 0x0000, 0x0000, 0x00EE})});
+    // keeps the sound timer running so audio rendering produces a tone
+    kernels.push_back({"kernel/audio", opcodeImage({0x60FF, 0xF018, 0xF015, 0x1202})});
+    return kernels;
+}
+
+//---------------------------------------------------------------------------------------
+// ROM corpus, binaries get their preset from the extension, sources from the directory
+//---------------------------------------------------------------------------------------
+static bool presetForExtension(const std::string& ext, Preset& preset)
+{
+    if(ext == ".ch8") preset = Preset::eCHIP8;
+    else if(ext == ".ch10") preset = Preset::eCHIP10;
+    else if(ext == ".hc8") preset = Preset::eCHIP8VIP;
+    else if(ext == ".c8h") preset = Preset::eCHIP8VIP_TPD;
+    else if(ext == ".c8e") preset = Preset::eCHIP8EVIP;
+    else if(ext == ".c8x") preset = Preset::eCHIP8XVIP;
+    else if(ext == ".sc8") preset = Preset::eSCHIP11;
+    else if(ext == ".mc8") preset = Preset::eMEGACHIP;
+    else if(ext == ".xo8") preset = Preset::eXOCHIP;
+    else return false;
+    return true;
+}
+
+static Preset presetForSource(const emu::fs::path& file)
+{
+    auto dir = emu::toLower(file.parent_path().filename().string());
+    if(dir.find("megachip") != std::string::npos)
+        return Preset::eMEGACHIP;
+    if(dir.find("schip") != std::string::npos)
+        return Preset::eSCHIP_MODERN;
+    if(dir == "chip8" || dir == "chip-8")
+        return Preset::eCHIP8;
+    return Preset::eXOCHIP;
+}
+
+static void collectFiles(const emu::fs::path& path, std::vector<emu::fs::path>& files)
+{
+    std::error_code ec;
+    if(emu::fs::is_directory(path, ec)) {
+        for(auto& de : emu::fs::recursive_directory_iterator(path, ec)) {
+            if(de.is_regular_file())
+                files.push_back(de.path());
+        }
+    }
+    else if(emu::fs::is_regular_file(path, ec)) {
+        files.push_back(path);
+    }
+}
+
+static std::vector<Workload> loadCorpus(const std::vector<std::string>& paths)
+{
+    std::vector<emu::fs::path> files;
+    for(const auto& path : paths) {
+        collectFiles(path, files);
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<std::string> binaryStems;
+    for(const auto& file : files) {
+        Preset preset;
+        if(presetForExtension(emu::toLower(file.extension().string()), preset))
+            binaryStems.push_back(file.stem().string());
+    }
+    std::vector<Workload> corpus;
+    for(const auto& file : files) {
+        Workload workload;
+        workload.name = file.generic_string();
+        auto ext = emu::toLower(file.extension().string());
+        if(presetForExtension(ext, workload.preset)) {
+            workload.image = emu::loadFile(file.string(), 65536);
+        }
+        else if(ext == ".8o") {
+            // the assembled binary of a source is already part of the corpus
+            if(std::find(binaryStems.begin(), binaryStems.end(), file.stem().string()) != binaryStems.end())
+                continue;
+            // sources in include directories are libraries, not programs
+            auto parent = file.parent_path();
+            if(std::find(parent.begin(), parent.end(), emu::fs::path("inc")) != parent.end())
+                continue;
+            emu::OctoCompiler compiler;
+            if(compiler.compile(file.string()).resultType != emu::CompileResult::eOK) {
+                std::cerr << "WARNING: could not compile '" << file.string() << "', skipped" << std::endl;
+                continue;
+            }
+            workload.preset = presetForSource(file);
+            workload.image.assign(compiler.code(), compiler.code() + compiler.codeSize());
+        }
+        else {
+            continue;
+        }
+        if(workload.image.empty()) {
+            std::cerr << "WARNING: could not load '" << file.string() << "', skipped" << std::endl;
+            continue;
+        }
+        corpus.push_back(std::move(workload));
+    }
+    return corpus;
+}
+
+//---------------------------------------------------------------------------------------
+// Measurement
+//---------------------------------------------------------------------------------------
+static double elapsedMicroseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static RunSample runOnce(const BenchConfig& config, Engine engine, Preset preset, const Workload& workload)
+{
+    RunSample sample;
+    BenchHost host;
+    auto options = emu::Chip8EmulatorOptions::optionsOfPreset(preset);
+    if(config.instructionsPerFrame > 0)
+        options.instructionsPerFrame = config.instructionsPerFrame;
+    // the draw kernel measures sprite throughput, not the time spent in display wait
+    if(workload.instructionsPerDraw)
+        options.optInstantDxyn = true;
+
+    auto start = Clock::now();
+    auto core = createCore(engine, host, options);
+    core->reset();
+    std::memcpy(core->memory() + options.startAddress, workload.image.data(), std::min(workload.image.size(), size_t(core->memSize() - options.startAddress)));
+    sample.createTime = elapsedMicroseconds(start);
+
+    auto cyclesBefore = core->getCycles();
+    const auto* realCore = dynamic_cast<const emu::Chip8RealCoreBase*>(core.get());
+    auto skippedBefore = realCore ? realCore->skippedCycles() : 0;
+    auto framesBefore = core->frames();
+    start = Clock::now();
+    for(int frame = 0; frame < config.frames; ++frame) {
+        core->tick(options.instructionsPerFrame);
+    }
+    auto seconds = elapsedMicroseconds(start) / 1000000.0;
+    sample.instructions = core->getCycles() - cyclesBefore;
+    if(realCore)
+        sample.skippedCycles = realCore->skippedCycles() - skippedBefore;
+    if(seconds > 0) {
+        sample.mips = double(sample.instructions) / seconds / 1000000.0;
+        sample.fps = double(core->frames() - framesBefore) / seconds;
+        if(workload.instructionsPerDraw)
+            sample.drawsPerSecond = double(sample.instructions) / workload.instructionsPerDraw / seconds;
+    }
+
+    std::vector<uint32_t> pixels(emu::Chip8EmulatorBase::MAX_SCREEN_WIDTH * emu::Chip8EmulatorBase::MAX_SCREEN_HEIGHT);
+    start = Clock::now();
+    for(int i = 0; i < CONVERT_LOOPS; ++i) {
+        if(const auto* screen = core->getScreen())
+            screen->convert(pixels.data(), emu::Chip8EmulatorBase::MAX_SCREEN_WIDTH, 255, nullptr);
+        else if(const auto* screenRGBA = core->getScreenRGBA())
+            screenRGBA->convert(pixels.data(), emu::Chip8EmulatorBase::MAX_SCREEN_WIDTH, core->getScreenAlpha(), core->getWorkRGBA());
+    }
+    sample.convertTime = elapsedMicroseconds(start) / CONVERT_LOOPS;
+
+    std::vector<int16_t> samples(AUDIO_SAMPLE_RATE / 60);
+    start = Clock::now();
+    for(int frame = 0; frame < config.frames; ++frame) {
+        core->renderAudio(samples.data(), samples.size(), AUDIO_SAMPLE_RATE);
+    }
+    sample.audioTime = elapsedMicroseconds(start) / std::max(config.frames, 1);
+    return sample;
+}
+
+static nlohmann::ordered_json statistics(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    auto n = values.size();
+    double mean = 0;
+    for(auto val : values) {
+        mean += val;
+    }
+    mean /= n;
+    double variance = 0;
+    for(auto val : values) {
+        variance += (val - mean) * (val - mean);
+    }
+    variance = n > 1 ? variance / (n - 1) : 0;
+    auto median = n & 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    return {{"median", median}, {"min", values.front()}, {"max", values.back()}, {"mean", mean}, {"stddev", std::sqrt(variance)}};
+}
+
+static nlohmann::ordered_json benchmark(const BenchConfig& config, Engine engine, Preset preset, const Workload& workload)
+{
+    for(int i = 0; i < config.warmup; ++i) {
+        runOnce(config, engine, preset, workload);
+    }
+    std::vector<RunSample> runs;
+    for(int i = 0; i < config.repetitions; ++i) {
+        runs.push_back(runOnce(config, engine, preset, workload));
+    }
+    auto collect = [&runs](double RunSample::*member) {
+        std::vector<double> values;
+        for(const auto& run : runs) {
+            values.push_back(run.*member);
+        }
+        return statistics(values);
+    };
+    nlohmann::ordered_json result;
+    result["workload"] = workload.name;
+    result["engine"] = engineNames[engine];
+    result["preset"] = emu::Chip8EmulatorOptions::shortNameOfPreset(preset);
+    result["instructions"] = runs.front().instructions;
+    if(runs.front().skippedCycles >= 0)
+        result["skipped_cycles"] = runs.front().skippedCycles;
+    auto& metrics = result["metrics"];
+    metrics["create_us"] = collect(&RunSample::createTime);
+    metrics["mips"] = collect(&RunSample::mips);
+    metrics["fps"] = collect(&RunSample::fps);
+    if(workload.instructionsPerDraw)
+        metrics["draws_per_s"] = collect(&RunSample::drawsPerSecond);
+    metrics["convert_us"] = collect(&RunSample::convertTime);
+    metrics["audio_frame_us"] = collect(&RunSample::audioTime);
+    std::clog << fmt::format("{:<6} {:<13} {:<48} {:>9.2f} MIPS {:>9.1f} fps", engineNames[engine], result["preset"].get<std::string>(), workload.name, metrics["mips"]["median"].get<double>(), metrics["fps"]["median"].get<double>()) << std::endl;
+    return result;
+}
+
+static bool isSelected(const BenchConfig& config, Engine engine, Preset preset)
+{
+    if(!config.engineFilter.empty() && emu::toLower(config.engineFilter) != engineNames[engine])
+        return false;
+    return config.presetFilter.empty() || emu::toLower(config.presetFilter) == emu::toLower(emu::Chip8EmulatorOptions::shortNameOfPreset(preset));
+}
+
+static std::string currentTimestamp()
+{
+    auto now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buffer;
+}
+
+int main(int argc, char* argv[])
+{
+    ghc::CLI cli(argc, argv);
+    std::vector<std::string> corpusPaths;
+    std::string outputFile;
+    int64_t repetitions = 5;
+    int64_t warmup = 1;
+    int64_t frames = 300;
+    int64_t instructionsPerFrame = 1000;
+    std::string engineFilter, presetFilter;
+    bool kernelsOnly = false;
+    cli.option({"-o", "--output"}, outputFile, "Write the JSON results into the given file instead of stdout");
+    cli.option({"-r", "--repetitions"}, repetitions, "Number of measured runs per benchmark, default: 5");
+    cli.option({"-w", "--warmup"}, warmup, "Number of discarded warmup runs per benchmark, default: 1");
+    cli.option({"-f", "--frames"}, frames, "Number of frames emulated per run, default: 300");
+    cli.option({"--ipf"}, instructionsPerFrame, "Instructions per frame for the generic cores, default: 1000");
+    cli.option({"--engine"}, engineFilter, "Only benchmark the given engine (fp, ts, strict, vip or dream)");
+    cli.option({"--preset"}, presetFilter, "Only benchmark the given preset by short name (e.g. schip11)");
+    cli.option({"--kernels-only"}, kernelsOnly, "Only run the synthetic kernels, skip the ROM corpus");
+    cli.positional(corpusPaths, "ROM files or directories of the corpus, default: test-roms examples");
+    try {
+        cli.parse();
+    }
+    catch(std::exception& ex) {
+        std::cerr << "ERROR: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(repetitions < 1 || warmup < 0 || frames < 1) {
+        std::cerr << "ERROR: repetitions and frames need to be at least one" << std::endl;
+        return EXIT_FAILURE;
+    }
+    BenchConfig config;
+    config.repetitions = int(repetitions);
+    config.warmup = int(warmup);
+    config.frames = int(frames);
+    config.instructionsPerFrame = int(instructionsPerFrame);
+    config.engineFilter = engineFilter;
+    config.presetFilter = presetFilter;
+    if(corpusPaths.empty())
+        corpusPaths = {"test-roms", "examples"};
+
+    nlohmann::ordered_json results = nlohmann::ordered_json::array();
+    for(const auto& kernel : syntheticKernels()) {
+        for(int preset = 0; preset < Preset::eNUM_PRESETS; ++preset) {
+            // raw VIP mode has no CHIP-8 interpreter to run the kernels
+            if(preset == Preset::eRAWVIP)
+                continue;
+            for(auto engine : enginesForPreset(Preset(preset))) {
+                if(isSelected(config, engine, Preset(preset)))
+                    results.push_back(benchmark(config, engine, Preset(preset), kernel));
+            }
+        }
+    }
+    if(!kernelsOnly) {
+        for(const auto& rom : loadCorpus(corpusPaths)) {
+            for(auto engine : enginesForPreset(rom.preset)) {
+                if(isSelected(config, engine, rom.preset))
+                    results.push_back(benchmark(config, engine, rom.preset, rom));
+            }
+        }
+    }
+
+    nlohmann::ordered_json report;
+    report["tool"] = "cadmium-bench";
+    report["version"] = CADMIUM_VERSION;
+    report["timestamp"] = currentTimestamp();
+    report["config"] = {{"repetitions", config.repetitions}, {"warmup", config.warmup}, {"frames", config.frames}, {"ipf", config.instructionsPerFrame}, {"convertLoops", CONVERT_LOOPS}, {"audioSampleRate", AUDIO_SAMPLE_RATE}};
+    report["results"] = results;
+    if(outputFile.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    }
+    else {
+        std::ofstream out(outputFile);
+        out << report.dump(2) << std::endl;
+        if(!out) {
+            std::cerr << "ERROR: could not write '" << outputFile << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}